@@ -0,0 +1,41 @@
+#ifndef ALLOCATIONCHECK_HPP
+#define ALLOCATIONCHECK_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+// Heap allocations counted for one operation
+struct AllocationResult {
+    std::string operation;
+    std::uint64_t calls = 0;
+    std::uint64_t allocations = 0;
+
+    // Checks if the operation ran without allocating
+    bool passed() const { return allocations == 0; }
+};
+
+// Class guarding the booking hot paths against heap allocations.
+// AllocationCheck.cpp replaces the global operator new so that every
+// allocation bumps a per-thread counter. The replacement is only compiled
+// with CCM_ALLOCATION_CHECK defined (make allocation-check builds such a
+// binary), so regular builds keep the standard allocator. The check builds a small synthetic
+// facility (long usernames, so short-string storage cannot hide a copy),
+// warms every operation up once so metric slots and vector capacities exist,
+// then repeats availability checks, cost calculation, ticket purchase and
+// cancellation, the payment lookup, payment, refund and the overlap check,
+// and reports any operation that still allocates in this steady state.
+class AllocationCheck {
+public:
+    // Checks if this build counts allocations
+    static bool available();
+    // Returns the number of heap allocations made so far by the calling thread
+    static std::uint64_t allocationCount();
+    // Runs every hot path calls times and returns the allocations counted for each
+    static std::vector<AllocationResult> run(std::uint64_t calls = 1000);
+    // Prints the results as a table
+    static void print(std::ostream& out, const std::vector<AllocationResult>& results);
+};
+
+#endif // ALLOCATIONCHECK_HPP
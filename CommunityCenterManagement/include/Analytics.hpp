@@ -0,0 +1,64 @@
+#ifndef ANALYTICS_HPP
+#define ANALYTICS_HPP
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include "Snapshot.hpp"
+
+// Utilization aggregates of one calendar day, or of the whole dataset once merged
+struct UtilizationTotals {
+    static const int kHoursPerWeek = 7 * 24;
+    static const int kFillBuckets = 11;  // 0-9%, 10-19%, ..., 90-99%, full
+    static const int kLayouts = 4;       // By LayoutStyle
+
+    long long bookedMinutes[kHoursPerWeek] = {};  // Minutes booked per hour of the week, Monday 00:00 first
+    long long events = 0;
+    long long ticketsSold = 0;
+    long long capacity = 0;                       // Sum of maxGuests
+    long long fillHistogram[kFillBuckets] = {};   // Events by fill rate (ticketsSold / maxGuests)
+    long long layoutEvents[kLayouts] = {};
+    long long layoutMinutes[kLayouts] = {};
+    long long canceledReservations = 0;
+    long long endedReservations = 0;              // Not canceled, event already over
+    long long noShows = 0;                        // Ended reservations that were never paid
+
+    // Adds another set of aggregates to this one
+    void add(const UtilizationTotals& other);
+};
+
+// Utilization and occupancy report over all dated events
+struct AnalyticsReport {
+    UtilizationTotals totals;
+    long long firstDay = 0;         // First and last day with events (days since the epoch)
+    long long lastDay = -1;
+    size_t days = 0;
+    size_t daysRecomputed = 0;      // Days aggregated again in this refresh
+    std::uint64_t snapshotVersion = 0;
+    unsigned threadsUsed = 0;
+    double milliseconds = 0.0;
+
+    // Returns the number of weeks the report spans
+    long long weeks() const;
+    // Prints the report as text
+    void print(std::ostream& out) const;
+    // Writes the report as CSV ("section,key,value" rows), returning false if the file cannot be written
+    bool writeCsv(const std::string& filename) const;
+};
+
+// Class computing utilization analytics from schedule snapshots.
+// Aggregates are kept per calendar day. A refresh compares the day
+// fingerprints of the snapshot with those seen last time and re-aggregates
+// only days that changed (or whose events have ended since, which turns
+// their reservations into shows or no-shows); the changed days are split into
+// contiguous ranges, one per worker thread, each producing per-day partial
+// histograms that are merged into the report at the end.
+class Analytics {
+public:
+    // Refreshes the report from a snapshot split into up to threads ranges run on the shared task pool (0 for one per pool thread)
+    static AnalyticsReport refresh(const ScheduleSnapshot& snapshot, unsigned threads = 0);
+    // Forgets the cached day aggregates
+    static void reset();
+};
+
+#endif // ANALYTICS_HPP
@@ -0,0 +1,57 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <functional>
+#include "Event.hpp"
+
+// Outcome of moving closed periods into the archive
+struct ArchiveResult {
+    int segments = 0;
+    int events = 0;
+    int reservations = 0;
+};
+
+// Reservation totals of one archived month
+struct MonthRevenue {
+    std::string month;  // YYYY-MM
+    int reservations = 0;
+    int paidReservations = 0;
+    double revenue = 0.0;
+};
+
+// Class keeping closed periods out of the live data files.
+// Events that ended before a cutoff move, together with all of their
+// reservations, into immutable per-month segment files under data/archive
+// (one "<YYYY-MM>.seg" per month, "<YYYY-MM>.<n>.seg" if a month is archived
+// again later). A segment is a sequence of independently compressed blocks of
+// "E <event record>" and "R <reservation record>" lines, so queries stream
+// over it one block at a time. data/archive/manifest.txt lists the segments.
+// The live events.txt and reservations.txt then only hold open periods.
+//
+// With a horizon set (--archive-months), archiving also keeps running: each
+// time the clock enters a new month, tick() hands the new cutoff to the
+// archiver, which saves the data, archives and reloads the live files.
+class Archive {
+public:
+    // Returns the first minute of the month months months before the one containing now
+    static long long monthCutoff(long long now, int months);
+    // Keeps archiving periods more than months months back while running; archiver returns false if it could not run yet
+    static void setHorizon(int months, long long appliedCutoff, const std::function<bool(long long cutoff)>& archiver);
+    // Runs the archiver when the horizon has moved into another month since the last run
+    static void tick(long long now);
+
+    // Moves events that ended before cutoff (minutes since the epoch) and their reservations into segments
+    static ArchiveResult archiveBefore(long long cutoff, std::map<std::string, Event*>& events);
+    // Prints the archived reservations of a user, returning how many were found
+    static size_t printUserHistory(const std::string& username, std::ostream& out);
+    // Computes reservation counts and revenue of every archived month
+    static std::vector<MonthRevenue> revenueByMonth();
+    // Returns the highest archived reservation ID (0 if there is none)
+    static int maxReservationID();
+};
+
+#endif // ARCHIVE_HPP
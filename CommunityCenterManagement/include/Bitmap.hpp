@@ -0,0 +1,69 @@
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Compressed bitmap over row numbers (Roaring layout).
+// Rows are split into chunks of 65536 by their high 16 bits. A chunk with
+// few rows stores them as a sorted array of 16-bit values, a dense chunk as a
+// 65536-bit bitset, whichever is smaller, and empty chunks are not stored.
+// Set operations work chunk by chunk with a specialized loop per pair of
+// container kinds, so their cost follows the compressed size, not the row count.
+class Bitmap {
+public:
+    // Returns a bitmap holding the rows [0, count)
+    static Bitmap range(std::uint32_t count);
+
+    // Adds a row; rows must be added in increasing order
+    void add(std::uint32_t row);
+    // Adds a row in any order
+    void insert(std::uint32_t row);
+    // Removes a row
+    void remove(std::uint32_t row);
+    // Checks if a row is set
+    bool contains(std::uint32_t row) const;
+    // Returns the number of rows set
+    size_t cardinality() const;
+    // Checks if no row is set
+    bool empty() const { return chunks.empty(); }
+    // Returns the bytes used by the containers
+    size_t memoryUsage() const;
+    // Appends the rows set, in increasing order, up to limit rows (0 for all)
+    void collect(std::vector<std::uint32_t>& rows, size_t limit = 0) const;
+
+    // Returns the rows set in both bitmaps
+    static Bitmap intersect(const Bitmap& a, const Bitmap& b);
+    // Returns the rows set in either bitmap
+    static Bitmap unite(const Bitmap& a, const Bitmap& b);
+    // Returns the rows set in a but not in b
+    static Bitmap subtract(const Bitmap& a, const Bitmap& b);
+
+private:
+    // Rows of one 65536-row chunk, as a sorted array or as a bitset
+    struct Chunk {
+        std::uint16_t key = 0;
+        std::uint32_t count = 0;
+        std::vector<std::uint16_t> array;  // Used while count <= kArrayLimit
+        std::vector<std::uint64_t> bits;   // 1024 words otherwise
+
+        bool isBitset() const { return !bits.empty(); }
+    };
+
+    // Largest chunk kept as an array (4096 rows take as much space as the bitset)
+    static const std::uint32_t kArrayLimit = 4096;
+
+    std::vector<Chunk> chunks;  // Ordered by key
+
+    // Converts an array chunk to a bitset
+    static void toBitset(Chunk& chunk);
+    // Converts a bitset chunk back to an array if that is smaller
+    static void shrink(Chunk& chunk);
+    // Combines two chunks with the same key
+    static Chunk intersectChunks(const Chunk& a, const Chunk& b);
+    static Chunk uniteChunks(const Chunk& a, const Chunk& b);
+    static Chunk subtractChunks(const Chunk& a, const Chunk& b);
+};
+
+#endif // BITMAP_HPP
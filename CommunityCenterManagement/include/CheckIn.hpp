@@ -0,0 +1,118 @@
+#ifndef CHECKIN_HPP
+#define CHECKIN_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <cstdint>
+#include "Snapshot.hpp"
+
+// Minimal perfect hash over a fixed set of reservation IDs (hash and displace).
+// Keys are split into buckets of about four; buckets are placed largest first,
+// each trying displacement seeds until all its keys land on distinct free
+// slots. A lookup is two hashes and one key comparison, and the table has
+// exactly one slot per key.
+class PerfectHash {
+public:
+    // Builds the hash over distinct keys, returning false if they could not be placed
+    bool build(const std::vector<std::uint32_t>& keys);
+    // Returns the slot of a key (0 to size() - 1), or -1 if it is not one of the keys
+    long long lookup(std::uint32_t key) const;
+    // Returns the number of keys
+    size_t size() const { return keys.size(); }
+
+private:
+    std::vector<std::uint32_t> seeds;  // Displacement seed of every bucket
+    std::vector<std::uint32_t> keys;   // Key stored in every slot
+
+    // Mixes a key with a seed
+    static std::uint32_t hash(std::uint32_t key, std::uint32_t seed);
+};
+
+// Outcome of scanning a reservation at the door
+enum class CheckInResult {
+    Admitted,
+    AlreadyCheckedIn,
+    WrongEvent,
+    Canceled,
+    NotFound
+};
+
+// Door check-in state of one event.
+// Opening the event hashes its reservations with a perfect hash and restores
+// earlier arrivals from the check-in journal; a scan is then a hash lookup
+// and an atomic claim of the reservation's arrival time, so several scanners
+// can share one session and a reservation is admitted exactly once. IDs the
+// hash does not know are classified from the schedule snapshot (bookings made
+// after the doors opened are admitted through a small locked table). Every
+// scan is appended to the journal, data/checkins.log, as
+//   <time> <event> <reservationID> <user> <guests> <outcome>
+class CheckInSession {
+public:
+    // Opens the doors of an event of a snapshot, replaying its journaled arrivals
+    CheckInSession(const ScheduleSnapshot& snapshot, const EventSnapshot& event);
+
+    // Scans a reservation at minute now; snapshot is the caller's current view of the schedule
+    CheckInResult scan(int reservationID, long long now, const ScheduleSnapshot& snapshot, std::string& message);
+
+    // Checks if a reservation was hashed when the doors opened
+    bool knows(int reservationID) const { return hash.lookup(static_cast<std::uint32_t>(reservationID)) >= 0; }
+    // Returns the event name
+    const std::string& getEventName() const { return eventName; }
+    // Returns the number of guests checked in
+    int getHeadcount() const { return headcount.load(std::memory_order_relaxed); }
+    // Returns the maximum number of guests of the event
+    int getMaxGuests() const { return maxGuests; }
+    // Returns the number of reservations hashed when the doors opened
+    size_t getReservationCount() const { return entries.size(); }
+    // Checks if the session still describes an event: same times, organizer and capacity
+    bool describes(const EventSnapshot& event) const;
+
+private:
+    // Reservation as it was when the doors opened
+    struct Entry {
+        int reservationID;
+        std::string username;
+        int guests;
+        ReservationStatus reservationStatus;
+        PaymentStatus paymentStatus;
+    };
+
+    std::string eventName;
+    std::string organizer;
+    long long startMinute;
+    long long endMinute;
+    int maxGuests;
+    std::uint64_t openedVersion;  // Snapshot version the entries were copied from
+    PerfectHash hash;
+    std::vector<Entry> entries;   // By hash slot
+    std::unique_ptr<std::atomic<long long>[]> arrivals;  // Arrival minute by hash slot, 0 until checked in
+    std::atomic<int> headcount;
+
+    std::mutex lateMutex;
+    std::map<int, long long> lateArrivals;  // Arrivals of reservations booked after opening
+
+    // Appends one scan to the journal
+    void journal(long long now, int reservationID, const std::string& username, int guests, const char* outcome);
+    // Admits an entry if it has not arrived yet
+    CheckInResult admit(std::atomic<long long>& arrival, long long now, int reservationID, const std::string& username, int guests,
+                        ReservationStatus status, PaymentStatus payment, std::string& message);
+};
+
+// Class keeping the open check-in sessions
+class CheckIn {
+public:
+    // Returns the session of an event, opening its doors on first use (nullptr if the event is unknown).
+    // A session is reopened once its event was canceled, moved or recreated; reopening replays the journal.
+    static std::shared_ptr<CheckInSession> open(const std::string& eventName, const ScheduleSnapshot& snapshot);
+    // Closes every session (after the data was reloaded)
+    static void closeAll();
+    // Returns the number of guests a reservation snapshot admits
+    static int guestsOf(const ReservationSnapshot& reservation, const EventSnapshot& event);
+};
+
+#endif // CHECKIN_HPP
@@ -0,0 +1,20 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <string>
+#include <cstddef>
+
+// Small built-in LZ77 block codec used for archive segments.
+// A block is a list of sequences: a token byte (literal count in the high
+// nibble, match length - 4 in the low nibble, 15 meaning "more length bytes
+// follow"), the literals, then a two-byte little-endian back-reference
+// offset. The last sequence only carries literals. Archive records repeat
+// usernames, event names, statuses and timestamps, which this captures well
+// without an external dependency.
+
+// Compresses a block (back-references reach at most 64 KiB back)
+std::string compressBlock(const char* data, size_t size);
+// Decompresses a block produced by compressBlock, returning false if it is corrupt or not rawSize bytes long
+bool decompressBlock(const char* data, size_t size, size_t rawSize, std::string& output);
+
+#endif // CODEC_HPP
@@ -0,0 +1,40 @@
+#ifndef COMPLEXITYCHECK_HPP
+#define COMPLEXITYCHECK_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Measured scaling of one operation
+struct ScalingResult {
+    std::string operation;
+    double budget;                   // Largest allowed exponent
+    std::vector<size_t> sizes;
+    std::vector<double> nanoseconds; // Per operation (or per call for whole-dataset operations) at every size
+    double exponent = 0;             // Fitted slope of log(time) over log(size)
+
+    // Checks if the fitted exponent is within the budget
+    bool passed() const { return exponent <= budget; }
+};
+
+// Class guarding the hot paths against complexity regressions.
+// Every operation runs on synthetic datasets (users, events, reservations)
+// of geometrically increasing size; the scaling exponent k of time ~ n^k is
+// fitted by least squares over log(time) and log(n), and compared with a
+// declared budget: lookups and updates must stay logarithmic or better
+// (k <= 0.6; log n alone fits well below that at these sizes, the margin
+// absorbs cache misses as the data outgrows the caches), whole-file saves
+// must stay linear (k <= 1.3). A linear scan reintroduced on a lookup
+// path shows up as k near 1, a quadratic save as k near 2.
+// The datasets live in memory only; the save is written to a temporary file.
+class ComplexityCheck {
+public:
+    // Runs every operation at sizes from minSize doubling up to maxSize and returns the results
+    static std::vector<ScalingResult> run(size_t minSize = 1024, size_t maxSize = 16384);
+    // Prints the results as a table
+    static void print(std::ostream& out, const std::vector<ScalingResult>& results);
+    // Fits the exponent of time ~ size^k
+    static double fitExponent(const std::vector<size_t>& sizes, const std::vector<double>& times);
+};
+
+#endif // COMPLEXITYCHECK_HPP
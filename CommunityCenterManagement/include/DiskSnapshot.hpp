@@ -0,0 +1,57 @@
+#ifndef DISKSNAPSHOT_HPP
+#define DISKSNAPSHOT_HPP
+
+#include <string>
+#include <map>
+#include <ostream>
+#include <cstdint>
+#include "User.hpp"
+#include "Event.hpp"
+#include "Reservation.hpp"
+#include "FacilityManager.hpp"
+
+// Counters of the snapshots taken by this process
+struct DiskSnapshotStats {
+    std::uint64_t started = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t failed = 0;
+    std::uint64_t lastPauseNanoseconds = 0;  // Time the caller was blocked by the last fork
+    std::uint64_t maxPauseNanoseconds = 0;
+    std::uint64_t lastWriteNanoseconds = 0;  // Time the last child spent writing
+    std::uint64_t lastReservations = 0;      // Reservations in the last completed snapshot
+    std::string lastDirectory;               // Last completed snapshot
+};
+
+// Class taking copy-on-write snapshots of the data in the background.
+// start() forks: the child serializes its frozen copy of the users, events,
+// recurring series and reservations (archived ones merged in) into
+// data/snapshots/<YYYY-MM-DDTHH-MM>.partial, renames it to the final
+// directory once every file is written and exits; the parent only pays for
+// the fork itself and goes on serving. The child reports the outcome through
+// a pipe; tick() collects it, reaps the child, records the completed
+// directory in data/snapshots/latest and starts the next scheduled snapshot
+// when one is due. One snapshot runs at a time.
+//
+// Pause (fork) and write times are recorded as the snapshot_fork and
+// snapshot_write metrics and kept in the stats.
+class DiskSnapshot {
+public:
+    // Takes a snapshot every interval minutes from tick() (0 disables scheduling)
+    static void setInterval(int minutes);
+    // Forks a child writing a snapshot; returns false with a message if one is running or the fork failed
+    static bool start(FacilityManager& facilityManager, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events,
+                      const std::map<int, Reservation*>& reservations, std::string& message);
+    // Collects a finished snapshot and starts a scheduled one if due at minute now
+    static void tick(long long now, FacilityManager& facilityManager, const std::map<std::string, User*>& users,
+                     const std::map<std::string, Event*>& events, const std::map<int, Reservation*>& reservations);
+    // Waits for a running snapshot to finish (at shutdown)
+    static void finish();
+    // Checks if a snapshot is being written
+    static bool isRunning();
+    // Returns the counters of this process
+    static DiskSnapshotStats getStats();
+    // Prints the counters
+    static void printStats(std::ostream& out);
+};
+
+#endif // DISKSNAPSHOT_HPP
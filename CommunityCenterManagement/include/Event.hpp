@@ -5,8 +5,10 @@
 #include <vector>
 #include <map>
 #include <ctime> 
+#include <cstdint>
 #include "User.hpp"
 #include "Reservation.hpp"
+#include "SeatMap.hpp"
 
 // Enum class for different layout styles for an event
 enum class LayoutStyle {
@@ -40,8 +42,14 @@ public:
     int getMaxGuests() const;                   
     // Get the ticket price for the event 
     double getTicketPrice() const;               
+    // Get the number of tickets sold for the event
+    int getTicketsSold() const;
+    // Get the waitlist for the event
+    const std::vector<User*>& getWaitlist() const;
     // Get the reservations for the event
-    const std::vector<Reservation*>& getReservations() const; 
+    std::vector<Reservation*> getReservations() const;  // Resolves the handles, skipping destroyed reservations
+    // Get the render version: a process-wide stamp taken at the event's last visible change
+    std::uint64_t getVersion() const;
     // Check if the event is open to residents
     bool isOpenToResidents() const;      
     // Check if the event is open to non-residents        
@@ -52,32 +60,62 @@ public:
     void getEventDetails() const;          
     // Print detailed view of the event      
     void getDetailedView() const;            
-    // Handle ticket purchase for a user   
-    void purchaseTicket(User* user); 
-    // Handle ticket cancellation for a user            
-    void cancelTicket(User* user);            
+    // Handle ticket purchase for a user (count tickets for a group), describing the outcome in message
+    void purchaseTicket(User* user, int count, std::string& message);
+    // Sell one ticket to each of the first admitted buyers in one step and waitlist the rest in order
+    void admitBatch(const std::vector<User*>& buyers, size_t admitted);
+    // Handle ticket cancellation for a user (count tickets for a group), describing the outcome in message
+    void cancelTicket(User* user, int count, std::string& message);
+    // Forget every sold ticket and the waitlist, once all the event's reservations were dropped
+    void clearAttendance();
+    // Book the waiting reservations in waitlist order, seats included, while the free capacity lasts, returning them
+    std::vector<Reservation*> promoteFromWaitlist();
     // Add a reservation to the event  
     void addReservation(Reservation* reservation); 
+    // Remove a reservation from the event
+    void removeReservation(Reservation* reservation);
     // Add a user to the waitlist
     void addToWaitlist(User* user); 
     // Remove a user from the waitlist             
     void removeFromWaitlist(User* user);    
     // Check if the event is within operating hours     
     bool isWithinOperatingHours(const std::string& startTime, const std::string& endTime) const; 
+    // Check if already parsed times (minutes since the epoch) are within operating hours
+    static bool isWithinOperatingHours(long long start, long long end);
     // Check if the reservation time is within event time
     bool isWithinEventTime(const std::string& reservationTime) const; 
+    // Check if the event's layout assigns seats
+    bool hasAssignedSeating() const;
+    // Get the seat occupancy of the event (empty for open seating)
+    const SeatMap& getSeatMap() const;
+    // Find and occupy the best available seats for a group, returning false if there are not enough
+    bool allocateSeats(int count, std::vector<SeatBlock>& blocks);
+    // Occupy specific seats, returning false (and occupying none) if any is taken
+    bool claimSeats(const std::vector<SeatBlock>& blocks);
+    // Free seats again
+    void releaseSeats(const std::vector<SeatBlock>& blocks);
+    // Format seats as labels such as "C5-C8"
+    std::string formatSeats(const std::vector<SeatBlock>& blocks) const;
+    // Take a new render version (the mutators do; the schedule does when the event moves in or out of a day)
+    void markChanged();
 
     // Setters
     // Set if the event is open to residents
     void setOpenToResidents(bool openToResidents);   
     // Set if the event is open to non-residents    
     void setOpenToNonResidents(bool openToNonResidents); 
+    // Move the event to new times (use Schedule::rescheduleEvent for scheduled events)
+    void reschedule(const std::string& startTime, const std::string& endTime);
 
     // Static Functions
+    // Hand out the next render version, larger than every version handed out before
+    static std::uint64_t nextVersion();
     // Load events from a file
     static std::map<std::string, Event*> loadEvents(const std::string& filename, const std::map<std::string, User*>& users); 
+    // Format the event as one line of the event file
+    std::string formatRecord() const;
     // Save events to a file
-    static void saveEvents(const std::string& filename, const std::map<std::string, Event*>& events); 
+    static bool saveEvents(const std::string& filename, const std::map<std::string, Event*>& events); 
 
 private:
     // Name of the event
@@ -105,7 +143,11 @@ private:
     // Waitlist of users for the event
     std::vector<User*> waitlist;  
     // Reservations for the event
-    std::vector<Reservation*> reservations; 
+    std::vector<ReservationHandle> reservations;  // Handles into the reservation slot map
+    // Seat occupancy for layouts with assigned seats
+    SeatMap seatMap;
+    // Render version, bumped by every change shown in the event and schedule views
+    std::uint64_t version;
 
     // Helper function to parse time strings: Parse a time string into a std::tm structure
     bool parseTime(const std::string& timeStr, struct std::tm& time) const; 
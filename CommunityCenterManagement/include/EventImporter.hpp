@@ -0,0 +1,34 @@
+#ifndef EVENTIMPORTER_HPP
+#define EVENTIMPORTER_HPP
+
+#include <string>
+#include <map>
+#include "Event.hpp"
+#include "User.hpp"
+#include "Schedule.hpp"
+
+// Outcome of a bulk import
+struct ImportResult {
+    int accepted = 0;   // Rows committed as new events
+    int rejected = 0;   // Rows written to the reject report
+    bool committed = false;  // Whether the accepted rows were saved
+};
+
+// Class importing many events at once.
+// All rows are parsed first, then sorted together with the existing events by
+// start time and checked in a single sweep, instead of running
+// checkAvailability (and a full save) once per event.
+//
+// Input rows are comma separated:
+//   eventName,organizer,startTime,endTime,layoutStyle,isPublic,maxGuests,ticketPrice,openToResidents,openToNonResidents
+// A header line starting with "eventName" and lines starting with '#' are skipped.
+// Existing events always win a conflict; between two imported rows the one
+// starting first wins.
+class EventImporter {
+public:
+    // Imports events from a file, commits the clean rows with one save and writes rejects to reportFilename
+    static ImportResult importEvents(const std::string& filename, const std::string& reportFilename,
+                                     std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule);
+};
+
+#endif // EVENTIMPORTER_HPP
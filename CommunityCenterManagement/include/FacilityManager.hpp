@@ -14,6 +14,10 @@ public:
 
     // Adds an event to the facility manager
     void addEvent(Event* event);   
+    // Removes an event from the facility manager and schedule (the caller frees it)
+    void removeEvent(Event* event);
+    // Removes every event and recurring series from the facility manager and schedule (the caller frees them)
+    void clearEvents();
     // Creates a new event
     void createEvent(std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule); 
     // Cancels an existing event  
@@ -0,0 +1,64 @@
+#ifndef FLASHSALE_HPP
+#define FLASHSALE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "User.hpp"
+#include "Event.hpp"
+#include "Reservation.hpp"
+#include "Schedule.hpp"
+
+// Purchase request waiting in the flash-sale queue
+struct FlashSaleRequest {
+    User* user;
+    std::string eventName;
+    std::string reservationTime;
+    int requester = -1;          // Whoever waits for the outcome (the server's connection), -1 for the menu
+    std::uint64_t serial = 0;    // Tells apart requesters that reuse the same descriptor
+};
+
+// Outcome of a request once its batch was admitted
+struct FlashSaleOutcome {
+    FlashSaleRequest request;
+    Reservation* reservation = nullptr;  // nullptr if the booking rules refused the request
+    bool waitlisted = false;             // The reservation was made but the event was sold out
+    std::string message;
+};
+
+// Class selling tickets of designated hot events in batches.
+// When a popular event opens, every buyer would otherwise contend on the
+// same ticket counter and trigger a full reservation save. Purchase requests
+// for a flash-sale event are queued first-come-first-served instead and
+// admitted in fixed-size batches, one batch per server tick: the batch is
+// checked against the booking rules in arrival order, the free tickets of
+// each event are handed to the first buyers in one step, the remaining
+// buyers join the waitlist in order, and the whole batch is saved once and
+// appended to the flash-sale journal (data/flash_sale.log) in one write.
+// The cost per request stays flat however many buyers pile up.
+//
+// Flash-sale events are read from a policy file of lines
+//   batch <size>
+//   event <eventName>
+// where an event line naming a recurring series covers all its occurrences.
+// Without a policy file no event is a flash sale.
+class FlashSale {
+public:
+    // Loads the flash-sale events and the batch size; a missing file turns flash sales off
+    static void loadPolicy(const std::string& filename);
+    // Checks if requests for an event go through the queue
+    static bool isFlashSale(const std::string& eventName);
+    // Returns the number of requests admitted per batch
+    static size_t batchSize();
+
+    // Appends a request to the queue
+    static void enqueue(const FlashSaleRequest& request);
+    // Returns the number of requests waiting
+    static size_t queued();
+    // Admits the next batch, appending one outcome per request in queue order; returns how many reservations were made
+    static size_t admitBatch(Schedule& schedule, std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations,
+                             std::vector<FlashSaleOutcome>& outcomes);
+};
+
+#endif // FLASHSALE_HPP
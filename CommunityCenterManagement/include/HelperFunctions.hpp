@@ -3,33 +3,100 @@
 
 #include <iostream>
 #include <map>
+#include <string>
+#include <memory>
 #include "User.hpp"
 #include "Event.hpp"
 #include "Reservation.hpp"
 #include "FacilityManager.hpp"
+#include "RecurringEvent.hpp"
+
+class CheckInSession;
 
 // Function declarations for various helper functions
 // Prints the main menu
 void printMenu();   
 // Handles the creation of a new user
 void handleUserCreation(std::map<std::string, User*>& users);  
+// Views the schedule for today, this week, a date range or all events
+void viewScheduleByRange(const Schedule& schedule);
 // Handles making a reservation
-void handleReservation(Schedule& schedule, User* currentUser, std::map<int, Reservation*>& reservations);  
+void handleReservation(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations);  
 // Handles cancellation of a reservation
 void handleCancellation(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager); 
 // Lists all reservations
-void listAllReservations(const std::map<int, Reservation*>& reservations);  
+void listAllReservations(const Schedule& schedule);  
 // Views detailed information of an event
-void viewDetailedEvent(Schedule& schedule);  
+void viewDetailedEvent(Schedule& schedule, std::map<int, Reservation*>& reservations);  
 // Views detailed information of a reservation
-void viewDetailedReservation(const std::map<int, Reservation*>& reservations);  
+void viewDetailedReservation(Schedule& schedule, std::map<int, Reservation*>& reservations);  
 // Handles event creation
 void createEvent(FacilityManager& facilityManager, std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule);  
 // Handles user login
 User* handleLogin(const std::map<std::string, User*>& users);  
 // Gets a yes/no input from the user
 bool getYesNoInput();  
+// Handles creation of a recurring event
+void createRecurringEvent(std::map<std::string, RecurringEvent*>& recurringEvents, const std::map<std::string, User*>& users, Schedule& schedule);
+// Lists the occurrences of a recurring event within a date range
+void viewRecurringOccurrences(const Schedule& schedule);
+// Imports events from a file in one batch and reports the rejected rows
+void handleEventImport(std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule);
+// Creates the accounts listed in a file in one batch and reports the rejected rows
+void handleUserProvisioning(std::map<std::string, User*>& users);
+// Shows reports over the archived months
+void viewArchiveReports();
+// Prints the reservations matching a filter, at most limit of them (0 for all)
+bool printReservationQuery(const Schedule& schedule, const std::string& filter, size_t limit);
+// Asks for a reservation filter and prints the matches
+void handleReservationQuery(const Schedule& schedule);
+// Prints the utilization report and optionally writes it as CSV
+void viewUtilizationAnalytics(const Schedule& schedule);
+// Opens the door check-in of an event for its organizer or a City user (nullptr with a message if not allowed)
+std::shared_ptr<CheckInSession> openCheckIn(User* currentUser, Schedule& schedule, std::map<int, Reservation*>& reservations,
+                                            const std::string& eventName, std::string& message);
+// Scans one reservation at the door, paging in an unknown ID first so wrong-event scans are recognized
+bool scanAtDoor(CheckInSession& session, Schedule& schedule, std::map<int, Reservation*>& reservations, int reservationID, std::string& message);
+// Edits the logged-in user's information and re-renders the views showing their name
+void handleUserEdit(User* currentUser, std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations, Schedule& schedule);
+// Scans reservations at the door of an event until the scanner is closed
+void handleCheckIn(User* currentUser, Schedule& schedule, std::map<int, Reservation*>& reservations);
+// Reloads every data file after another process changed them, keeping the existing user objects valid;
+// with an archiveCutoff, the events that ended before it are archived on the way
+void reloadData(FacilityManager& facilityManager, std::map<std::string, User*>& users, std::map<std::string, Event*>& events,
+                std::map<int, Reservation*>& reservations, std::map<std::string, RecurringEvent*>& recurringEvents, long long horizonStart,
+                size_t reservationCache, long long archiveCutoff = -1);
+// Starts a background snapshot of the data for a City user and shows the snapshot stats
+void handleSnapshot(User* currentUser, FacilityManager& facilityManager, const std::map<std::string, User*>& users,
+                    const std::map<std::string, Event*>& events, const std::map<int, Reservation*>& reservations);
+// Books an event for a City user, displacing lower-priority events if needed
+void handlePriorityBooking(User* currentUser, FacilityManager& facilityManager, std::map<std::string, Event*>& events,
+                           std::map<int, Reservation*>& reservations);
 // Handles payment for a reservation
 void handlePayment(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager);  
 
+// I/O-agnostic operations shared by the interactive menu and the server mode.
+// They never read input; the outcome is described in the message parameter.
+// Returns the user matching the credentials, or nullptr
+User* authenticateUser(const std::map<std::string, User*>& users, const std::string& username, const std::string& password);
+// Finds a user's reservation for an event (O(reservations of the user)), or nullptr
+Reservation* findUserReservation(const User* user, const std::string& eventName);
+// Checks if the user already holds a reservation for the event
+bool hasReservationForEvent(const User* user, const std::string& eventName);
+// Finds the event a user asks to book for seatCount seats, or nullptr if the booking rules refuse the request;
+// a recurring occurrence is only materialized once every rule passed
+Event* findBookableEvent(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations,
+                         const std::string& eventName, const std::string& reservationTime, std::string& message, int seatCount = 1);
+// Creates a reservation for an event, returning nullptr if it is not allowed; events with assigned seats seat a group of seatCount
+Reservation* reserveEvent(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations,
+                          const std::string& eventName, const std::string& reservationTime, std::string& message, int seatCount = 1);
+// Cancels and refunds a reservation owned by the user
+bool cancelReservationByID(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager,
+                           int reservationID, std::string& message);
+// Turns a recurring event occurrence into a standalone event and saves it, or returns nullptr
+Event* materializeOccurrence(Schedule& schedule, std::map<std::string, Event*>& events, const std::string& occurrenceName);
+// Pays for the user's reservation of an event, returning nullptr if none is found
+Reservation* payForEvent(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager,
+                         const std::string& eventName, std::string& message);
+
 #endif // HELPERFUNCTIONS_HPP
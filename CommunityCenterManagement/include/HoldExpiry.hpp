@@ -0,0 +1,84 @@
+#ifndef HOLDEXPIRY_HPP
+#define HOLDEXPIRY_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "Reservation.hpp"
+
+// Hierarchical timing wheel of reservation deadlines, in minutes since the epoch.
+// Level l has 64 slots of 64^l minutes each; a deadline goes to the lowest
+// level whose window still contains it, and when a level's cursor wraps the
+// next slot of the level above is redistributed into it. Scheduling is O(1)
+// and every entry is moved at most once per level, so expiring a hold costs
+// O(1) amortized no matter how many holds are pending. Deadlines beyond the
+// top level wait in an overflow list until the wheel gets there.
+class TimingWheel {
+public:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+
+    // Entry of the wheel
+    struct Timer {
+        long long deadline;
+        ReservationHandle handle;
+    };
+
+    // Starts the wheel at a minute, dropping all timers
+    void reset(long long now);
+    // Schedules a timer (deadlines not after the current minute fire on the next advance)
+    void schedule(long long deadline, ReservationHandle handle);
+    // Moves the wheel to now and appends the timers that came due
+    void advance(long long now, std::vector<Timer>& due);
+    // Returns the number of scheduled timers
+    size_t size() const { return count; }
+
+private:
+    std::vector<Timer> slots[kLevels][kSlots];
+    std::vector<Timer> overflow;
+    std::vector<Timer> pending;  // Already due when scheduled
+    long long current = 0;
+    size_t count = 0;
+
+    // Places a timer in the slot matching its deadline
+    void place(const Timer& timer);
+};
+
+// Class expiring unpaid reservation holds.
+// A Pending, Unpaid reservation expires a time-to-live after it was created:
+// its status becomes Canceled, its seats and tickets are released, the
+// waitlist is promoted in order (seats and all) while the freed capacity
+// lasts, and the transition is appended to the hold log. A hold still on the
+// waitlist just leaves it, and is logged as well. Holds only expire before their event starts; once an event
+// has begun its unpaid reservations count as no-shows instead.
+//
+// Time-to-live values are read from a policy file of lines
+//   default <minutes>
+//   usertype <City|Organization|Resident|NonResident> <minutes>
+//   event <eventName> <minutes>
+// where an event line beats a user type line, which beats the default, and 0
+// means the hold never expires. Without a policy file no hold expires.
+//
+// The wheel only holds reservation handles: a reservation that is paid,
+// canceled or destroyed before its deadline is skipped when the timer fires,
+// so nothing has to be unscheduled.
+class HoldExpiry {
+public:
+    // Loads the time-to-live policy; a missing file leaves holds without expiry
+    static void loadPolicy(const std::string& filename);
+    // Returns the time-to-live of a reservation's hold in minutes (0 for none)
+    static long long ttlFor(const Reservation* reservation);
+    // Rebuilds the wheel from the creation times of the resident reservations
+    static void rebuild(const std::map<int, Reservation*>& reservations, long long now);
+    // Schedules the expiry of a new reservation; waitlisted ones hold no ticket and are scheduled once promoted
+    static void track(const Reservation* reservation);
+    // Expires the holds due by now, saving and logging them; returns how many expired, with one line per expiry in message
+    static size_t advance(long long now, std::map<int, Reservation*>& reservations, std::map<std::string, Event*>& events,
+                          std::string& message);
+    // Returns the number of holds scheduled
+    static size_t scheduledCount();
+};
+
+#endif // HOLDEXPIRY_HPP
@@ -0,0 +1,61 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Class collecting per-operation counters and latency histograms.
+// Every thread accumulates into its own slot, so recording never contends;
+// readers sum the slots when a report is requested. When a thread exits its
+// counts are merged into retired totals and its slot is kept for the next
+// thread, so short-lived threads do not pile up slots.
+class Metrics {
+public:
+    // Maximum number of distinct metrics that can be registered
+    static const int kMaxMetrics = 128;
+    // Number of latency buckets: <=1us, <=2us, <=4us, ... and an overflow bucket
+    static const int kBuckets = 24;
+
+    // Registers a named metric and returns its ID (registering the same name twice returns the same ID)
+    static int registerMetric(const std::string& name);
+    // Records one sample of the given metric on the calling thread
+    static void record(int metricID, std::uint64_t nanoseconds);
+
+    // Checks if metric collection is enabled
+    static bool isEnabled();
+    // Enables or disables metric collection
+    static void setEnabled(bool enabled);
+
+    // Prints a human readable summary of all metrics
+    static void printSummary(std::ostream& out);
+    // Writes all metrics in Prometheus text exposition format
+    static void writePrometheus(std::ostream& out);
+    // Writes all metrics as a JSON document
+    static void writeJson(std::ostream& out);
+    // Dumps all metrics to a file (JSON if the name ends in .json, Prometheus text otherwise)
+    static bool dumpToFile(const std::string& filename);
+
+    // Starts a background thread dumping metrics to a file every intervalSeconds
+    static void startPeriodicDump(const std::string& filename, int intervalSeconds);
+    // Stops the background dump thread and writes a final dump
+    static void stopPeriodicDump();
+};
+
+// Class timing the enclosing scope and recording it into a metric
+class ScopedTimer {
+public:
+    explicit ScopedTimer(int metricID);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    int metricID;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // METRICS_HPP
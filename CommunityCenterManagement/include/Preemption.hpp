@@ -0,0 +1,94 @@
+#ifndef PREEMPTION_HPP
+#define PREEMPTION_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include "Event.hpp"
+#include "User.hpp"
+#include "Reservation.hpp"
+#include "Schedule.hpp"
+#include "FacilityManager.hpp"
+
+// Booking a high-priority organizer wants placed, possibly by displacing other events
+struct PriorityRequest {
+    std::string eventName;
+    User* organizer = nullptr;
+    long long preferredStart = 0;  // Minutes since the epoch
+    long long duration = 0;        // Minutes
+    long long windowStart = 0;     // The event must lie within [windowStart, windowEnd)
+    long long windowEnd = 0;
+    LayoutStyle layoutStyle = LayoutStyle::Meeting;
+    bool isPublic = true;
+    int maxGuests = 0;
+    double ticketPrice = 0.0;
+    bool openToResidents = true;
+    bool openToNonResidents = true;
+};
+
+// Lower-priority event a plan displaces
+struct DisplacedEvent {
+    Event* event;
+    long long start;
+    long long end;
+    size_t reservations;                  // Reservations that are not canceled yet
+    double refundTotal;                   // Total cost of those reservations that were paid
+    std::vector<long long> relocations;   // Offered new start times, earliest first
+    int chosenRelocation = 0;             // Index into relocations, or -1 to cancel the event instead
+};
+
+// Cheapest way found to place a priority request
+struct PreemptionPlan {
+    bool feasible = false;
+    std::string reason;                   // Why no placement exists
+    long long start = -1;
+    long long end = -1;
+    std::vector<DisplacedEvent> displaced;
+    size_t reservations = 0;
+    double refundTotal = 0.0;
+    double cost = 0.0;
+    size_t candidatesChecked = 0;
+    double milliseconds = 0.0;
+
+    // Prints the placement, the displaced events and their relocation options
+    void print(std::ostream& out) const;
+};
+
+// Class planning and executing priority bookings for City users.
+// An event whose organizer has a lower priority (by user type: City,
+// Organization, Resident, NonResident) can be displaced; events of equal or
+// higher priority, events already under way and recurring occurrences block
+// a placement. Displacing an event costs kReservationWeight per reservation
+// holder affected plus the refunds owed to them.
+//
+// The planner collects the events around the request window from the day
+// index once, sorts their starts and ends and keeps prefix sums of their
+// costs, so the cost of displacing everything that overlaps a candidate
+// placement is two binary searches. Only placements that start at the
+// window's start, the preferred start, the opening time of a day, the end of
+// an event or just early enough to finish before an event can be cheapest,
+// so planning is O(n log n) in the events of the window.
+//
+// Each displaced event is offered up to kRelocationOptions free slots of its
+// own length in the following kRelocationDays days. The offers of different
+// events never overlap each other or the new booking, so any combination of
+// choices can be executed.
+class PreemptionPlanner {
+public:
+    static constexpr double kReservationWeight = 25.0;
+    static const int kRelocationOptions = 3;
+    static const int kRelocationDays = 28;
+
+    // Returns the priority of a user type; higher priorities may displace lower ones
+    static int priorityOf(UserType userType);
+    // Finds the cheapest placement of a request not before now (minutes since the epoch)
+    static PreemptionPlan plan(const Schedule& schedule, const PriorityRequest& request, long long now);
+    // Executes a plan as one transaction: refunds and cancels the reservations of the displaced
+    // events, moves them to their chosen slots (or cancels them), creates the new event and saves
+    // everything once. Returns nullptr without changing anything if the plan is out of date.
+    static Event* execute(const PreemptionPlan& plan, const PriorityRequest& request, FacilityManager& facilityManager,
+                          std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations, std::string& message);
+};
+
+#endif // PREEMPTION_HPP
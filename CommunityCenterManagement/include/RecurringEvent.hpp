@@ -0,0 +1,118 @@
+#ifndef RECURRINGEVENT_HPP
+#define RECURRINGEVENT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cstdint>
+#include "Event.hpp"
+#include "User.hpp"
+
+// Enum class for how often a recurring event repeats
+enum class RecurrenceFrequency {
+    Weekly,   // Repeats every interval weeks
+    Monthly   // Repeats every interval months on the same day of the month
+};
+
+// Rule describing when a recurring event repeats
+struct RecurrenceRule {
+    RecurrenceFrequency frequency = RecurrenceFrequency::Weekly;
+    int interval = 1;                  // Number of weeks or months between occurrences
+    int count = 0;                     // Maximum number of occurrences (0 for no limit)
+    std::string until;                 // Last date occurrences may start on (YYYY-MM-DD, empty for no limit)
+    std::set<std::string> exceptions;  // Dates (YYYY-MM-DD) on which the occurrence is skipped
+};
+
+// Class representing a series of events stored as a single record.
+// Occurrences are never stored: they are computed arithmetically from the
+// first occurrence and the rule, so checking a two-year weekly class costs
+// the same as checking a single event. An occurrence is only turned into a
+// standalone Event (named "<series>@<YYYY-MM-DD>") when someone books it.
+class RecurringEvent {
+public:
+    // Constructor taking the times of the first occurrence
+    RecurringEvent(const std::string& eventName, User* organizer, const std::string& startTime, const std::string& endTime,
+                   LayoutStyle layoutStyle, bool isPublic, int maxGuests, double ticketPrice, const RecurrenceRule& rule);
+
+    // Getters
+    const std::string& getEventName() const { return eventName; }
+    User* getOrganizer() const { return organizer; }
+    const std::string& getStartTime() const { return startTime; }
+    const std::string& getEndTime() const { return endTime; }
+    LayoutStyle getLayoutStyle() const { return layoutStyle; }
+    bool isPublicEvent() const { return isPublic; }
+    int getMaxGuests() const { return maxGuests; }
+    double getTicketPrice() const { return ticketPrice; }
+    const RecurrenceRule& getRule() const { return rule; }
+    // Get the duration of one occurrence in minutes
+    long long getDuration() const { return duration; }
+    // Check if the first occurrence times were parsed successfully
+    bool isValid() const { return valid; }
+    // Get the render version (see Event::getVersion)
+    std::uint64_t getVersion() const { return version; }
+    // Take a new render version (the schedule does when the series is added; a skipped occurrence only leaves its day)
+    void markChanged() { version = Event::nextVersion(); }
+
+    // Setters
+    void setOpenToResidents(bool openToResidents) { this->openToResidents = openToResidents; }
+    void setOpenToNonResidents(bool openToNonResidents) { this->openToNonResidents = openToNonResidents; }
+    bool isOpenToResidents() const { return openToResidents; }
+    bool isOpenToNonResidents() const { return openToNonResidents; }
+
+    // Checks if any occurrence overlaps [start, end) (minutes since the epoch); reports the first one found
+    bool overlaps(long long start, long long end, long long* occurrenceStart = nullptr) const;
+    // Returns the start of every occurrence overlapping [start, end), in order
+    std::vector<long long> occurrencesBetween(long long start, long long end) const;
+    // Returns the start of the first occurrence at or after a minute, or -1 if there is none
+    long long nextOccurrence(long long from) const;
+    // Checks if an occurrence starts on the given day (days since the epoch)
+    bool occursOn(long long day, long long& occurrenceStart) const;
+    // Skips the occurrence on the given date
+    void addException(const std::string& date);
+    // Creates a standalone event for the occurrence on the given date and skips it in the series
+    Event* materialize(const std::string& date);
+
+    // Builds the name of an occurrence
+    static std::string occurrenceName(const std::string& seriesName, const std::string& date);
+    // Splits an occurrence name into series name and date, returning false if it is not one
+    static bool splitOccurrenceName(const std::string& name, std::string& seriesName, std::string& date);
+
+    // Loads recurring events from a file
+    static std::map<std::string, RecurringEvent*> loadRecurringEvents(const std::string& filename, const std::map<std::string, User*>& users);
+    // Saves recurring events to a file
+    static void saveRecurringEvents(const std::string& filename, const std::map<std::string, RecurringEvent*>& recurringEvents);
+
+private:
+    std::string eventName;
+    User* organizer;
+    std::string startTime;
+    std::string endTime;
+    LayoutStyle layoutStyle;
+    bool isPublic;
+    int maxGuests;
+    double ticketPrice;
+    bool openToResidents;
+    bool openToNonResidents;
+    RecurrenceRule rule;
+
+    // Values derived from the first occurrence and the rule
+    bool valid;
+    long long firstStart;              // Start of the first occurrence
+    long long duration;                // Length of one occurrence
+    long long minuteOfDay;             // Start minute within the day
+    int firstMonth;                    // Year * 12 + month - 1 of the first occurrence
+    int dayOfMonth;                    // Day of the month of the first occurrence
+    long long untilDay;                // Last day an occurrence may start on (-1 for no limit)
+    std::set<long long> exceptionDays; // Parsed exception dates
+    std::uint64_t version;             // Render version
+
+    // Computes the start of occurrence n, returning false if that period has no occurrence
+    bool occurrenceStartAt(long long n, long long& start) const;
+    // Checks the count, until and exception limits for occurrence n
+    bool isActive(long long n, long long start) const;
+    // Computes the range of occurrence numbers that can overlap [start, end)
+    void candidateRange(long long start, long long end, long long& first, long long& last) const;
+};
+
+#endif // RECURRINGEVENT_HPP
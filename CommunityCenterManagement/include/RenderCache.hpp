@@ -0,0 +1,63 @@
+#ifndef RENDERCACHE_HPP
+#define RENDERCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+#include "Snapshot.hpp"
+
+// Hit and miss counters of the render cache
+struct RenderCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;  // Entries rendered (again)
+    size_t events = 0;         // Events with cached text
+    size_t days = 0;           // Days with cached text
+};
+
+// Outcome of one step of the render cache check
+struct RenderCheckResult {
+    std::string step;
+    std::uint64_t rendered = 0;  // Entries the step rendered again
+    std::uint64_t expected = 0;  // Entries the step changed
+    bool matches = true;         // Every cached view equals a fresh rendering
+
+    // Checks if the step re-rendered exactly what changed and nothing went stale
+    bool passed() const { return matches && rendered == expected; }
+};
+
+// Class keeping the text of the schedule and event views between changes.
+// The views are rendered from snapshots; the cache keeps, per event, its
+// basic and detailed view, and per day, the day's block of the schedule view
+// (the date and one line per event or recurring occurrence starting that
+// day). Every change shown in these views stamps the event or recurring
+// series with a new version from one process-wide counter (see
+// Event::markChanged), so an event entry is valid while its version is
+// unchanged, and a day entry while the number of events and occurrences on
+// the day and the largest version among them are unchanged: adding anything
+// brings a version larger than all before, and removing something alone
+// lowers the count. Between changes a view is a buffer write. Entries are
+// checked only when looked up, so a write costs nothing here; the least
+// recently used events and days are evicted beyond a fixed bound.
+class RenderCache {
+public:
+    // Returns the basic details of an event, rendered once per event version
+    static std::shared_ptr<const std::string> eventDetails(const EventSnapshot& event);
+    // Returns the detailed view of an event, rendered once per event version
+    static std::shared_ptr<const std::string> eventDetailedView(const EventSnapshot& event);
+    // Returns the schedule block of a day (date line first), rendered once per change of the day
+    static std::shared_ptr<const std::string> dayView(const ScheduleSnapshot& snapshot, long long day);
+
+    // Returns the counters
+    static RenderCacheStats getStats();
+    // Forgets every cached view
+    static void reset();
+
+    // Checks the cache against fresh renderings through every kind of change on a synthetic schedule
+    static std::vector<RenderCheckResult> runCheck();
+    // Prints the check results as a table
+    static void printCheck(std::ostream& out, const std::vector<RenderCheckResult>& results);
+};
+
+#endif // RENDERCACHE_HPP
@@ -4,7 +4,10 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <cstdint>
 #include "User.hpp"
+#include "SlotMap.hpp"
+#include "SeatMap.hpp"
 
 // Forward declaration of Event class
 class Event;
@@ -22,7 +25,14 @@ enum class PaymentStatus {
     Paid
 };
 
-// Class representing a reservation
+// Handle of a reservation in the reservation slot map
+using ReservationHandle = SlotHandle;
+
+// Class representing a reservation.
+// Reservations live in a generational slot map; users and events refer to
+// them by handle, so a reservation that has been destroyed is skipped
+// instead of dereferenced. Create and destroy them with create() and
+// destroy(), which also link them to and unlink them from their user and event.
 class Reservation {
 private:
     int reservationID;
@@ -33,24 +43,49 @@ private:
     PaymentStatus paymentStatus;
     std::string reservationTime;
     static int nextReservationID; // Static variable for unique IDs
+    ReservationHandle handle;
+    std::vector<SeatBlock> seats;  // Assigned seats (empty for open seating)
+    long long createdMinute;  // When the hold was placed, in minutes since the epoch
+    std::uint64_t version;  // Render version, bumped by every change (see Event::getVersion)
 
-public:
     Reservation(int reservationID, User* user, Event* event, const std::string& reservationTime);
-    
+    template <typename, size_t> friend class SlotMap;
+
+public:
+    static Reservation* create(int reservationID, User* user, Event* event, const std::string& reservationTime);  // Creates a reservation and links it to its user and event
+    static void destroy(Reservation* reservation);  // Unlinks a reservation from its user and event and frees it
+    static void destroyAll();  // Frees every reservation (at shutdown, without unlinking)
+    static Reservation* resolve(ReservationHandle handle);  // Returns the reservation a handle refers to, or nullptr if it was destroyed
+
+    ReservationHandle getHandle() const { return handle; }
+
     int getReservationID() const { return reservationID; }
     User* getUser() const { return user; }
     Event* getEvent() const { return event; }
     ReservationStatus getReservationStatus() const { return reservationStatus; }
     double getTotalCost() const { return totalCost; }
     PaymentStatus getPaymentStatus() const { return paymentStatus; }
-    std::string getReservationTime() const { return reservationTime; }
+    const std::string& getReservationTime() const { return reservationTime; }
+    const std::vector<SeatBlock>& getSeats() const { return seats; }
+    std::string getSeatLabels() const;  // Formats the assigned seats as labels such as "C5-C8", empty if none
+    bool assignSeats(int count);  // Allocates the best available seats of the event for a group of count
+    int getGroupSize() const;  // Number of seats held, or 1 for a reservation without assigned seats
+    long long getCreatedMinute() const { return createdMinute; }
+    std::uint64_t getVersion() const { return version; }  // Get the render version: snapshots reuse their copy while it is unchanged
+    void markChanged();  // Takes a new render version and notes the change for the next save
+    void expireHold();  // Cancels an unpaid hold and releases its seats
+    void restartHold(long long minute);  // Restarts the hold clock (on promotion from the waitlist)
 
     double calculateCost();  // Calculates the total cost of the reservation
-    void makePayment(FacilityManager& facilityManager);  // Handles payment for the reservation
-    void processRefund(FacilityManager& facilityManager); // Processes a refund for the reservation
+    void makePayment(FacilityManager& facilityManager, std::string& message);  // Handles payment for the reservation, describing it in message
+    void processRefund(FacilityManager& facilityManager, std::string& message); // Processes a refund for the reservation, describing it in message
 
     void getDetailedView() const;  // Prints detailed information of the reservation
 
+    std::string formatRecord() const;  // Formats the reservation as one line of the reservation file
+    static Reservation* parseRecord(const std::string& line, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events);  // Parses one line of the reservation file (nullptr if invalid)
+    static std::string formatTombstone(int reservationID);  // Formats the line that removes a reservation from the file ("-<id>")
+    static bool parseTombstone(const std::string& line, int& reservationID);  // Checks if a line removes a reservation, extracting its ID
     static void saveReservations(const std::string& filename, const std::map<int, Reservation*>& reservations);  // Saves reservations to a file
     static std::map<int, Reservation*> loadReservations(const std::string& filename, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events);  // Loads reservations from a file
 };
@@ -0,0 +1,68 @@
+#ifndef RESERVATIONQUERY_HPP
+#define RESERVATIONQUERY_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include "Bitmap.hpp"
+
+struct ReservationSnapshot;
+struct ScheduleSnapshot;
+
+// Bitmap indexes over the reservations of a snapshot.
+// Rows are reservation IDs; there is one compressed bitmap per
+// reservation status, payment status, user type, event day and event week, so
+// a filter is answered with bitmap AND/OR/AND NOT instead of visiting
+// reservations. Date ranges take whole weeks from the week bitmaps and only
+// the days at their edges from the day bitmaps. The bitmaps are immutable and
+// shared between the indexes of successive snapshots: an update copies only
+// the bitmaps the changed reservations enter or leave.
+//
+// Filter syntax: whitespace-separated terms that must all hold, each
+// "field=value[,value...]" (any of the values) or "field!=value[,value...]"
+// (none of them). Fields and values are case-insensitive:
+//   status=Pending|Confirmed|Canceled
+//   payment=Unpaid|Paid
+//   usertype=City|Organization|Resident|NonResident
+//   date=YYYY-MM-DD|YYYY-MM-DD..YYYY-MM-DD|today|thisweek|nextweek  (day the event starts)
+// Example: "status=Pending payment=Unpaid usertype=NonResident date=nextweek"
+class ReservationIndex {
+public:
+    // Reservation before and after a change, nullptr for none
+    using Change = std::pair<const ReservationSnapshot*, const ReservationSnapshot*>;
+
+    // Constructor for empty indexes
+    ReservationIndex();
+    // Moves the changed reservations between the bitmaps
+    void update(const std::vector<Change>& changes);
+    // Evaluates a filter, returning false with a message if it does not parse
+    bool evaluate(const std::string& filter, Bitmap& rows, std::string& error) const;
+    // Returns the rows of reservations for events starting on a day, or nullptr if there are none
+    const Bitmap* dayBitmap(long long day) const;
+    // Returns the bytes used by the indexes
+    size_t memoryUsage() const;
+
+private:
+    using SharedBitmap = std::shared_ptr<const Bitmap>;
+
+    SharedBitmap allRows;
+    SharedBitmap statusRows[3];                 // By ReservationStatus
+    SharedBitmap paymentRows[2];                // By PaymentStatus
+    SharedBitmap userTypeRows[4];               // By UserType
+    std::map<long long, SharedBitmap> dayRows;  // By the day the event starts
+    std::map<long long, SharedBitmap> weekRows; // By the Monday of the week the event starts
+
+    // Appends the bitmaps whose union holds the rows matching one value of a field
+    bool matchValue(const std::string& field, const std::string& value, std::vector<const Bitmap*>& parts, std::string& error) const;
+};
+
+// Runs a filter against a snapshot, returning up to limit matches (0 for all) and the total count
+bool queryReservations(const ScheduleSnapshot& snapshot, const std::string& filter, size_t limit,
+                       std::vector<const ReservationSnapshot*>& matches, size_t& total, std::string& error);
+// Formats a reservation as one query result line "<id> <user> <event> <status> <payment> <cost>"
+std::string formatQueryRow(const ReservationSnapshot& reservation);
+
+#endif // RESERVATIONQUERY_HPP
@@ -0,0 +1,65 @@
+#ifndef RESERVATIONSTORE_HPP
+#define RESERVATIONSTORE_HPP
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <istream>
+#include <cstddef>
+#include <cstdint>
+#include "Reservation.hpp"
+#include "Event.hpp"
+#include "User.hpp"
+
+// Class paging reservations in from the reservation file on demand.
+// At startup only the reservations of events ending inside the active
+// horizon are materialized; everything else stays on disk, reachable through
+// a compact binary index (<file>.idx) that maps reservation IDs and event
+// names to file offsets. The index is memory-mapped, so only the pages a
+// lookup touches become resident. Archived reservations of an event are paged
+// in the first time the event is viewed, booked, paid or canceled, and the
+// least recently used paged-in events are evicted again once more than
+// capacity paged-in reservations are resident.
+//
+// Every change to a reservation is saved right away (as everywhere else in
+// the application), so an evicted reservation can always be read back from
+// the file. Reservations report their changes through noteChange(), and a
+// save appends just those records to the file: a later line for an ID
+// supersedes the earlier ones and a tombstone line "-<id>" removes it. Once
+// such stale lines outnumber the reservations in the file, the next save
+// rewrites it with one line per reservation. The index only covers the file
+// up to the size it was built for: appended lines are tracked in memory (and
+// scanned again on open), and once they outnumber the indexed records a new
+// index covering them is written, without rewriting the file.
+class ReservationStore {
+public:
+    // Opens a reservation file, loading the reservations of events ending at or after horizonStart (minutes since the epoch)
+    static std::map<int, Reservation*> open(const std::string& filename, const std::map<std::string, User*>& users,
+                                            const std::map<std::string, Event*>& events, long long horizonStart, size_t capacity);
+    // Releases the index
+    static void close();
+    // Checks if a file is paged by the store
+    static bool isOpen(const std::string& filename);
+
+    // Pages in the archived reservations of an event, returning how many were loaded
+    static size_t pageInEvent(const std::string& eventName, std::map<int, Reservation*>& reservations);
+    // Pages in the archived reservations of the event a reservation belongs to, returning how many were loaded
+    static size_t pageInReservation(int reservationID, std::map<int, Reservation*>& reservations);
+    // Returns the highest reservation ID ever handed out (canceled ones included, the index keeps the mark)
+    static int maxReservationID(const std::map<int, Reservation*>& reservations);
+    // Keeps IDs up to maxID (e.g. archived reservations) from being handed out again
+    static void reserveIDs(int maxID);
+    // Returns the number of reservations on disk that are not resident
+    static size_t archivedCount();
+
+    // Notes that a reservation was created, changed or destroyed, so the next save appends it
+    static void noteChange(int reservationID);
+    // Finds the offset of the line holding the current record (or tombstone) of each reservation in a reservation file
+    static std::unordered_map<int, std::uint64_t> latestRecords(std::istream& input);
+    // Saves the changed reservations, returning false if the store does not manage filename
+    static bool save(const std::string& filename, const std::map<int, Reservation*>& reservations);
+    // Writes the resident reservations merged with the archived ones to another file (e.g. a snapshot), returning false if no file is open
+    static bool exportTo(const std::string& target, const std::map<int, Reservation*>& reservations);
+};
+
+#endif // RESERVATIONSTORE_HPP
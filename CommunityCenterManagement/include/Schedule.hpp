@@ -2,24 +2,83 @@
 #define SCHEDULE_HPP
 
 #include <vector>
+#include <map>
+#include <set>
 #include "Event.hpp"
+#include "Snapshot.hpp"
+#include "RecurringEvent.hpp"
 
 // Class representing a schedule of events
 class Schedule {
 public:
+    // Event stored in a day bucket with its parsed times
+    struct CalendarEntry {
+        long long start;
+        long long end;
+        Event* event;
+    };
+
     // Adds an event to the schedule
     void addEvent(Event* event);  
     // Removes an event from the schedule
-    void removeEvent(int eventID);  
+    void removeEvent(const Event* event);  
+    // Removes every event and recurring series from the schedule (the caller frees them)
+    void clear();
+    // Moves an event to new times, keeping the day index sorted
+    void rescheduleEvent(Event* event, const std::string& startTime, const std::string& endTime);
     // Checks if a time slot is available
     bool checkAvailability(const std::string& startTime, const std::string& endTime) const;  
-    // Views the current schedule
+    // Views the current schedule (reads the latest published snapshot)
     void viewSchedule() const; 
+    // Views the events of the days [firstDay, lastDay] (days since the epoch), one line per event
+    void viewScheduleRange(long long firstDay, long long lastDay) const;
+    // Returns the events overlapping [start, end) (minutes since the epoch) in start order
+    std::vector<Event*> eventsBetween(long long start, long long end) const;
+    // Returns the first event (in start order) overlapping [start, end), or nullptr
+    Event* firstEventBetween(long long start, long long end) const;
+    // Returns the events indexed by start day (days since the epoch), sorted by start time within each day
+    const std::map<long long, std::vector<CalendarEntry>>& getCalendar() const;
+    // Returns the events whose times could not be parsed
+    const std::vector<Event*>& getUndatedEvents() const;
+    // Returns the longest duration of an indexed event in minutes
+    long long getLongestEvent() const;
     // Finds an event by name
     Event* findEvent(const std::string& eventName) const;  
 
+    // Adds a recurring event series to the schedule
+    void addRecurringEvent(RecurringEvent* series);
+    // Finds a recurring event series by name, or nullptr
+    RecurringEvent* findRecurringEvent(const std::string& seriesName) const;
+    // Returns all recurring event series
+    const std::map<std::string, RecurringEvent*>& getRecurringEvents() const;
+    // Checks if a name refers to a not yet materialized occurrence ("<series>@<YYYY-MM-DD>")
+    bool findOccurrence(const std::string& occurrenceName, RecurringEvent*& series, long long& occurrenceStart) const;
+    // Turns an occurrence into a standalone event in the schedule, or returns nullptr
+    Event* materializeOccurrence(const std::string& occurrenceName);
+    // Checks if no occurrence of a new series overlaps the schedule
+    bool checkRecurringAvailability(const RecurringEvent& series) const;
+
+    // Publishes a snapshot of the schedule and reservations for readers
+    void publishSnapshot(const std::map<int, Reservation*>& reservations);
+    // Returns the snapshot store readers pin snapshots from
+    const SnapshotStore& getSnapshots() const;
+
 private:
-    std::vector<Event*> events;
+    // Events by name
+    std::map<std::string, Event*> events;
+    // Events indexed by the day they start on, sorted by start time within each day
+    std::map<long long, std::vector<CalendarEntry>> calendar;
+    // Events whose times could not be parsed and therefore have no day
+    std::vector<Event*> undatedEvents;
+    // Durations of the indexed events; the longest bounds how many earlier days a range query must visit
+    std::multiset<long long> durations;
+    std::map<std::string, RecurringEvent*> recurringEvents;
+    SnapshotStore snapshots;
+
+    // Adds an event to the day index, or to the undated events if its times do not parse
+    void indexEvent(Event* event);
+    // Removes an event from the day index and the undated events
+    void unindexEvent(const Event* event);
 };
 
 #endif // SCHEDULE_HPP
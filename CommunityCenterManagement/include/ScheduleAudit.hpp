@@ -0,0 +1,51 @@
+#ifndef SCHEDULEAUDIT_HPP
+#define SCHEDULEAUDIT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include "Event.hpp"
+#include "User.hpp"
+#include "Reservation.hpp"
+#include "Schedule.hpp"
+
+// Organizer whose events in one week exceed their weekly limit
+struct QuotaViolation {
+    const User* organizer;
+    long long weekStart;  // Monday of the week (days since the epoch)
+    long long minutes;    // Minutes booked in that week
+};
+
+// Findings of a whole-dataset audit
+struct AuditReport {
+    std::vector<std::pair<const Event*, const Event*>> overlaps;  // Overlapping pairs, earlier start first
+    std::vector<const Event*> outsideOperatingHours;
+    std::vector<const Event*> invalidTimes;                      // Events whose times could not be parsed
+    std::vector<QuotaViolation> quotaViolations;
+    std::vector<const Reservation*> reservationsOutsideEvent;    // Reservation time not within its event
+    size_t eventsChecked = 0;
+    size_t reservationsChecked = 0;
+    unsigned threadsUsed = 0;
+    double milliseconds = 0.0;
+
+    // Checks if the audit found nothing
+    bool isClean() const;
+    // Prints the findings, at most limit entries per category (0 for all)
+    void print(std::ostream& out, size_t limit) const;
+};
+
+// Class auditing all events and reservations for rule violations.
+// Loading and the helper-level createEvent do not enforce every rule, so
+// the audit checks the whole dataset after the fact: it splits the schedule's
+// day buckets (already sorted by start time) into contiguous day ranges, one
+// per worker thread, and runs a sweep line over each range. A range is seeded
+// with the events of earlier days that still run into it, so overlaps across
+// range boundaries are found exactly once.
+class ScheduleAudit {
+public:
+    // Audits the schedule and reservations split into up to threads ranges run on the shared task pool (0 for one per pool thread)
+    static AuditReport run(const Schedule& schedule, const std::map<int, Reservation*>& reservations, unsigned threads = 0);
+};
+
+#endif // SCHEDULEAUDIT_HPP
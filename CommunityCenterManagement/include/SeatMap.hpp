@@ -0,0 +1,85 @@
+#ifndef SEATMAP_HPP
+#define SEATMAP_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum class LayoutStyle;
+
+// Run of consecutive seats in one section of one row, by seat number (row-major, from 0)
+struct SeatBlock {
+    std::uint32_t first;
+    std::uint32_t count;
+};
+
+// Seat grid template of a layout style: every row is split into sections by aisles
+struct SeatLayout {
+    bool assigned;               // False for open seating (no seat map is kept)
+    std::vector<int> sections;   // Seats per section, front to back of one row, left to right
+
+    // Returns the number of seats in one row
+    int seatsPerRow() const;
+    // Returns the template of a layout style
+    static const SeatLayout& forStyle(LayoutStyle style);
+};
+
+// Occupancy of the seats of one event.
+// Seats are laid out row by row in one bitset, with a permanently occupied
+// "aisle" bit after every section and every unused bit of the last word set,
+// so a run of free bits never crosses an aisle or a row. Searches jump over
+// whole words with count-trailing-zeros instead of testing seats one by one,
+// and occupying or releasing a block sets or clears word masks, so every
+// operation is O(words) rather than O(seats).
+class SeatMap {
+public:
+    SeatMap() = default;
+    // Builds an empty map of capacity seats laid out by a template
+    SeatMap(const SeatLayout& layout, int capacity);
+
+    // Returns the number of seats
+    int capacity() const { return seatCount; }
+    // Returns the number of free seats
+    int available() const { return seatCount - occupiedCount; }
+
+    // Finds count seats for a group: the frontmost, most central contiguous block,
+    // or failing that the frontmost free seats in as few blocks as possible
+    bool findBestAvailable(int count, std::vector<SeatBlock>& blocks) const;
+    // Finds the frontmost, most central contiguous block of count seats
+    bool findContiguous(int count, SeatBlock& block) const;
+    // Marks a block occupied, returning false (and changing nothing) if it is invalid or any seat is taken
+    bool occupy(const SeatBlock& block);
+    // Marks a block free again
+    void release(const SeatBlock& block);
+
+    // Formats blocks as seat labels ("C5-C8,D2")
+    static std::string formatBlocks(const std::vector<SeatBlock>& blocks, int seatsPerRow);
+    // Parses seat labels, returning false if they are malformed
+    static bool parseBlocks(const std::string& text, int seatsPerRow, std::vector<SeatBlock>& blocks);
+
+private:
+    std::vector<std::uint64_t> words;  // Bit set = seat taken or aisle
+    std::vector<int> sectionStarts;    // Bit offset of every section within a row
+    std::vector<int> sectionSizes;
+    int stride = 0;                    // Bits per row (seats plus one aisle bit per section)
+    int perRow = 0;
+    int seatCount = 0;
+    int occupiedCount = 0;
+
+    // Returns the bit of a seat
+    std::uint32_t bitOfSeat(std::uint32_t seat) const;
+    // Returns the seat of a bit that is not an aisle
+    std::uint32_t seatOfBit(std::uint32_t bit) const;
+    // Returns the first free bit at or after a bit, or the number of bits
+    std::uint32_t nextFree(std::uint32_t bit) const;
+    // Returns the first taken bit at or after a bit, or the number of bits
+    std::uint32_t nextTaken(std::uint32_t bit) const;
+    // Checks if every bit of [first, first + count) is free
+    bool rangeFree(std::uint32_t first, std::uint32_t count) const;
+    // Sets or clears the bits [first, first + count)
+    void setRange(std::uint32_t first, std::uint32_t count, bool taken);
+    // Converts a seat block to its bit range, returning false if it leaves its section
+    bool toBits(const SeatBlock& block, std::uint32_t& first) const;
+};
+
+#endif // SEATMAP_HPP
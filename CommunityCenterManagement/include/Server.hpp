@@ -0,0 +1,104 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include "User.hpp"
+#include "Event.hpp"
+#include "Reservation.hpp"
+#include "FacilityManager.hpp"
+
+// Class serving the booking operations over a local socket.
+// Requests and responses are single text lines:
+//   LOGIN <user> <password>      -> OK <user>
+//   LOGOUT                       -> OK
+//   LIST                         -> OK <n>, then n lines "<event> <start> <end> <sold> <max> <price>"
+//   MYRES                        -> OK <n>, then n lines "<id> <event> <status> <payment> <cost>"
+//   AVAIL <start> <end>          -> OK available | OK unavailable
+//   RESERVE <event> <time>       -> OK <reservationID> <cost>, or OK <reservationID> <cost> waitlisted
+//                                   (flash-sale events answer once the request's batch is admitted, see FlashSale.hpp;
+//                                   later requests of the connection wait for that answer)
+//   PAY <event>                  -> OK <reservationID>
+//   CANCEL <reservationID>       -> OK <reservationID>
+//   QUERY <filter>               -> OK <n>, then n lines "<id> <user> <event> <status> <payment> <cost>"
+//                                   (city staff only; filter syntax in ReservationQuery.hpp)
+//   CHECKIN <event> <reservationID> -> OK <headcount> <maxGuests>
+//                                   (organizer or city staff; duplicates and wrong-event IDs are rejected)
+//   SNAPSHOT                     -> OK <snapshotNumber> <pauseMicroseconds>
+//                                   (city staff only; written in the background, see DiskSnapshot.hpp)
+//   QUIT                         -> OK, then the connection is closed
+// Failures are answered with "ERR <message>". A request line longer than 64 KB is answered with
+// "ERR Request line too long." and the connection is closed.
+class Server {
+public:
+    // Per-connection state
+    struct Session {
+        User* user = nullptr;
+        bool closeRequested = false;
+        bool wroteData = false;          // Set by a request that modified events or reservations
+        bool unpublishedWrites = false;  // Some request of the current batch wrote data the snapshot does not show yet
+        int connectionFd = -1;
+        std::uint64_t serial = 0;    // Unique per connection, as descriptors are reused
+        int queuedRequests = 0;      // Requests waiting in the flash-sale queue
+    };
+
+    Server(FacilityManager& facilityManager, std::map<std::string, User*>& users, std::map<std::string, Event*>& events,
+           std::map<int, Reservation*>& reservations);
+    ~Server();
+
+    // Listens on a Unix domain socket at the given path
+    bool listenUnix(const std::string& path);
+    // Listens on a TCP port bound to localhost
+    bool listenTcp(int port);
+    // Runs the event loop until stop() is called or a termination signal arrives
+    void run();
+    // Asks the event loop to exit
+    void stop();
+
+    // Executes one request line for a session and returns the response (without I/O)
+    std::string handleRequest(Session& session, const std::string& line);
+
+private:
+    // Buffered state of an open client connection
+    struct Connection {
+        int fd;
+        std::string input;
+        std::string output;
+        bool inputClosed = false;  // The client finished sending
+        Session session;
+    };
+
+    FacilityManager& facilityManager;
+    std::map<std::string, User*>& users;
+    std::map<std::string, Event*>& events;
+    std::map<int, Reservation*>& reservations;
+
+    int listenFd;
+    int epollFd;
+    std::string unixPath;
+    std::map<int, Connection> connections;
+    std::uint64_t nextSerial;
+
+    // Accepts all pending connections
+    void acceptConnections();
+    // Reads available data, up to a full input buffer, and processes complete request lines
+    void readFromConnection(Connection& connection);
+    // Processes the buffered request lines until one waits in the flash-sale queue
+    void processInput(Connection& connection);
+    // Publishes the session's unpublished writes to snapshot readers
+    void publishWrites(Session& session);
+    // Admits one flash-sale batch and answers the waiting connections
+    void admitFlashSaleBatch();
+    // Writes as much buffered output as the socket accepts
+    void flushConnection(Connection& connection);
+    // Updates the epoll interest set of a connection
+    void updateInterest(Connection& connection);
+    // Closes a connection and forgets its state
+    void closeConnection(int fd);
+    // Registers the listening socket with a new epoll instance
+    bool startLoop();
+};
+
+#endif // SERVER_HPP
@@ -0,0 +1,70 @@
+#ifndef SHAREDSTORE_HPP
+#define SHAREDSTORE_HPP
+
+#include <string>
+#include <functional>
+#include <cstdint>
+
+// Optional coordination of several local processes (desks) over one dataset.
+// The processes map a small shared file (data/shared.store by default)
+// holding a process-shared robust mutex and a change record: the data
+// generation, the writer's pid and the minute of the last write, published
+// under a seqlock. Every process keeps its own objects, loaded from the data
+// files; before an action it reads the generation straight from the mapping
+// (no system call) and reloads the data files if another desk wrote since it
+// last loaded them. Actions that modify data run under the mutex, so writes
+// from different desks are serialized and each one starts from the latest
+// files. If a desk dies while holding the mutex, the next one to lock it
+// recovers it and reloads the data.
+//
+// Only the lock and the change record live in the mapping, not the objects:
+// users, events and reservations are pointer-linked heap objects, and
+// placing them in shared memory would mean offset-based versions of every
+// class. A reload therefore rereads the data files and drops the caches
+// derived from the old objects (check-in sessions, rendered views,
+// analytics). The reservation index (<file>.idx) is already a
+// memory-mapped file with offset-based records; it is rebuilt by whichever
+// process saves and picked up by the others when they reload.
+class SharedStore {
+public:
+    // Maps the shared file, creating and initializing it if needed; returns false if it could not be used
+    static bool open(const std::string& filename);
+    // Unmaps the shared file
+    static void close();
+    // Checks if shared mode is on
+    static bool isEnabled();
+
+    // Sets the function reloading every data file into the process (called with the mutex held)
+    static void setReloader(std::function<void()> reloader);
+    // Reloads the data if another process wrote since the last load, returning true if it did
+    static bool refresh();
+    // Returns the current data generation (one atomic read of the mapping)
+    static std::uint64_t generation();
+    // Returns the pid of the last writer and the minute of its last write
+    static void lastWrite(int& pid, long long& minute);
+
+    // Holds the shared mutex for an action that modifies data: the data are
+    // refreshed when the lock is taken and the generation is bumped when it
+    // is released, so the other desks reload before their next action.
+    // Does nothing when shared mode is off. With wait false the lock is
+    // only tried: if another desk holds it, acquired() is false.
+    class WriteLock {
+    public:
+        explicit WriteLock(bool wait = true);
+        ~WriteLock();
+        WriteLock(const WriteLock&) = delete;
+        WriteLock& operator=(const WriteLock&) = delete;
+
+        // Checks if the caller may write (the lock is held, or shared mode is off)
+        bool acquired() const { return !skipped; }
+        // Releases without bumping the generation, when nothing was changed after all
+        void noChanges() { changed = false; }
+
+    private:
+        bool locked;
+        bool skipped;
+        bool changed;
+    };
+};
+
+#endif // SHAREDSTORE_HPP
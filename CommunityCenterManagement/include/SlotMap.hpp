@@ -0,0 +1,117 @@
+#ifndef SLOTMAP_HPP
+#define SLOTMAP_HPP
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// Reference to an object stored in a SlotMap: the slot index plus the
+// generation the slot had when the object was stored
+struct SlotHandle {
+    std::uint32_t index = UINT32_MAX;
+    std::uint32_t generation = 0;
+
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Generational slot map owning objects of type T.
+// Objects are constructed in place inside fixed-size blocks that never move,
+// so an object's address stays valid for its whole lifetime, and freed slots
+// are reused through a free list, which keeps live objects packed together.
+// Every slot carries a generation that is bumped when its object is erased:
+// a handle whose generation no longer matches is stale and resolves to
+// nullptr instead of to a freed or reused object.
+template <typename T, size_t BlockSize = 1024>
+class SlotMap {
+public:
+    SlotMap() = default;
+    ~SlotMap() { clear(); }
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    // Constructs an object in a free slot and returns its handle
+    template <typename... Args>
+    SlotHandle emplace(Args&&... args) {
+        std::uint32_t index;
+        if (freeHead != kNoSlot) {
+            index = freeHead;
+            freeHead = slot(index).nextFree;
+        } else {
+            if (slotCount % BlockSize == 0) {
+                blocks.emplace_back(new Slot[BlockSize]);
+            }
+            index = slotCount++;
+        }
+        Slot& target = slot(index);
+        new (target.storage) T(std::forward<Args>(args)...);
+        target.live = true;
+        ++count;
+        return SlotHandle{index, target.generation};
+    }
+
+    // Returns the object a handle refers to, or nullptr if the handle is stale
+    T* get(SlotHandle handle) const {
+        if (handle.index >= slotCount) return nullptr;
+        Slot& target = slot(handle.index);
+        return target.live && target.generation == handle.generation ? target.object() : nullptr;
+    }
+
+    // Destroys the object a handle refers to, returning false if the handle is stale
+    bool erase(SlotHandle handle) {
+        if (!get(handle)) return false;
+        Slot& target = slot(handle.index);
+        target.object()->~T();
+        target.live = false;
+        ++target.generation;
+        target.nextFree = freeHead;
+        freeHead = handle.index;
+        --count;
+        return true;
+    }
+
+    // Visits every live object in slot order
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (std::uint32_t index = 0; index < slotCount; ++index) {
+            Slot& target = slot(index);
+            if (target.live) visit(*target.object());
+        }
+    }
+
+    // Destroys all objects; handles to them become stale
+    void clear() {
+        for (std::uint32_t index = 0; index < slotCount; ++index) {
+            Slot& target = slot(index);
+            if (target.live) erase(SlotHandle{index, target.generation});
+        }
+    }
+
+    // Returns the number of live objects
+    size_t size() const { return count; }
+
+private:
+    static const std::uint32_t kNoSlot = UINT32_MAX;
+
+    // Storage for one object plus its bookkeeping
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::uint32_t generation = 1;  // Starts at 1 so a default handle is never valid
+        std::uint32_t nextFree = kNoSlot;
+        bool live = false;
+
+        T* object() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    std::uint32_t slotCount = 0;
+    std::uint32_t freeHead = kNoSlot;
+    size_t count = 0;
+
+    Slot& slot(std::uint32_t index) const { return blocks[index / BlockSize][index % BlockSize]; }
+};
+
+#endif // SLOTMAP_HPP
@@ -0,0 +1,173 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <iostream>
+#include "Event.hpp"
+#include "Reservation.hpp"
+#include "RecurringEvent.hpp"
+#include "ReservationQuery.hpp"
+
+// Immutable copy of an event as seen by readers
+struct EventSnapshot {
+    std::string eventName;
+    std::string organizer;
+    std::string startTime;
+    std::string endTime;
+    long long startMinute;  // Parsed start time (minutes since the epoch, -1 if invalid)
+    long long endMinute;    // Parsed end time (minutes since the epoch, -1 if invalid)
+    LayoutStyle layoutStyle;
+    bool isPublic;
+    int maxGuests;
+    double ticketPrice;
+    int ticketsSold;
+    std::vector<std::string> waitlist;
+    std::vector<std::pair<int, std::string>> reservations;  // Reservation ID and username
+    int seatCapacity = 0;    // Assigned seats (0 for open seating)
+    int seatsAvailable = 0;
+    std::uint64_t version = 0;  // Render version of the event (Event::getVersion)
+};
+
+// Immutable copy of a reservation as seen by readers
+struct ReservationSnapshot {
+    int reservationID;
+    std::string username;
+    UserType userType;
+    std::string eventName;
+    long long eventDay;  // Day the event starts (days since the epoch, -1 if invalid)
+    ReservationStatus reservationStatus;
+    PaymentStatus paymentStatus;
+    double totalCost;
+    std::string reservationTime;
+    std::string seats;  // Seat labels, empty for open seating
+    std::uint64_t version = 0;  // Render version of the reservation (Reservation::getVersion)
+};
+
+// Reservations whose IDs share a page number (ID / kReservationPageSize), in ID order
+struct ReservationPage {
+    std::vector<std::shared_ptr<const ReservationSnapshot>> reservations;
+};
+
+// Positions of the events of a snapshot
+struct EventLayout {
+    std::map<std::string, size_t> eventIndex;                 // Event name to position in events
+    std::map<long long, std::pair<size_t, size_t>> dayIndex;  // Day to the [first, last) positions of events starting that day
+    long long longestEvent = 0;                               // Longest event duration in minutes
+};
+
+// Immutable, versioned view of the schedule and reservation indexes.
+// Snapshots share structure: a new snapshot copies only the events and
+// reservations whose render version changed, the reservation pages holding
+// those reservations, and the bitmaps they move between. Everything else,
+// including the event layout while no event is added, removed or moved, is
+// the same immutable node the previous snapshot points to.
+struct ScheduleSnapshot {
+    static const int kReservationPageSize = 256;
+
+    std::uint64_t version = 0;
+    std::vector<std::shared_ptr<const EventSnapshot>> events;            // In start time order, undated events last
+    std::shared_ptr<const EventLayout> layout = std::make_shared<EventLayout>();  // Positions of the events
+    std::vector<std::shared_ptr<const RecurringEvent>> recurringEvents;  // Copies of the recurring series, by name
+    std::vector<std::shared_ptr<const ReservationPage>> reservationPages;  // By page number, nullptr for an empty page
+    size_t reservationCount = 0;
+    ReservationIndex reservationIndex;                   // Bitmap indexes over reservations for filter queries
+    std::map<long long, std::uint64_t> daySignatures;    // Fingerprint of each day's events and their reservations
+
+    // Finds an event by name, or nullptr
+    const EventSnapshot* findEvent(const std::string& eventName) const;
+    // Finds a reservation by ID, or nullptr
+    const ReservationSnapshot* findReservation(int reservationID) const;
+    // Returns the events overlapping [start, end) in start order, visiting only the relevant days
+    std::vector<const EventSnapshot*> eventsBetween(long long start, long long end) const;
+
+    // Calls visit for every reservation, in ID order
+    template <typename Visit>
+    void forEachReservation(Visit visit) const {
+        for (const auto& page : reservationPages) {
+            if (!page) continue;
+            for (const auto& reservation : page->reservations) visit(*reservation);
+        }
+    }
+
+    // Builds a snapshot of the given events (in start order), recurring series and reservations, sharing what did not change since previous
+    static ScheduleSnapshot* build(const std::vector<Event*>& events, const std::map<std::string, RecurringEvent*>& recurringEvents,
+                                   const std::map<int, Reservation*>& reservations, const ScheduleSnapshot& previous);
+};
+
+// Prints basic details of an event snapshot
+void printEventDetails(const EventSnapshot& event, std::ostream& out = std::cout);
+// Prints the detailed view of an event snapshot
+void printEventDetailedView(const EventSnapshot& event, std::ostream& out = std::cout);
+// Prints one schedule line "  HH:MM-HH:MM  <name>  (<sold>/<max> tickets)"; ticketsSold -1 marks an unbooked recurring occurrence
+void printScheduleLine(long long start, long long end, const std::string& name, int ticketsSold, int maxGuests, std::ostream& out = std::cout);
+// Prints the date and the schedule lines of the events and recurring occurrences starting on a day, in start order
+void printScheduleDay(const ScheduleSnapshot& snapshot, long long day, std::ostream& out = std::cout);
+// Prints the detailed view of a reservation snapshot
+void printReservationDetails(const ReservationSnapshot& reservation);
+
+// Class publishing schedule snapshots with read-copy-update semantics.
+// Writers build a new snapshot and swap it in atomically; readers pin the
+// current one for as long as they need it without taking any lock. Replaced
+// snapshots are reclaimed once every reader that could still see them has
+// left its read section (epoch-based reclamation).
+class SnapshotStore {
+public:
+    // Maximum number of threads that can read concurrently
+    static const int kMaxReaders = 256;
+
+    // RAII guard pinning the current snapshot
+    class ReadGuard {
+    public:
+        ReadGuard(const SnapshotStore& store);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const ScheduleSnapshot& operator*() const { return *snapshot; }
+        const ScheduleSnapshot* operator->() const { return snapshot; }
+
+    private:
+        const SnapshotStore& store;
+        int readerID;
+        const ScheduleSnapshot* snapshot;
+    };
+
+    SnapshotStore();
+    ~SnapshotStore();
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+    // Pins the current snapshot for reading
+    ReadGuard read() const { return ReadGuard(*this); }
+    // Publishes a new snapshot, taking ownership of it, and retires the previous one
+    void publish(ScheduleSnapshot* snapshot);
+    // Returns the version of the current snapshot
+    std::uint64_t currentVersion() const;
+    // Returns the number of replaced snapshots not reclaimed yet
+    size_t retiredCount() const;
+
+private:
+    // Epoch announced by one reader thread (0 when not reading)
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> epoch{0};
+        int depth = 0;  // Nesting depth, only touched by the owning thread
+    };
+
+    std::atomic<const ScheduleSnapshot*> current;
+    std::atomic<std::uint64_t> globalEpoch;
+    std::uint64_t nextVersion;
+    mutable ReaderSlot readers[kMaxReaders];
+    mutable std::mutex retiredMutex;
+    std::vector<std::pair<std::uint64_t, const ScheduleSnapshot*>> retired;
+
+    // Frees retired snapshots no active reader can still reference
+    void reclaim();
+};
+
+#endif // SNAPSHOT_HPP
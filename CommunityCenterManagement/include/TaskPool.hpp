@@ -0,0 +1,141 @@
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+#include <exception>
+#include <type_traits>
+#include <chrono>
+#include <algorithm>
+
+// Work-stealing task pool shared by every parallel path of the application
+// (index scans, the schedule audit and the analytics reductions).
+// Every worker owns a deque: it pushes and pops its own tasks at the back,
+// which keeps nested work hot in its cache, and when it runs dry it steals
+// the oldest task from the front of another worker's deque. Threads waiting
+// on the pool (in parallelFor or wait) run queued tasks instead of blocking,
+// so nested parallel work cannot deadlock and the calling thread counts as
+// one more worker. Each deque has its own lock, so pushes, pops and steals
+// on different deques never contend.
+class TaskPool {
+public:
+    // Starts a pool with the given number of worker threads (0 runs every task on the caller)
+    explicit TaskPool(unsigned workers);
+    // Finishes the queued tasks and joins the workers
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Sets the worker count of the shared pool; only effective before its first use
+    static void configure(unsigned workers);
+    // Returns the shared pool (one worker per core besides the caller unless configured)
+    static TaskPool& shared();
+
+    // Returns the number of worker threads
+    unsigned workerCount() const { return static_cast<unsigned>(threads.size()); }
+    // Returns the number of threads working on a parallel loop (the workers and the caller)
+    unsigned concurrency() const { return workerCount() + 1; }
+
+    // Queues a task and returns a future for its result
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task);
+    // Waits for a future, running queued tasks meanwhile, and returns its result
+    template <typename T>
+    T wait(std::future<T>& future);
+    // Calls body(first, last) on chunks of at most grain indices covering [begin, end) and waits for all of them
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F body);
+
+private:
+    using Task = std::function<void()>;
+
+    // Deque of one worker (the last one is shared by threads outside the pool)
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued;  // Tasks in all deques, for idle workers to sleep on
+    bool stopping = false;       // Guarded by sleepMutex
+
+    // Pushes a task onto the deque of the calling worker (or the shared one)
+    void push(Task task);
+    // Runs one queued task, own deque first, then stolen; returns false if none was found
+    bool runOne();
+    // Loop of a worker thread
+    void workerLoop(size_t index);
+};
+
+// Queues a task and returns a future for its result
+template <typename F>
+std::future<typename std::result_of<F()>::type> TaskPool::submit(F task) {
+    using Result = typename std::result_of<F()>::type;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> future = packaged->get_future();
+    if (threads.empty()) {
+        (*packaged)();  // Nobody else could run it
+    } else {
+        push([packaged]() { (*packaged)(); });
+    }
+    return future;
+}
+
+// Waits for a future, running queued tasks meanwhile
+template <typename T>
+T TaskPool::wait(std::future<T>& future) {
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!runOne()) std::this_thread::yield();
+    }
+    return future.get();
+}
+
+// Calls body(first, last) on chunks of [begin, end) and waits for all of them
+template <typename F>
+void TaskPool::parallelFor(size_t begin, size_t end, size_t grain, F body) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+    size_t chunks = (end - begin + grain - 1) / grain;
+    if (chunks == 1 || threads.empty()) {
+        for (size_t first = begin; first < end; first += grain) {
+            body(first, std::min(end, first + grain));
+        }
+        return;
+    }
+    // The chunks refer to this frame, so the caller waits here until the last one has finished
+    std::atomic<size_t> remaining(chunks);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto runChunk = [&](size_t first, size_t last) {
+        try {
+            body(first, last);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure) failure = std::current_exception();
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    };
+    // The caller takes the first chunk itself
+    for (size_t first = begin + grain; first < end; first += grain) {
+        size_t last = std::min(end, first + grain);
+        push([&runChunk, first, last]() { runChunk(first, last); });
+    }
+    runChunk(begin, std::min(end, begin + grain));
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne()) std::this_thread::yield();
+    }
+    if (failure) std::rethrow_exception(failure);
+}
+
+#endif // TASKPOOL_HPP
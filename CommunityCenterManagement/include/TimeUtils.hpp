@@ -0,0 +1,36 @@
+#ifndef TIMEUTILS_HPP
+#define TIMEUTILS_HPP
+
+#include <string>
+
+// Time helpers working on the "YYYY-MM-DDTHH:MM" format used throughout the data files.
+// Times are converted to minutes since 1970-01-01T00:00 on the civil calendar (no time
+// zone or daylight saving adjustments), which makes comparisons and arithmetic exact.
+
+// Number of minutes in a day
+const long long kMinutesPerDay = 24 * 60;
+
+// Converts a civil date to days since 1970-01-01
+long long daysFromCivil(int year, int month, int day);
+// Converts days since 1970-01-01 to a civil date
+void civilFromDays(long long days, int& year, int& month, int& day);
+// Returns the number of days in a month
+int daysInMonth(int year, int month);
+// Returns the day of the week (0 = Monday ... 6 = Sunday) for days since 1970-01-01
+int weekdayFromDays(long long days);
+
+// Parses "YYYY-MM-DDTHH:MM" into minutes since the epoch, returning false if malformed
+bool parseTimestamp(const std::string& text, long long& minutes);
+// Parses "YYYY-MM-DD" into days since the epoch, returning false if malformed
+bool parseDate(const std::string& text, long long& days);
+// Formats minutes since the epoch as "YYYY-MM-DDTHH:MM"
+std::string formatTimestamp(long long minutes);
+// Formats days since the epoch as "YYYY-MM-DD"
+std::string formatDate(long long days);
+
+// Returns the day (days since the epoch) containing the given minute
+long long dayOfMinute(long long minutes);
+// Returns the current local time in minutes since the epoch
+long long currentMinutes();
+
+#endif // TIMEUTILS_HPP
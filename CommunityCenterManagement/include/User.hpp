@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include "SlotMap.hpp"
 
 // Enums for different user types
 enum class UserType {
@@ -15,6 +16,13 @@ enum class UserType {
 
 class Reservation; // Forward declaration
 
+// Time range booked by one of a user's reservations (the event's start and end, in minutes since the epoch)
+struct BookedInterval {
+    long long start;
+    long long end;
+    SlotHandle reservation;
+};
+
 // Base class representing a user
 class User {
 protected:
@@ -22,26 +30,49 @@ protected:
     std::string password;
     UserType userType;
     int weeklyReservationHours;
-    std::vector<Reservation*> userReservations;
+    std::vector<SlotHandle> userReservations;  // Handles into the reservation slot map
+    // Personal calendar: the time ranges of the live (not canceled) reservations, sorted by start,
+    // and for every position the index of the range reaching furthest among those up to it, so
+    // an overlap check is one binary search
+    std::vector<BookedInterval> bookings;
+    std::vector<size_t> furthestBooking;
+
+    // Adds or removes the time range of a reservation in the personal calendar
+    void addBooking(const Reservation* reservation);
+    void removeBooking(SlotHandle reservation);
 
 public:
     User(const std::string& username, const std::string& password, UserType userType);
     virtual ~User() = default;
 
-    std::string getUsername() const { return username; }
+    const std::string& getUsername() const { return username; }
     UserType getUserType() const { return userType; }
-    std::string getPassword() const { return password; }
+    const std::string& getPassword() const { return password; }
+    void setPassword(const std::string& password) { this->password = password; }
     int getWeeklyReservationHours() const { return weeklyReservationHours; }
-    const std::vector<Reservation*>& getUserReservations() const { return userReservations; }
+    std::vector<Reservation*> getUserReservations() const;  // Resolves the handles, skipping destroyed reservations
+    Reservation* findReservation(const std::string& eventName) const;  // Returns the user's reservation for an event, or nullptr (no allocation)
 
     // Adds a reservation to the user
     void addReservation(Reservation* reservation);  
+    // Removes a reservation from the user
+    void removeReservation(Reservation* reservation);
+    // Forgets every reservation at once (before all reservations are freed and reloaded)
+    void clearReservations();
+    // Updates the personal calendar after a reservation was canceled or its event moved
+    void refreshBooking(const Reservation* reservation);
+    // Returns a live reservation whose event overlaps [start, end), or nullptr (O(log k))
+    Reservation* findConflict(long long start, long long end) const;
+    // Returns the live reservations whose events start at or after now, in start order
+    std::vector<Reservation*> getUpcomingReservations(long long now) const;
     // Adds reservation hours to the user
     void addReservationHours(int hours);  
     // Subtracts reservation hours from the user
     void subtractReservationHours(int hours);  
     // Checks if the user has exceeded their weekly reservation limit
     bool checkWeeklyLimit(int duration) const;  
+    // Returns the weekly reservation limit in hours for the user's type
+    int getWeeklyLimit() const;
 
     // Logs the user in
     virtual void login();  
@@ -51,8 +82,6 @@ public:
     virtual void viewSchedule();  
     // Makes a reservation for the user
     virtual void makeReservation();  
-    // Cancels a reservation for the user
-    virtual void cancelReservation(int reservationID);  
     // Views the user's reservations
     virtual void viewReservations();  
     // Edits the user's information
@@ -0,0 +1,35 @@
+#ifndef USERPROVISIONER_HPP
+#define USERPROVISIONER_HPP
+
+#include <string>
+#include <map>
+#include "User.hpp"
+
+// Outcome of a bulk provisioning run
+struct ProvisionResult {
+    int accepted = 0;        // Accounts created
+    int rejected = 0;        // Rows written to the reject report
+    bool committed = false;  // Whether the accepted accounts were saved
+};
+
+// Class creating many user accounts at once.
+// Creating accounts one by one probes the registry and rewrites all of
+// users.txt per account. Here the whole list is read first and sorted by
+// username, so duplicates inside the list sit next to each other. A Bloom
+// filter built over the existing usernames clears most new names outright;
+// only the names it flags are confirmed by a sorted merge against the
+// registry. The new users are then inserted in one pass and appended to
+// users.txt in a single write.
+//
+// Input rows use the users.txt format:
+//   username password Type
+// where Type is City, Organization, Resident or NonResident. Blank lines and
+// lines starting with '#' are skipped. Existing accounts always win a
+// collision; between two rows of the list the earlier one wins.
+class UserProvisioner {
+public:
+    // Creates the accounts listed in a file, saves them with one write and writes rejects to reportFilename
+    static ProvisionResult provisionUsers(const std::string& filename, const std::string& reportFilename, std::map<std::string, User*>& users);
+};
+
+#endif // USERPROVISIONER_HPP
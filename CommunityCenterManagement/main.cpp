@@ -1,11 +1,35 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <optional>
 #include "User.hpp"
 #include "Event.hpp"
 #include "Reservation.hpp"
+#include "RecurringEvent.hpp"
 #include "FacilityManager.hpp"
 #include "HelperFunctions.hpp"
+#include "Metrics.hpp"
+#include "Server.hpp"
+#include "EventImporter.hpp"
+#include "ScheduleAudit.hpp"
+#include "ReservationStore.hpp"
+#include "Archive.hpp"
+#include "Analytics.hpp"
+#include "TimeUtils.hpp"
+#include "HoldExpiry.hpp"
+#include "TaskPool.hpp"
+#include "ComplexityCheck.hpp"
+#include "AllocationCheck.hpp"
+#include "DiskSnapshot.hpp"
+#include "SharedStore.hpp"
+#include "FlashSale.hpp"
+#include "RenderCache.hpp"
+#include "UserProvisioner.hpp"
+#include <fstream>
 
 // Displays the main menu
 void displayMenu() {
@@ -25,21 +49,261 @@ void displayMenu() {
     std::cout << "14. View Facility Budget" << std::endl;
     std::cout << "15. Logout" << std::endl;
     std::cout << "16. Exit" << std::endl;
+    std::cout << "17. View Performance Metrics" << std::endl;
+    std::cout << "18. Create a Recurring Event" << std::endl;
+    std::cout << "19. View Recurring Event Occurrences" << std::endl;
+    std::cout << "20. Import Events from File" << std::endl;
+    std::cout << "21. Audit All Events and Reservations" << std::endl;
+    std::cout << "22. View Archive Reports" << std::endl;
+    std::cout << "23. Query Reservations" << std::endl;
+    std::cout << "24. View Utilization Analytics" << std::endl;
+    std::cout << "25. Priority Booking (City)" << std::endl;
+    std::cout << "26. Door Check-In" << std::endl;
+    std::cout << "27. Take a Snapshot (City)" << std::endl;
+    std::cout << "28. Provision Users from File" << std::endl;
+}
+
+// Registers one latency metric per menu handler, indexed by menu choice
+static std::vector<int> registerMenuMetrics() {
+    const char* names[] = {"menu_invalid", "menu_login", "menu_create_user", "menu_view_schedule", "menu_make_reservation",
+                           "menu_cancel_reservation", "menu_view_user_reservations", "menu_edit_user", "menu_list_reservations",
+                           "menu_view_event", "menu_view_reservation", "menu_create_event", "menu_cancel_event",
+                           "menu_make_payment", "menu_view_budget", "menu_logout", "menu_exit", "menu_view_metrics",
+                           "menu_create_recurring_event", "menu_view_recurring_occurrences", "menu_import_events", "menu_audit",
+                           "menu_archive_reports", "menu_query_reservations", "menu_analytics",
+                           "menu_priority_booking", "menu_check_in", "menu_snapshot", "menu_provision_users"};
+    std::vector<int> metrics;
+    for (const char* name : names) {
+        metrics.push_back(Metrics::registerMetric(name));
+    }
+    return metrics;
+}
+
+// Prints command line usage
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--server unix:<path>|tcp:<port>] [--import-events <file>] [--provision-users <file>] [--audit] [--audit-report <path>] [--query <filter>] [--analytics <path>] [--reservation-horizon <days>] [--reservation-cache <count>] [--archive-months <n>] [--metrics-file <path>] [--metrics-interval <seconds>] [--no-metrics] [--workers <n>] [--complexity-check] [--allocation-check] [--render-check] [--snapshot-interval <minutes>] [--shared-store <path>]" << std::endl;
+    std::cout << "  --server               Serve requests on a local socket instead of the interactive menu" << std::endl;
+    std::cout << "  --import-events        Import events from a file, write rejects to <file>.rejects.txt and exit" << std::endl;
+    std::cout << "  --provision-users      Create the accounts listed in a file, write rejects to <file>.rejects.txt and exit" << std::endl;
+    std::cout << "  --audit                Audit all events and reservations at startup and print a summary" << std::endl;
+    std::cout << "  --audit-report         Audit at startup and write every finding to a file" << std::endl;
+    std::cout << "  --query                Print the reservations matching a filter (e.g. \"status=Pending payment=Unpaid\") and exit" << std::endl;
+    std::cout << "  --analytics            Write the utilization report as CSV to a file and exit" << std::endl;
+    std::cout << "  --reservation-horizon  Load reservations of events that ended up to this many days ago at startup (default 30)" << std::endl;
+    std::cout << "  --reservation-cache    Older reservations kept in memory after being paged in (default 100000)" << std::endl;
+    std::cout << "  --archive-months       Move events that ended before the last n months and their reservations into the archive, at startup and as months pass" << std::endl;
+    std::cout << "  --metrics-file         Periodically dump metrics (JSON if the path ends in .json, Prometheus text otherwise)" << std::endl;
+    std::cout << "  --metrics-interval     Seconds between metric dumps (default 10)" << std::endl;
+    std::cout << "  --no-metrics           Disable metric collection" << std::endl;
+    std::cout << "  --workers              Worker threads of the shared task pool besides the main thread (default one fewer than the cores)" << std::endl;
+    std::cout << "  --complexity-check     Measure how the hot paths scale on synthetic data, exit 1 if one grew beyond its budget" << std::endl;
+    std::cout << "  --allocation-check     Count heap allocations of the booking hot paths, exit 1 if one allocates in steady state (make allocation-check build only)" << std::endl;
+    std::cout << "  --render-check         Check the cached schedule and event views against fresh renderings through every kind of change, exit 1 on a mismatch" << std::endl;
+    std::cout << "  --snapshot-interval    Write a background snapshot of the data to data/snapshots every n minutes" << std::endl;
+    std::cout << "  --shared-store         Share the data with other local processes started with the same file (e.g. data/shared.store)" << std::endl;
+}
+
+// Runs the socket server on the given endpoint until it is stopped
+bool runServer(const std::string& endpoint, FacilityManager& facilityManager, std::map<std::string, User*>& users,
+               std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations) {
+    Server server(facilityManager, users, events, reservations);
+    bool listening = false;
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        listening = server.listenUnix(endpoint.substr(5));
+    } else if (endpoint.compare(0, 4, "tcp:") == 0) {
+        listening = server.listenTcp(std::atoi(endpoint.substr(4).c_str()));
+    } else {
+        std::cerr << "Error: Unknown server endpoint " << endpoint << std::endl;
+    }
+    if (!listening) {
+        return false;
+    }
+    server.run();
+    return true;
 }
 
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
+    std::string serverEndpoint;
+    std::string metricsFile;
+    std::string importFile;
+    std::string provisionFile;
+    std::string auditReportFile;
+    std::string queryFilter;
+    bool query = false;
+    std::string analyticsFile;
+    bool audit = false;
+    int reservationHorizonDays = 30;
+    size_t reservationCache = 100000;
+    int archiveMonths = -1;
+    int metricsInterval = 10;
+    bool complexityCheck = false;
+    bool allocationCheck = false;
+    bool renderCheck = false;
+    std::string sharedStoreFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--server" && i + 1 < argc) {
+            serverEndpoint = argv[++i];
+        } else if (arg == "--import-events" && i + 1 < argc) {
+            importFile = argv[++i];
+        } else if (arg == "--provision-users" && i + 1 < argc) {
+            provisionFile = argv[++i];
+        } else if (arg == "--audit") {
+            audit = true;
+        } else if (arg == "--audit-report" && i + 1 < argc) {
+            audit = true;
+            auditReportFile = argv[++i];
+        } else if (arg == "--query" && i + 1 < argc) {
+            query = true;
+            queryFilter = argv[++i];
+        } else if (arg == "--analytics" && i + 1 < argc) {
+            analyticsFile = argv[++i];
+        } else if (arg == "--reservation-horizon" && i + 1 < argc) {
+            reservationHorizonDays = std::atoi(argv[++i]);
+        } else if (arg == "--reservation-cache" && i + 1 < argc) {
+            reservationCache = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--archive-months" && i + 1 < argc) {
+            archiveMonths = std::atoi(argv[++i]);
+        } else if (arg == "--metrics-file" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::atoi(argv[++i]);
+        } else if (arg == "--no-metrics") {
+            Metrics::setEnabled(false);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            TaskPool::configure(static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        } else if (arg == "--complexity-check") {
+            complexityCheck = true;
+        } else if (arg == "--snapshot-interval" && i + 1 < argc) {
+            DiskSnapshot::setInterval(std::atoi(argv[++i]));
+        } else if (arg == "--shared-store" && i + 1 < argc) {
+            sharedStoreFile = argv[++i];
+        } else if (arg == "--allocation-check") {
+            allocationCheck = true;
+        } else if (arg == "--render-check") {
+            renderCheck = true;
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (complexityCheck) {
+        // Runs on synthetic data only, before anything is loaded
+        std::vector<ScalingResult> results = ComplexityCheck::run();
+        ComplexityCheck::print(std::cout, results);
+        bool passed = std::all_of(results.begin(), results.end(), [](const ScalingResult& result) { return result.passed(); });
+        return passed ? 0 : 1;
+    }
+    if (allocationCheck) {
+        if (!AllocationCheck::available()) {
+            std::cerr << "Error: This build does not count allocations; build it with make allocation-check." << std::endl;
+            return 1;
+        }
+        std::vector<AllocationResult> results = AllocationCheck::run();
+        AllocationCheck::print(std::cout, results);
+        bool passed = std::all_of(results.begin(), results.end(), [](const AllocationResult& result) { return result.passed(); });
+        return passed ? 0 : 1;
+    }
+    if (renderCheck) {
+        std::vector<RenderCheckResult> results = RenderCache::runCheck();
+        RenderCache::printCheck(std::cout, results);
+        bool passed = std::all_of(results.begin(), results.end(), [](const RenderCheckResult& result) { return result.passed(); });
+        return passed ? 0 : 1;
+    }
+    if (!metricsFile.empty()) {
+        Metrics::startPeriodicDump(metricsFile, metricsInterval);
+    }
+    const std::vector<int> menuMetrics = registerMenuMetrics();
+    // Attach before loading, so any write by another desk from now on triggers a reload
+    if (!sharedStoreFile.empty() && !SharedStore::open(sharedStoreFile)) {
+        return 1;
+    }
+
     FacilityManager facilityManager;
     std::map<std::string, User*> users = User::loadUsers("data/users.txt");
     std::map<std::string, Event*> events = Event::loadEvents("data/events.txt", users);
-    std::map<int, Reservation*> reservations = Reservation::loadReservations("data/reservations.txt", users, events);
+    if (archiveMonths >= 0) {
+        // Everything that ended before the first day of the month archiveMonths months ago is closed
+        long long cutoff = Archive::monthCutoff(currentMinutes(), archiveMonths);
+        ArchiveResult archived = Archive::archiveBefore(cutoff, events);
+        std::cout << "Archived " << archived.events << " event(s) and " << archived.reservations << " reservation(s) into "
+                  << archived.segments << " segment(s)." << std::endl;
+    }
+    // Only reservations of recent and upcoming events are loaded, older ones are paged in on demand
+    long long horizonStart = currentMinutes() - static_cast<long long>(reservationHorizonDays) * kMinutesPerDay;
+    std::map<int, Reservation*> reservations = ReservationStore::open("data/reservations.txt", users, events, horizonStart, reservationCache);
+    ReservationStore::reserveIDs(Archive::maxReservationID());
+    std::map<std::string, RecurringEvent*> recurringEvents = RecurringEvent::loadRecurringEvents("data/recurring.txt", users);
 
     for (const auto& pair : events) {
         facilityManager.addEvent(pair.second);
     }
+    for (const auto& pair : recurringEvents) {
+        facilityManager.getSchedule().addRecurringEvent(pair.second);
+    }
+    // Unpaid holds expire on a timing wheel that is advanced before every action
+    HoldExpiry::loadPolicy("data/hold_ttl.txt");
+    HoldExpiry::rebuild(reservations, currentMinutes());
+    // Purchases for hot events are queued and admitted in batches
+    FlashSale::loadPolicy("data/flash_sale.txt");
+    facilityManager.getSchedule().publishSnapshot(reservations);
+    SharedStore::setReloader([&]() {
+        reloadData(facilityManager, users, events, reservations, recurringEvents, horizonStart, reservationCache);
+    });
+    if (archiveMonths >= 0) {
+        // Later months are archived as the clock reaches them, with the data saved first and reloaded after
+        Archive::setHorizon(archiveMonths, Archive::monthCutoff(currentMinutes(), archiveMonths), [&](long long cutoff) {
+            SharedStore::WriteLock archiveLock(false);
+            if (!archiveLock.acquired()) return false;
+            Event::saveEvents("data/events.txt", events);
+            Reservation::saveReservations("data/reservations.txt", reservations);
+            reloadData(facilityManager, users, events, reservations, recurringEvents, horizonStart, reservationCache, cutoff);
+            return true;
+        });
+    }
+
+    if (audit) {
+        AuditReport report = ScheduleAudit::run(facilityManager.getSchedule(), reservations);
+        report.print(std::cout, 20);
+        if (!auditReportFile.empty()) {
+            std::ofstream reportFile(auditReportFile);
+            if (reportFile.is_open()) {
+                report.print(reportFile, 0);
+            } else {
+                std::cerr << "Error: Unable to open file " << auditReportFile << std::endl;
+            }
+        }
+    }
 
     bool running = true;
     User* loggedInUser = nullptr;
+    int exitCode = 0;
+
+    if (!importFile.empty()) {
+        running = false;
+        SharedStore::WriteLock importLock;
+        ImportResult result = EventImporter::importEvents(importFile, importFile + ".rejects.txt", events, users, facilityManager.getSchedule());
+        std::cout << "Imported " << result.accepted << " event(s), rejected " << result.rejected << "." << std::endl;
+        exitCode = (result.committed || result.rejected == 0) ? 0 : 1;
+    } else if (!provisionFile.empty()) {
+        running = false;
+        SharedStore::WriteLock provisionLock;
+        ProvisionResult result = UserProvisioner::provisionUsers(provisionFile, provisionFile + ".rejects.txt", users);
+        std::cout << "Provisioned " << result.accepted << " user(s), rejected " << result.rejected << "." << std::endl;
+        exitCode = (result.committed || result.rejected == 0) ? 0 : 1;
+    } else if (query) {
+        running = false;
+        exitCode = printReservationQuery(facilityManager.getSchedule(), queryFilter, 0) ? 0 : 1;
+    } else if (!analyticsFile.empty()) {
+        running = false;
+        AnalyticsReport report = Analytics::refresh(*facilityManager.getSchedule().getSnapshots().read());
+        report.print(std::cout);
+        exitCode = report.writeCsv(analyticsFile) ? 0 : 1;
+    } else if (!serverEndpoint.empty()) {
+        running = false;
+        exitCode = runServer(serverEndpoint, facilityManager, users, events, reservations) ? 0 : 1;
+    }
 
     while (running) {
         displayMenu();
@@ -56,6 +320,29 @@ int main() {
         
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // clear the newline character
 
+        // In shared mode, catch up with the other desks first; commands that modify data hold the shared lock throughout
+        const bool writesData = choice == 2 || choice == 4 || choice == 5 || choice == 7 || choice == 11 || choice == 12 || choice == 13 ||
+                                choice == 18 || choice == 20 || choice == 25 || choice == 28;
+        SharedStore::refresh();
+        std::optional<SharedStore::WriteLock> writeLock;
+        if (writesData) {
+            writeLock.emplace();
+        }
+        {
+            // Holds are expired by whichever desk gets the lock; a busy lock just postpones them
+            SharedStore::WriteLock holdLock(false);
+            std::string expiries;
+            if (holdLock.acquired() && HoldExpiry::advance(currentMinutes(), reservations, events, expiries) > 0) {
+                facilityManager.getSchedule().publishSnapshot(reservations);
+                std::cout << expiries << std::endl;
+            } else {
+                holdLock.noChanges();
+            }
+        }
+        DiskSnapshot::tick(currentMinutes(), facilityManager, users, events, reservations);
+        Archive::tick(currentMinutes());
+
+        ScopedTimer menuTimer(choice > 0 && choice < static_cast<int>(menuMetrics.size()) ? menuMetrics[choice] : menuMetrics[0]);
         switch (choice) {
             case 1:
                 loggedInUser = handleLogin(users);
@@ -64,10 +351,10 @@ int main() {
                 handleUserCreation(users);
                 break;
             case 3:
-                facilityManager.getSchedule().viewSchedule();
+                viewScheduleByRange(facilityManager.getSchedule());
                 break;
             case 4:
-                handleReservation(facilityManager.getSchedule(), loggedInUser, reservations);
+                handleReservation(facilityManager.getSchedule(), events, loggedInUser, reservations);
                 break;
             case 5:
                 handleCancellation(loggedInUser, reservations, facilityManager);
@@ -80,20 +367,16 @@ int main() {
                 }
                 break;
             case 7:
-                if (loggedInUser) {
-                    loggedInUser->editUserInfo();
-                } else {
-                    std::cout << "Please login first." << std::endl;
-                }
+                handleUserEdit(loggedInUser, events, reservations, facilityManager.getSchedule());
                 break;
             case 8:
-                listAllReservations(reservations);
+                listAllReservations(facilityManager.getSchedule());
                 break;
             case 9:
-                viewDetailedEvent(facilityManager.getSchedule());
+                viewDetailedEvent(facilityManager.getSchedule(), reservations);
                 break;
             case 10:
-                viewDetailedReservation(reservations);
+                viewDetailedReservation(facilityManager.getSchedule(), reservations);
                 break;
             case 11:
                 createEvent(facilityManager, events, users, facilityManager.getSchedule());
@@ -118,21 +401,69 @@ int main() {
             case 16:
                 running = false;
                 break;
+            case 17:
+                Metrics::printSummary(std::cout);
+                break;
+            case 18:
+                createRecurringEvent(recurringEvents, users, facilityManager.getSchedule());
+                break;
+            case 19:
+                viewRecurringOccurrences(facilityManager.getSchedule());
+                break;
+            case 20:
+                handleEventImport(events, users, facilityManager.getSchedule());
+                break;
+            case 21:
+                ScheduleAudit::run(facilityManager.getSchedule(), reservations).print(std::cout, 20);
+                break;
+            case 22:
+                viewArchiveReports();
+                break;
+            case 23:
+                handleReservationQuery(facilityManager.getSchedule());
+                break;
+            case 24:
+                viewUtilizationAnalytics(facilityManager.getSchedule());
+                break;
+            case 25:
+                handlePriorityBooking(loggedInUser, facilityManager, events, reservations);
+                break;
+            case 26:
+                handleCheckIn(loggedInUser, facilityManager.getSchedule(), reservations);
+                break;
+            case 27:
+                handleSnapshot(loggedInUser, facilityManager, users, events, reservations);
+                break;
+            case 28:
+                handleUserProvisioning(users);
+                break;
             default:
                 std::cout << "Invalid choice. Please try again." << std::endl;
         }
+
+        // Commands that modify events or reservations end a write batch: publish it to readers
+        if (choice == 4 || choice == 5 || choice == 11 || choice == 12 || choice == 13 || choice == 18 || choice == 20 || choice == 25) {
+            facilityManager.getSchedule().publishSnapshot(reservations);
+        }
     }
 
+    // A snapshot still being written is completed before the process exits
+    DiskSnapshot::finish();
+    SharedStore::close();
+    Metrics::stopPeriodicDump();
+    ReservationStore::close();
+
     // Clean up dynamically allocated memory
+    Reservation::destroyAll();
     for (auto& pair : users) {
         delete pair.second;
     }
     for (auto& pair : events) {
         delete pair.second;
     }
-    for (auto& pair : reservations) {
+    for (auto& pair : recurringEvents) {
         delete pair.second;
     }
 
-    return 0;
+    return exitCode;
 }
@@ -0,0 +1,143 @@
+#include "AllocationCheck.hpp"
+#include "FacilityManager.hpp"
+#include "Reservation.hpp"
+#include "HelperFunctions.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <cstdlib>
+#include <new>
+
+// Allocations made by this thread; plain thread-local storage, so counting needs no allocation itself
+static thread_local std::uint64_t threadAllocations = 0;
+
+// The counting allocator replaces the global one for the whole program, so only the check build
+// (make allocation-check) compiles it in; the regular build keeps the standard allocator
+#ifdef CCM_ALLOCATION_CHECK
+
+// Allocates size bytes, counting the allocation
+static void* countedAllocate(std::size_t size) {
+    ++threadAllocations;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++threadAllocations;
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    ++threadAllocations;
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+#endif // CCM_ALLOCATION_CHECK
+
+// Stream buffer dropping everything written to it (unlike a string stream it never grows)
+class DiscardBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Checks if this build counts allocations
+bool AllocationCheck::available() {
+#ifdef CCM_ALLOCATION_CHECK
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Returns the number of heap allocations made so far by the calling thread
+std::uint64_t AllocationCheck::allocationCount() {
+    return threadAllocations;
+}
+
+// Runs every hot path calls times and returns the allocations counted for each
+std::vector<AllocationResult> AllocationCheck::run(std::uint64_t calls) {
+    FacilityManager facilityManager;
+    Schedule& schedule = facilityManager.getSchedule();
+    std::vector<User*> users = {
+        new CityUser("allocation_check_city_user", "password"),
+        new OrganizationUser("allocation_check_organization", "password"),
+        new ResidentUser("allocation_check_resident_user", "password"),
+        new NonResidentUser("allocation_check_nonresident_user", "password"),
+    };
+    long long firstDay = daysFromCivil(2030, 1, 1);
+    std::vector<Event*> events;
+    for (int i = 0; i < 8; ++i) {
+        long long start = (firstDay + i) * kMinutesPerDay + 10 * 60;
+        events.push_back(new Event("allocation_check_event_" + std::to_string(i), users[0], formatTimestamp(start), formatTimestamp(start + 180),
+                                   i % 2 ? LayoutStyle::Lecture : LayoutStyle::Meeting, true, 10000, 25.0));
+        facilityManager.addEvent(events.back());
+    }
+    std::vector<Reservation*> reservations;
+    for (size_t i = 0; i < events.size(); ++i) {
+        reservations.push_back(Reservation::create(static_cast<int>(i) + 1, users[i % users.size()], events[i], events[i]->getStartTime()));
+    }
+    std::string freeStart = formatTimestamp((firstDay + 20) * kMinutesPerDay + 10 * 60);
+    std::string freeEnd = formatTimestamp((firstDay + 20) * kMinutesPerDay + 12 * 60);
+    const std::string& eventName = events[3]->getEventName();
+    long long takenStart;
+    parseTimestamp(events[5]->getStartTime(), takenStart);
+
+    std::string message;  // Reused like a request handler's message, so it only grows during the warm-up
+    std::vector<std::pair<std::string, std::function<void(std::uint64_t)>>> operations = {
+        {"check_availability", [&](std::uint64_t i) {
+             if (i % 2) schedule.checkAvailability(freeStart, freeEnd);
+             else schedule.checkAvailability(events[i % events.size()]->getStartTime(), events[i % events.size()]->getEndTime());
+         }},
+        {"calculate_cost", [&](std::uint64_t i) { reservations[i % reservations.size()]->calculateCost(); }},
+        {"purchase_ticket", [&](std::uint64_t i) { events[i % events.size()]->purchaseTicket(users[i % users.size()], 1 + static_cast<int>(i % 3), message); }},
+        {"cancel_ticket", [&](std::uint64_t i) { events[i % events.size()]->cancelTicket(users[i % users.size()], 1 + static_cast<int>(i % 3), message); }},
+        {"find_user_reservation", [&](std::uint64_t) { findUserReservation(users[3], eventName); }},
+        {"make_payment", [&](std::uint64_t i) { reservations[i % reservations.size()]->makePayment(facilityManager, message); }},
+        {"process_refund", [&](std::uint64_t i) { reservations[i % reservations.size()]->processRefund(facilityManager, message); }},
+        {"find_conflict", [&](std::uint64_t i) { users[i % users.size()]->findConflict(takenStart, takenStart + 60); }},
+    };
+
+    // Some operations still print (availability, budget); the default stream buffers are kept out of the count
+    DiscardBuffer discard;
+    std::streambuf* console = std::cout.rdbuf(&discard);
+    std::vector<AllocationResult> results;
+    for (int warm = 0; warm < 2; ++warm) {
+        for (auto& operation : operations) {
+            for (std::uint64_t i = 0; i < reservations.size(); ++i) operation.second(i);
+        }
+    }
+    for (auto& operation : operations) {
+        AllocationResult result;
+        result.operation = operation.first;
+        result.calls = calls;
+        std::uint64_t before = allocationCount();
+        for (std::uint64_t i = 0; i < calls; ++i) operation.second(i);
+        result.allocations = allocationCount() - before;
+        results.push_back(result);
+    }
+    std::cout.rdbuf(console);
+
+    for (Event* event : events) delete event;
+    for (User* user : users) delete user;
+    // Runs before any real reservation is loaded, so every slot is synthetic
+    Reservation::destroyAll();
+    return results;
+}
+
+// Prints the results as a table
+void AllocationCheck::print(std::ostream& out, const std::vector<AllocationResult>& results) {
+    out << std::left << std::setw(24) << "Operation" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Allocations" << "  Result"
+        << std::endl;
+    for (const AllocationResult& result : results) {
+        out << std::left << std::setw(24) << result.operation << std::right << std::setw(10) << result.calls << std::setw(14)
+            << result.allocations << "  " << (result.passed() ? "ok" : "ALLOCATES") << std::endl;
+    }
+}
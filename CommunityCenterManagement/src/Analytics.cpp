@@ -0,0 +1,295 @@
+#include "Analytics.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include "TaskPool.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <climits>
+
+static const int kAnalyticsMetric = Metrics::registerMetric("analytics_refresh");
+
+static const char* kLayoutNames[] = {"Meeting", "Lecture", "Wedding", "Dance"};
+static const char* kWeekdayNames[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+// Aggregates of one day as of the last refresh
+struct CachedDay {
+    std::uint64_t signature = 0;
+    long long validUntil = LLONG_MAX;  // When an event of the day ends and its reservations have to be counted again
+    UtilizationTotals totals;
+};
+
+// Day that has to be aggregated again
+struct DirtyDay {
+    long long day;
+    std::pair<size_t, size_t> events;  // [first, last) positions in the snapshot
+    std::uint64_t signature;
+};
+
+static std::mutex cacheMutex;
+static std::map<long long, CachedDay> cache;
+
+// Adds another set of aggregates to this one
+void UtilizationTotals::add(const UtilizationTotals& other) {
+    for (int i = 0; i < kHoursPerWeek; ++i) bookedMinutes[i] += other.bookedMinutes[i];
+    for (int i = 0; i < kFillBuckets; ++i) fillHistogram[i] += other.fillHistogram[i];
+    for (int i = 0; i < kLayouts; ++i) {
+        layoutEvents[i] += other.layoutEvents[i];
+        layoutMinutes[i] += other.layoutMinutes[i];
+    }
+    events += other.events;
+    ticketsSold += other.ticketsSold;
+    capacity += other.capacity;
+    canceledReservations += other.canceledReservations;
+    endedReservations += other.endedReservations;
+    noShows += other.noShows;
+}
+
+// Spreads the minutes [start, end) over the hours of the week they fall into
+static void addBookedMinutes(UtilizationTotals& totals, long long start, long long end) {
+    while (start < end) {
+        long long day = dayOfMinute(start);
+        long long hourEnd = (start / 60 + 1) * 60;
+        int slot = weekdayFromDays(day) * 24 + static_cast<int>((start - day * kMinutesPerDay) / 60);
+        totals.bookedMinutes[slot] += std::min(end, hourEnd) - start;
+        start = hourEnd;
+    }
+}
+
+// Aggregates the events starting on one day and their reservations
+static void aggregateDay(const ScheduleSnapshot& snapshot, const DirtyDay& dirty, long long now, CachedDay& result) {
+    result.signature = dirty.signature;
+    UtilizationTotals& totals = result.totals;
+    std::unordered_map<std::string, long long> endMinutes;
+    for (size_t i = dirty.events.first; i < dirty.events.second; ++i) {
+        const EventSnapshot& event = *snapshot.events[i];
+        int layout = static_cast<int>(event.layoutStyle);
+        ++totals.events;
+        totals.ticketsSold += event.ticketsSold;
+        totals.capacity += event.maxGuests;
+        if (event.maxGuests > 0) {
+            long long bucket = static_cast<long long>(event.ticketsSold) * 10 / event.maxGuests;
+            ++totals.fillHistogram[std::min<long long>(bucket, UtilizationTotals::kFillBuckets - 1)];
+        }
+        if (layout >= 0 && layout < UtilizationTotals::kLayouts) {
+            ++totals.layoutEvents[layout];
+            totals.layoutMinutes[layout] += event.endMinute - event.startMinute;
+        }
+        addBookedMinutes(totals, event.startMinute, event.endMinute);
+        endMinutes[event.eventName] = event.endMinute;
+        if (event.endMinute > now) {
+            result.validUntil = std::min(result.validUntil, event.endMinute);
+        }
+    }
+
+    const Bitmap* rows = snapshot.reservationIndex.dayBitmap(dirty.day);
+    if (!rows) return;
+    std::vector<std::uint32_t> selected;
+    rows->collect(selected);
+    for (std::uint32_t row : selected) {
+        const ReservationSnapshot& reservation = *snapshot.findReservation(static_cast<int>(row));
+        if (reservation.reservationStatus == ReservationStatus::Canceled) {
+            ++totals.canceledReservations;
+            continue;
+        }
+        auto end = endMinutes.find(reservation.eventName);
+        if (end != endMinutes.end() && end->second <= now) {
+            ++totals.endedReservations;
+            if (reservation.paymentStatus == PaymentStatus::Unpaid) {
+                ++totals.noShows;
+            }
+        }
+    }
+}
+
+// Aggregates the dirty days [first, last)
+static void aggregateRange(const ScheduleSnapshot& snapshot, const std::vector<DirtyDay>& dirty, size_t first, size_t last, long long now,
+                           std::vector<CachedDay>& results) {
+    for (size_t i = first; i < last; ++i) {
+        aggregateDay(snapshot, dirty[i], now, results[i]);
+    }
+}
+
+// Refreshes the report from a snapshot split into up to threads ranges run on the shared task pool
+AnalyticsReport Analytics::refresh(const ScheduleSnapshot& snapshot, unsigned threads) {
+    ScopedTimer timer(kAnalyticsMetric);
+    auto started = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    AnalyticsReport report;
+    long long now = currentMinutes();
+
+    // Forget days without events, then find the days whose fingerprint changed or whose events ended since
+    for (auto it = cache.begin(); it != cache.end();) {
+        it = snapshot.layout->dayIndex.count(it->first) ? std::next(it) : cache.erase(it);
+    }
+    std::vector<DirtyDay> dirty;
+    size_t totalWeight = 0;
+    std::vector<size_t> weights;
+    for (const auto& pair : snapshot.layout->dayIndex) {
+        auto signature = snapshot.daySignatures.find(pair.first);
+        DirtyDay day{pair.first, pair.second, signature != snapshot.daySignatures.end() ? signature->second : 0};
+        auto cached = cache.find(pair.first);
+        if (cached == cache.end() || cached->second.signature != day.signature || cached->second.validUntil <= now) {
+            const Bitmap* rows = snapshot.reservationIndex.dayBitmap(pair.first);
+            weights.push_back(pair.second.second - pair.second.first + (rows ? rows->cardinality() : 0));
+            totalWeight += weights.back();
+            dirty.push_back(day);
+        }
+    }
+
+    TaskPool& pool = TaskPool::shared();
+    if (threads == 0) {
+        threads = pool.concurrency();
+    }
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, dirty.size())));
+
+    // Split the dirty days into contiguous ranges holding about the same number of events and reservations
+    std::vector<size_t> bounds(1, 0);
+    size_t seen = 0;
+    for (size_t i = 0; i < dirty.size() && bounds.size() < threads; ++i) {
+        seen += weights[i];
+        if (seen * threads >= totalWeight * bounds.size()) {
+            bounds.push_back(i + 1);
+        }
+    }
+    while (bounds.size() <= threads) {
+        bounds.push_back(dirty.size());
+    }
+
+    std::vector<CachedDay> results(dirty.size());
+    pool.parallelFor(0, threads, 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+            aggregateRange(snapshot, dirty, bounds[t], bounds[t + 1], now, results);
+        }
+    });
+    for (size_t i = 0; i < dirty.size(); ++i) {
+        cache[dirty[i].day] = results[i];
+    }
+
+    for (const auto& pair : cache) {
+        report.totals.add(pair.second.totals);
+    }
+    if (!snapshot.layout->dayIndex.empty()) {
+        report.firstDay = snapshot.layout->dayIndex.begin()->first;
+        report.lastDay = snapshot.layout->dayIndex.rbegin()->first;
+    }
+    report.days = snapshot.layout->dayIndex.size();
+    report.daysRecomputed = dirty.size();
+    report.snapshotVersion = snapshot.version;
+    report.threadsUsed = std::min(threads, pool.concurrency());
+    report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+// Forgets the cached day aggregates
+void Analytics::reset() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.clear();
+}
+
+// Returns the number of weeks the report spans
+long long AnalyticsReport::weeks() const {
+    if (lastDay < firstDay) return 0;
+    long long firstMonday = firstDay - weekdayFromDays(firstDay);
+    long long lastMonday = lastDay - weekdayFromDays(lastDay);
+    return (lastMonday - firstMonday) / 7 + 1;
+}
+
+// Returns part as a percentage of whole (0 if whole is 0)
+static double percent(long long part, long long whole) {
+    return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+// Returns the label of a fill rate bucket
+static std::string fillBucketName(int bucket) {
+    return bucket == UtilizationTotals::kFillBuckets - 1 ? "100%" : std::to_string(bucket * 10) + "-" + std::to_string(bucket * 10 + 9) + "%";
+}
+
+// Prints the report as text
+void AnalyticsReport::print(std::ostream& out) const {
+    const UtilizationTotals& t = totals;
+    if (days == 0) {
+        out << "No dated events to analyze." << std::endl;
+        return;
+    }
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+    out << "Utilization from " << formatDate(firstDay) << " to " << formatDate(lastDay) << " (" << weeks() << " week(s), " << days
+        << " day(s) with events)" << std::endl;
+    out << "Refreshed " << daysRecomputed << " of " << days << " day(s) in " << milliseconds << " ms using " << threadsUsed
+        << " thread(s)." << std::endl;
+    out << "Events: " << t.events << ", tickets sold: " << t.ticketsSold << " of " << t.capacity << " (fill rate "
+        << percent(t.ticketsSold, t.capacity) << "%)" << std::endl;
+
+    out << "Fill rate distribution:";
+    for (int i = 0; i < UtilizationTotals::kFillBuckets; ++i) {
+        out << " " << fillBucketName(i) << ": " << t.fillHistogram[i] << (i + 1 < UtilizationTotals::kFillBuckets ? "," : "");
+    }
+    out << std::endl;
+
+    long long bookedMinutes = 0;
+    for (long long minutes : t.layoutMinutes) bookedMinutes += minutes;
+    out << "Layout mix:" << std::endl;
+    for (int i = 0; i < UtilizationTotals::kLayouts; ++i) {
+        out << " - " << kLayoutNames[i] << ": " << t.layoutEvents[i] << " event(s) (" << percent(t.layoutEvents[i], t.events) << "%), "
+            << t.layoutMinutes[i] / 60.0 << " hour(s) (" << percent(t.layoutMinutes[i], bookedMinutes) << "% of booked time)" << std::endl;
+    }
+
+    out << "Reservations of past events: " << t.endedReservations << ", no-shows (never paid): " << t.noShows << " ("
+        << percent(t.noShows, t.endedReservations) << "%), canceled: " << t.canceledReservations << std::endl;
+
+    out << "Hour-of-week utilization (% of each hour booked, averaged over " << weeks() << " week(s)):" << std::endl;
+    out << std::setprecision(0) << "   ";
+    for (int hour = 0; hour < 24; ++hour) out << std::setw(4) << hour;
+    out << std::endl;
+    for (int weekday = 0; weekday < 7; ++weekday) {
+        out << kWeekdayNames[weekday];
+        for (int hour = 0; hour < 24; ++hour) {
+            out << std::setw(4) << percent(t.bookedMinutes[weekday * 24 + hour], weeks() * 60);
+        }
+        out << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+// Writes the report as CSV
+bool AnalyticsReport::writeCsv(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return false;
+    }
+    const UtilizationTotals& t = totals;
+    file << "section,key,value" << std::endl;
+    if (days > 0) {
+        file << "summary,first_day," << formatDate(firstDay) << std::endl;
+        file << "summary,last_day," << formatDate(lastDay) << std::endl;
+    }
+    file << "summary,weeks," << weeks() << std::endl;
+    file << "summary,events," << t.events << std::endl;
+    file << "summary,tickets_sold," << t.ticketsSold << std::endl;
+    file << "summary,capacity," << t.capacity << std::endl;
+    file << "summary,fill_rate_percent," << percent(t.ticketsSold, t.capacity) << std::endl;
+    file << "summary,ended_reservations," << t.endedReservations << std::endl;
+    file << "summary,no_shows," << t.noShows << std::endl;
+    file << "summary,no_show_rate_percent," << percent(t.noShows, t.endedReservations) << std::endl;
+    file << "summary,canceled_reservations," << t.canceledReservations << std::endl;
+    for (int i = 0; i < UtilizationTotals::kFillBuckets; ++i) {
+        file << "fill_rate_events," << fillBucketName(i) << "," << t.fillHistogram[i] << std::endl;
+    }
+    for (int i = 0; i < UtilizationTotals::kLayouts; ++i) {
+        file << "layout_events," << kLayoutNames[i] << "," << t.layoutEvents[i] << std::endl;
+        file << "layout_hours," << kLayoutNames[i] << "," << t.layoutMinutes[i] / 60.0 << std::endl;
+    }
+    for (int slot = 0; slot < UtilizationTotals::kHoursPerWeek; ++slot) {
+        file << "hour_of_week_utilization_percent," << kWeekdayNames[slot / 24] << " " << std::setw(2) << std::setfill('0') << slot % 24
+             << ":00," << std::setfill(' ') << percent(t.bookedMinutes[slot], weeks() * 60) << std::endl;
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,376 @@
+#include "Archive.hpp"
+#include "Codec.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include "Reservation.hpp"
+#include "ReservationStore.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <filesystem>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_map>
+
+static const int kArchiveMetric = Metrics::registerMetric("archive_closed_periods");
+static const int kArchiveQueryMetric = Metrics::registerMetric("archive_query");
+
+static const std::string kArchiveDirectory = "data/archive";
+static const std::string kManifestFilename = "data/archive/manifest.txt";
+static const char kSegmentMagic[8] = {'C', 'C', 'M', 'S', 'E', 'G', '1', '\n'};
+static const size_t kBlockSize = 64 * 1024;
+
+// Archiving horizon applied while running
+static int horizonMonths = -1;
+static long long horizonCutoff = 0;   // Cutoff of the last archiving run
+static long long nextCheckMinute = 0; // First minute of the month after that run
+static std::function<bool(long long cutoff)> horizonArchiver;
+
+// Segment listed in the manifest
+struct SegmentInfo {
+    std::string filename;
+    std::string month;
+    int events;
+    int reservations;
+    int maxReservationID;
+};
+
+// Writes a little-endian 32-bit value
+static void writeU32(std::ostream& out, std::uint32_t value) {
+    char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+    out.write(bytes, 4);
+}
+
+// Reads a little-endian 32-bit value
+static bool readU32(std::istream& in, std::uint32_t& value) {
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), 4)) return false;
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+// Class writing one segment file block by block
+class SegmentWriter {
+public:
+    SegmentWriter(const std::string& filename) : filename(filename), file(filename + ".tmp", std::ios::binary) {
+        file.write(kSegmentMagic, sizeof(kSegmentMagic));
+    }
+
+    // Adds one record line
+    void add(char type, const std::string& record) {
+        buffer.push_back(type);
+        buffer.push_back(' ');
+        buffer += record;
+        buffer.push_back('\n');
+        if (buffer.size() >= kBlockSize) flush();
+    }
+
+    // Drops a segment that will not be finished
+    void abandon() {
+        if (!file.is_open()) return;
+        file.close();
+        std::remove((filename + ".tmp").c_str());
+    }
+
+    // Writes the last block and moves the segment into place
+    bool finish() {
+        flush();
+        file.close();
+        const std::string tempFilename = filename + ".tmp";
+        if (!file || std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+            std::cerr << "Error: Unable to write file " << filename << std::endl;
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string filename;
+    std::ofstream file;
+    std::string buffer;
+
+    // Compresses and writes the buffered records as one block
+    void flush() {
+        if (buffer.empty()) return;
+        std::string compressed = compressBlock(buffer.data(), buffer.size());
+        writeU32(file, static_cast<std::uint32_t>(buffer.size()));
+        writeU32(file, static_cast<std::uint32_t>(compressed.size()));
+        file.write(compressed.data(), compressed.size());
+        buffer.clear();
+    }
+};
+
+// Streams the record lines of a segment one block at a time
+static bool forEachRecord(const std::string& filename, const std::function<void(const std::string& line)>& visit) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(kSegmentMagic)];
+    if (!file.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != std::string(kSegmentMagic, sizeof(kSegmentMagic))) {
+        std::cerr << "Error: " << filename << " is not an archive segment." << std::endl;
+        return false;
+    }
+    std::string compressed, block, line;
+    std::uint32_t rawSize, compressedSize;
+    while (readU32(file, rawSize)) {
+        if (!readU32(file, compressedSize)) return false;
+        compressed.resize(compressedSize);
+        if (!file.read(&compressed[0], compressedSize) || !decompressBlock(compressed.data(), compressed.size(), rawSize, block)) {
+            std::cerr << "Error: Corrupt block in " << filename << std::endl;
+            return false;
+        }
+        std::istringstream lines(block);
+        while (getline(lines, line)) {
+            visit(line);
+        }
+    }
+    return true;
+}
+
+// Reads the segment list
+static std::vector<SegmentInfo> readManifest() {
+    std::vector<SegmentInfo> segments;
+    std::ifstream file(kManifestFilename);
+    std::string line;
+    while (getline(file, line)) {
+        std::istringstream iss(line);
+        SegmentInfo segment;
+        if (iss >> segment.filename >> segment.month >> segment.events >> segment.reservations >> segment.maxReservationID) {
+            segments.push_back(segment);
+        }
+    }
+    return segments;
+}
+
+// Returns the month ("YYYY-MM") of a timestamp
+static std::string monthOf(const std::string& timestamp) {
+    return timestamp.substr(0, 7);
+}
+
+// Picks a segment file name for a month that is not taken yet
+static std::string segmentFilename(const std::string& month) {
+    std::string filename = kArchiveDirectory + "/" + month + ".seg";
+    for (int sequence = 2; std::filesystem::exists(filename); ++sequence) {
+        filename = kArchiveDirectory + "/" + month + "." + std::to_string(sequence) + ".seg";
+    }
+    return filename;
+}
+
+// Returns the first minute of the month months months before the one containing now
+long long Archive::monthCutoff(long long now, int months) {
+    int year, month, day;
+    civilFromDays(dayOfMinute(now), year, month, day);
+    int monthIndex = year * 12 + (month - 1) - months;
+    return daysFromCivil(monthIndex / 12, monthIndex % 12 + 1, 1) * kMinutesPerDay;
+}
+
+// Keeps archiving periods more than months months back while running
+void Archive::setHorizon(int months, long long appliedCutoff, const std::function<bool(long long cutoff)>& archiver) {
+    horizonMonths = months;
+    horizonCutoff = appliedCutoff;
+    nextCheckMinute = monthCutoff(appliedCutoff, -(months + 1));
+    horizonArchiver = archiver;
+}
+
+// Runs the archiver when the horizon has moved into another month since the last run
+void Archive::tick(long long now) {
+    // One comparison per action until the next month starts
+    if (horizonMonths < 0 || !horizonArchiver || now < nextCheckMinute) return;
+    long long cutoff = monthCutoff(now, horizonMonths);
+    if (cutoff <= horizonCutoff || !horizonArchiver(cutoff)) return;
+    horizonCutoff = cutoff;
+    nextCheckMinute = monthCutoff(now, -1);
+}
+
+// Moves events that ended before cutoff and their reservations into segments
+ArchiveResult Archive::archiveBefore(long long cutoff, std::map<std::string, Event*>& events) {
+    ScopedTimer timer(kArchiveMetric);
+    ArchiveResult result;
+
+    // Closed events, grouped by the month they started in
+    std::map<std::string, std::vector<Event*>> closedByMonth;
+    std::map<std::string, std::string> monthOfEvent;
+    for (const auto& pair : events) {
+        long long end;
+        if (parseTimestamp(pair.second->getEndTime(), end) && end < cutoff) {
+            std::string month = monthOf(pair.second->getStartTime());
+            closedByMonth[month].push_back(pair.second);
+            monthOfEvent[pair.first] = month;
+        }
+    }
+    if (closedByMonth.empty()) return result;
+
+    std::error_code error;
+    std::filesystem::create_directories(kArchiveDirectory, error);
+    if (error) {
+        std::cerr << "Error: Unable to create " << kArchiveDirectory << std::endl;
+        return result;
+    }
+
+    std::map<std::string, std::unique_ptr<SegmentWriter>> writers;
+    std::map<std::string, SegmentInfo> infos;
+    for (const auto& pair : closedByMonth) {
+        SegmentInfo& info = infos[pair.first];
+        info = SegmentInfo{segmentFilename(pair.first), pair.first, 0, 0, 0};
+        std::unique_ptr<SegmentWriter>& writer = writers[pair.first];
+        writer.reset(new SegmentWriter(info.filename));
+        for (Event* event : pair.second) {
+            writer->add('E', event->formatRecord());
+            ++info.events;
+        }
+    }
+
+    // Split the reservation file in one pass: closed records go to their segment, the rest stays live
+    const std::string reservationsFilename = "data/reservations.txt";
+    const std::string liveTempFilename = reservationsFilename + ".tmp";
+    std::ifstream input(reservationsFilename);
+    if (!input.is_open()) {
+        std::cerr << "Error: Unable to open file " << reservationsFilename << std::endl;
+        for (auto& pair : writers) pair.second->abandon();
+        return result;
+    }
+    // Only the current record of each reservation is split; superseded lines and tombstones are dropped
+    std::unordered_map<int, std::uint64_t> latest = ReservationStore::latestRecords(input);
+    input.clear();
+    input.seekg(0);
+    std::ofstream live(liveTempFilename);
+    std::string line;
+    std::uint64_t offset = 0;
+    while (getline(input, line)) {
+        std::uint64_t lineOffset = offset;
+        offset += line.size() + 1;
+        int reservationID;
+        if (Reservation::parseTombstone(line, reservationID)) continue;
+        std::istringstream iss(line);
+        std::string username, eventName;
+        bool parsed = static_cast<bool>(iss >> reservationID >> username >> eventName);
+        if (parsed && latest[reservationID] != lineOffset) continue;
+        auto closed = parsed ? monthOfEvent.find(eventName) : monthOfEvent.end();
+        if (closed == monthOfEvent.end()) {
+            live << line << '\n';
+            continue;
+        }
+        SegmentInfo& info = infos[closed->second];
+        writers[closed->second]->add('R', line);
+        ++info.reservations;
+        info.maxReservationID = std::max(info.maxReservationID, reservationID);
+    }
+    input.close();
+    live.close();
+    if (!live) {
+        std::cerr << "Error: Unable to write file " << liveTempFilename << std::endl;
+        for (auto& pair : writers) pair.second->abandon();
+        std::remove(liveTempFilename.c_str());
+        return result;
+    }
+
+    // Segments are complete before the live files shrink; a crash in between only duplicates records
+    std::vector<std::string> finished;
+    for (auto& pair : writers) {
+        if (!pair.second->finish()) {
+            for (auto& writer : writers) writer.second->abandon();
+            for (const std::string& filename : finished) std::remove(filename.c_str());
+            std::remove(liveTempFilename.c_str());
+            return result;
+        }
+        finished.push_back(infos[pair.first].filename);
+    }
+    std::error_code sizeError;
+    std::uintmax_t manifestSize = std::filesystem::exists(kManifestFilename) ? std::filesystem::file_size(kManifestFilename, sizeError) : 0;
+    std::ofstream manifest(kManifestFilename, std::ios::app);
+    for (const auto& pair : infos) {
+        const SegmentInfo& info = pair.second;
+        manifest << info.filename << " " << info.month << " " << info.events << " " << info.reservations << " " << info.maxReservationID << std::endl;
+    }
+    manifest.close();
+
+    if (!manifest || std::rename(liveTempFilename.c_str(), reservationsFilename.c_str()) != 0) {
+        // The live file still holds every record: take the segments back and leave the events alone
+        std::cerr << "Error: Unable to write file " << (manifest ? reservationsFilename : kManifestFilename) << std::endl;
+        std::remove(liveTempFilename.c_str());
+        std::filesystem::resize_file(kManifestFilename, manifestSize, sizeError);
+        for (const std::string& filename : finished) std::remove(filename.c_str());
+        return result;
+    }
+    for (const auto& pair : infos) {
+        ++result.segments;
+        result.events += pair.second.events;
+        result.reservations += pair.second.reservations;
+    }
+    for (const auto& pair : monthOfEvent) {
+        auto it = events.find(pair.first);
+        delete it->second;
+        events.erase(it);
+    }
+    Event::saveEvents("data/events.txt", events);
+    return result;
+}
+
+// Prints the archived reservations of a user
+size_t Archive::printUserHistory(const std::string& username, std::ostream& out) {
+    ScopedTimer timer(kArchiveQueryMetric);
+    size_t found = 0;
+    for (const SegmentInfo& segment : readManifest()) {
+        // Event records come first in a segment, so their times are known before the reservations
+        std::map<std::string, std::pair<std::string, std::string>> eventTimes;
+        forEachRecord(segment.filename, [&](const std::string& line) {
+            std::istringstream iss(line.substr(2));
+            if (line[0] == 'E') {
+                std::string eventName, organizer, startTime, endTime;
+                if (iss >> eventName >> organizer >> startTime >> endTime) eventTimes[eventName] = std::make_pair(startTime, endTime);
+                return;
+            }
+            int reservationID;
+            std::string user, eventName, status, payment, reservationTime;
+            double totalCost;
+            if (line[0] != 'R' || !(iss >> reservationID >> user >> eventName >> status >> payment >> totalCost >> reservationTime) || user != username) {
+                return;
+            }
+            out << " - Reservation " << reservationID << ": " << eventName;
+            auto times = eventTimes.find(eventName);
+            if (times != eventTimes.end()) out << " (" << times->second.first << " to " << times->second.second << ")";
+            out << ", " << status << ", " << payment << ", $" << totalCost << std::endl;
+            ++found;
+        });
+    }
+    return found;
+}
+
+// Computes reservation counts and revenue of every archived month
+std::vector<MonthRevenue> Archive::revenueByMonth() {
+    ScopedTimer timer(kArchiveQueryMetric);
+    std::map<std::string, MonthRevenue> months;
+    for (const SegmentInfo& segment : readManifest()) {
+        MonthRevenue& month = months[segment.month];
+        month.month = segment.month;
+        forEachRecord(segment.filename, [&month](const std::string& line) {
+            if (line[0] != 'R') return;
+            std::istringstream iss(line.substr(2));
+            int reservationID;
+            std::string user, eventName, status, payment;
+            double totalCost;
+            if (!(iss >> reservationID >> user >> eventName >> status >> payment >> totalCost)) return;
+            ++month.reservations;
+            if (payment == "Paid") {
+                ++month.paidReservations;
+                month.revenue += totalCost;
+            }
+        });
+    }
+    std::vector<MonthRevenue> revenue;
+    for (const auto& pair : months) {
+        revenue.push_back(pair.second);
+    }
+    return revenue;
+}
+
+// Returns the highest archived reservation ID
+int Archive::maxReservationID() {
+    int maxID = 0;
+    for (const SegmentInfo& segment : readManifest()) {
+        maxID = std::max(maxID, segment.maxReservationID);
+    }
+    return maxID;
+}
@@ -0,0 +1,322 @@
+#include "Bitmap.hpp"
+#include <algorithm>
+#include <iterator>
+
+static const size_t kBitsetWords = 65536 / 64;
+
+// Counts the bits set in a word (portable; the build does not assume a popcnt instruction)
+static inline std::uint32_t popcount(std::uint64_t word) {
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<std::uint32_t>((word * 0x0101010101010101ULL) >> 56);
+}
+
+// Counts the bits set in a bitset
+static std::uint32_t popcount(const std::vector<std::uint64_t>& bits) {
+    std::uint32_t count = 0;
+    for (std::uint64_t word : bits) {
+        count += popcount(word);
+    }
+    return count;
+}
+
+// Checks if a value is set in an array or bitset chunk
+static bool chunkContains(const std::vector<std::uint16_t>& array, const std::vector<std::uint64_t>& bits, std::uint16_t value) {
+    if (!bits.empty()) {
+        return (bits[value >> 6] >> (value & 63)) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), value);
+}
+
+// Returns a bitmap holding the rows [0, count)
+Bitmap Bitmap::range(std::uint32_t count) {
+    Bitmap bitmap;
+    for (std::uint64_t first = 0; first < count; first += 65536) {
+        Chunk chunk;
+        chunk.key = static_cast<std::uint16_t>(first >> 16);
+        chunk.count = static_cast<std::uint32_t>(std::min<std::uint64_t>(65536, count - first));
+        chunk.bits.assign(kBitsetWords, 0);
+        for (std::uint32_t i = 0; i < chunk.count; ++i) {
+            chunk.bits[i >> 6] |= std::uint64_t(1) << (i & 63);
+        }
+        shrink(chunk);
+        bitmap.chunks.push_back(std::move(chunk));
+    }
+    return bitmap;
+}
+
+// Adds a row; rows must be added in increasing order
+void Bitmap::add(std::uint32_t row) {
+    std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    std::uint16_t value = static_cast<std::uint16_t>(row);
+    if (chunks.empty() || chunks.back().key != key) {
+        chunks.emplace_back();
+        chunks.back().key = key;
+    }
+    Chunk& chunk = chunks.back();
+    if (chunk.isBitset()) {
+        std::uint64_t& word = chunk.bits[value >> 6];
+        std::uint64_t bit = std::uint64_t(1) << (value & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            ++chunk.count;
+        }
+        return;
+    }
+    if (!chunk.array.empty() && chunk.array.back() >= value) return;
+    chunk.array.push_back(value);
+    if (++chunk.count > kArrayLimit) toBitset(chunk);
+}
+
+// Adds a row in any order
+void Bitmap::insert(std::uint32_t row) {
+    std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    std::uint16_t value = static_cast<std::uint16_t>(row);
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), key, [](const Chunk& c, std::uint16_t k) { return c.key < k; });
+    if (chunk == chunks.end() || chunk->key != key) {
+        chunk = chunks.emplace(chunk);
+        chunk->key = key;
+    }
+    if (chunk->isBitset()) {
+        std::uint64_t& word = chunk->bits[value >> 6];
+        std::uint64_t bit = std::uint64_t(1) << (value & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            ++chunk->count;
+        }
+        return;
+    }
+    auto position = std::lower_bound(chunk->array.begin(), chunk->array.end(), value);
+    if (position != chunk->array.end() && *position == value) return;
+    chunk->array.insert(position, value);
+    if (++chunk->count > kArrayLimit) toBitset(*chunk);
+}
+
+// Removes a row
+void Bitmap::remove(std::uint32_t row) {
+    std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    std::uint16_t value = static_cast<std::uint16_t>(row);
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), key, [](const Chunk& c, std::uint16_t k) { return c.key < k; });
+    if (chunk == chunks.end() || chunk->key != key) return;
+    if (chunk->isBitset()) {
+        std::uint64_t& word = chunk->bits[value >> 6];
+        std::uint64_t bit = std::uint64_t(1) << (value & 63);
+        if (!(word & bit)) return;
+        word &= ~bit;
+        --chunk->count;
+        shrink(*chunk);
+    } else {
+        auto position = std::lower_bound(chunk->array.begin(), chunk->array.end(), value);
+        if (position == chunk->array.end() || *position != value) return;
+        chunk->array.erase(position);
+        --chunk->count;
+    }
+    // Empty chunks are not stored
+    if (chunk->count == 0) chunks.erase(chunk);
+}
+
+// Checks if a row is set
+bool Bitmap::contains(std::uint32_t row) const {
+    std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), key, [](const Chunk& c, std::uint16_t k) { return c.key < k; });
+    return chunk != chunks.end() && chunk->key == key && chunkContains(chunk->array, chunk->bits, static_cast<std::uint16_t>(row));
+}
+
+// Returns the number of rows set
+size_t Bitmap::cardinality() const {
+    size_t count = 0;
+    for (const Chunk& chunk : chunks) {
+        count += chunk.count;
+    }
+    return count;
+}
+
+// Returns the bytes used by the containers
+size_t Bitmap::memoryUsage() const {
+    size_t bytes = chunks.capacity() * sizeof(Chunk);
+    for (const Chunk& chunk : chunks) {
+        bytes += chunk.array.capacity() * sizeof(std::uint16_t) + chunk.bits.capacity() * sizeof(std::uint64_t);
+    }
+    return bytes;
+}
+
+// Appends the rows set, in increasing order, up to limit rows
+void Bitmap::collect(std::vector<std::uint32_t>& rows, size_t limit) const {
+    for (const Chunk& chunk : chunks) {
+        std::uint32_t high = static_cast<std::uint32_t>(chunk.key) << 16;
+        if (chunk.isBitset()) {
+            for (size_t i = 0; i < kBitsetWords; ++i) {
+                for (std::uint64_t word = chunk.bits[i]; word; word &= word - 1) {
+                    if (limit && rows.size() >= limit) return;
+                    rows.push_back(high | static_cast<std::uint32_t>(i * 64 + __builtin_ctzll(word)));
+                }
+            }
+        } else {
+            for (std::uint16_t value : chunk.array) {
+                if (limit && rows.size() >= limit) return;
+                rows.push_back(high | value);
+            }
+        }
+    }
+}
+
+// Converts an array chunk to a bitset
+void Bitmap::toBitset(Chunk& chunk) {
+    chunk.bits.assign(kBitsetWords, 0);
+    for (std::uint16_t value : chunk.array) {
+        chunk.bits[value >> 6] |= std::uint64_t(1) << (value & 63);
+    }
+    chunk.array.clear();
+    chunk.array.shrink_to_fit();
+}
+
+// Converts a bitset chunk back to an array if that is smaller
+void Bitmap::shrink(Chunk& chunk) {
+    if (!chunk.isBitset() || chunk.count > kArrayLimit) return;
+    chunk.array.reserve(chunk.count);
+    for (size_t i = 0; i < kBitsetWords; ++i) {
+        for (std::uint64_t word = chunk.bits[i]; word; word &= word - 1) {
+            chunk.array.push_back(static_cast<std::uint16_t>(i * 64 + __builtin_ctzll(word)));
+        }
+    }
+    chunk.bits.clear();
+    chunk.bits.shrink_to_fit();
+}
+
+// Intersects two chunks with the same key
+Bitmap::Chunk Bitmap::intersectChunks(const Chunk& a, const Chunk& b) {
+    Chunk result;
+    result.key = a.key;
+    if (a.isBitset() && b.isBitset()) {
+        // Count first so a sparse result goes straight into an array
+        for (size_t i = 0; i < kBitsetWords; ++i) {
+            result.count += popcount(a.bits[i] & b.bits[i]);
+        }
+        if (result.count > kArrayLimit) {
+            result.bits.resize(kBitsetWords);
+            for (size_t i = 0; i < kBitsetWords; ++i) {
+                result.bits[i] = a.bits[i] & b.bits[i];
+            }
+        } else {
+            result.array.reserve(result.count);
+            for (size_t i = 0; i < kBitsetWords; ++i) {
+                for (std::uint64_t word = a.bits[i] & b.bits[i]; word; word &= word - 1) {
+                    result.array.push_back(static_cast<std::uint16_t>(i * 64 + __builtin_ctzll(word)));
+                }
+            }
+        }
+    } else if (a.isBitset() || b.isBitset()) {
+        const Chunk& array = a.isBitset() ? b : a;
+        const Chunk& bitset = a.isBitset() ? a : b;
+        for (std::uint16_t value : array.array) {
+            if ((bitset.bits[value >> 6] >> (value & 63)) & 1) result.array.push_back(value);
+        }
+        result.count = static_cast<std::uint32_t>(result.array.size());
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(result.array));
+        result.count = static_cast<std::uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+// Unites two chunks with the same key
+Bitmap::Chunk Bitmap::uniteChunks(const Chunk& a, const Chunk& b) {
+    Chunk result;
+    result.key = a.key;
+    if (!a.isBitset() && !b.isBitset() && a.count + b.count <= kArrayLimit) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(result.array));
+        result.count = static_cast<std::uint32_t>(result.array.size());
+        return result;
+    }
+    result.bits.assign(kBitsetWords, 0);
+    for (const Chunk* chunk : {&a, &b}) {
+        if (chunk->isBitset()) {
+            for (size_t i = 0; i < kBitsetWords; ++i) {
+                result.bits[i] |= chunk->bits[i];
+            }
+        } else {
+            for (std::uint16_t value : chunk->array) {
+                result.bits[value >> 6] |= std::uint64_t(1) << (value & 63);
+            }
+        }
+    }
+    result.count = popcount(result.bits);
+    shrink(result);
+    return result;
+}
+
+// Removes the rows of b from a chunk a with the same key
+Bitmap::Chunk Bitmap::subtractChunks(const Chunk& a, const Chunk& b) {
+    Chunk result;
+    result.key = a.key;
+    if (a.isBitset()) {
+        result.bits = a.bits;
+        if (b.isBitset()) {
+            for (size_t i = 0; i < kBitsetWords; ++i) {
+                result.bits[i] &= ~b.bits[i];
+            }
+        } else {
+            for (std::uint16_t value : b.array) {
+                result.bits[value >> 6] &= ~(std::uint64_t(1) << (value & 63));
+            }
+        }
+        result.count = popcount(result.bits);
+        shrink(result);
+    } else {
+        for (std::uint16_t value : a.array) {
+            if (!chunkContains(b.array, b.bits, value)) result.array.push_back(value);
+        }
+        result.count = static_cast<std::uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+// Returns the rows set in both bitmaps
+Bitmap Bitmap::intersect(const Bitmap& a, const Bitmap& b) {
+    Bitmap result;
+    auto i = a.chunks.begin(), j = b.chunks.begin();
+    while (i != a.chunks.end() && j != b.chunks.end()) {
+        if (i->key < j->key) {
+            ++i;
+        } else if (j->key < i->key) {
+            ++j;
+        } else {
+            Chunk chunk = intersectChunks(*i++, *j++);
+            if (chunk.count) result.chunks.push_back(std::move(chunk));
+        }
+    }
+    return result;
+}
+
+// Returns the rows set in either bitmap
+Bitmap Bitmap::unite(const Bitmap& a, const Bitmap& b) {
+    Bitmap result;
+    auto i = a.chunks.begin(), j = b.chunks.begin();
+    while (i != a.chunks.end() || j != b.chunks.end()) {
+        if (j == b.chunks.end() || (i != a.chunks.end() && i->key < j->key)) {
+            result.chunks.push_back(*i++);
+        } else if (i == a.chunks.end() || j->key < i->key) {
+            result.chunks.push_back(*j++);
+        } else {
+            result.chunks.push_back(uniteChunks(*i++, *j++));
+        }
+    }
+    return result;
+}
+
+// Returns the rows set in a but not in b
+Bitmap Bitmap::subtract(const Bitmap& a, const Bitmap& b) {
+    Bitmap result;
+    auto j = b.chunks.begin();
+    for (const Chunk& chunk : a.chunks) {
+        while (j != b.chunks.end() && j->key < chunk.key) ++j;
+        if (j == b.chunks.end() || j->key != chunk.key) {
+            result.chunks.push_back(chunk);
+            continue;
+        }
+        Chunk remaining = subtractChunks(chunk, *j);
+        if (remaining.count) result.chunks.push_back(std::move(remaining));
+    }
+    return result;
+}
@@ -0,0 +1,250 @@
+#include "CheckIn.hpp"
+#include "SeatMap.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+static const int kCheckInScanMetric = Metrics::registerMetric("check_in_scan");
+static const char* kJournalFilename = "data/checkins.log";
+
+// Mixes a key with a seed
+std::uint32_t PerfectHash::hash(std::uint32_t key, std::uint32_t seed) {
+    std::uint32_t h = key ^ (seed * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Builds the hash over distinct keys
+bool PerfectHash::build(const std::vector<std::uint32_t>& input) {
+    size_t n = input.size();
+    seeds.clear();
+    keys.assign(n, 0);
+    if (n == 0) return true;
+    // Start with about four keys per bucket; more buckets make placement easier if it ever fails
+    for (size_t bucketCount = (n + 3) / 4; bucketCount <= n; bucketCount *= 2) {
+        std::vector<std::vector<std::uint32_t>> buckets(bucketCount);
+        for (std::uint32_t key : input) {
+            buckets[hash(key, 0) % bucketCount].push_back(key);
+        }
+        std::vector<size_t> order(bucketCount);
+        for (size_t i = 0; i < bucketCount; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        seeds.assign(bucketCount, 0);
+        std::vector<bool> taken(n, false);
+        std::vector<size_t> slots;
+        bool placed = true;
+        for (size_t bucket : order) {
+            const std::vector<std::uint32_t>& members = buckets[bucket];
+            if (members.empty()) break;  // Sorted by size: the rest are empty too
+            std::uint32_t seed = 1;
+            for (; seed < (1u << 16); ++seed) {
+                slots.clear();
+                for (std::uint32_t key : members) {
+                    size_t slot = hash(key, seed) % n;
+                    if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) break;
+                    slots.push_back(slot);
+                }
+                if (slots.size() == members.size()) break;
+            }
+            if (slots.size() != members.size()) {
+                placed = false;
+                break;
+            }
+            seeds[bucket] = seed;
+            for (size_t i = 0; i < members.size(); ++i) {
+                taken[slots[i]] = true;
+                keys[slots[i]] = members[i];
+            }
+        }
+        if (placed) return true;
+    }
+    seeds.clear();
+    keys.clear();
+    return false;
+}
+
+// Returns the slot of a key, or -1
+long long PerfectHash::lookup(std::uint32_t key) const {
+    if (keys.empty()) return -1;
+    std::uint32_t seed = seeds[hash(key, 0) % seeds.size()];
+    if (seed == 0) return -1;  // Empty bucket
+    size_t slot = hash(key, seed) % keys.size();
+    return keys[slot] == key ? static_cast<long long>(slot) : -1;
+}
+
+// Returns the number of guests a reservation admits: its seats, or one for open seating
+int CheckIn::guestsOf(const ReservationSnapshot& reservation, const EventSnapshot& event) {
+    std::vector<SeatBlock> blocks;
+    if (reservation.seats.empty() || !SeatMap::parseBlocks(reservation.seats, SeatLayout::forStyle(event.layoutStyle).seatsPerRow(), blocks)) {
+        return 1;
+    }
+    int guests = 0;
+    for (const SeatBlock& block : blocks) guests += static_cast<int>(block.count);
+    return guests;
+}
+
+// Opens the doors of an event, replaying its journaled arrivals
+CheckInSession::CheckInSession(const ScheduleSnapshot& snapshot, const EventSnapshot& event)
+    : eventName(event.eventName), organizer(event.organizer), startMinute(event.startMinute), endMinute(event.endMinute), maxGuests(event.maxGuests),
+      openedVersion(snapshot.version), headcount(0) {
+    std::vector<std::uint32_t> keys;
+    std::map<std::uint32_t, Entry> byID;
+    for (const auto& pair : event.reservations) {
+        const ReservationSnapshot* reservation = snapshot.findReservation(pair.first);
+        if (!reservation) continue;
+        keys.push_back(static_cast<std::uint32_t>(pair.first));
+        byID[static_cast<std::uint32_t>(pair.first)] = Entry{pair.first, pair.second, CheckIn::guestsOf(*reservation, event),
+                                                             reservation->reservationStatus, reservation->paymentStatus};
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (!hash.build(keys)) {
+        // Unreachable in practice; every scan then takes the locked path
+        std::cerr << "Error: Unable to build the check-in hash of " << eventName << std::endl;
+        keys.clear();
+        hash.build(keys);
+    }
+    entries.resize(hash.size());
+    arrivals.reset(new std::atomic<long long>[hash.size()]);
+    for (size_t slot = 0; slot < hash.size(); ++slot) arrivals[slot].store(0, std::memory_order_relaxed);
+    for (std::uint32_t key : keys) {
+        entries[static_cast<size_t>(hash.lookup(key))] = byID[key];
+    }
+
+    // Guests admitted before a restart stay admitted; arrivals of reservations the event no longer has
+    // (canceled, or booked for an earlier event of the same name) do not count
+    std::ifstream journalFile(kJournalFilename);
+    std::string line;
+    while (getline(journalFile, line)) {
+        std::istringstream iss(line);
+        std::string time, name, username, outcome;
+        int reservationID, guests;
+        long long minute;
+        if (!(iss >> time >> name >> reservationID >> username >> guests >> outcome) || name != eventName || outcome != "admitted" ||
+            !parseTimestamp(time, minute)) {
+            continue;
+        }
+        long long slot = hash.lookup(static_cast<std::uint32_t>(reservationID));
+        if (slot >= 0 && arrivals[slot].load(std::memory_order_relaxed) == 0) {
+            arrivals[slot].store(minute, std::memory_order_relaxed);
+            headcount.fetch_add(guests, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Checks if the session still describes an event
+bool CheckInSession::describes(const EventSnapshot& event) const {
+    return event.organizer == organizer && event.startMinute == startMinute && event.endMinute == endMinute && event.maxGuests == maxGuests;
+}
+
+// Appends one scan to the journal
+void CheckInSession::journal(long long now, int reservationID, const std::string& username, int guests, const char* outcome) {
+    // One journal for all sessions; every line is flushed so a crash loses no arrival
+    static std::mutex journalMutex;
+    static std::ofstream journalFile;
+    std::lock_guard<std::mutex> lock(journalMutex);
+    if (!journalFile.is_open()) {
+        journalFile.open(kJournalFilename, std::ios::app);
+        if (!journalFile.is_open()) {
+            std::cerr << "Error: Unable to open file " << kJournalFilename << std::endl;
+            return;
+        }
+    }
+    journalFile << formatTimestamp(now) << ' ' << eventName << ' ' << reservationID << ' ' << username << ' ' << guests << ' ' << outcome << '\n';
+    journalFile.flush();
+}
+
+// Admits an entry if it has not arrived yet
+CheckInResult CheckInSession::admit(std::atomic<long long>& arrival, long long now, int reservationID, const std::string& username,
+                                    int guests, ReservationStatus status, PaymentStatus payment, std::string& message) {
+    if (status == ReservationStatus::Canceled) {
+        journal(now, reservationID, username, guests, "canceled");
+        message = "Reservation " + std::to_string(reservationID) + " was canceled.";
+        return CheckInResult::Canceled;
+    }
+    long long expected = 0;
+    if (!arrival.compare_exchange_strong(expected, now, std::memory_order_acq_rel)) {
+        journal(now, reservationID, username, guests, "duplicate");
+        message = "Reservation " + std::to_string(reservationID) + " already checked in at " + formatTimestamp(expected) + ".";
+        return CheckInResult::AlreadyCheckedIn;
+    }
+    int count = headcount.fetch_add(guests, std::memory_order_relaxed) + guests;
+    journal(now, reservationID, username, guests, "admitted");
+    message = "Admitted " + username + " (" + std::to_string(guests) + " guest(s)). Headcount " + std::to_string(count) + " / " +
+              std::to_string(maxGuests) + ".";
+    if (count > maxGuests) message += " Over capacity!";
+    if (payment == PaymentStatus::Unpaid) message += " Unpaid: collect payment.";
+    return CheckInResult::Admitted;
+}
+
+// Scans a reservation at minute now
+CheckInResult CheckInSession::scan(int reservationID, long long now, const ScheduleSnapshot& snapshot, std::string& message) {
+    ScopedTimer timer(kCheckInScanMetric);
+    long long slot = hash.lookup(static_cast<std::uint32_t>(reservationID));
+    if (slot >= 0) {
+        const Entry& entry = entries[static_cast<size_t>(slot)];
+        ReservationStatus status = entry.reservationStatus;
+        PaymentStatus payment = entry.paymentStatus;
+        if (snapshot.version != openedVersion) {
+            // Something changed since the doors opened: the reservation may have been paid or canceled
+            const ReservationSnapshot* current = snapshot.findReservation(reservationID);
+            status = current && current->eventName == eventName ? current->reservationStatus : ReservationStatus::Canceled;
+            payment = current ? current->paymentStatus : payment;
+        }
+        return admit(arrivals[static_cast<size_t>(slot)], now, reservationID, entry.username, entry.guests, status, payment, message);
+    }
+
+    const ReservationSnapshot* reservation = snapshot.findReservation(reservationID);
+    if (!reservation) {
+        journal(now, reservationID, "-", 0, "unknown");
+        message = "Reservation " + std::to_string(reservationID) + " not found.";
+        return CheckInResult::NotFound;
+    }
+    const EventSnapshot* event = snapshot.findEvent(reservation->eventName);
+    int guests = event ? CheckIn::guestsOf(*reservation, *event) : 1;
+    if (reservation->eventName != eventName) {
+        journal(now, reservationID, reservation->username, guests, "wrong-event");
+        message = "Reservation " + std::to_string(reservationID) + " is for " + reservation->eventName + ", not " + eventName + ".";
+        return CheckInResult::WrongEvent;
+    }
+    // Booked after the doors opened
+    std::lock_guard<std::mutex> lock(lateMutex);
+    auto late = lateArrivals.find(reservationID);
+    std::atomic<long long> arrival(late != lateArrivals.end() ? late->second : 0);
+    CheckInResult result = admit(arrival, now, reservationID, reservation->username, guests, reservation->reservationStatus,
+                                 reservation->paymentStatus, message);
+    if (result == CheckInResult::Admitted) lateArrivals[reservationID] = now;
+    return result;
+}
+
+// Open sessions by event name
+static std::mutex sessionsMutex;
+static std::map<std::string, std::shared_ptr<CheckInSession>> sessions;
+
+// Returns the session of an event, opening its doors on first use
+std::shared_ptr<CheckInSession> CheckIn::open(const std::string& eventName, const ScheduleSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    const EventSnapshot* event = snapshot.findEvent(eventName);
+    auto it = sessions.find(eventName);
+    if (!event) {
+        if (it != sessions.end()) sessions.erase(it);
+        return nullptr;
+    }
+    if (it != sessions.end() && it->second->describes(*event)) return it->second;
+    std::shared_ptr<CheckInSession> session = std::make_shared<CheckInSession>(snapshot, *event);
+    sessions[eventName] = session;
+    return session;
+}
+
+// Closes every session
+void CheckIn::closeAll() {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    sessions.clear();
+}
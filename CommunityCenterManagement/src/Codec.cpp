@@ -0,0 +1,107 @@
+#include "Codec.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+static const size_t kMinMatch = 4;
+static const size_t kMaxOffset = 65535;
+static const int kHashBits = 14;
+
+// Reads four bytes for hashing and comparing
+static std::uint32_t read32(const char* data) {
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Appends a length that did not fit in its nibble
+static void writeExtraLength(std::string& output, size_t length) {
+    while (length >= 255) {
+        output.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    output.push_back(static_cast<char>(length));
+}
+
+// Appends one sequence; matchLength 0 marks the final literal-only sequence
+static void writeSequence(std::string& output, const char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+    size_t literalNibble = literalCount < 15 ? literalCount : 15;
+    size_t matchCode = matchLength ? matchLength - kMinMatch : 0;
+    size_t matchNibble = matchCode < 15 ? matchCode : 15;
+    output.push_back(static_cast<char>((literalNibble << 4) | matchNibble));
+    if (literalNibble == 15) writeExtraLength(output, literalCount - 15);
+    output.append(literals, literalCount);
+    if (matchLength == 0) return;
+    output.push_back(static_cast<char>(offset & 0xff));
+    output.push_back(static_cast<char>(offset >> 8));
+    if (matchNibble == 15) writeExtraLength(output, matchCode - 15);
+}
+
+// Compresses a block
+std::string compressBlock(const char* data, size_t size) {
+    std::string output;
+    output.reserve(size / 2 + 16);
+    std::vector<std::uint32_t> table(size_t(1) << kHashBits, UINT32_MAX);
+    size_t position = 0, anchor = 0;
+    while (position + kMinMatch <= size) {
+        std::uint32_t sequence = read32(data + position);
+        std::uint32_t hash = (sequence * 2654435761u) >> (32 - kHashBits);
+        std::uint32_t candidate = table[hash];
+        table[hash] = static_cast<std::uint32_t>(position);
+        if (candidate != UINT32_MAX && position - candidate <= kMaxOffset && read32(data + candidate) == sequence) {
+            size_t matchLength = kMinMatch;
+            while (position + matchLength < size && data[candidate + matchLength] == data[position + matchLength]) {
+                ++matchLength;
+            }
+            writeSequence(output, data + anchor, position - anchor, position - candidate, matchLength);
+            position += matchLength;
+            anchor = position;
+        } else {
+            ++position;
+        }
+    }
+    writeSequence(output, data + anchor, size - anchor, 0, 0);
+    return output;
+}
+
+// Reads a length continued in extra bytes
+static bool readExtraLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+    do {
+        if (in >= end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Decompresses a block
+bool decompressBlock(const char* data, size_t size, size_t rawSize, std::string& output) {
+    output.clear();
+    output.reserve(rawSize);
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = in + size;
+    while (in < end) {
+        unsigned char token = *in++;
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readExtraLength(in, end, literalCount)) return false;
+        if (static_cast<size_t>(end - in) < literalCount || output.size() + literalCount > rawSize) return false;
+        output.append(reinterpret_cast<const char*>(in), literalCount);
+        in += literalCount;
+        if (in == end) break;  // Final literal-only sequence
+
+        if (end - in < 2) return false;
+        size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readExtraLength(in, end, matchLength)) return false;
+        matchLength += kMinMatch;
+        if (offset == 0 || offset > output.size() || output.size() + matchLength > rawSize) return false;
+        // Copy byte by byte: the match may overlap the bytes it produces
+        size_t from = output.size() - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            output.push_back(output[from + i]);
+        }
+    }
+    return output.size() == rawSize;
+}
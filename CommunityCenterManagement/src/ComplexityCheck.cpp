@@ -0,0 +1,185 @@
+#include "ComplexityCheck.hpp"
+#include "FacilityManager.hpp"
+#include "Reservation.hpp"
+#include "HelperFunctions.hpp"
+#include "CheckIn.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+
+static const int kRepetitions = 3;         // Best of this many timings is kept, which filters out scheduler noise
+static const size_t kQueries = 20000;      // Lookups timed per repetition
+static const int kReservationsPerUser = 8;
+static volatile size_t sink;               // Keeps the timed work from being optimized away
+
+// Synthetic dataset of one size
+struct Dataset {
+    FacilityManager facilityManager;
+    std::vector<Event*> events;
+    std::vector<User*> users;
+    User* busyUser = nullptr;  // Holds a reservation for every event
+    std::map<int, Reservation*> reservations;
+    std::vector<std::uint32_t> reservationIDs;
+
+    // Builds n events (four a day from 2030 on), n reservations over n / 8 users and the busy user's n reservations
+    explicit Dataset(size_t n) {
+        long long firstDay = daysFromCivil(2030, 1, 1);
+        for (size_t i = 0; i < n; ++i) {
+            long long start = (firstDay + static_cast<long long>(i / 4)) * kMinutesPerDay + (8 + 3 * static_cast<long long>(i % 4)) * 60;
+            events.push_back(new Event("complexity_event_" + std::to_string(i), nullptr, formatTimestamp(start), formatTimestamp(start + 120),
+                                       LayoutStyle::Meeting, true, 100, 10.0));
+        }
+        for (size_t i = 0; i < n / kReservationsPerUser; ++i) {
+            users.push_back(new ResidentUser("complexity_user_" + std::to_string(i), "password"));
+        }
+        busyUser = new ResidentUser("complexity_busy_user", "password");
+        for (size_t i = 0; i < n; ++i) {
+            int reservationID = static_cast<int>(i) + 1;
+            reservations[reservationID] = Reservation::create(reservationID, users[i / kReservationsPerUser], events[i], events[i]->getStartTime());
+            reservationIDs.push_back(static_cast<std::uint32_t>(reservationID));
+            Reservation::create(static_cast<int>(n + i) + 1, busyUser, events[i], events[i]->getStartTime());
+        }
+    }
+
+    ~Dataset() {
+        for (Event* event : events) delete event;
+        for (User* user : users) delete user;
+        delete busyUser;
+        // Runs before any real reservation is loaded, so every slot is synthetic
+        Reservation::destroyAll();
+    }
+};
+
+// Returns the best time in nanoseconds of kRepetitions runs of work
+static double bestOf(const std::function<void()>& work) {
+    double best = 0;
+    for (int repetition = 0; repetition < kRepetitions; ++repetition) {
+        auto begin = std::chrono::steady_clock::now();
+        work();
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        if (repetition == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Returns a well-spread index below n for query q, so lookups do not walk the data in order
+static size_t spread(size_t q, size_t n) {
+    return (q * 2654435761u) % n;
+}
+
+// Fits the exponent of time ~ size^k
+double ComplexityCheck::fitExponent(const std::vector<size_t>& sizes, const std::vector<double>& times) {
+    double count = static_cast<double>(sizes.size());
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        double x = std::log(static_cast<double>(sizes[i]));
+        double y = std::log(std::max(times[i], 1e-3));
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    double denominator = count * sumXX - sumX * sumX;
+    return denominator == 0 ? 0 : (count * sumXY - sumX * sumY) / denominator;
+}
+
+// Runs every operation at sizes from minSize doubling up to maxSize and returns the results
+std::vector<ScalingResult> ComplexityCheck::run(size_t minSize, size_t maxSize) {
+    std::vector<ScalingResult> results = {
+        {"find_event", 0.6, {}, {}},
+        {"check_availability", 0.6, {}, {}},
+        {"add_event", 0.6, {}, {}},
+        {"find_user_reservation", 0.6, {}, {}},
+        {"find_conflict", 0.6, {}, {}},
+        {"check_in_lookup", 0.6, {}, {}},
+        {"save_reservations", 1.3, {}, {}},
+    };
+    std::string scratchFile = (std::filesystem::temp_directory_path() / "ccm-complexity-check.txt").string();
+
+    // The operations print progress messages of their own, which would swamp the table
+    std::streambuf* console = std::cout.rdbuf();
+    std::ostringstream discarded;
+    std::cout.rdbuf(discarded.rdbuf());
+    for (size_t n = minSize; n <= maxSize; n *= 2) {
+        Dataset data(n);
+        std::vector<double> times;
+
+        Schedule& schedule = data.facilityManager.getSchedule();
+        double perEvent = bestOf([&]() {
+            FacilityManager fresh;
+            for (Event* event : data.events) fresh.addEvent(event);
+        }) / static_cast<double>(n);
+        for (Event* event : data.events) data.facilityManager.addEvent(event);
+
+        times.push_back(bestOf([&]() {
+            for (size_t q = 0; q < kQueries; ++q) sink = sink + (schedule.findEvent(data.events[spread(q, n)]->getEventName()) != nullptr);
+        }) / kQueries);
+        times.push_back(bestOf([&]() {
+            for (size_t q = 0; q < kQueries; ++q) {
+                const Event* event = data.events[spread(q, n)];
+                sink = sink + schedule.checkAvailability(event->getStartTime(), event->getEndTime());
+            }
+        }) / kQueries);
+        times.push_back(perEvent);
+        times.push_back(bestOf([&]() {
+            for (size_t q = 0; q < kQueries; ++q) {
+                size_t index = spread(q, n);
+                sink = sink + (findUserReservation(data.users[index / kReservationsPerUser], data.events[index]->getEventName()) != nullptr);
+            }
+        }) / kQueries);
+        std::vector<long long> starts;
+        for (const Event* event : data.events) {
+            long long start;
+            parseTimestamp(event->getStartTime(), start);
+            starts.push_back(start);
+        }
+        times.push_back(bestOf([&]() {
+            for (size_t q = 0; q < kQueries; ++q) {
+                long long start = starts[spread(q, n)];
+                sink = sink + (data.busyUser->findConflict(start + 30, start + 60) != nullptr);
+            }
+        }) / kQueries);
+        PerfectHash hash;
+        hash.build(data.reservationIDs);
+        times.push_back(bestOf([&]() {
+            for (size_t q = 0; q < kQueries; ++q) sink = sink + static_cast<size_t>(hash.lookup(data.reservationIDs[spread(q, n)]));
+        }) / kQueries);
+        times.push_back(bestOf([&]() { Reservation::saveReservations(scratchFile, data.reservations); }));
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            results[i].sizes.push_back(n);
+            results[i].nanoseconds.push_back(times[i]);
+        }
+    }
+    std::cout.rdbuf(console);
+    std::remove(scratchFile.c_str());
+
+    for (ScalingResult& result : results) {
+        result.exponent = fitExponent(result.sizes, result.nanoseconds);
+    }
+    return results;
+}
+
+// Prints the results as a table
+void ComplexityCheck::print(std::ostream& out, const std::vector<ScalingResult>& results) {
+    if (results.empty()) return;
+    out << std::left << std::setw(24) << "Operation";
+    for (size_t n : results.front().sizes) out << std::right << std::setw(12) << ("n=" + std::to_string(n));
+    out << std::right << std::setw(10) << "Exponent" << std::setw(8) << "Budget" << "  Result" << std::endl;
+    for (const ScalingResult& result : results) {
+        out << std::left << std::setw(24) << result.operation << std::right << std::fixed;
+        for (double nanoseconds : result.nanoseconds) {
+            out << std::setw(12) << std::setprecision(0) << nanoseconds;
+        }
+        out << std::setw(10) << std::setprecision(2) << result.exponent << std::setw(8) << std::setprecision(1) << result.budget << "  "
+            << (result.passed() ? "ok" : "REGRESSION") << std::endl;
+    }
+    out << "(times in nanoseconds per operation, save_reservations per whole save)" << std::endl;
+}
@@ -0,0 +1,267 @@
+#include "DiskSnapshot.hpp"
+#include "ReservationStore.hpp"
+#include "RecurringEvent.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+static const int kSnapshotForkMetric = Metrics::registerMetric("snapshot_fork");
+static const int kSnapshotWriteMetric = Metrics::registerMetric("snapshot_write");
+static const std::string kSnapshotDirectory = "data/snapshots";
+
+// State of the snapshot in progress and the schedule
+static int intervalMinutes = 0;
+static long long nextDue = -1;
+static pid_t child = -1;
+static int reportFd = -1;
+static std::string childDirectory;
+static std::string childReport;  // What the child wrote to the pipe so far
+static DiskSnapshotStats stats;
+
+// Picks a snapshot directory name that is not taken yet
+static std::string snapshotDirectory(long long now) {
+    std::string stamp = formatTimestamp(now);
+    std::replace(stamp.begin(), stamp.end(), ':', '-');
+    std::string directory = kSnapshotDirectory + "/" + stamp;
+    for (int sequence = 2; std::filesystem::exists(directory) || std::filesystem::exists(directory + ".partial"); ++sequence) {
+        directory = kSnapshotDirectory + "/" + stamp + "." + std::to_string(sequence);
+    }
+    return directory;
+}
+
+// Writes every data file into directory (runs in the child), returning an error message or an empty string
+static std::string writeSnapshot(const std::string& directory, FacilityManager& facilityManager, const std::map<std::string, User*>& users,
+                                 const std::map<std::string, Event*>& events, const std::map<int, Reservation*>& reservations) {
+    const std::string partial = directory + ".partial";
+    std::error_code error;
+    std::filesystem::create_directories(partial, error);
+    if (error) {
+        return "Unable to create " + partial;
+    }
+    User::saveUsers(partial + "/users.txt", users);
+    if (!Event::saveEvents(partial + "/events.txt", events)) {
+        return "Unable to write " + partial + "/events.txt";
+    }
+    RecurringEvent::saveRecurringEvents(partial + "/recurring.txt", facilityManager.getSchedule().getRecurringEvents());
+    if (ReservationStore::isOpen("data/reservations.txt")) {
+        if (!ReservationStore::exportTo(partial + "/reservations.txt", reservations)) {
+            return "Unable to write " + partial + "/reservations.txt";
+        }
+    } else {
+        Reservation::saveReservations(partial + "/reservations.txt", reservations);
+    }
+    for (const char* name : {"users.txt", "events.txt", "recurring.txt", "reservations.txt"}) {
+        if (!std::filesystem::exists(partial + "/" + name)) {
+            return "Unable to write " + partial + "/" + name;
+        }
+    }
+    // The snapshot only appears under its final name once it is complete
+    std::filesystem::rename(partial, directory, error);
+    if (error) {
+        return "Unable to rename " + partial;
+    }
+    return "";
+}
+
+// Sets the schedule interval
+void DiskSnapshot::setInterval(int minutes) {
+    intervalMinutes = std::max(minutes, 0);
+    nextDue = -1;
+}
+
+// Closes every descriptor above stderr except keep, so the child holds none of the parent's sockets or files
+static void closeInheritedFds(int keep) {
+    std::vector<int> fds;
+    if (DIR* directory = opendir("/proc/self/fd")) {
+        while (dirent* entry = readdir(directory)) {
+            int fd = std::atoi(entry->d_name);
+            if (fd > 2 && fd != keep && fd != dirfd(directory)) fds.push_back(fd);
+        }
+        closedir(directory);
+    } else {
+        long limit = std::min(sysconf(_SC_OPEN_MAX), 65536L);
+        for (int fd = 3; fd < limit; ++fd) {
+            if (fd != keep) fds.push_back(fd);
+        }
+    }
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+// Forks a child writing a snapshot
+bool DiskSnapshot::start(FacilityManager& facilityManager, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events,
+                         const std::map<int, Reservation*>& reservations, std::string& message) {
+    if (isRunning()) {
+        message = "A snapshot is already being written to " + childDirectory + ".";
+        return false;
+    }
+    std::string directory = snapshotDirectory(currentMinutes());
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) {
+        message = std::string("Unable to create a pipe: ") + std::strerror(errno);
+        return false;
+    }
+    // Buffered output would otherwise be written twice, once by each process
+    std::cout.flush();
+    std::cerr.flush();
+
+    auto begin = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child: the address space is a frozen copy-on-write image of the parent's. It must not keep
+        // the listening socket bound or client connections open after the parent closes them.
+        closeInheritedFds(pipeFds[1]);
+        Metrics::setEnabled(false);  // Metric locks may have been held by other threads at the fork
+        std::cout.rdbuf(nullptr);
+        auto writeBegin = std::chrono::steady_clock::now();
+        std::string error = writeSnapshot(directory, facilityManager, users, events, reservations);
+        auto writeNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - writeBegin).count();
+        std::ostringstream report;
+        if (error.empty()) {
+            report << "ok " << writeNanoseconds << ' ' << reservations.size() + ReservationStore::archivedCount() << '\n';
+        } else {
+            report << "error " << error << '\n';
+        }
+        std::string text = report.str();
+        ssize_t written = write(pipeFds[1], text.data(), text.size());
+        _exit(error.empty() && written == static_cast<ssize_t>(text.size()) ? 0 : 1);
+    }
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    close(pipeFds[1]);
+    if (pid < 0) {
+        close(pipeFds[0]);
+        message = std::string("Unable to fork: ") + std::strerror(errno);
+        return false;
+    }
+
+    Metrics::record(kSnapshotForkMetric, static_cast<std::uint64_t>(pause));
+    fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+    child = pid;
+    reportFd = pipeFds[0];
+    childDirectory = directory;
+    childReport.clear();
+    ++stats.started;
+    stats.lastPauseNanoseconds = static_cast<std::uint64_t>(pause);
+    stats.maxPauseNanoseconds = std::max(stats.maxPauseNanoseconds, stats.lastPauseNanoseconds);
+    message = "Snapshot started in the background: " + directory + " (paused " + std::to_string(pause / 1000) + " us).";
+    return true;
+}
+
+// Reads what the child reported so far
+static void readReport() {
+    char buffer[256];
+    ssize_t count;
+    while ((count = read(reportFd, buffer, sizeof(buffer))) > 0) {
+        childReport.append(buffer, static_cast<size_t>(count));
+    }
+}
+
+// Records the outcome of a reaped child
+static void completeSnapshot(int status) {
+    readReport();
+    close(reportFd);
+    reportFd = -1;
+    child = -1;
+
+    std::istringstream report(childReport);
+    std::string outcome;
+    report >> outcome;
+    long long writeNanoseconds = 0;
+    std::uint64_t reservationCount = 0;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && outcome == "ok" && report >> writeNanoseconds >> reservationCount) {
+        ++stats.completed;
+        stats.lastWriteNanoseconds = static_cast<std::uint64_t>(writeNanoseconds);
+        stats.lastReservations = reservationCount;
+        stats.lastDirectory = childDirectory;
+        Metrics::record(kSnapshotWriteMetric, stats.lastWriteNanoseconds);
+        // Restores start from the newest complete snapshot
+        std::ofstream latest(kSnapshotDirectory + "/latest");
+        if (latest.is_open()) {
+            latest << childDirectory << std::endl;
+        } else {
+            std::cerr << "Error: Unable to open file " << kSnapshotDirectory << "/latest" << std::endl;
+        }
+        std::cout << "Snapshot completed: " << childDirectory << " (" << reservationCount << " reservation(s) written in "
+                  << writeNanoseconds / 1000000 << " ms)." << std::endl;
+    } else {
+        ++stats.failed;
+        std::string error;
+        getline(report, error);
+        std::cerr << "Error: Snapshot " << childDirectory << " failed" << (error.empty() ? "" : ":" + error) << std::endl;
+    }
+}
+
+// Collects a finished snapshot and starts a scheduled one if due
+void DiskSnapshot::tick(long long now, FacilityManager& facilityManager, const std::map<std::string, User*>& users,
+                        const std::map<std::string, Event*>& events, const std::map<int, Reservation*>& reservations) {
+    if (isRunning()) {
+        readReport();
+        int status;
+        if (waitpid(child, &status, WNOHANG) == child) {
+            completeSnapshot(status);
+        }
+    }
+    if (intervalMinutes <= 0) return;
+    if (nextDue < 0) {
+        nextDue = now + intervalMinutes;
+        return;
+    }
+    if (now >= nextDue && !isRunning()) {
+        std::string message;
+        if (!start(facilityManager, users, events, reservations, message)) {
+            std::cerr << "Error: " << message << std::endl;
+        }
+        nextDue = now + intervalMinutes;
+    }
+}
+
+// Waits for a running snapshot to finish
+void DiskSnapshot::finish() {
+    if (!isRunning()) return;
+    int status;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR) {
+    }
+    completeSnapshot(status);
+}
+
+// Checks if a snapshot is being written
+bool DiskSnapshot::isRunning() {
+    return child > 0;
+}
+
+// Returns the counters of this process
+DiskSnapshotStats DiskSnapshot::getStats() {
+    return stats;
+}
+
+// Prints the counters
+void DiskSnapshot::printStats(std::ostream& out) {
+    out << "Snapshots started: " << stats.started << ", completed: " << stats.completed << ", failed: " << stats.failed << std::endl;
+    if (isRunning()) {
+        out << "In progress: " << childDirectory << std::endl;
+    }
+    if (stats.started > 0) {
+        out << "Pause (fork) last: " << stats.lastPauseNanoseconds / 1000 << " us, max: " << stats.maxPauseNanoseconds / 1000 << " us" << std::endl;
+    }
+    if (stats.completed > 0) {
+        out << "Last snapshot: " << stats.lastDirectory << ", " << stats.lastReservations << " reservation(s) written in the background in "
+            << stats.lastWriteNanoseconds / 1000000 << " ms" << std::endl;
+    }
+    if (intervalMinutes > 0) {
+        out << "Scheduled every " << intervalMinutes << " minute(s)" << std::endl;
+    }
+}
@@ -1,18 +1,34 @@
 #include "Event.hpp"
 #include "User.hpp"
 #include "Reservation.hpp"
+#include "Metrics.hpp"
+#include "TimeUtils.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
+#include <atomic>
+
+static const int kPurchaseTicketMetric = Metrics::registerMetric("purchase_ticket");
+static const int kLoadEventsMetric = Metrics::registerMetric("load_events");
+static const int kSaveEventsMetric = Metrics::registerMetric("save_events");
+
+// Source of render versions, shared by events and recurring series
+static std::atomic<std::uint64_t> versionCounter{0};
 
 // Constructor for the Event class
 Event::Event(const std::string& eventName, User* organizer, const std::string& startTime, const std::string& endTime,
              LayoutStyle layoutStyle, bool isPublic, int maxGuests, double ticketPrice)
     : eventName(eventName), organizer(organizer), startTime(startTime), endTime(endTime), layoutStyle(layoutStyle),
-      isPublic(isPublic), maxGuests(maxGuests), ticketPrice(ticketPrice), openToResidents(true), openToNonResidents(true), ticketsSold(0) {}
+      isPublic(isPublic), maxGuests(maxGuests), ticketPrice(ticketPrice), openToResidents(true), openToNonResidents(true), ticketsSold(0), version(nextVersion()) {
+    const SeatLayout& layout = SeatLayout::forStyle(layoutStyle);
+    if (layout.assigned) {
+        seatMap = SeatMap(layout, maxGuests);
+    }
+}
 
 // Getters for various member variables
 const std::string& Event::getEventName() const {
@@ -47,8 +63,25 @@ double Event::getTicketPrice() const {
     return ticketPrice;
 }
 
-const std::vector<Reservation*>& Event::getReservations() const {
-    return reservations;
+int Event::getTicketsSold() const {
+    return ticketsSold;
+}
+
+const std::vector<User*>& Event::getWaitlist() const {
+    return waitlist;
+}
+
+std::vector<Reservation*> Event::getReservations() const {
+    std::vector<Reservation*> live;
+    live.reserve(reservations.size());
+    for (ReservationHandle handle : reservations) {
+        if (Reservation* reservation = Reservation::resolve(handle)) live.push_back(reservation);
+    }
+    return live;
+}
+
+std::uint64_t Event::getVersion() const {
+    return version;
 }
 
 bool Event::isOpenToResidents() const {
@@ -83,13 +116,20 @@ bool Event::isWithinOperatingHours(const std::string& startTime, const std::stri
     return (eventStartTime.tm_hour >= facilityOpenTime.tm_hour && eventEndTime.tm_hour <= facilityCloseTime.tm_hour);
 }
 
+// Checks if already parsed times are within operating hours, using the same rule as above
+bool Event::isWithinOperatingHours(long long start, long long end) {
+    long long startHour = (start - dayOfMinute(start) * kMinutesPerDay) / 60;
+    long long endHour = (end - dayOfMinute(end) * kMinutesPerDay) / 60;
+    return startHour >= 8 && endHour <= 23;
+}
+
 // Prints event details
 void Event::getEventDetails() const {
     std::cout << "Event: " << eventName << "\nOrganizer: " << organizer->getUsername() << "\nStart Time: " << startTime << "\nEnd Time: " << endTime
               << "\nLayout Style: " << static_cast<int>(layoutStyle) << "\nPublic: " << (isPublic ? "Yes" : "No")
               << "\nMax Guests: " << maxGuests << "\nTicket Price: $" << ticketPrice << "\nTickets Sold: " << ticketsSold
               << "\nReservations: " << std::endl;
-    for (const auto& reservation : reservations) {
+    for (const auto& reservation : getReservations()) {
         std::cout << " - Reservation ID: " << reservation->getReservationID() << ", User: " << reservation->getUser()->getUsername() << std::endl;
     }
 }
@@ -104,50 +144,195 @@ void Event::getDetailedView() const {
         std::cout << " - " << user->getUsername() << std::endl;
     }
     std::cout << "Reservations: " << std::endl;
-    for (const auto& reservation : reservations) {
+    for (const auto& reservation : getReservations()) {
         std::cout << " - Reservation ID: " << reservation->getReservationID() << ", User: " << reservation->getUser()->getUsername() << std::endl;
     }
 }
 
+// Appends "Ticket" or "<count> tickets" to message; a reused message keeps its capacity
+static void appendTicketCount(std::string& message, int count) {
+    if (count == 1) {
+        message += "Ticket";
+    } else {
+        message += std::to_string(count);
+        message += " tickets";
+    }
+}
+
 // Handles ticket purchase
-void Event::purchaseTicket(User* user) {
+void Event::purchaseTicket(User* user, int count, std::string& message) {
+    ScopedTimer timer(kPurchaseTicketMetric);
+    message.clear();
     if (!openToNonResidents && user->getUserType() == UserType::NonResident) {
-        std::cout << "This event is not open to non-residents. Ticket purchase denied for user " << user->getUsername() << "." << std::endl;
+        message += "This event is not open to non-residents. Ticket purchase denied for user ";
+        message += user->getUsername();
+        message += ".";
         return;
     }
-    if (ticketsSold < maxGuests) {
-        ++ticketsSold;
-        std::cout << "Ticket purchased by user " << user->getUsername() << "." << std::endl;
+    markChanged();
+    if (ticketsSold + count <= maxGuests) {
+        ticketsSold += count;
+        appendTicketCount(message, count);
+        message += " purchased by user ";
+        message += user->getUsername();
+        message += ".";
     } else {
         addToWaitlist(user);
-        std::cout << "Event full. User " << user->getUsername() << " added to waitlist." << std::endl;
+        message += "Event full. User ";
+        message += user->getUsername();
+        message += " added to waitlist.";
     }
 }
 
+// Sells tickets to a batch of buyers at once, waitlisting the ones past admitted in their order
+void Event::admitBatch(const std::vector<User*>& buyers, size_t admitted) {
+    admitted = std::min(admitted, buyers.size());
+    markChanged();
+    ticketsSold += static_cast<int>(admitted);
+    waitlist.insert(waitlist.end(), buyers.begin() + static_cast<std::ptrdiff_t>(admitted), buyers.end());
+}
+
 // Handles ticket cancellation
-void Event::cancelTicket(User* user) {
+void Event::cancelTicket(User* user, int count, std::string& message) {
+    message.clear();
     if (ticketsSold > 0) {
-        --ticketsSold;
-        std::cout << "Ticket canceled by user " << user->getUsername() << "." << std::endl;
+        markChanged();
+        ticketsSold -= std::min(count, ticketsSold);
+        appendTicketCount(message, count);
+        message += " canceled by user ";
     } else {
-        std::cout << "No tickets to cancel for user " << user->getUsername() << "." << std::endl;
+        message += "No tickets to cancel for user ";
     }
-    // Implement waitlist management
+    message += user->getUsername();
+    message += ".";
+}
+
+// Forgets every sold ticket and the waitlist
+void Event::clearAttendance() {
+    markChanged();
+    ticketsSold = 0;
+    waitlist.clear();
+}
+
+// Books the waiting reservations in waitlist order while the free capacity lasts
+std::vector<Reservation*> Event::promoteFromWaitlist() {
+    std::vector<Reservation*> promoted;
+    std::string ticketMessage;  // The caller reports the promotions
+    while (!waitlist.empty()) {
+        User* user = waitlist.front();
+        Reservation* waiting = nullptr;
+        for (Reservation* reservation : getReservations()) {
+            if (reservation->getUser() == user && reservation->getReservationStatus() != ReservationStatus::Canceled) {
+                waiting = reservation;
+                break;
+            }
+        }
+        if (!waiting) {
+            // The reservation behind this entry is gone
+            removeFromWaitlist(user);
+            continue;
+        }
+        // The same steps as a new booking: seats first, then the tickets; the head of the line is never skipped
+        int group = waiting->getGroupSize();
+        if (ticketsSold + group > maxGuests) break;
+        if (hasAssignedSeating() && waiting->getSeats().empty() && !waiting->assignSeats(group)) break;
+        waitlist.erase(waitlist.begin());
+        purchaseTicket(user, group, ticketMessage);
+        promoted.push_back(waiting);
+    }
+    return promoted;
 }
 
 // Adds a user to the waitlist
 void Event::addToWaitlist(User* user) {
     waitlist.push_back(user);
+    markChanged();
 }
 
 // Removes a user from the waitlist
 void Event::removeFromWaitlist(User* user) {
     waitlist.erase(std::remove(waitlist.begin(), waitlist.end(), user), waitlist.end());
+    markChanged();
 }
 
 // Adds a reservation to the event
 void Event::addReservation(Reservation* reservation) {
-    reservations.push_back(reservation);
+    reservations.push_back(reservation->getHandle());
+    markChanged();
+}
+
+// Removes a reservation from the event
+void Event::removeReservation(Reservation* reservation) {
+    reservations.erase(std::remove(reservations.begin(), reservations.end(), reservation->getHandle()), reservations.end());
+    markChanged();
+}
+
+// Checks if the event's layout assigns seats
+bool Event::hasAssignedSeating() const {
+    return SeatLayout::forStyle(layoutStyle).assigned;
+}
+
+// Returns the seat occupancy of the event
+const SeatMap& Event::getSeatMap() const {
+    return seatMap;
+}
+
+// Finds and occupies the best available seats for a group
+bool Event::allocateSeats(int count, std::vector<SeatBlock>& blocks) {
+    if (!hasAssignedSeating() || !seatMap.findBestAvailable(count, blocks)) {
+        blocks.clear();
+        return false;
+    }
+    for (const SeatBlock& block : blocks) {
+        seatMap.occupy(block);
+    }
+    markChanged();
+    return true;
+}
+
+// Occupies specific seats
+bool Event::claimSeats(const std::vector<SeatBlock>& blocks) {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!seatMap.occupy(blocks[i])) {
+            for (size_t j = 0; j < i; ++j) seatMap.release(blocks[j]);
+            return false;
+        }
+    }
+    markChanged();
+    return true;
+}
+
+// Frees seats again
+void Event::releaseSeats(const std::vector<SeatBlock>& blocks) {
+    for (const SeatBlock& block : blocks) {
+        seatMap.release(block);
+    }
+    markChanged();
+}
+
+// Formats seats as labels
+std::string Event::formatSeats(const std::vector<SeatBlock>& blocks) const {
+    return SeatMap::formatBlocks(blocks, SeatLayout::forStyle(layoutStyle).seatsPerRow());
+}
+
+// Moves the event to new times
+void Event::reschedule(const std::string& startTime, const std::string& endTime) {
+    this->startTime = startTime;
+    this->endTime = endTime;
+    markChanged();
+    for (Reservation* reservation : getReservations()) {
+        reservation->getUser()->refreshBooking(reservation);
+    }
+}
+
+// Takes a new render version
+void Event::markChanged() {
+    version = nextVersion();
+}
+
+// Hands out the next render version
+std::uint64_t Event::nextVersion() {
+    return versionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 // Sets if the event is open to residents
@@ -162,6 +347,7 @@ void Event::setOpenToNonResidents(bool openToNonResidents) {
 
 // Loads events from a file
 std::map<std::string, Event*> Event::loadEvents(const std::string& filename, const std::map<std::string, User*>& users) {
+    ScopedTimer timer(kLoadEventsMetric);
     std::map<std::string, Event*> events;
     std::ifstream file(filename);
     if (file.is_open()) {
@@ -201,27 +387,42 @@ std::map<std::string, Event*> Event::loadEvents(const std::string& filename, con
     return events;
 }
 
+// Formats the event as one line of the event file
+std::string Event::formatRecord() const {
+    std::string layoutStyleStr;
+    switch (layoutStyle) {
+        case LayoutStyle::Meeting: layoutStyleStr = "Meeting"; break;
+        case LayoutStyle::Lecture: layoutStyleStr = "Lecture"; break;
+        case LayoutStyle::Wedding: layoutStyleStr = "Wedding"; break;
+        case LayoutStyle::Dance: layoutStyleStr = "Dance"; break;
+    }
+    std::ostringstream line;
+    line << eventName << " " << organizer->getUsername() << " " << startTime << " " << endTime << " "
+         << layoutStyleStr << " " << (isPublic ? "true" : "false") << " " << maxGuests << " " << ticketPrice << " "
+         << openToResidents << " " << openToNonResidents;
+    return line.str();
+}
+
 // Saves events to a file
-void Event::saveEvents(const std::string& filename, const std::map<std::string, Event*>& events) {
-    std::ofstream file(filename);
+bool Event::saveEvents(const std::string& filename, const std::map<std::string, Event*>& events) {
+    ScopedTimer timer(kSaveEventsMetric);
+    // Write a temporary file and rename it over the old one, so readers never see a partial file
+    const std::string tempFilename = filename + ".tmp";
+    std::ofstream file(tempFilename);
     if (file.is_open()) {
         for (const auto& pair : events) {
-            Event* event = pair.second;
-            std::string layoutStyleStr;
-            switch (event->layoutStyle) {
-                case LayoutStyle::Meeting: layoutStyleStr = "Meeting"; break;
-                case LayoutStyle::Lecture: layoutStyleStr = "Lecture"; break;
-                case LayoutStyle::Wedding: layoutStyleStr = "Wedding"; break;
-                case LayoutStyle::Dance: layoutStyleStr = "Dance"; break;
-            }
-            file << event->getEventName() << " " << event->getOrganizer()->getUsername() << " " << event->getStartTime() << " " << event->getEndTime() << " "
-                 << layoutStyleStr << " " << (event->isPublic ? "true" : "false") << " " << event->getMaxGuests() << " " << event->getTicketPrice() << " "
-                 << event->isOpenToResidents() << " " << event->isOpenToNonResidents() << std::endl;
+            file << pair.second->formatRecord() << std::endl;
         }
         file.close();
-    } else {
-        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        if (!file || std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+            std::cerr << "Error: Unable to write file " << filename << std::endl;
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        return true;
     }
+    std::cerr << "Error: Unable to open file " << tempFilename << std::endl;
+    return false;
 }
 
 // Checks if the reservation time is within the event time
@@ -0,0 +1,243 @@
+#include "EventImporter.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+static const int kImportEventsMetric = Metrics::registerMetric("import_events");
+
+// One parsed input row
+struct ImportRow {
+    int lineNumber;
+    std::string eventName;
+    User* organizer = nullptr;
+    std::string startTime;
+    std::string endTime;
+    long long start = 0;
+    long long end = 0;
+    LayoutStyle layoutStyle = LayoutStyle::Meeting;
+    bool isPublic = false;
+    int maxGuests = 0;
+    double ticketPrice = 0.0;
+    bool openToResidents = true;
+    bool openToNonResidents = true;
+    std::string rejectReason;  // Empty while the row is still clean
+};
+
+// Interval taking part in the sweep: an existing event (row < 0) or an input row
+struct SweepEntry {
+    long long start;
+    long long end;
+    int row;
+    const Event* event;
+};
+
+// Splits a line on commas, trimming spaces around each field
+static std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream stream(line);
+    while (getline(stream, field, ',')) {
+        size_t first = field.find_first_not_of(" \t\r");
+        size_t last = field.find_last_not_of(" \t\r");
+        fields.push_back(first == std::string::npos ? "" : field.substr(first, last - first + 1));
+    }
+    return fields;
+}
+
+// Parses a layout style given by name or number (1-4)
+static bool parseLayoutStyle(const std::string& text, LayoutStyle& layoutStyle) {
+    if (text == "1" || text == "Meeting") layoutStyle = LayoutStyle::Meeting;
+    else if (text == "2" || text == "Lecture") layoutStyle = LayoutStyle::Lecture;
+    else if (text == "3" || text == "Wedding") layoutStyle = LayoutStyle::Wedding;
+    else if (text == "4" || text == "Dance") layoutStyle = LayoutStyle::Dance;
+    else return false;
+    return true;
+}
+
+// Parses true/false, yes/no or 1/0
+static bool parseFlag(const std::string& text, bool& value) {
+    if (text == "true" || text == "yes" || text == "1") value = true;
+    else if (text == "false" || text == "no" || text == "0") value = false;
+    else return false;
+    return true;
+}
+
+// Parses the fields of a row, returning the reason it is invalid or an empty string
+static std::string parseRow(const std::vector<std::string>& fields, ImportRow& row) {
+    if (!fields.empty()) row.eventName = fields[0];
+    if (fields.size() != 10) return "expected 10 fields";
+    row.startTime = fields[2];
+    row.endTime = fields[3];
+    if (row.eventName.empty() || row.eventName.find(' ') != std::string::npos) return "invalid event name";
+    if (!parseTimestamp(row.startTime, row.start) || !parseTimestamp(row.endTime, row.end)) return "invalid time";
+    if (row.end <= row.start) return "end time not after start time";
+    if (!parseLayoutStyle(fields[4], row.layoutStyle)) return "invalid layout style";
+    if (!parseFlag(fields[5], row.isPublic) || !parseFlag(fields[8], row.openToResidents) || !parseFlag(fields[9], row.openToNonResidents)) {
+        return "invalid yes/no field";
+    }
+    std::istringstream guests(fields[6]), price(fields[7]);
+    if (!(guests >> row.maxGuests) || row.maxGuests < 0) return "invalid max guests";
+    if (!(price >> row.ticketPrice) || row.ticketPrice < 0) return "invalid ticket price";
+    return "";
+}
+
+// Imports events from a file, commits the clean rows with one save and writes rejects to reportFilename
+ImportResult EventImporter::importEvents(const std::string& filename, const std::string& reportFilename,
+                                         std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule) {
+    ScopedTimer timer(kImportEventsMetric);
+    ImportResult result;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return result;
+    }
+
+    // Parse every row and apply the checks that need no ordering
+    std::vector<ImportRow> rows;
+    std::set<std::string> seenNames;
+    std::string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#' || line.compare(0, 9, "eventName") == 0) continue;
+        ImportRow row;
+        row.lineNumber = lineNumber;
+        std::vector<std::string> fields = splitFields(line);
+        row.rejectReason = parseRow(fields, row);
+        if (row.rejectReason.empty()) {
+            auto organizer = users.find(fields[1]);
+            if (organizer == users.end()) {
+                row.rejectReason = "unknown organizer " + fields[1];
+            } else if (!Event::isWithinOperatingHours(row.start, row.end)) {
+                row.rejectReason = "outside operating hours";
+            } else if (events.count(row.eventName) || schedule.findRecurringEvent(row.eventName) || !seenNames.insert(row.eventName).second) {
+                row.rejectReason = "duplicate event name";
+            } else {
+                row.organizer = organizer->second;
+            }
+        }
+        rows.push_back(row);
+    }
+    file.close();
+
+    // Sort the candidate rows together with the existing events they could touch
+    std::vector<SweepEntry> sweep;
+    long long rangeStart = 0, rangeEnd = 0;
+    bool haveRange = false;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!rows[i].rejectReason.empty()) continue;
+        sweep.push_back(SweepEntry{rows[i].start, rows[i].end, static_cast<int>(i), nullptr});
+        rangeStart = haveRange ? std::min(rangeStart, rows[i].start) : rows[i].start;
+        rangeEnd = haveRange ? std::max(rangeEnd, rows[i].end) : rows[i].end;
+        haveRange = true;
+    }
+    if (haveRange) {
+        for (Event* event : schedule.eventsBetween(rangeStart, rangeEnd)) {
+            long long start, end;
+            if (parseTimestamp(event->getStartTime(), start) && parseTimestamp(event->getEndTime(), end)) {
+                sweep.push_back(SweepEntry{start, end, -1, event});
+            }
+        }
+    }
+    // Existing events sort before rows starting at the same minute, rows keep their file order
+    std::sort(sweep.begin(), sweep.end(), [](const SweepEntry& a, const SweepEntry& b) {
+        if (a.start != b.start) return a.start < b.start;
+        return a.row < b.row;
+    });
+
+    // Forward pass: conflicts with existing events starting at or before the row.
+    // Backward pass: conflicts with existing events starting inside the row.
+    long long existingEnd = 0;
+    const Event* existingEndEvent = nullptr;
+    for (const SweepEntry& entry : sweep) {
+        if (entry.row < 0) {
+            if (!existingEndEvent || entry.end > existingEnd) {
+                existingEnd = entry.end;
+                existingEndEvent = entry.event;
+            }
+        } else if (existingEndEvent && existingEnd > entry.start) {
+            rows[entry.row].rejectReason = "conflicts with event " + existingEndEvent->getEventName();
+        }
+    }
+    const Event* nextExisting = nullptr;
+    long long nextExistingStart = 0;
+    for (auto entry = sweep.rbegin(); entry != sweep.rend(); ++entry) {
+        if (entry->row < 0) {
+            nextExisting = entry->event;
+            nextExistingStart = entry->start;
+        } else if (nextExisting && nextExistingStart < entry->end && rows[entry->row].rejectReason.empty()) {
+            rows[entry->row].rejectReason = "conflicts with event " + nextExisting->getEventName();
+        }
+    }
+
+    // Final pass: rows must not overlap each other or a recurring series; the earlier row wins
+    int lastAccepted = -1;
+    for (const SweepEntry& entry : sweep) {
+        if (entry.row < 0) continue;
+        ImportRow& row = rows[entry.row];
+        if (!row.rejectReason.empty()) continue;
+        if (lastAccepted >= 0 && rows[lastAccepted].end > row.start) {
+            row.rejectReason = "conflicts with imported event " + rows[lastAccepted].eventName;
+            continue;
+        }
+        for (const auto& pair : schedule.getRecurringEvents()) {
+            if (pair.second->overlaps(row.start, row.end)) {
+                row.rejectReason = "conflicts with recurring event " + pair.first;
+                break;
+            }
+        }
+        if (row.rejectReason.empty()) {
+            lastAccepted = entry.row;
+        }
+    }
+
+    // Commit the clean rows, then persist them with a single write
+    std::vector<Event*> added;
+    for (const ImportRow& row : rows) {
+        if (!row.rejectReason.empty()) {
+            ++result.rejected;
+            continue;
+        }
+        Event* event = new Event(row.eventName, row.organizer, row.startTime, row.endTime, row.layoutStyle, row.isPublic, row.maxGuests, row.ticketPrice);
+        event->setOpenToResidents(row.openToResidents);
+        event->setOpenToNonResidents(row.openToNonResidents);
+        events[row.eventName] = event;
+        added.push_back(event);
+    }
+    if (!added.empty()) {
+        if (Event::saveEvents("data/events.txt", events)) {
+            for (Event* event : added) {
+                schedule.addEvent(event);
+            }
+            result.accepted = static_cast<int>(added.size());
+            result.committed = true;
+        } else {
+            // Nothing reached the file, so roll the whole batch back
+            for (Event* event : added) {
+                events.erase(event->getEventName());
+                delete event;
+            }
+            std::cerr << "Error: Import not committed, events.txt could not be written." << std::endl;
+        }
+    }
+
+    if (result.rejected > 0) {
+        std::ofstream report(reportFilename);
+        if (report.is_open()) {
+            for (const ImportRow& row : rows) {
+                if (!row.rejectReason.empty()) {
+                    report << "line " << row.lineNumber << "," << row.eventName << "," << row.rejectReason << std::endl;
+                }
+            }
+            report.close();
+        } else {
+            std::cerr << "Error: Unable to open file " << reportFilename << std::endl;
+        }
+    }
+    return result;
+}
@@ -1,6 +1,7 @@
 #include "FacilityManager.hpp"
 #include "Event.hpp"
 #include "HelperFunctions.hpp"
+#include "ReservationStore.hpp"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -15,6 +16,18 @@ void FacilityManager::addEvent(Event* event) {
     schedule.addEvent(event);  
 }
 
+// Removes an event from the facility manager and schedule
+void FacilityManager::removeEvent(Event* event) {
+    events.erase(event->getEventName());
+    schedule.removeEvent(event);
+}
+
+// Removes every event and recurring series from the facility manager and schedule
+void FacilityManager::clearEvents() {
+    events.clear();
+    schedule.clear();
+}
+
 // Returns the schedule of events
 Schedule& FacilityManager::getSchedule() {
     return schedule;
@@ -107,20 +120,35 @@ void FacilityManager::createEvent(std::map<std::string, Event*>& events, const s
 void FacilityManager::cancelEvent(std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations, const std::string& eventName) {
     auto it = events.find(eventName);
     if (it == events.end()) {
+        // Canceling an occurrence that was never booked only needs an exception in its series
+        RecurringEvent* series;
+        long long occurrenceStart;
+        std::string seriesName, date;
+        if (schedule.findOccurrence(eventName, series, occurrenceStart) && RecurringEvent::splitOccurrenceName(eventName, seriesName, date)) {
+            series->addException(date);
+            RecurringEvent::saveRecurringEvents("data/recurring.txt", schedule.getRecurringEvents());
+            std::cout << "Occurrence " << eventName << " canceled successfully." << std::endl;
+            return;
+        }
         std::cout << "Event not found." << std::endl;
         return;
     }
 
     Event* event = it->second;
+    // Archived reservations of the event need refunds too
+    ReservationStore::pageInEvent(eventName, reservations);
     for (const auto& reservation : event->getReservations()) {
         User* user = reservation->getUser();
         double refundAmount = reservation->getTotalCost();
         user->processRefund(refundAmount);
         reservations.erase(reservation->getReservationID());
         std::cout << "Refund processed for user: " << user->getUsername() << " for amount: " << refundAmount << std::endl;
+        Reservation::destroy(reservation);
     }
 
     events.erase(it);
+    this->events.erase(eventName);
+    schedule.removeEvent(event);
     delete event;
     std::cout << "Event canceled successfully." << std::endl;
 
@@ -0,0 +1,171 @@
+#include "FlashSale.hpp"
+#include "HelperFunctions.hpp"
+#include "HoldExpiry.hpp"
+#include "ReservationStore.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <set>
+#include <chrono>
+#include <algorithm>
+
+static const int kFlashSaleBatchMetric = Metrics::registerMetric("flash_sale_batch");
+static const int kFlashSaleWaitMetric = Metrics::registerMetric("flash_sale_wait");
+static const char* kFlashSaleLogFilename = "data/flash_sale.log";
+static const size_t kDefaultBatchSize = 64;
+
+// Policy and queue
+namespace {
+struct QueuedRequest {
+    FlashSaleRequest request;
+    std::chrono::steady_clock::time_point arrival;
+};
+struct FlashSaleState {
+    size_t batchSize = kDefaultBatchSize;
+    std::set<std::string> events;
+    std::deque<QueuedRequest> queue;
+    std::uint64_t batches = 0;
+};
+FlashSaleState state;
+}
+
+// Loads the flash-sale events and the batch size
+void FlashSale::loadPolicy(const std::string& filename) {
+    state.batchSize = kDefaultBatchSize;
+    state.events.clear();
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return;
+    }
+    std::string line;
+    while (getline(file, line)) {
+        std::istringstream iss(line);
+        std::string kind, name;
+        long long size;
+        if (!(iss >> kind) || kind[0] == '#') continue;
+        if (kind == "batch" && iss >> size && size > 0) {
+            state.batchSize = static_cast<size_t>(size);
+        } else if (kind == "event" && iss >> name) {
+            state.events.insert(name);
+        } else {
+            std::cerr << "Error: Invalid line in " << filename << ": " << line << std::endl;
+        }
+    }
+}
+
+// Checks if requests for an event go through the queue
+bool FlashSale::isFlashSale(const std::string& eventName) {
+    if (state.events.empty()) return false;
+    if (state.events.count(eventName) > 0) return true;
+    // Occurrences of a recurring series are named <series>@<date>
+    size_t at = eventName.find('@');
+    return at != std::string::npos && state.events.count(eventName.substr(0, at)) > 0;
+}
+
+// Returns the number of requests admitted per batch
+size_t FlashSale::batchSize() {
+    return state.batchSize;
+}
+
+// Appends a request to the queue
+void FlashSale::enqueue(const FlashSaleRequest& request) {
+    state.queue.push_back({request, std::chrono::steady_clock::now()});
+}
+
+// Returns the number of requests waiting
+size_t FlashSale::queued() {
+    return state.queue.size();
+}
+
+// Admits the next batch of queued requests
+size_t FlashSale::admitBatch(Schedule& schedule, std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations,
+                             std::vector<FlashSaleOutcome>& outcomes) {
+    if (state.queue.empty()) return 0;
+    ScopedTimer timer(kFlashSaleBatchMetric);
+    const size_t first = outcomes.size();
+    const size_t count = std::min(state.queue.size(), state.batchSize);
+    const auto now = std::chrono::steady_clock::now();
+
+    // Check the requests in arrival order; each accepted one gets its reservation right away,
+    // so a buyer asking twice in one batch is refused the second time
+    std::vector<Event*> batchEvents;           // Events of the batch, in order of their first request
+    std::vector<std::vector<size_t>> buyers;  // Outcome indexes of each event's accepted requests, in arrival order
+    for (size_t i = 0; i < count; ++i) {
+        QueuedRequest queuedRequest = std::move(state.queue.front());
+        state.queue.pop_front();
+        Metrics::record(kFlashSaleWaitMetric,
+                        static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - queuedRequest.arrival).count()));
+        outcomes.push_back(FlashSaleOutcome());
+        FlashSaleOutcome& outcome = outcomes.back();
+        outcome.request = std::move(queuedRequest.request);
+        User* user = outcome.request.user;
+        Event* event = findBookableEvent(schedule, events, user, reservations, outcome.request.eventName, outcome.request.reservationTime,
+                                         outcome.message);
+        if (!event) continue;
+        int reservationID = ReservationStore::maxReservationID(reservations) + 1;
+        outcome.reservation = Reservation::create(reservationID, user, event, outcome.request.reservationTime);
+        reservations[reservationID] = outcome.reservation;
+        size_t group = std::find(batchEvents.begin(), batchEvents.end(), event) - batchEvents.begin();
+        if (group == batchEvents.size()) {
+            batchEvents.push_back(event);
+            buyers.emplace_back();
+        }
+        buyers[group].push_back(outcomes.size() - 1);
+    }
+
+    // Hand each event's free tickets to its first buyers in one step
+    size_t made = 0;
+    for (size_t group = 0; group < batchEvents.size(); ++group) {
+        Event* event = batchEvents[group];
+        size_t freeTickets = static_cast<size_t>(std::max(event->getMaxGuests() - event->getTicketsSold(), 0));
+        size_t admitted = 0;
+        bool soldOut = false;  // Once a buyer is waitlisted, everyone after them is too
+        std::vector<User*> groupUsers;
+        for (size_t index : buyers[group]) {
+            FlashSaleOutcome& outcome = outcomes[index];
+            groupUsers.push_back(outcome.request.user);
+            soldOut = soldOut || admitted == freeTickets || (event->hasAssignedSeating() && !outcome.reservation->assignSeats(1));
+            if (!soldOut) {
+                ++admitted;
+                outcome.message = "Reservation made successfully.";
+                if (!outcome.reservation->getSeats().empty()) {
+                    outcome.message += " Seats: " + outcome.reservation->getSeatLabels();
+                }
+            } else {
+                outcome.waitlisted = true;
+                outcome.message = "Reservation made, but the event is sold out: you are on the waitlist.";
+            }
+            ++made;
+        }
+        event->admitBatch(groupUsers, admitted);
+        // Only the admitted buyers hold a ticket whose hold can expire
+        for (size_t index : buyers[group]) {
+            HoldExpiry::track(outcomes[index].reservation);
+        }
+    }
+
+    // The whole batch is saved once and journaled in one write
+    ++state.batches;
+    if (made > 0) {
+        Reservation::saveReservations("data/reservations.txt", reservations);
+    }
+    std::ostringstream journal;
+    const std::string stamp = formatTimestamp(currentMinutes());
+    for (size_t i = first; i < outcomes.size(); ++i) {
+        const FlashSaleOutcome& outcome = outcomes[i];
+        journal << stamp << " batch " << state.batches << " "
+                << (!outcome.reservation ? "refused" : outcome.waitlisted ? "waitlisted" : "admitted") << " "
+                << (outcome.reservation ? std::to_string(outcome.reservation->getReservationID()) : std::string("-")) << " "
+                << (outcome.request.user ? outcome.request.user->getUsername() : std::string("-")) << " " << outcome.request.eventName << "\n";
+    }
+    std::ofstream log(kFlashSaleLogFilename, std::ios::app);
+    if (!log.is_open()) {
+        std::cerr << "Error: Unable to open file " << kFlashSaleLogFilename << std::endl;
+    } else {
+        log << journal.str() << std::flush;
+    }
+    return made;
+}
@@ -1,8 +1,21 @@
 #include "HelperFunctions.hpp"
+#include "TimeUtils.hpp"
+#include "EventImporter.hpp"
+#include "UserProvisioner.hpp"
+#include "ReservationStore.hpp"
+#include "Archive.hpp"
+#include "Analytics.hpp"
+#include "Preemption.hpp"
+#include "HoldExpiry.hpp"
+#include "CheckIn.hpp"
+#include "DiskSnapshot.hpp"
+#include "FlashSale.hpp"
+#include "RenderCache.hpp"
 #include <iostream>
 #include <limits>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 // Prints the main menu
 void printMenu() {
@@ -22,6 +35,18 @@ void printMenu() {
     std::cout << "14. View Facility Budget" << std::endl;
     std::cout << "15. Logout" << std::endl;
     std::cout << "16. Exit" << std::endl;
+    std::cout << "17. View Performance Metrics" << std::endl;
+    std::cout << "18. Create a Recurring Event" << std::endl;
+    std::cout << "19. View Recurring Event Occurrences" << std::endl;
+    std::cout << "20. Import Events from File" << std::endl;
+    std::cout << "21. Audit All Events and Reservations" << std::endl;
+    std::cout << "22. View Archive Reports" << std::endl;
+    std::cout << "23. Query Reservations" << std::endl;
+    std::cout << "24. View Utilization Analytics" << std::endl;
+    std::cout << "25. Priority Booking (City)" << std::endl;
+    std::cout << "26. Door Check-In" << std::endl;
+    std::cout << "27. Take a Snapshot (City)" << std::endl;
+    std::cout << "28. Provision Users from File" << std::endl;
 }
 
 // Handles the creation of a new user
@@ -58,8 +83,39 @@ void handleUserCreation(std::map<std::string, User*>& users) {
     std::cout << "User created successfully." << std::endl;
 }
 
+// Views the schedule for today, this week, a date range or all events
+void viewScheduleByRange(const Schedule& schedule) {
+    std::string mode;
+    std::cout << "View (1) today, (2) this week, (3) a date range or (4) all events: ";
+    std::getline(std::cin, mode);
+
+    long long today = dayOfMinute(currentMinutes());
+    if (mode == "1" || mode.empty()) {
+        schedule.viewScheduleRange(today, today);
+    } else if (mode == "2") {
+        long long monday = today - weekdayFromDays(today);
+        schedule.viewScheduleRange(monday, monday + 6);
+    } else if (mode == "3") {
+        std::string fromStr, toStr;
+        long long fromDay, toDay;
+        std::cout << "From date (YYYY-MM-DD): ";
+        std::getline(std::cin, fromStr);
+        std::cout << "To date (YYYY-MM-DD): ";
+        std::getline(std::cin, toStr);
+        if (!parseDate(fromStr, fromDay) || !parseDate(toStr, toDay) || toDay < fromDay) {
+            std::cout << "Invalid date range." << std::endl;
+            return;
+        }
+        schedule.viewScheduleRange(fromDay, toDay);
+    } else if (mode == "4") {
+        schedule.viewSchedule();
+    } else {
+        std::cout << "Invalid choice." << std::endl;
+    }
+}
+
 // Handles making a reservation
-void handleReservation(Schedule& schedule, User* currentUser, std::map<int, Reservation*>& reservations) {
+void handleReservation(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations) {
     if (!currentUser) {
         std::cout << "Please login first." << std::endl;
         return;
@@ -73,37 +129,158 @@ void handleReservation(Schedule& schedule, User* currentUser, std::map<int, Rese
     std::cout << "Enter the event name to make a reservation: ";
     std::cin >> eventName;
 
-    Event* event = schedule.findEvent(eventName);
-    if (event) {
-        // Check for duplicate reservation
-        for (const auto& reservation : currentUser->getUserReservations()) {
-            if (reservation->getEvent()->getEventName() == eventName) {
-                std::cout << "You already have a reservation for this event." << std::endl;
-                return;
-            }
+    // Occurrences of recurring events are only materialized once the booking goes through
+    RecurringEvent* series;
+    long long occurrenceStart;
+    LayoutStyle layoutStyle;
+    if (schedule.findOccurrence(eventName, series, occurrenceStart)) {
+        layoutStyle = series->getLayoutStyle();
+    } else if (Event* event = schedule.findEvent(eventName)) {
+        layoutStyle = event->getLayoutStyle();
+    } else {
+        std::cout << "Event not found." << std::endl;
+        return;
+    }
+    if (hasReservationForEvent(currentUser, eventName)) {
+        std::cout << "You already have a reservation for this event." << std::endl;
+        return;
+    }
+
+    std::string reservationTime;
+    std::cout << "Enter reservation time (YYYY-MM-DDTHH:MM): ";
+    std::cin >> reservationTime;
+    if (FlashSale::isFlashSale(eventName)) {
+        // Flash sales sell single tickets through the batch queue, which only holds this request at the desk
+        FlashSale::enqueue({currentUser, eventName, reservationTime});
+        std::vector<FlashSaleOutcome> outcomes;
+        FlashSale::admitBatch(schedule, events, reservations, outcomes);
+        for (const FlashSaleOutcome& outcome : outcomes) {
+            std::cout << outcome.message << std::endl;
         }
+        return;
+    }
+    int seatCount = 1;
+    if (SeatLayout::forStyle(layoutStyle).assigned) {
+        std::cout << "Enter number of seats (seated together when possible): ";
+        while (!(std::cin >> seatCount) || seatCount < 1) {
+            std::cout << "Invalid input. Please enter a positive number: ";
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    }
+
+    std::string message;
+    reserveEvent(schedule, events, currentUser, reservations, eventName, reservationTime, message, seatCount);
+    std::cout << message << std::endl;
+}
 
-        std::string reservationTime;
-        std::cout << "Enter reservation time (YYYY-MM-DDTHH:MM): ";
-        std::cin >> reservationTime;
+// Finds a user's reservation for an event by walking the user's own reservations, or nullptr
+Reservation* findUserReservation(const User* user, const std::string& eventName) {
+    return user->findReservation(eventName);
+}
 
-        if (!event->isWithinEventTime(reservationTime)) {
-            std::cout << "The reservation time is outside the event's start and end times." << std::endl;
-            return;
+// Checks if the user already holds a reservation for the event
+bool hasReservationForEvent(const User* user, const std::string& eventName) {
+    return findUserReservation(user, eventName) != nullptr;
+}
+
+// Finds the event a user asks to book, checking the request against the booking rules
+Event* findBookableEvent(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations,
+                         const std::string& eventName, const std::string& reservationTime, std::string& message, int seatCount) {
+    if (!currentUser) {
+        message = "Please login first.";
+        return nullptr;
+    }
+    // An occurrence is checked through its series and only materialized (and saved) once the booking will go ahead
+    RecurringEvent* series;
+    long long eventStart = 0, eventEnd = 0;
+    const bool occurrence = schedule.findOccurrence(eventName, series, eventStart);
+    Event* event = nullptr;
+    bool timed = true;
+    if (occurrence) {
+        eventEnd = eventStart + series->getDuration();
+        long long requestedTime;
+        if (!parseTimestamp(reservationTime, requestedTime) || requestedTime < eventStart || requestedTime > eventEnd) {
+            message = "The reservation time is outside the event's start and end times.";
+            return nullptr;
         }
+    } else {
+        event = schedule.findEvent(eventName);
+        if (!event) {
+            message = "Event not found.";
+            return nullptr;
+        }
+        timed = parseTimestamp(event->getStartTime(), eventStart) && parseTimestamp(event->getEndTime(), eventEnd);
+        // Archived reservations must be resident before checking for an existing one
+        ReservationStore::pageInEvent(event->getEventName(), reservations);
+    }
+    if (hasReservationForEvent(currentUser, eventName)) {
+        message = "You already have a reservation for this event.";
+        return nullptr;
+    }
+    if (timed) {
+        if (const Reservation* conflict = currentUser->findConflict(eventStart, eventEnd)) {
+            message = "You already have a reservation for " + conflict->getEvent()->getEventName() + " (" + conflict->getEvent()->getStartTime() +
+                      " to " + conflict->getEvent()->getEndTime() + "), which overlaps this event.";
+            return nullptr;
+        }
+    }
+    if (event && !event->isWithinEventTime(reservationTime)) {
+        message = "The reservation time is outside the event's start and end times.";
+        return nullptr;
+    }
+    if (!(occurrence ? series->isOpenToNonResidents() : event->isOpenToNonResidents()) && currentUser->getUserType() == UserType::NonResident) {
+        message = "This event is not open to non-residents.";
+        return nullptr;
+    }
+    // An unbooked occurrence has every seat free
+    if (SeatLayout::forStyle(occurrence ? series->getLayoutStyle() : event->getLayoutStyle()).assigned) {
+        int available = occurrence ? series->getMaxGuests() : event->getSeatMap().available();
+        int capacity = occurrence ? series->getMaxGuests() : event->getSeatMap().capacity();
+        if (seatCount > available) {
+            message = "Not enough seats left: " + std::to_string(available) + " of " + std::to_string(capacity) + " are free.";
+            return nullptr;
+        }
+    }
+    if (occurrence) {
+        event = materializeOccurrence(schedule, events, eventName);
+        if (!event) {
+            message = "Event not found.";
+            return nullptr;
+        }
+    }
+    return event;
+}
+
+// Creates a reservation for an event
+Reservation* reserveEvent(Schedule& schedule, std::map<std::string, Event*>& events, User* currentUser, std::map<int, Reservation*>& reservations,
+                          const std::string& eventName, const std::string& reservationTime, std::string& message, int seatCount) {
+    Event* event = findBookableEvent(schedule, events, currentUser, reservations, eventName, reservationTime, message, seatCount);
+    if (!event) {
+        return nullptr;
+    }
 
-        int reservationID = reservations.size() + 1;
-        Reservation* reservation = new Reservation(reservationID, currentUser, event, reservationTime);
-        reservations[reservationID] = reservation;
-        event->purchaseTicket(currentUser);
+    // Use one past the highest ID ever handed out (archived and canceled ones included) so IDs stay unique
+    int reservationID = ReservationStore::maxReservationID(reservations) + 1;
+    Reservation* reservation = Reservation::create(reservationID, currentUser, event, reservationTime);
+    if (event->hasAssignedSeating() && !reservation->assignSeats(seatCount)) {
+        Reservation::destroy(reservation);
+        message = "Not enough seats left: " + std::to_string(event->getSeatMap().available()) + " of " +
+                  std::to_string(event->getSeatMap().capacity()) + " are free.";
+        return nullptr;
+    }
+    reservations[reservationID] = reservation;
+    event->purchaseTicket(currentUser, event->hasAssignedSeating() ? seatCount : 1, message);
+    HoldExpiry::track(reservation);
 
-        // Save the updated reservations to the file
-        Reservation::saveReservations("data/reservations.txt", reservations);
+    // Save the updated reservations to the file
+    Reservation::saveReservations("data/reservations.txt", reservations);
 
-        std::cout << "Reservation made successfully." << std::endl;
-    } else {
-        std::cout << "Event not found." << std::endl;
+    message += "\nReservation made successfully.";
+    if (!reservation->getSeats().empty()) {
+        message += " Seats: " + reservation->getSeatLabels();
     }
+    return reservation;
 }
 
 // Handles cancellation of a reservation
@@ -121,52 +298,73 @@ void handleCancellation(User* currentUser, std::map<int, Reservation*>& reservat
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
 
+    std::string message;
+    cancelReservationByID(currentUser, reservations, facilityManager, reservationID, message);
+    std::cout << message << std::endl;
+}
+
+// Cancels and refunds a reservation owned by the user
+bool cancelReservationByID(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager,
+                           int reservationID, std::string& message) {
+    if (!currentUser) {
+        message = "Please login first.";
+        return false;
+    }
+    ReservationStore::pageInReservation(reservationID, reservations);
     auto it = reservations.find(reservationID);
-    if (it != reservations.end() && it->second->getUser() == currentUser) {
-        it->second->processRefund(facilityManager);
-        delete it->second;
-        reservations.erase(it);
+    if (it == reservations.end() || it->second->getUser() != currentUser) {
+        message = "Reservation not found or you do not have permission to cancel this reservation.";
+        return false;
+    }
+    Reservation* reservation = it->second;
+    reservation->processRefund(facilityManager, message);
+    reservations.erase(it);
+    Reservation::destroy(reservation);
 
-        // Save the updated reservations to the file
-        Reservation::saveReservations("data/reservations.txt", reservations);
+    // Save the updated reservations to the file
+    Reservation::saveReservations("data/reservations.txt", reservations);
 
-        std::cout << "Reservation canceled successfully." << std::endl;
-    } else {
-        std::cout << "Reservation not found or you do not have permission to cancel this reservation." << std::endl;
-    }
+    message += "\nReservation canceled successfully.";
+    return true;
 }
 
 // Lists all reservations
-void listAllReservations(const std::map<int, Reservation*>& reservations) {
-    if (reservations.empty()) {
+void listAllReservations(const Schedule& schedule) {
+    SnapshotStore::ReadGuard snapshot = schedule.getSnapshots().read();
+    size_t archived = ReservationStore::archivedCount();
+    if (snapshot->reservationCount == 0) {
         std::cout << "No reservations found." << std::endl;
-        return;
     }
-    for (const auto& pair : reservations) {
-        Reservation* reservation = pair.second;
-        std::cout << "Reservation ID: " << reservation->getReservationID() << "\nUser: " << reservation->getUser()->getUsername()
-                  << "\nEvent: " << reservation->getEvent()->getEventName() << "\nStatus: " << static_cast<int>(reservation->getReservationStatus())
-                  << "\nPayment Status: " << static_cast<int>(reservation->getPaymentStatus()) << "\nTotal Cost: " << reservation->getTotalCost()
-                  << "\nReservation Time: " << reservation->getReservationTime() << "\n" << std::endl;
+    snapshot->forEachReservation([](const ReservationSnapshot& reservation) {
+        printReservationDetails(reservation);
+        std::cout << std::endl;
+    });
+    if (archived > 0) {
+        std::cout << archived << " archived reservation(s) of past events are not loaded; view an event or reservation to load them." << std::endl;
     }
 }
 
 // Views detailed information of an event
-void viewDetailedEvent(Schedule& schedule) {
+void viewDetailedEvent(Schedule& schedule, std::map<int, Reservation*>& reservations) {
     std::string eventName;
     std::cout << "Enter the event name: ";
     std::cin >> eventName;
 
-    Event* event = schedule.findEvent(eventName);
+    if (ReservationStore::pageInEvent(eventName, reservations) > 0) {
+        schedule.publishSnapshot(reservations);
+    }
+
+    SnapshotStore::ReadGuard snapshot = schedule.getSnapshots().read();
+    const EventSnapshot* event = snapshot->findEvent(eventName);
     if (event) {
-        event->getDetailedView();
+        std::cout << *RenderCache::eventDetailedView(*event) << std::flush;
     } else {
         std::cout << "Event not found." << std::endl;
     }
 }
 
 // Views detailed information of a reservation
-void viewDetailedReservation(const std::map<int, Reservation*>& reservations) {
+void viewDetailedReservation(Schedule& schedule, std::map<int, Reservation*>& reservations) {
     int reservationID;
     std::cout << "Enter the reservation ID: ";
     while (!(std::cin >> reservationID)) {
@@ -175,9 +373,13 @@ void viewDetailedReservation(const std::map<int, Reservation*>& reservations) {
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
 
-    auto it = reservations.find(reservationID);
-    if (it != reservations.end()) {
-        it->second->getDetailedView();
+    if (ReservationStore::pageInReservation(reservationID, reservations) > 0) {
+        schedule.publishSnapshot(reservations);
+    }
+    SnapshotStore::ReadGuard snapshot = schedule.getSnapshots().read();
+    const ReservationSnapshot* reservation = snapshot->findReservation(reservationID);
+    if (reservation) {
+        printReservationDetails(*reservation);
     } else {
         std::cout << "Reservation not found." << std::endl;
     }
@@ -251,14 +453,22 @@ User* handleLogin(const std::map<std::string, User*>& users) {
     std::cout << "Enter password: ";
     std::cin >> password;
 
-    auto it = users.find(username);
-    if (it != users.end() && it->second->getPassword() == password) {
+    User* user = authenticateUser(users, username, password);
+    if (user) {
         std::cout << "Login successful." << std::endl;
-        return it->second;
     } else {
         std::cout << "Invalid username or password." << std::endl;
-        return nullptr;
     }
+    return user;
+}
+
+// Returns the user matching the credentials, or nullptr
+User* authenticateUser(const std::map<std::string, User*>& users, const std::string& username, const std::string& password) {
+    auto it = users.find(username);
+    if (it != users.end() && it->second->getPassword() == password) {
+        return it->second;
+    }
+    return nullptr;
 }
 
 // Gets a yes/no input from the user
@@ -287,15 +497,505 @@ void handlePayment(User* currentUser, std::map<int, Reservation*>& reservations,
     std::cout << "Enter the event name to make a payment: ";
     std::cin >> eventName;
 
-    for (const auto& pair : reservations) {
-        Reservation* reservation = pair.second;
-        if (reservation->getEvent()->getEventName() == eventName && reservation->getUser() == currentUser) {
-            reservation->makePayment(facilityManager);
-            Reservation::saveReservations("data/reservations.txt", reservations);
-            std::cout << "Payment made successfully." << std::endl;
-            return;
+    std::string message;
+    payForEvent(currentUser, reservations, facilityManager, eventName, message);
+    std::cout << message << std::endl;
+}
+
+// Turns a recurring event occurrence into a standalone event and saves it
+Event* materializeOccurrence(Schedule& schedule, std::map<std::string, Event*>& events, const std::string& occurrenceName) {
+    Event* event = schedule.materializeOccurrence(occurrenceName);
+    if (!event) {
+        return nullptr;
+    }
+    events[occurrenceName] = event;
+    Event::saveEvents("data/events.txt", events);
+    RecurringEvent::saveRecurringEvents("data/recurring.txt", schedule.getRecurringEvents());
+    return event;
+}
+
+// Handles creation of a recurring event
+void createRecurringEvent(std::map<std::string, RecurringEvent*>& recurringEvents, const std::map<std::string, User*>& users, Schedule& schedule) {
+    std::string eventName, organizerUsername, startTime, endTime, layoutStyleStr, frequencyStr, untilStr, exceptionsStr;
+    int maxGuests;
+    double ticketPrice;
+    RecurrenceRule rule;
+
+    std::cout << "Enter series name: ";
+    std::getline(std::cin, eventName);
+    std::cout << "Enter organizer username: ";
+    std::getline(std::cin, organizerUsername);
+    std::cout << "Enter first start time (YYYY-MM-DDTHH:MM): ";
+    std::getline(std::cin, startTime);
+    std::cout << "Enter first end time (YYYY-MM-DDTHH:MM): ";
+    std::getline(std::cin, endTime);
+    std::cout << "Enter layout style (integer 1-4): ";
+    std::getline(std::cin, layoutStyleStr);
+    std::cout << "Enter max guests: ";
+    std::cin >> maxGuests;
+    std::cout << "Enter ticket price: ";
+    std::cin >> ticketPrice;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "Repeat Weekly or Monthly: ";
+    std::getline(std::cin, frequencyStr);
+    std::cout << "Repeat every how many weeks/months: ";
+    std::cin >> rule.interval;
+    std::cout << "Number of occurrences (0 for no limit): ";
+    std::cin >> rule.count;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "Last date (YYYY-MM-DD, empty for no limit): ";
+    std::getline(std::cin, untilStr);
+    std::cout << "Skipped dates (comma separated YYYY-MM-DD, empty for none): ";
+    std::getline(std::cin, exceptionsStr);
+    std::cout << "Is this event public? (yes/no): ";
+    bool isPublic = getYesNoInput();
+    std::cout << "Open to residents only? (yes/no): ";
+    bool openToResidents = getYesNoInput();
+    std::cout << "Open to non-residents? (yes/no): ";
+    bool openToNonResidents = getYesNoInput();
+
+    LayoutStyle layoutStyle = LayoutStyle::Meeting;
+    if (layoutStyleStr == "2") layoutStyle = LayoutStyle::Lecture;
+    else if (layoutStyleStr == "3") layoutStyle = LayoutStyle::Wedding;
+    else if (layoutStyleStr == "4") layoutStyle = LayoutStyle::Dance;
+
+    rule.frequency = (frequencyStr == "Monthly" || frequencyStr == "monthly") ? RecurrenceFrequency::Monthly : RecurrenceFrequency::Weekly;
+    rule.until = untilStr;
+    std::istringstream exceptionStream(exceptionsStr);
+    std::string date;
+    while (std::getline(exceptionStream, date, ',')) {
+        if (!date.empty()) rule.exceptions.insert(date);
+    }
+
+    if (recurringEvents.find(eventName) != recurringEvents.end() || schedule.findRecurringEvent(eventName)) {
+        std::cout << "Recurring event with this name already exists. Please choose a different name." << std::endl;
+        return;
+    }
+    if (users.find(organizerUsername) == users.end()) {
+        std::cout << "Organizer username not found." << std::endl;
+        return;
+    }
+    long long untilDay;
+    if (!rule.until.empty() && !parseDate(rule.until, untilDay)) {
+        std::cout << "Invalid last date." << std::endl;
+        return;
+    }
+
+    RecurringEvent* series = new RecurringEvent(eventName, users.at(organizerUsername), startTime, endTime, layoutStyle, isPublic,
+                                                maxGuests, ticketPrice, rule);
+    series->setOpenToResidents(openToResidents);
+    series->setOpenToNonResidents(openToNonResidents);
+
+    Event firstOccurrence(eventName, series->getOrganizer(), startTime, endTime, layoutStyle, isPublic, maxGuests, ticketPrice);
+    if (!series->isValid()) {
+        std::cout << "Invalid start/end time or interval." << std::endl;
+        delete series;
+        return;
+    }
+    if (!firstOccurrence.isWithinOperatingHours(startTime, endTime)) {
+        std::cout << "The event time is outside the facility's operating hours." << std::endl;
+        delete series;
+        return;
+    }
+    if (!schedule.checkRecurringAvailability(*series)) {
+        std::cout << "The facility is not available for every occurrence of this series." << std::endl;
+        delete series;
+        return;
+    }
+
+    recurringEvents[eventName] = series;
+    schedule.addRecurringEvent(series);
+    RecurringEvent::saveRecurringEvents("data/recurring.txt", schedule.getRecurringEvents());
+    std::cout << "Recurring event created successfully." << std::endl;
+}
+
+// Lists the occurrences of a recurring event within a date range
+void viewRecurringOccurrences(const Schedule& schedule) {
+    std::string seriesName, fromStr, toStr;
+    std::cout << "Enter the recurring event name: ";
+    std::cin >> seriesName;
+    std::cout << "From date (YYYY-MM-DD): ";
+    std::cin >> fromStr;
+    std::cout << "To date (YYYY-MM-DD): ";
+    std::cin >> toStr;
+
+    RecurringEvent* series = schedule.findRecurringEvent(seriesName);
+    long long fromDay, toDay;
+    if (!series) {
+        std::cout << "Recurring event not found." << std::endl;
+        return;
+    }
+    if (!parseDate(fromStr, fromDay) || !parseDate(toStr, toDay) || toDay < fromDay) {
+        std::cout << "Invalid date range." << std::endl;
+        return;
+    }
+
+    std::vector<long long> occurrences = series->occurrencesBetween(fromDay * kMinutesPerDay, (toDay + 1) * kMinutesPerDay);
+    std::cout << "Occurrences of " << seriesName << " (" << occurrences.size() << "):" << std::endl;
+    for (long long start : occurrences) {
+        std::cout << " - " << RecurringEvent::occurrenceName(seriesName, formatDate(dayOfMinute(start))) << ": "
+                  << formatTimestamp(start) << " to " << formatTimestamp(start + series->getDuration()) << std::endl;
+    }
+}
+
+// Imports events from a file in one batch and reports the rejected rows
+void handleEventImport(std::map<std::string, Event*>& events, const std::map<std::string, User*>& users, Schedule& schedule) {
+    std::string filename, reportFilename;
+    std::cout << "Enter the import file path: ";
+    std::getline(std::cin, filename);
+    std::cout << "Enter the reject report path (empty for " << filename << ".rejects.txt): ";
+    std::getline(std::cin, reportFilename);
+    if (reportFilename.empty()) {
+        reportFilename = filename + ".rejects.txt";
+    }
+
+    ImportResult result = EventImporter::importEvents(filename, reportFilename, events, users, schedule);
+    std::cout << "Imported " << result.accepted << " event(s), rejected " << result.rejected << "." << std::endl;
+    if (result.rejected > 0) {
+        std::cout << "Rejected rows were written to " << reportFilename << std::endl;
+    }
+}
+
+// Creates the accounts listed in a file in one batch and reports the rejected rows
+void handleUserProvisioning(std::map<std::string, User*>& users) {
+    std::string filename, reportFilename;
+    std::cout << "Enter the account list path: ";
+    std::getline(std::cin, filename);
+    std::cout << "Enter the reject report path (empty for " << filename << ".rejects.txt): ";
+    std::getline(std::cin, reportFilename);
+    if (reportFilename.empty()) {
+        reportFilename = filename + ".rejects.txt";
+    }
+
+    ProvisionResult result = UserProvisioner::provisionUsers(filename, reportFilename, users);
+    std::cout << "Provisioned " << result.accepted << " user(s), rejected " << result.rejected << "." << std::endl;
+    if (result.rejected > 0) {
+        std::cout << "Rejected rows were written to " << reportFilename << std::endl;
+    }
+}
+
+// Shows reports over the archived months
+void viewArchiveReports() {
+    std::cout << "1. Reservation history of a user" << std::endl;
+    std::cout << "2. Revenue by month" << std::endl;
+    std::cout << "Enter your choice: ";
+    int choice;
+    std::cin >> choice;
+    if (std::cin.fail()) {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cout << "Invalid choice." << std::endl;
+        return;
+    }
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    if (choice == 1) {
+        std::string username;
+        std::cout << "Enter the username: ";
+        std::getline(std::cin, username);
+        std::cout << "Archived reservations of " << username << ":" << std::endl;
+        if (Archive::printUserHistory(username, std::cout) == 0) {
+            std::cout << "No archived reservations found." << std::endl;
+        }
+    } else if (choice == 2) {
+        std::vector<MonthRevenue> months = Archive::revenueByMonth();
+        if (months.empty()) {
+            std::cout << "The archive is empty." << std::endl;
         }
+        for (const MonthRevenue& month : months) {
+            std::cout << month.month << ": " << month.reservations << " reservation(s), " << month.paidReservations
+                      << " paid, revenue $" << month.revenue << std::endl;
+        }
+    } else {
+        std::cout << "Invalid choice." << std::endl;
     }
+}
+
+// Prints the reservations matching a filter, at most limit of them (0 for all)
+bool printReservationQuery(const Schedule& schedule, const std::string& filter, size_t limit) {
+    std::vector<const ReservationSnapshot*> matches;
+    size_t total = 0;
+    std::string error;
+    SnapshotStore::ReadGuard snapshot = schedule.getSnapshots().read();
+    if (!queryReservations(*snapshot, filter, limit, matches, total, error)) {
+        std::cout << "Invalid filter: " << error << std::endl;
+        return false;
+    }
+    std::cout << total << " matching reservation(s)" << (matches.size() < total ? ", showing the first " + std::to_string(matches.size()) : "") << ":" << std::endl;
+    for (const ReservationSnapshot* reservation : matches) {
+        std::cout << " - " << formatQueryRow(*reservation) << std::endl;
+    }
+    return true;
+}
 
-    std::cout << "Reservation not found or you do not have permission to make a payment for this reservation." << std::endl;
+// Asks for a reservation filter and prints the matches
+void handleReservationQuery(const Schedule& schedule) {
+    std::string filter;
+    std::cout << "Filter terms field=value[,value] or field!=value, all of which must hold." << std::endl;
+    std::cout << "Fields: status (Pending, Confirmed, Canceled), payment (Unpaid, Paid)," << std::endl;
+    std::cout << "usertype (City, Organization, Resident, NonResident), date (YYYY-MM-DD, YYYY-MM-DD..YYYY-MM-DD, today, thisweek, nextweek)." << std::endl;
+    std::cout << "Enter the filter (empty for all): ";
+    std::getline(std::cin, filter);
+    printReservationQuery(schedule, filter, 50);
+}
+
+// Prints the utilization report and optionally writes it as CSV
+void viewUtilizationAnalytics(const Schedule& schedule) {
+    AnalyticsReport report = Analytics::refresh(*schedule.getSnapshots().read());
+    report.print(std::cout);
+    std::string filename;
+    std::cout << "Enter a CSV file path to export the report (empty to skip): ";
+    std::getline(std::cin, filename);
+    if (!filename.empty() && report.writeCsv(filename)) {
+        std::cout << "Report written to " << filename << std::endl;
+    }
+}
+
+// Books an event for a City user, displacing lower-priority events if needed
+void handlePriorityBooking(User* currentUser, FacilityManager& facilityManager, std::map<std::string, Event*>& events,
+                           std::map<int, Reservation*>& reservations) {
+    if (!currentUser || currentUser->getUserType() != UserType::City) {
+        std::cout << "Priority booking is available to City users only." << std::endl;
+        return;
+    }
+    PriorityRequest request;
+    std::string startTime, endTime, layoutStyleStr;
+    long long flexibleHours = 0;
+    request.organizer = currentUser;
+    std::cout << "Enter event name: ";
+    std::getline(std::cin, request.eventName);
+    std::cout << "Enter start time (YYYY-MM-DDTHH:MM): ";
+    std::getline(std::cin, startTime);
+    std::cout << "Enter end time (YYYY-MM-DDTHH:MM): ";
+    std::getline(std::cin, endTime);
+    std::cout << "Hours the event may move earlier or later (0 for exactly this time): ";
+    std::cin >> flexibleHours;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "Enter layout style (integer 1-4): ";
+    std::getline(std::cin, layoutStyleStr);
+    std::cout << "Enter max guests: ";
+    std::cin >> request.maxGuests;
+    std::cout << "Enter ticket price: ";
+    std::cin >> request.ticketPrice;
+    std::cout << "Is this event public? (yes/no): ";
+    request.isPublic = getYesNoInput();
+    std::cout << "Open to residents only? (yes/no): ";
+    request.openToResidents = getYesNoInput();
+    std::cout << "Open to non-residents? (yes/no): ";
+    request.openToNonResidents = getYesNoInput();
+
+    if (layoutStyleStr == "2") request.layoutStyle = LayoutStyle::Lecture;
+    else if (layoutStyleStr == "3") request.layoutStyle = LayoutStyle::Wedding;
+    else if (layoutStyleStr == "4") request.layoutStyle = LayoutStyle::Dance;
+
+    long long start, end;
+    if (!parseTimestamp(startTime, start) || !parseTimestamp(endTime, end) || end <= start || flexibleHours < 0) {
+        std::cout << "Invalid time format. Use YYYY-MM-DDTHH:MM." << std::endl;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return;
+    }
+    if (events.count(request.eventName)) {
+        std::cout << "Event with this name already exists. Please choose a different name." << std::endl;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return;
+    }
+    request.preferredStart = start;
+    request.duration = end - start;
+    request.windowStart = start - flexibleHours * 60;
+    request.windowEnd = end + flexibleHours * 60;
+
+    PreemptionPlan plan = PreemptionPlanner::plan(facilityManager.getSchedule(), request, currentMinutes());
+    plan.print(std::cout);
+    if (!plan.feasible) {
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return;
+    }
+    for (DisplacedEvent& displaced : plan.displaced) {
+        if (displaced.relocations.empty()) continue;
+        int choice = -1;
+        while (choice < 0 || choice > static_cast<int>(displaced.relocations.size())) {
+            std::cout << "Move " << displaced.event->getEventName() << " to option (1-" << displaced.relocations.size()
+                      << ", 0 to cancel the event): ";
+            if (!(std::cin >> choice)) return;
+        }
+        displaced.chosenRelocation = choice - 1;
+    }
+    std::cout << "Execute this plan? (yes/no): ";
+    bool confirmed = getYesNoInput();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    if (!confirmed) {
+        std::cout << "Priority booking abandoned." << std::endl;
+        return;
+    }
+    std::string message;
+    PreemptionPlanner::execute(plan, request, facilityManager, events, reservations, message);
+    std::cout << message << std::endl;
+}
+
+// Pays for the user's reservation of an event
+Reservation* payForEvent(User* currentUser, std::map<int, Reservation*>& reservations, FacilityManager& facilityManager,
+                         const std::string& eventName, std::string& message) {
+    if (!currentUser) {
+        message = "Please login first.";
+        return nullptr;
+    }
+    ReservationStore::pageInEvent(eventName, reservations);
+    Reservation* reservation = findUserReservation(currentUser, eventName);
+    if (reservation) {
+        reservation->makePayment(facilityManager, message);
+        Reservation::saveReservations("data/reservations.txt", reservations);
+        message += "\nPayment made successfully.";
+        return reservation;
+    }
+    message = "Reservation not found or you do not have permission to make a payment for this reservation.";
+    return nullptr;
+}
+
+// Opens the door check-in of an event for its organizer or a City user
+std::shared_ptr<CheckInSession> openCheckIn(User* currentUser, Schedule& schedule, std::map<int, Reservation*>& reservations,
+                                            const std::string& eventName, std::string& message) {
+    if (!currentUser) {
+        message = "Please login first.";
+        return nullptr;
+    }
+    const Event* event = schedule.findEvent(eventName);
+    if (!event) {
+        message = "Event not found.";
+        return nullptr;
+    }
+    if (currentUser->getUserType() != UserType::City && event->getOrganizer() != currentUser) {
+        message = "Only the organizer or City staff can check guests in.";
+        return nullptr;
+    }
+    // The hash covers every reservation of the event, including archived ones
+    if (ReservationStore::pageInEvent(eventName, reservations) > 0) {
+        schedule.publishSnapshot(reservations);
+    }
+    std::shared_ptr<CheckInSession> session = CheckIn::open(eventName, *schedule.getSnapshots().read());
+    if (!session) {
+        message = "Event not found.";
+    }
+    return session;
+}
+
+// Scans one reservation at the door, returning true if it was admitted
+bool scanAtDoor(CheckInSession& session, Schedule& schedule, std::map<int, Reservation*>& reservations, int reservationID, std::string& message) {
+    // A reservation missing from the snapshot may just have been evicted: page it back in rather than call it canceled
+    if (ReservationStore::pageInReservation(reservationID, reservations) > 0) {
+        schedule.publishSnapshot(reservations);
+    }
+    return session.scan(reservationID, currentMinutes(), *schedule.getSnapshots().read(), message) == CheckInResult::Admitted;
+}
+
+// Edits the logged-in user's information and re-renders the views showing their name
+void handleUserEdit(User* currentUser, std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations, Schedule& schedule) {
+    if (!currentUser) {
+        std::cout << "Please login first." << std::endl;
+        return;
+    }
+    currentUser->editUserInfo();
+    // The name appears as organizer, on reservations and on waitlists
+    for (const auto& pair : events) {
+        Event* event = pair.second;
+        const std::vector<User*>& waitlist = event->getWaitlist();
+        if (event->getOrganizer() == currentUser || std::find(waitlist.begin(), waitlist.end(), currentUser) != waitlist.end()) {
+            event->markChanged();
+        }
+    }
+    for (Reservation* reservation : currentUser->getUserReservations()) {
+        reservation->getEvent()->markChanged();
+        reservation->markChanged();
+    }
+    for (const auto& pair : schedule.getRecurringEvents()) {
+        if (pair.second->getOrganizer() == currentUser) pair.second->markChanged();
+    }
+    schedule.publishSnapshot(reservations);
+}
+
+// Scans reservations at the door of an event until the scanner is closed
+void handleCheckIn(User* currentUser, Schedule& schedule, std::map<int, Reservation*>& reservations) {
+    std::string eventName, message;
+    std::cout << "Enter the event name: ";
+    std::getline(std::cin, eventName);
+    std::shared_ptr<CheckInSession> session = openCheckIn(currentUser, schedule, reservations, eventName, message);
+    if (!session) {
+        std::cout << message << std::endl;
+        return;
+    }
+    std::cout << "Doors open for " << eventName << ": " << session->getReservationCount() << " reservation(s), headcount "
+              << session->getHeadcount() << " / " << session->getMaxGuests() << "." << std::endl;
+    int reservationID;
+    // One line per scan; the prompt flushes it, so no line needs its own flush
+    while (std::cout << "Scan reservation ID (0 to close the scanner): " && std::cin >> reservationID && reservationID != 0) {
+        scanAtDoor(*session, schedule, reservations, reservationID, message);
+        std::cout << message << '\n';
+    }
+    if (std::cin.fail()) {
+        std::cin.clear();
+    }
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "Scanner closed. Headcount " << session->getHeadcount() << " / " << session->getMaxGuests() << "." << std::endl;
+}
+
+// Starts a background snapshot of the data for a City user and shows the snapshot stats
+void handleSnapshot(User* currentUser, FacilityManager& facilityManager, const std::map<std::string, User*>& users,
+                    const std::map<std::string, Event*>& events, const std::map<int, Reservation*>& reservations) {
+    if (!currentUser || currentUser->getUserType() != UserType::City) {
+        std::cout << "Snapshots are available to City users only." << std::endl;
+        return;
+    }
+    std::string message;
+    DiskSnapshot::start(facilityManager, users, events, reservations, message);
+    std::cout << message << std::endl;
+    DiskSnapshot::printStats(std::cout);
+}
+
+// Reloads every data file after another process changed them, archiving the events that ended before archiveCutoff on the way
+void reloadData(FacilityManager& facilityManager, std::map<std::string, User*>& users, std::map<std::string, Event*>& events,
+                std::map<int, Reservation*>& reservations, std::map<std::string, RecurringEvent*>& recurringEvents, long long horizonStart,
+                size_t reservationCache, long long archiveCutoff) {
+    // Everything is reloaded, so reservations are freed wholesale instead of unlinked one by one
+    for (const auto& pair : users) {
+        pair.second->clearReservations();
+    }
+    reservations.clear();
+    Reservation::destroyAll();
+    ReservationStore::close();
+    facilityManager.clearEvents();
+    for (const auto& pair : events) {
+        delete pair.second;
+    }
+    for (const auto& pair : recurringEvents) {
+        delete pair.second;
+    }
+
+    // Users are only ever added, so logged-in sessions keep pointing at live objects; known users take over the saved password
+    for (const auto& pair : User::loadUsers("data/users.txt")) {
+        auto known = users.emplace(pair.first, pair.second);
+        if (!known.second) {
+            known.first->second->setPassword(pair.second->getPassword());
+            delete pair.second;
+        }
+    }
+    events = Event::loadEvents("data/events.txt", users);
+    if (archiveCutoff >= 0) {
+        ArchiveResult archived = Archive::archiveBefore(archiveCutoff, events);
+        std::cout << "Archived " << archived.events << " event(s) and " << archived.reservations << " reservation(s) into "
+                  << archived.segments << " segment(s)." << std::endl;
+    }
+    recurringEvents = RecurringEvent::loadRecurringEvents("data/recurring.txt", users);
+    for (const auto& pair : events) {
+        facilityManager.addEvent(pair.second);
+    }
+    for (const auto& pair : recurringEvents) {
+        facilityManager.getSchedule().addRecurringEvent(pair.second);
+    }
+    reservations = ReservationStore::open("data/reservations.txt", users, events, horizonStart, reservationCache);
+    ReservationStore::reserveIDs(Archive::maxReservationID());
+    HoldExpiry::rebuild(reservations, currentMinutes());
+    // Open doors, rendered views and analytics describe the old objects
+    CheckIn::closeAll();
+    RenderCache::reset();
+    Analytics::reset();
+    facilityManager.getSchedule().publishSnapshot(reservations);
 }
@@ -0,0 +1,237 @@
+#include "HoldExpiry.hpp"
+#include "Event.hpp"
+#include "User.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+static const int kHoldExpiryMetric = Metrics::registerMetric("hold_expiry");
+static const char* kHoldLogFilename = "data/holds.log";
+
+// Starts the wheel at a minute, dropping all timers
+void TimingWheel::reset(long long now) {
+    for (auto& level : slots) {
+        for (auto& slot : level) slot.clear();
+    }
+    overflow.clear();
+    pending.clear();
+    current = now;
+    count = 0;
+}
+
+// Places a timer in the slot matching its deadline
+void TimingWheel::place(const Timer& timer) {
+    if (timer.deadline <= current) {
+        pending.push_back(timer);
+        return;
+    }
+    for (int level = 0; level < kLevels; ++level) {
+        int shift = kSlotBits * (level + 1);
+        // The lowest level whose current window (64 slots) contains the deadline
+        if ((timer.deadline >> shift) == (current >> shift)) {
+            slots[level][(timer.deadline >> (kSlotBits * level)) & (kSlots - 1)].push_back(timer);
+            return;
+        }
+    }
+    overflow.push_back(timer);
+}
+
+// Schedules a timer
+void TimingWheel::schedule(long long deadline, ReservationHandle handle) {
+    place(Timer{deadline, handle});
+    ++count;
+}
+
+// Moves the wheel to now and appends the timers that came due
+void TimingWheel::advance(long long now, std::vector<Timer>& due) {
+    due.insert(due.end(), pending.begin(), pending.end());
+    count -= pending.size();
+    pending.clear();
+    if (count == 0) {
+        current = std::max(current, now);
+        return;
+    }
+    while (current < now) {
+        ++current;
+        // Count the levels whose cursor wrapped, then refill them from the top down
+        int wrapped = 0;
+        while (wrapped + 1 < kLevels && (current & ((1LL << (kSlotBits * (wrapped + 1))) - 1)) == 0) ++wrapped;
+        if (wrapped == kLevels - 1 && (current & ((1LL << (kSlotBits * kLevels)) - 1)) == 0) {
+            std::vector<Timer> waiting;
+            waiting.swap(overflow);
+            for (const Timer& timer : waiting) place(timer);
+        }
+        for (int level = wrapped; level >= 1; --level) {
+            std::vector<Timer> moving;
+            moving.swap(slots[level][(current >> (kSlotBits * level)) & (kSlots - 1)]);
+            for (const Timer& timer : moving) place(timer);
+        }
+        std::vector<Timer>& slot = slots[0][current & (kSlots - 1)];
+        due.insert(due.end(), slot.begin(), slot.end());
+        count -= slot.size();
+        slot.clear();
+        // Anything the refill found already due
+        due.insert(due.end(), pending.begin(), pending.end());
+        count -= pending.size();
+        pending.clear();
+        if (count == 0) {
+            current = now;
+        }
+    }
+}
+
+// Time-to-live policy and the wheel
+namespace {
+struct HoldState {
+    bool loaded = false;
+    long long defaultTTL = 0;
+    std::map<UserType, long long> userTypeTTL;
+    std::map<std::string, long long> eventTTL;
+    TimingWheel wheel;
+};
+HoldState state;
+}
+
+// Loads the time-to-live policy
+void HoldExpiry::loadPolicy(const std::string& filename) {
+    state = HoldState();
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return;
+    }
+    std::string line;
+    while (getline(file, line)) {
+        std::istringstream iss(line);
+        std::string kind, name;
+        long long minutes;
+        if (!(iss >> kind) || kind[0] == '#') continue;
+        if (kind == "default" && iss >> minutes) {
+            state.defaultTTL = minutes;
+        } else if (kind == "usertype" && iss >> name >> minutes) {
+            if (name == "City") state.userTypeTTL[UserType::City] = minutes;
+            else if (name == "Organization") state.userTypeTTL[UserType::Organization] = minutes;
+            else if (name == "Resident") state.userTypeTTL[UserType::Resident] = minutes;
+            else if (name == "NonResident") state.userTypeTTL[UserType::NonResident] = minutes;
+            else std::cerr << "Error: Unknown user type " << name << " in " << filename << std::endl;
+        } else if (kind == "event" && iss >> name >> minutes) {
+            state.eventTTL[name] = minutes;
+        } else {
+            std::cerr << "Error: Invalid line in " << filename << ": " << line << std::endl;
+        }
+    }
+    state.loaded = true;
+}
+
+// Returns the time-to-live of a reservation's hold
+long long HoldExpiry::ttlFor(const Reservation* reservation) {
+    auto event = state.eventTTL.find(reservation->getEvent()->getEventName());
+    if (event != state.eventTTL.end()) return event->second;
+    auto userType = state.userTypeTTL.find(reservation->getUser()->getUserType());
+    if (userType != state.userTypeTTL.end()) return userType->second;
+    return state.defaultTTL;
+}
+
+// Returns the minute a reservation's hold expires, or -1 if it never does
+static long long deadlineOf(const Reservation* reservation) {
+    if (reservation->getReservationStatus() != ReservationStatus::Pending || reservation->getPaymentStatus() != PaymentStatus::Unpaid) {
+        return -1;
+    }
+    long long ttl = HoldExpiry::ttlFor(reservation);
+    long long eventStart;
+    if (ttl <= 0 || !parseTimestamp(reservation->getEvent()->getStartTime(), eventStart)) return -1;
+    long long deadline = reservation->getCreatedMinute() + ttl;
+    // Holds only expire before their event starts
+    return deadline < eventStart ? deadline : -1;
+}
+
+// Checks if a reservation's user is waiting for a ticket to the event instead of holding one
+static bool isWaitlisted(const Reservation* reservation) {
+    const std::vector<User*>& waitlist = reservation->getEvent()->getWaitlist();
+    return std::find(waitlist.begin(), waitlist.end(), reservation->getUser()) != waitlist.end();
+}
+
+// Rebuilds the wheel from the creation times of the resident reservations
+void HoldExpiry::rebuild(const std::map<int, Reservation*>& reservations, long long now) {
+    state.wheel.reset(now);
+    if (!state.loaded) return;
+    for (const auto& pair : reservations) {
+        track(pair.second);
+    }
+}
+
+// Schedules the expiry of a new reservation; a waitlisted one holds no ticket and is tracked once promoted
+void HoldExpiry::track(const Reservation* reservation) {
+    if (isWaitlisted(reservation)) return;
+    long long deadline = deadlineOf(reservation);
+    if (deadline >= 0) {
+        state.wheel.schedule(deadline, reservation->getHandle());
+    }
+}
+
+// Expires the holds due by now
+size_t HoldExpiry::advance(long long now, std::map<int, Reservation*>& reservations, std::map<std::string, Event*>& events,
+                           std::string& message) {
+    message.clear();
+    if (state.wheel.size() == 0) return 0;
+    ScopedTimer timer(kHoldExpiryMetric);
+    std::vector<TimingWheel::Timer> due;
+    state.wheel.advance(now, due);
+    std::ofstream log;
+    std::string ticketMessage;  // The expiry line below already says what happened to the tickets
+    size_t expired = 0;
+    for (const TimingWheel::Timer& timer : due) {
+        // Paid, canceled or destroyed since it was scheduled: nothing to do
+        Reservation* reservation = Reservation::resolve(timer.handle);
+        if (!reservation || deadlineOf(reservation) != timer.deadline) continue;
+        Event* event = reservation->getEvent();
+        if (!log.is_open()) {
+            log.open(kHoldLogFilename, std::ios::app);
+            if (!log.is_open()) std::cerr << "Error: Unable to open file " << kHoldLogFilename << std::endl;
+        }
+        log << formatTimestamp(now) << " expired " << reservation->getReservationID() << " " << reservation->getUser()->getUsername() << " "
+            << event->getEventName() << " created " << formatTimestamp(reservation->getCreatedMinute());
+        if (isWaitlisted(reservation)) {
+            // Never got a ticket, so there is none to give back or pass on
+            reservation->expireHold();
+            event->removeFromWaitlist(reservation->getUser());
+            ++expired;
+            log << " waitlisted" << std::endl;
+            message += (message.empty() ? "Hold " : "\nHold ") + std::to_string(reservation->getReservationID()) + " on the waitlist of " +
+                       event->getEventName() + " expired unpaid.";
+            continue;
+        }
+        int tickets = reservation->getGroupSize();
+        std::string seats = reservation->getSeatLabels();
+        reservation->expireHold();
+        event->cancelTicket(reservation->getUser(), tickets, ticketMessage);
+        // The freed capacity goes down the waitlist; each promoted hold only starts counting once it holds tickets
+        std::string promotedNames;
+        for (Reservation* waiting : event->promoteFromWaitlist()) {
+            if (deadlineOf(waiting) >= 0) {
+                waiting->restartHold(now);
+                track(waiting);
+            }
+            promotedNames += (promotedNames.empty() ? "" : ",") + waiting->getUser()->getUsername();
+        }
+        ++expired;
+
+        if (!seats.empty()) log << " seats " << seats;
+        if (!promotedNames.empty()) log << " promoted " << promotedNames;
+        log << std::endl;
+        message += (message.empty() ? "Hold " : "\nHold ") + std::to_string(reservation->getReservationID()) + " on " + event->getEventName() +
+                   " expired unpaid" + (promotedNames.empty() ? std::string() : "; promoted from the waitlist: " + promotedNames) + ".";
+    }
+    if (expired > 0) {
+        Reservation::saveReservations("data/reservations.txt", reservations);
+        Event::saveEvents("data/events.txt", events);
+    }
+    return expired;
+}
+
+// Returns the number of holds scheduled
+size_t HoldExpiry::scheduledCount() {
+    return state.wheel.size();
+}
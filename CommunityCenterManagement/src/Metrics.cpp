@@ -0,0 +1,344 @@
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+namespace {
+
+// Counters owned by a single thread; other threads only read them
+struct ThreadSlot {
+    std::atomic<std::uint64_t> count[Metrics::kMaxMetrics];
+    std::atomic<std::uint64_t> totalNanoseconds[Metrics::kMaxMetrics];
+    std::atomic<std::uint64_t> maxNanoseconds[Metrics::kMaxMetrics];
+    std::atomic<std::uint64_t> buckets[Metrics::kMaxMetrics][Metrics::kBuckets];
+
+    ThreadSlot() {
+        reset();
+    }
+
+    // Zeroes every counter
+    void reset() {
+        for (int i = 0; i < Metrics::kMaxMetrics; ++i) {
+            count[i].store(0, std::memory_order_relaxed);
+            totalNanoseconds[i].store(0, std::memory_order_relaxed);
+            maxNanoseconds[i].store(0, std::memory_order_relaxed);
+            for (int b = 0; b < Metrics::kBuckets; ++b) {
+                buckets[i][b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Totals of one metric summed over all thread slots
+struct MetricTotals {
+    std::uint64_t count = 0;
+    std::uint64_t totalNanoseconds = 0;
+    std::uint64_t maxNanoseconds = 0;
+    std::uint64_t buckets[Metrics::kBuckets] = {};
+};
+
+// Global registry of metric names and thread slots
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<ThreadSlot>> slots;
+    // Slots of exited threads, zeroed and waiting for the next new thread
+    std::vector<std::unique_ptr<ThreadSlot>> freeSlots;
+    // Counts merged from the slots of exited threads
+    ThreadSlot retired;
+    std::atomic<bool> enabled{true};
+
+    // Periodic dump state
+    std::thread dumpThread;
+    std::mutex dumpMutex;
+    std::condition_variable dumpCondition;
+    bool dumpStopRequested = false;
+    std::string dumpFilename;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// The calling thread's slot; a plain pointer, so it stays readable while the thread shuts down
+thread_local ThreadSlot* currentSlot = nullptr;
+
+// Adds the counts of one slot into another
+void mergeSlot(ThreadSlot& into, const ThreadSlot& from) {
+    for (int i = 0; i < Metrics::kMaxMetrics; ++i) {
+        into.count[i].fetch_add(from.count[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        into.totalNanoseconds[i].fetch_add(from.totalNanoseconds[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        std::uint64_t fromMax = from.maxNanoseconds[i].load(std::memory_order_relaxed);
+        if (fromMax > into.maxNanoseconds[i].load(std::memory_order_relaxed)) {
+            into.maxNanoseconds[i].store(fromMax, std::memory_order_relaxed);
+        }
+        for (int b = 0; b < Metrics::kBuckets; ++b) {
+            into.buckets[i][b].fetch_add(from.buckets[i][b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+}
+
+// Releases the calling thread's slot when the thread exits
+struct SlotReleaser {
+    ~SlotReleaser() {
+        if (!currentSlot) return;
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        mergeSlot(reg.retired, *currentSlot);
+        for (auto it = reg.slots.begin(); it != reg.slots.end(); ++it) {
+            if (it->get() == currentSlot) {
+                // The next new thread takes the zeroed slot instead of allocating one
+                (*it)->reset();
+                reg.freeSlots.push_back(std::move(*it));
+                reg.slots.erase(it);
+                break;
+            }
+        }
+        currentSlot = nullptr;
+    }
+};
+
+// Returns the calling thread's slot, taking a free one or creating it on first use
+ThreadSlot& threadSlot() {
+    if (!currentSlot) {
+        thread_local SlotReleaser releaser;
+        (void)releaser;
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (!reg.freeSlots.empty()) {
+            reg.slots.push_back(std::move(reg.freeSlots.back()));
+            reg.freeSlots.pop_back();
+        } else {
+            reg.slots.emplace_back(new ThreadSlot());
+        }
+        currentSlot = reg.slots.back().get();
+    }
+    return *currentSlot;
+}
+
+// Maps a latency to its histogram bucket (bucket b holds samples <= 2^b microseconds)
+int bucketFor(std::uint64_t nanoseconds) {
+    std::uint64_t micros = (nanoseconds + 999) / 1000;
+    int bucket = 0;
+    while (bucket < Metrics::kBuckets - 1 && micros > (1ULL << bucket)) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+// Sums the thread slots of every registered metric
+std::vector<MetricTotals> collect(std::vector<std::string>& names) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    names = reg.names;
+    std::vector<MetricTotals> totals(names.size());
+    std::vector<const ThreadSlot*> sources = {&reg.retired};
+    for (const auto& slot : reg.slots) {
+        sources.push_back(slot.get());
+    }
+    for (const ThreadSlot* slot : sources) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            MetricTotals& t = totals[i];
+            t.count += slot->count[i].load(std::memory_order_relaxed);
+            t.totalNanoseconds += slot->totalNanoseconds[i].load(std::memory_order_relaxed);
+            std::uint64_t slotMax = slot->maxNanoseconds[i].load(std::memory_order_relaxed);
+            if (slotMax > t.maxNanoseconds) t.maxNanoseconds = slotMax;
+            for (int b = 0; b < Metrics::kBuckets; ++b) {
+                t.buckets[b] += slot->buckets[i][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return totals;
+}
+
+// Estimates a percentile (0-100) in microseconds from the histogram
+double percentileMicros(const MetricTotals& t, double percentile) {
+    if (t.count == 0) return 0.0;
+    std::uint64_t target = static_cast<std::uint64_t>(t.count * percentile / 100.0 + 0.5);
+    if (target == 0) target = 1;
+    std::uint64_t seen = 0;
+    for (int b = 0; b < Metrics::kBuckets; ++b) {
+        seen += t.buckets[b];
+        if (seen >= target) {
+            return static_cast<double>(1ULL << b);
+        }
+    }
+    return t.maxNanoseconds / 1000.0;
+}
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+// Registers a named metric and returns its ID
+int Metrics::registerMetric(const std::string& name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t i = 0; i < reg.names.size(); ++i) {
+        if (reg.names[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    if (reg.names.size() >= static_cast<size_t>(kMaxMetrics)) {
+        std::cerr << "Error: Too many metrics registered, ignoring " << name << std::endl;
+        return -1;
+    }
+    reg.names.push_back(name);
+    return static_cast<int>(reg.names.size() - 1);
+}
+
+// Records one sample of the given metric on the calling thread
+void Metrics::record(int metricID, std::uint64_t nanoseconds) {
+    if (metricID < 0 || metricID >= kMaxMetrics) return;
+    ThreadSlot& slot = threadSlot();
+    // Only the owning thread writes to its slot, so load + store is enough
+    slot.count[metricID].store(slot.count[metricID].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot.totalNanoseconds[metricID].store(slot.totalNanoseconds[metricID].load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > slot.maxNanoseconds[metricID].load(std::memory_order_relaxed)) {
+        slot.maxNanoseconds[metricID].store(nanoseconds, std::memory_order_relaxed);
+    }
+    std::atomic<std::uint64_t>& bucket = slot.buckets[metricID][bucketFor(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Checks if metric collection is enabled
+bool Metrics::isEnabled() {
+    return registry().enabled.load(std::memory_order_relaxed);
+}
+
+// Enables or disables metric collection
+void Metrics::setEnabled(bool enabled) {
+    registry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+// Prints a human readable summary of all metrics
+void Metrics::printSummary(std::ostream& out) {
+    std::vector<std::string> names;
+    std::vector<MetricTotals> totals = collect(names);
+    if (!isEnabled()) {
+        out << "Metrics collection is disabled." << std::endl;
+    }
+    out << std::left << std::setw(28) << "Operation" << std::right << std::setw(10) << "Count" << std::setw(12) << "Avg(us)"
+        << std::setw(12) << "p50(us)" << std::setw(12) << "p99(us)" << std::setw(12) << "Max(us)" << std::endl;
+    for (size_t i = 0; i < names.size(); ++i) {
+        const MetricTotals& t = totals[i];
+        if (t.count == 0) continue;
+        out << std::left << std::setw(28) << names[i] << std::right << std::setw(10) << t.count << std::fixed << std::setprecision(1)
+            << std::setw(12) << (t.totalNanoseconds / 1000.0 / t.count) << std::setw(12) << percentileMicros(t, 50)
+            << std::setw(12) << percentileMicros(t, 99) << std::setw(12) << (t.maxNanoseconds / 1000.0) << std::endl;
+        out.unsetf(std::ios::fixed);
+    }
+}
+
+// Writes all metrics in Prometheus text exposition format
+void Metrics::writePrometheus(std::ostream& out) {
+    std::vector<std::string> names;
+    std::vector<MetricTotals> totals = collect(names);
+    out << "# HELP ccm_operation_seconds Latency of community center operations.\n";
+    out << "# TYPE ccm_operation_seconds histogram\n";
+    for (size_t i = 0; i < names.size(); ++i) {
+        const MetricTotals& t = totals[i];
+        std::uint64_t cumulative = 0;
+        for (int b = 0; b < kBuckets - 1; ++b) {
+            cumulative += t.buckets[b];
+            out << "ccm_operation_seconds_bucket{op=\"" << names[i] << "\",le=\"" << ((1ULL << b) / 1e6) << "\"} " << cumulative << "\n";
+        }
+        out << "ccm_operation_seconds_bucket{op=\"" << names[i] << "\",le=\"+Inf\"} " << t.count << "\n";
+        out << "ccm_operation_seconds_sum{op=\"" << names[i] << "\"} " << (t.totalNanoseconds / 1e9) << "\n";
+        out << "ccm_operation_seconds_count{op=\"" << names[i] << "\"} " << t.count << "\n";
+    }
+}
+
+// Writes all metrics as a JSON document
+void Metrics::writeJson(std::ostream& out) {
+    std::vector<std::string> names;
+    std::vector<MetricTotals> totals = collect(names);
+    out << "{\"enabled\":" << (isEnabled() ? "true" : "false") << ",\"operations\":[";
+    for (size_t i = 0; i < names.size(); ++i) {
+        const MetricTotals& t = totals[i];
+        out << (i ? "," : "") << "{\"name\":\"" << names[i] << "\",\"count\":" << t.count
+            << ",\"total_ns\":" << t.totalNanoseconds << ",\"max_ns\":" << t.maxNanoseconds
+            << ",\"p50_us\":" << percentileMicros(t, 50) << ",\"p99_us\":" << percentileMicros(t, 99) << ",\"buckets_us\":{";
+        for (int b = 0; b < kBuckets; ++b) {
+            out << (b ? "," : "") << "\"" << (b == kBuckets - 1 ? std::string("inf") : std::to_string(1ULL << b)) << "\":" << t.buckets[b];
+        }
+        out << "}}";
+    }
+    out << "]}\n";
+}
+
+// Dumps all metrics to a file
+bool Metrics::dumpToFile(const std::string& filename) {
+    // Write to a temporary file and rename so readers never see a partial dump
+    std::string tempFilename = filename + ".tmp";
+    std::ofstream file(tempFilename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << tempFilename << std::endl;
+        return false;
+    }
+    if (endsWith(filename, ".json")) {
+        writeJson(file);
+    } else {
+        writePrometheus(file);
+    }
+    file.close();
+    return std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+}
+
+// Starts a background thread dumping metrics to a file periodically
+void Metrics::startPeriodicDump(const std::string& filename, int intervalSeconds) {
+    Registry& reg = registry();
+    stopPeriodicDump();
+    if (intervalSeconds < 1) intervalSeconds = 1;
+    {
+        std::lock_guard<std::mutex> lock(reg.dumpMutex);
+        reg.dumpStopRequested = false;
+        reg.dumpFilename = filename;
+    }
+    reg.dumpThread = std::thread([&reg, filename, intervalSeconds]() {
+        std::unique_lock<std::mutex> lock(reg.dumpMutex);
+        while (!reg.dumpCondition.wait_for(lock, std::chrono::seconds(intervalSeconds), [&reg]() { return reg.dumpStopRequested; })) {
+            lock.unlock();
+            dumpToFile(filename);
+            lock.lock();
+        }
+    });
+}
+
+// Stops the background dump thread and writes a final dump
+void Metrics::stopPeriodicDump() {
+    Registry& reg = registry();
+    if (!reg.dumpThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(reg.dumpMutex);
+        reg.dumpStopRequested = true;
+    }
+    reg.dumpCondition.notify_all();
+    reg.dumpThread.join();
+    dumpToFile(reg.dumpFilename);
+}
+
+// Starts timing if metrics are enabled
+ScopedTimer::ScopedTimer(int metricID) : metricID(metricID), active(Metrics::isEnabled()) {
+    if (active) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+// Records the elapsed time of the scope
+ScopedTimer::~ScopedTimer() {
+    if (active) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        Metrics::record(metricID, static_cast<std::uint64_t>(elapsed.count()));
+    }
+}
@@ -0,0 +1,381 @@
+#include "Preemption.hpp"
+#include "ReservationStore.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <climits>
+
+static const int kPlanMetric = Metrics::registerMetric("preemption_plan");
+static const int kExecuteMetric = Metrics::registerMetric("preemption_execute");
+
+static const long long kOpeningMinute = 8 * 60;   // Placements and relocation slots lie between 08:00
+static const long long kClosingMinute = 23 * 60;  // and 23:00 of one day
+static const long long kSlotGranularity = 15;     // "Now" is rounded up to a quarter hour
+
+// Something occupying the facility around a request
+struct Occupant {
+    long long start;
+    long long end;
+    Event* event;   // nullptr for recurring occurrences
+    double cost;
+    bool blocking;  // Cannot be displaced
+};
+
+// Calls visit for every dated event overlapping [start, end)
+template <typename Visitor>
+static void forEachEventBetween(const Schedule& schedule, long long start, long long end, Visitor visit) {
+    const auto& calendar = schedule.getCalendar();
+    for (auto bucket = calendar.lower_bound(dayOfMinute(start - schedule.getLongestEvent()));
+         bucket != calendar.end() && bucket->first * kMinutesPerDay < end; ++bucket) {
+        for (const Schedule::CalendarEntry& entry : bucket->second) {
+            if (entry.start >= end) break;
+            if (entry.end > start) visit(entry);
+        }
+    }
+}
+
+// Calls visit(start, end) for every recurring occurrence overlapping [start, end)
+template <typename Visitor>
+static void forEachOccurrenceBetween(const Schedule& schedule, long long start, long long end, Visitor visit) {
+    for (const auto& pair : schedule.getRecurringEvents()) {
+        for (long long occurrence : pair.second->occurrencesBetween(start, end)) {
+            visit(occurrence, occurrence + pair.second->getDuration());
+        }
+    }
+}
+
+// Counts the reservations of an event that are not canceled and the refunds owed for them
+static void measureEvent(const Event* event, size_t& reservations, double& refundTotal) {
+    reservations = 0;
+    refundTotal = 0.0;
+    for (const Reservation* reservation : event->getReservations()) {
+        if (reservation->getReservationStatus() == ReservationStatus::Canceled) continue;
+        ++reservations;
+        if (reservation->getPaymentStatus() == PaymentStatus::Paid) {
+            refundTotal += reservation->getTotalCost();
+        }
+    }
+}
+
+// Prefix sums over occupants sorted by one of their times
+struct OccupantPrefix {
+    std::vector<long long> times;
+    std::vector<double> cost;
+    std::vector<size_t> count;
+    std::vector<size_t> blocking;
+
+    // Builds the sums from (time, occupant) pairs sorted by time
+    void build(const std::vector<std::pair<long long, const Occupant*>>& sorted) {
+        times.clear();
+        cost.assign(1, 0.0);
+        count.assign(1, 0);
+        blocking.assign(1, 0);
+        for (const auto& pair : sorted) {
+            times.push_back(pair.first);
+            cost.push_back(cost.back() + (pair.second->blocking ? 0.0 : pair.second->cost));
+            count.push_back(count.back() + (pair.second->blocking ? 0 : 1));
+            blocking.push_back(blocking.back() + (pair.second->blocking ? 1 : 0));
+        }
+    }
+};
+
+// Checks if [start, end) lies within the opening hours of one day
+static bool withinOpeningHours(long long start, long long end) {
+    long long dayStart = dayOfMinute(start) * kMinutesPerDay;
+    return start >= dayStart + kOpeningMinute && end <= dayStart + kClosingMinute;
+}
+
+// Returns the priority of a user type
+int PreemptionPlanner::priorityOf(UserType userType) {
+    switch (userType) {
+        case UserType::City:
+            return 3;
+        case UserType::Organization:
+            return 2;
+        case UserType::Resident:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Offers relocation slots to the displaced events of a plan
+static void offerRelocations(const Schedule& schedule, PreemptionPlan& plan, long long now) {
+    if (plan.displaced.empty()) return;
+    std::set<const Event*> moving;
+    long long rangeStart = now, rangeEnd = now;
+    for (const DisplacedEvent& displaced : plan.displaced) {
+        moving.insert(displaced.event);
+        rangeStart = std::min(rangeStart, displaced.start);
+        rangeEnd = std::max(rangeEnd, std::max(now, displaced.start) + (PreemptionPlanner::kRelocationDays + 1) * kMinutesPerDay);
+    }
+
+    // Everything that stays put, plus the new booking; offered slots are added as they are made
+    std::vector<std::pair<long long, long long>> busy;
+    forEachEventBetween(schedule, rangeStart, rangeEnd, [&](const Schedule::CalendarEntry& entry) {
+        if (!moving.count(entry.event)) busy.emplace_back(entry.start, entry.end);
+    });
+    forEachOccurrenceBetween(schedule, rangeStart, rangeEnd, [&](long long start, long long end) { busy.emplace_back(start, end); });
+    busy.emplace_back(plan.start, plan.end);
+    std::sort(busy.begin(), busy.end());
+    long long longestBusy = 0;
+    for (const auto& interval : busy) longestBusy = std::max(longestBusy, interval.second - interval.first);
+
+    for (DisplacedEvent& displaced : plan.displaced) {
+        long long length = displaced.end - displaced.start;
+        long long from = std::max(now, displaced.start);
+        for (long long day = dayOfMinute(from); day <= dayOfMinute(from) + PreemptionPlanner::kRelocationDays &&
+                                                static_cast<int>(displaced.relocations.size()) < PreemptionPlanner::kRelocationOptions; ++day) {
+            long long open = std::max(day * kMinutesPerDay + kOpeningMinute, from);
+            long long close = day * kMinutesPerDay + kClosingMinute;
+            long long cursor = open;
+            long long slot = -1;
+            auto interval = std::lower_bound(busy.begin(), busy.end(), std::make_pair(open - longestBusy, LLONG_MIN));
+            for (; interval != busy.end() && interval->first < close; ++interval) {
+                if (interval->second <= cursor) continue;
+                if (interval->first - cursor >= length) break;
+                cursor = std::max(cursor, interval->second);
+            }
+            if (std::min(close, interval != busy.end() ? interval->first : close) - cursor >= length) {
+                slot = cursor;
+            }
+            // One offer per day keeps the options spread out
+            if (slot >= 0) {
+                displaced.relocations.push_back(slot);
+                auto position = std::upper_bound(busy.begin(), busy.end(), std::make_pair(slot, slot + length));
+                busy.insert(position, std::make_pair(slot, slot + length));
+                longestBusy = std::max(longestBusy, length);
+            }
+        }
+        displaced.chosenRelocation = displaced.relocations.empty() ? -1 : 0;
+    }
+}
+
+// Finds the cheapest placement of a request
+PreemptionPlan PreemptionPlanner::plan(const Schedule& schedule, const PriorityRequest& request, long long now) {
+    ScopedTimer timer(kPlanMetric);
+    auto startTime = std::chrono::steady_clock::now();
+    PreemptionPlan plan;
+    long long duration = request.duration;
+    if (!request.organizer || duration <= 0 || request.windowEnd - request.windowStart < duration) {
+        plan.reason = "The requested window cannot hold the event.";
+        return plan;
+    }
+    if (!request.organizer->checkWeeklyLimit(static_cast<int>(duration / 60))) {
+        plan.reason = "This reservation exceeds the weekly limit for the organizer.";
+        return plan;
+    }
+    int priority = priorityOf(request.organizer->getUserType());
+
+    // Everything in the window, costed once
+    std::vector<Occupant> occupants;
+    forEachEventBetween(schedule, request.windowStart, request.windowEnd, [&](const Schedule::CalendarEntry& entry) {
+        size_t reservations;
+        double refundTotal;
+        measureEvent(entry.event, reservations, refundTotal);
+        bool blocking = priorityOf(entry.event->getOrganizer()->getUserType()) >= priority || entry.start < now;
+        occupants.push_back(Occupant{entry.start, entry.end, entry.event, reservations * kReservationWeight + refundTotal, blocking});
+    });
+    forEachOccurrenceBetween(schedule, request.windowStart, request.windowEnd, [&](long long start, long long end) {
+        occupants.push_back(Occupant{start, end, nullptr, 0.0, true});
+    });
+
+    std::vector<std::pair<long long, const Occupant*>> byStart, byEnd;
+    for (const Occupant& occupant : occupants) {
+        byStart.emplace_back(occupant.start, &occupant);
+        byEnd.emplace_back(occupant.end, &occupant);
+    }
+    std::sort(byStart.begin(), byStart.end());
+    std::sort(byEnd.begin(), byEnd.end());
+    OccupantPrefix starts, ends;
+    starts.build(byStart);
+    ends.build(byEnd);
+
+    // A placement [s, s + duration) overlaps the occupants starting before s + duration minus those ending by s
+    std::vector<long long> candidates = {request.preferredStart, request.windowStart,
+                                         (now + kSlotGranularity - 1) / kSlotGranularity * kSlotGranularity};
+    for (const Occupant& occupant : occupants) {
+        candidates.push_back(occupant.end);
+        candidates.push_back(occupant.start - duration);
+    }
+    for (long long day = dayOfMinute(request.windowStart); day <= dayOfMinute(request.windowEnd); ++day) {
+        candidates.push_back(day * kMinutesPerDay + kOpeningMinute);
+    }
+
+    bool found = false;
+    double bestCost = 0.0;
+    size_t bestCount = 0;
+    long long bestStart = 0;
+    for (long long start : candidates) {
+        if (start < request.windowStart || start + duration > request.windowEnd || start < now ||
+            !withinOpeningHours(start, start + duration)) {
+            continue;
+        }
+        ++plan.candidatesChecked;
+        size_t startsBefore = std::lower_bound(starts.times.begin(), starts.times.end(), start + duration) - starts.times.begin();
+        size_t endsBy = std::upper_bound(ends.times.begin(), ends.times.end(), start) - ends.times.begin();
+        if (starts.blocking[startsBefore] - ends.blocking[endsBy] > 0) continue;
+        double cost = starts.cost[startsBefore] - ends.cost[endsBy];
+        size_t count = starts.count[startsBefore] - ends.count[endsBy];
+        // Cheapest first, then fewest events displaced, then closest to the preferred time
+        bool better = !found || cost < bestCost - 1e-9 ||
+                      (cost <= bestCost + 1e-9 && (count < bestCount || (count == bestCount &&
+                       (std::llabs(start - request.preferredStart) < std::llabs(bestStart - request.preferredStart) ||
+                        (std::llabs(start - request.preferredStart) == std::llabs(bestStart - request.preferredStart) && start < bestStart)))));
+        if (better) {
+            found = true;
+            bestCost = cost;
+            bestCount = count;
+            bestStart = start;
+        }
+    }
+    if (!found) {
+        plan.reason = "Every placement in the window overlaps an event of equal or higher priority, an event under way or a recurring event.";
+        return plan;
+    }
+
+    plan.feasible = true;
+    plan.start = bestStart;
+    plan.end = bestStart + duration;
+    plan.cost = bestCost;
+    for (const auto& pair : byStart) {
+        const Occupant& occupant = *pair.second;
+        if (occupant.start >= plan.end) break;
+        if (occupant.end <= plan.start) continue;
+        DisplacedEvent displaced{occupant.event, occupant.start, occupant.end, 0, 0.0, {}, -1};
+        measureEvent(occupant.event, displaced.reservations, displaced.refundTotal);
+        plan.reservations += displaced.reservations;
+        plan.refundTotal += displaced.refundTotal;
+        plan.displaced.push_back(displaced);
+    }
+    offerRelocations(schedule, plan, now);
+    plan.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return plan;
+}
+
+// Prints the placement, the displaced events and their relocation options
+void PreemptionPlan::print(std::ostream& out) const {
+    if (!feasible) {
+        out << "No placement found: " << reason << std::endl;
+        return;
+    }
+    out << "Placement: " << formatTimestamp(start) << " to " << formatTimestamp(end) << " (" << candidatesChecked
+        << " candidate(s) checked in " << milliseconds << " ms)" << std::endl;
+    if (displaced.empty()) {
+        out << "The slot is free; no events need to be displaced." << std::endl;
+        return;
+    }
+    out << "Displaces " << displaced.size() << " event(s), affecting " << reservations << " reservation(s) with $" << refundTotal
+        << " in refunds (cost " << cost << "):" << std::endl;
+    for (const DisplacedEvent& event : displaced) {
+        out << " - " << event.event->getEventName() << " (" << formatTimestamp(event.start) << " to " << formatTimestamp(event.end)
+            << ", organizer " << event.event->getOrganizer()->getUsername() << "): " << event.reservations << " reservation(s), $"
+            << event.refundTotal << " in refunds" << std::endl;
+        if (event.relocations.empty()) {
+            out << "     No free slot in the next " << PreemptionPlanner::kRelocationDays << " days; the event will be canceled." << std::endl;
+        }
+        for (size_t i = 0; i < event.relocations.size(); ++i) {
+            out << "     " << i + 1 << ". " << formatTimestamp(event.relocations[i]) << " to "
+                << formatTimestamp(event.relocations[i] + (event.end - event.start)) << std::endl;
+        }
+    }
+}
+
+// Executes a plan as one transaction
+Event* PreemptionPlanner::execute(const PreemptionPlan& plan, const PriorityRequest& request, FacilityManager& facilityManager,
+                                  std::map<std::string, Event*>& events, std::map<int, Reservation*>& reservations, std::string& message) {
+    ScopedTimer timer(kExecuteMetric);
+    if (!plan.feasible) {
+        message = plan.reason;
+        return nullptr;
+    }
+    if (events.count(request.eventName)) {
+        message = "Event with this name already exists. Please choose a different name.";
+        return nullptr;
+    }
+
+    // Validate everything before changing anything: the plan must still describe the schedule
+    Schedule& schedule = facilityManager.getSchedule();
+    std::set<const Event*> moving;
+    for (const DisplacedEvent& displaced : plan.displaced) {
+        auto it = events.find(displaced.event->getEventName());
+        long long start;
+        if (it == events.end() || it->second != displaced.event || !parseTimestamp(displaced.event->getStartTime(), start) ||
+            start != displaced.start) {
+            message = "The schedule changed since the plan was made; please plan again.";
+            return nullptr;
+        }
+        moving.insert(displaced.event);
+    }
+    // Checks that [start, end) only overlaps displaced events
+    auto isClear = [&](long long start, long long end) {
+        for (const Event* event : schedule.eventsBetween(start, end)) {
+            if (!moving.count(event)) return false;
+        }
+        for (const auto& pair : schedule.getRecurringEvents()) {
+            if (pair.second->overlaps(start, end)) return false;
+        }
+        return true;
+    };
+    bool clear = isClear(plan.start, plan.end);
+    for (const DisplacedEvent& displaced : plan.displaced) {
+        if (displaced.chosenRelocation >= 0) {
+            long long slot = displaced.relocations.at(displaced.chosenRelocation);
+            clear = clear && isClear(slot, slot + (displaced.end - displaced.start));
+        }
+    }
+    if (!clear) {
+        message = "The schedule changed since the plan was made; please plan again.";
+        return nullptr;
+    }
+
+    // Apply: refund and drop the reservations of displaced events, then move or cancel them
+    size_t moved = 0, canceled = 0, refunded = 0;
+    std::string refundMessage;  // Summed up in message below
+    for (const DisplacedEvent& displaced : plan.displaced) {
+        Event* event = displaced.event;
+        ReservationStore::pageInEvent(event->getEventName(), reservations);
+        for (Reservation* reservation : event->getReservations()) {
+            if (reservation->getReservationStatus() != ReservationStatus::Canceled && reservation->getPaymentStatus() == PaymentStatus::Paid) {
+                reservation->getUser()->processRefund(reservation->getTotalCost());
+                reservation->processRefund(facilityManager, refundMessage);
+                ++refunded;
+            }
+            reservations.erase(reservation->getReservationID());
+            Reservation::destroy(reservation);
+        }
+        // With no reservation left, nothing is sold and nobody waits: a moved event starts over empty
+        event->clearAttendance();
+        if (displaced.chosenRelocation >= 0) {
+            long long slot = displaced.relocations[displaced.chosenRelocation];
+            schedule.rescheduleEvent(event, formatTimestamp(slot), formatTimestamp(slot + (displaced.end - displaced.start)));
+            std::cout << "Moved " << event->getEventName() << " to " << event->getStartTime() << "." << std::endl;
+            ++moved;
+        } else {
+            events.erase(event->getEventName());
+            facilityManager.removeEvent(event);
+            std::cout << "Canceled " << event->getEventName() << "." << std::endl;
+            delete event;
+            ++canceled;
+        }
+    }
+
+    Event* newEvent = new Event(request.eventName, request.organizer, formatTimestamp(plan.start), formatTimestamp(plan.end),
+                                request.layoutStyle, request.isPublic, request.maxGuests, request.ticketPrice);
+    newEvent->setOpenToResidents(request.openToResidents);
+    newEvent->setOpenToNonResidents(request.openToNonResidents);
+    events[request.eventName] = newEvent;
+    facilityManager.addEvent(newEvent);
+
+    // Save once, after the whole plan has been applied
+    Event::saveEvents("data/events.txt", events);
+    Reservation::saveReservations("data/reservations.txt", reservations);
+    message = "Event " + request.eventName + " booked from " + newEvent->getStartTime() + " to " + newEvent->getEndTime() + "; " +
+              std::to_string(moved) + " event(s) moved, " + std::to_string(canceled) + " canceled, " + std::to_string(refunded) +
+              " reservation(s) refunded.";
+    return newEvent;
+}
@@ -0,0 +1,277 @@
+#include "RecurringEvent.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+// Floor division for possibly negative numerators
+static long long floorDiv(long long numerator, long long denominator) {
+    long long quotient = numerator / denominator;
+    if ((numerator % denominator != 0) && ((numerator < 0) != (denominator < 0))) --quotient;
+    return quotient;
+}
+
+// Returns year * 12 + month - 1 for the day containing a minute
+static int monthIndexOfMinute(long long minutes) {
+    int year, month, day;
+    civilFromDays(dayOfMinute(minutes), year, month, day);
+    return year * 12 + month - 1;
+}
+
+// Constructor for the RecurringEvent class
+RecurringEvent::RecurringEvent(const std::string& eventName, User* organizer, const std::string& startTime, const std::string& endTime,
+                               LayoutStyle layoutStyle, bool isPublic, int maxGuests, double ticketPrice, const RecurrenceRule& rule)
+    : eventName(eventName), organizer(organizer), startTime(startTime), endTime(endTime), layoutStyle(layoutStyle), isPublic(isPublic),
+      maxGuests(maxGuests), ticketPrice(ticketPrice), openToResidents(true), openToNonResidents(true), rule(rule), valid(false),
+      firstStart(0), duration(0), minuteOfDay(0), firstMonth(0), dayOfMonth(1), untilDay(-1), version(Event::nextVersion()) {
+    long long firstEnd;
+    if (!parseTimestamp(startTime, firstStart) || !parseTimestamp(endTime, firstEnd) || firstEnd <= firstStart || this->rule.interval < 1) {
+        return;
+    }
+    valid = true;
+    duration = firstEnd - firstStart;
+    long long firstDay = dayOfMinute(firstStart);
+    minuteOfDay = firstStart - firstDay * kMinutesPerDay;
+    int year, month;
+    civilFromDays(firstDay, year, month, dayOfMonth);
+    firstMonth = year * 12 + month - 1;
+    if (!rule.until.empty() && !parseDate(rule.until, untilDay)) {
+        untilDay = -1;
+    }
+    for (const auto& date : rule.exceptions) {
+        long long day;
+        if (parseDate(date, day)) {
+            exceptionDays.insert(day);
+        }
+    }
+}
+
+// Computes the start of occurrence n
+bool RecurringEvent::occurrenceStartAt(long long n, long long& start) const {
+    if (rule.frequency == RecurrenceFrequency::Weekly) {
+        start = firstStart + n * rule.interval * 7 * kMinutesPerDay;
+        return true;
+    }
+    long long monthIndex = firstMonth + n * rule.interval;
+    int year = static_cast<int>(floorDiv(monthIndex, 12));
+    int month = static_cast<int>(monthIndex - year * 12LL) + 1;
+    // Months without this day (e.g. the 31st) have no occurrence
+    if (dayOfMonth > daysInMonth(year, month)) {
+        return false;
+    }
+    start = daysFromCivil(year, month, dayOfMonth) * kMinutesPerDay + minuteOfDay;
+    return true;
+}
+
+// Checks the count, until and exception limits for occurrence n
+bool RecurringEvent::isActive(long long n, long long start) const {
+    if (n < 0 || (rule.count > 0 && n >= rule.count)) return false;
+    long long day = dayOfMinute(start);
+    if (untilDay >= 0 && day > untilDay) return false;
+    return exceptionDays.find(day) == exceptionDays.end();
+}
+
+// Computes the range of occurrence numbers that can overlap [start, end)
+void RecurringEvent::candidateRange(long long start, long long end, long long& first, long long& last) const {
+    if (rule.frequency == RecurrenceFrequency::Weekly) {
+        // Occurrence n overlaps when firstStart + n*period < end and firstStart + n*period + duration > start
+        long long period = rule.interval * 7 * kMinutesPerDay;
+        first = floorDiv(start - duration - firstStart, period) + 1;
+        last = floorDiv(end - 1 - firstStart, period);
+    } else {
+        first = -floorDiv(-(monthIndexOfMinute(start - duration) - firstMonth), rule.interval);
+        last = floorDiv(monthIndexOfMinute(end - 1) - firstMonth, rule.interval);
+    }
+    if (first < 0) first = 0;
+    if (rule.count > 0 && last > rule.count - 1) last = rule.count - 1;
+}
+
+// Checks if any occurrence overlaps [start, end)
+bool RecurringEvent::overlaps(long long start, long long end, long long* occurrenceStart) const {
+    if (!valid || end <= start) return false;
+    long long first, last;
+    candidateRange(start, end, first, last);
+    for (long long n = first; n <= last; ++n) {
+        long long candidate;
+        if (!occurrenceStartAt(n, candidate)) continue;
+        if (untilDay >= 0 && dayOfMinute(candidate) > untilDay) break;
+        if (isActive(n, candidate) && candidate < end && candidate + duration > start) {
+            if (occurrenceStart) *occurrenceStart = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the start of every occurrence overlapping [start, end)
+std::vector<long long> RecurringEvent::occurrencesBetween(long long start, long long end) const {
+    std::vector<long long> occurrences;
+    if (!valid || end <= start) return occurrences;
+    long long first, last;
+    candidateRange(start, end, first, last);
+    for (long long n = first; n <= last; ++n) {
+        long long candidate;
+        if (!occurrenceStartAt(n, candidate)) continue;
+        if (untilDay >= 0 && dayOfMinute(candidate) > untilDay) break;
+        if (isActive(n, candidate) && candidate < end && candidate + duration > start) {
+            occurrences.push_back(candidate);
+        }
+    }
+    return occurrences;
+}
+
+// Returns the start of the first occurrence at or after a minute, or -1
+long long RecurringEvent::nextOccurrence(long long from) const {
+    if (!valid) return -1;
+    long long first, last;
+    candidateRange(from, from + 1, first, last);
+    // Each skipped candidate is an exception or a month without the day, so this loop is short
+    long long limit = first + static_cast<long long>(exceptionDays.size()) + 12;
+    for (long long n = first; n <= limit; ++n) {
+        if (rule.count > 0 && n >= rule.count) break;
+        long long candidate;
+        if (!occurrenceStartAt(n, candidate)) continue;
+        if (untilDay >= 0 && dayOfMinute(candidate) > untilDay) break;
+        if (candidate >= from && isActive(n, candidate)) return candidate;
+    }
+    return -1;
+}
+
+// Checks if an occurrence starts on the given day
+bool RecurringEvent::occursOn(long long day, long long& occurrenceStart) const {
+    long long dayStart = day * kMinutesPerDay + minuteOfDay;
+    long long found;
+    if (overlaps(dayStart, dayStart + 1, &found) && found == dayStart) {
+        occurrenceStart = found;
+        return true;
+    }
+    return false;
+}
+
+// Skips the occurrence on the given date
+void RecurringEvent::addException(const std::string& date) {
+    long long day;
+    if (parseDate(date, day)) {
+        rule.exceptions.insert(date);
+        exceptionDays.insert(day);
+    }
+}
+
+// Creates a standalone event for the occurrence on the given date
+Event* RecurringEvent::materialize(const std::string& date) {
+    long long day, start;
+    if (!parseDate(date, day) || !occursOn(day, start)) {
+        return nullptr;
+    }
+    Event* event = new Event(occurrenceName(eventName, date), organizer, formatTimestamp(start), formatTimestamp(start + duration),
+                             layoutStyle, isPublic, maxGuests, ticketPrice);
+    event->setOpenToResidents(openToResidents);
+    event->setOpenToNonResidents(openToNonResidents);
+    // The standalone event now occupies this slot
+    addException(date);
+    return event;
+}
+
+// Builds the name of an occurrence
+std::string RecurringEvent::occurrenceName(const std::string& seriesName, const std::string& date) {
+    return seriesName + "@" + date;
+}
+
+// Splits an occurrence name into series name and date
+bool RecurringEvent::splitOccurrenceName(const std::string& name, std::string& seriesName, std::string& date) {
+    size_t separator = name.rfind('@');
+    if (separator == std::string::npos || separator == 0) {
+        return false;
+    }
+    seriesName = name.substr(0, separator);
+    date = name.substr(separator + 1);
+    long long day;
+    return parseDate(date, day);
+}
+
+// Loads recurring events from a file
+std::map<std::string, RecurringEvent*> RecurringEvent::loadRecurringEvents(const std::string& filename, const std::map<std::string, User*>& users) {
+    std::map<std::string, RecurringEvent*> recurringEvents;
+    std::ifstream file(filename);
+    if (file.is_open()) {
+        std::string line;
+        while (getline(file, line)) {
+            std::istringstream iss(line);
+            std::string eventName, organizerName, startTime, endTime, layoutStyleStr, isPublicStr, frequencyStr, untilStr, exceptionsStr;
+            LayoutStyle layoutStyle = LayoutStyle::Meeting;
+            int maxGuests;
+            double ticketPrice;
+            bool openToResidents, openToNonResidents;
+            RecurrenceRule rule;
+            if (!(iss >> eventName >> organizerName >> startTime >> endTime >> layoutStyleStr >> isPublicStr >> maxGuests >> ticketPrice
+                      >> openToResidents >> openToNonResidents >> frequencyStr >> rule.interval >> rule.count >> untilStr >> exceptionsStr)) {
+                continue;
+            }
+
+            if (layoutStyleStr == "Meeting") layoutStyle = LayoutStyle::Meeting;
+            else if (layoutStyleStr == "Lecture") layoutStyle = LayoutStyle::Lecture;
+            else if (layoutStyleStr == "Wedding") layoutStyle = LayoutStyle::Wedding;
+            else if (layoutStyleStr == "Dance") layoutStyle = LayoutStyle::Dance;
+
+            rule.frequency = (frequencyStr == "Monthly") ? RecurrenceFrequency::Monthly : RecurrenceFrequency::Weekly;
+            if (untilStr != "-") rule.until = untilStr;
+            if (exceptionsStr != "-") {
+                std::istringstream exceptionStream(exceptionsStr);
+                std::string date;
+                while (getline(exceptionStream, date, ',')) {
+                    rule.exceptions.insert(date);
+                }
+            }
+
+            if (users.find(organizerName) == users.end()) {
+                std::cerr << "Error: Organizer " << organizerName << " not found in users map." << std::endl;
+                continue;
+            }
+
+            RecurringEvent* series = new RecurringEvent(eventName, users.at(organizerName), startTime, endTime, layoutStyle,
+                                                        isPublicStr == "true", maxGuests, ticketPrice, rule);
+            if (!series->isValid()) {
+                std::cerr << "Error: Invalid recurring event " << eventName << std::endl;
+                delete series;
+                continue;
+            }
+            series->setOpenToResidents(openToResidents);
+            series->setOpenToNonResidents(openToNonResidents);
+            recurringEvents[eventName] = series;
+        }
+        file.close();
+    } else {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+    }
+    return recurringEvents;
+}
+
+// Saves recurring events to a file
+void RecurringEvent::saveRecurringEvents(const std::string& filename, const std::map<std::string, RecurringEvent*>& recurringEvents) {
+    std::ofstream file(filename);
+    if (file.is_open()) {
+        for (const auto& pair : recurringEvents) {
+            RecurringEvent* series = pair.second;
+            std::string layoutStyleStr;
+            switch (series->layoutStyle) {
+                case LayoutStyle::Meeting: layoutStyleStr = "Meeting"; break;
+                case LayoutStyle::Lecture: layoutStyleStr = "Lecture"; break;
+                case LayoutStyle::Wedding: layoutStyleStr = "Wedding"; break;
+                case LayoutStyle::Dance: layoutStyleStr = "Dance"; break;
+            }
+            std::string exceptionsStr;
+            for (const auto& date : series->rule.exceptions) {
+                exceptionsStr += (exceptionsStr.empty() ? "" : ",") + date;
+            }
+            file << series->eventName << " " << series->organizer->getUsername() << " " << series->startTime << " " << series->endTime << " "
+                 << layoutStyleStr << " " << (series->isPublic ? "true" : "false") << " " << series->maxGuests << " " << series->ticketPrice << " "
+                 << series->openToResidents << " " << series->openToNonResidents << " "
+                 << (series->rule.frequency == RecurrenceFrequency::Monthly ? "Monthly" : "Weekly") << " " << series->rule.interval << " "
+                 << series->rule.count << " " << (series->rule.until.empty() ? "-" : series->rule.until) << " "
+                 << (exceptionsStr.empty() ? "-" : exceptionsStr) << std::endl;
+        }
+        file.close();
+    } else {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+    }
+}
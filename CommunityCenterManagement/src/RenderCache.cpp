@@ -0,0 +1,281 @@
+#include "RenderCache.hpp"
+#include "Schedule.hpp"
+#include "Metrics.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <mutex>
+#include <map>
+#include <list>
+#include <functional>
+
+static const int kRenderMetric = Metrics::registerMetric("render_view");
+static const size_t kMaxEvents = 4096;  // Events with cached text kept, least recently used evicted first
+static const size_t kMaxDays = 1024;    // Days with cached text kept
+
+namespace {
+
+// Validity key of a day's block: number of events and occurrences starting that day and the largest version among them
+struct DayKey {
+    size_t count = 0;
+    std::uint64_t version = 0;
+
+    bool operator==(const DayKey& other) const { return count == other.count && version == other.version; }
+    bool operator!=(const DayKey& other) const { return !(*this == other); }
+};
+
+// Cached views of one event
+struct CachedEvent {
+    std::uint64_t version = 0;
+    std::shared_ptr<const std::string> details;
+    std::shared_ptr<const std::string> detailedView;
+    std::list<std::string>::iterator used;  // Position in the recency list
+};
+
+// Cached schedule block of one day
+struct CachedDay {
+    DayKey key;
+    std::shared_ptr<const std::string> text;
+    std::list<long long>::iterator used;
+};
+
+struct CacheState {
+    std::map<std::string, CachedEvent> events;
+    std::map<long long, CachedDay> days;
+    std::list<std::string> eventsUsed;  // Most recently used first
+    std::list<long long> daysUsed;
+    RenderCacheStats stats;
+};
+
+std::mutex cacheMutex;
+CacheState state;
+
+} // namespace
+
+// Computes the validity key of a day from a snapshot
+static DayKey dayKey(const ScheduleSnapshot& snapshot, long long day) {
+    DayKey key;
+    auto range = snapshot.layout->dayIndex.find(day);
+    if (range != snapshot.layout->dayIndex.end()) {
+        for (size_t i = range->second.first; i < range->second.second; ++i) {
+            ++key.count;
+            key.version = std::max(key.version, snapshot.events[i]->version);
+        }
+    }
+    for (const auto& series : snapshot.recurringEvents) {
+        long long start;
+        if (series->occursOn(day, start)) {
+            ++key.count;
+            key.version = std::max(key.version, series->getVersion());
+        }
+    }
+    return key;
+}
+
+// Returns the entry of a key, created if missing and moved to the front of the recency list; the least
+// recently used entry is evicted beyond limit (the cache mutex is held)
+template <typename Key, typename Entry>
+static Entry& touch(std::map<Key, Entry>& entries, std::list<Key>& used, const Key& key, size_t limit) {
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        used.splice(used.begin(), used, it->second.used);
+        return it->second;
+    }
+    used.push_front(key);
+    Entry& entry = entries[key];
+    entry.used = used.begin();
+    if (entries.size() > limit) {
+        entries.erase(used.back());
+        used.pop_back();
+    }
+    return entry;
+}
+
+// Returns a cached text, rendering it first if it is missing (the cache mutex is held)
+static std::shared_ptr<const std::string> lookup(std::shared_ptr<const std::string>& text, const std::function<void(std::ostream&)>& render) {
+    if (text) {
+        ++state.stats.hits;
+        return text;
+    }
+    ScopedTimer timer(kRenderMetric);
+    std::ostringstream out;
+    render(out);
+    text = std::make_shared<const std::string>(out.str());
+    ++state.stats.misses;
+    return text;
+}
+
+// Returns the entry of an event, emptied if the event changed (the cache mutex is held)
+static CachedEvent& eventEntry(const EventSnapshot& event) {
+    CachedEvent& cached = touch(state.events, state.eventsUsed, event.eventName, kMaxEvents);
+    if (cached.version != event.version) {
+        cached.version = event.version;
+        cached.details.reset();
+        cached.detailedView.reset();
+    }
+    return cached;
+}
+
+// Returns the basic details of an event
+std::shared_ptr<const std::string> RenderCache::eventDetails(const EventSnapshot& event) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return lookup(eventEntry(event).details, [&](std::ostream& out) { printEventDetails(event, out); });
+}
+
+// Returns the detailed view of an event
+std::shared_ptr<const std::string> RenderCache::eventDetailedView(const EventSnapshot& event) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return lookup(eventEntry(event).detailedView, [&](std::ostream& out) { printEventDetailedView(event, out); });
+}
+
+// Returns the schedule block of a day
+std::shared_ptr<const std::string> RenderCache::dayView(const ScheduleSnapshot& snapshot, long long day) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    CachedDay& cached = touch(state.days, state.daysUsed, day, kMaxDays);
+    DayKey key = dayKey(snapshot, day);
+    if (cached.key != key) {
+        cached.key = key;
+        cached.text.reset();
+    }
+    return lookup(cached.text, [&](std::ostream& out) { printScheduleDay(snapshot, day, out); });
+}
+
+// Returns the counters
+RenderCacheStats RenderCache::getStats() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    RenderCacheStats stats = state.stats;
+    stats.events = state.events.size();
+    stats.days = state.days.size();
+    return stats;
+}
+
+// Forgets every cached view
+void RenderCache::reset() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    state = CacheState();
+}
+
+// Renders every view of a snapshot through the cache, returning false if a cached text differs from a fresh rendering
+static bool renderAll(const ScheduleSnapshot& snapshot, long long firstDay, long long lastDay) {
+    bool matches = true;
+    for (const auto& shared : snapshot.events) {
+        const EventSnapshot& event = *shared;
+        std::ostringstream details, detailedView;
+        printEventDetails(event, details);
+        printEventDetailedView(event, detailedView);
+        matches = matches && *RenderCache::eventDetails(event) == details.str();
+        matches = matches && *RenderCache::eventDetailedView(event) == detailedView.str();
+    }
+    for (long long day = firstDay; day <= lastDay; ++day) {
+        if (dayKey(snapshot, day).count == 0) continue;
+        std::ostringstream text;
+        printScheduleDay(snapshot, day, text);
+        matches = matches && *RenderCache::dayView(snapshot, day) == text.str();
+    }
+    return matches;
+}
+
+// Checks the cache against fresh renderings through every kind of change on a synthetic schedule
+std::vector<RenderCheckResult> RenderCache::runCheck() {
+    reset();
+    Schedule schedule;
+    std::vector<User*> users = {
+        new OrganizationUser("render_check_organization", "password"),
+        new ResidentUser("render_check_resident_a", "password"),
+        new ResidentUser("render_check_resident_b", "password"),
+    };
+    const long long firstDay = daysFromCivil(2030, 1, 7);
+    const long long lastDay = firstDay + 20;
+    auto at = [&](long long day, int hour) { return formatTimestamp((firstDay + day) * kMinutesPerDay + hour * 60); };
+    std::vector<Event*> events;
+    auto addEvent = [&](long long day, int hour, LayoutStyle layoutStyle) {
+        events.push_back(new Event("render_check_event_" + std::to_string(events.size()), users[0], at(day, hour), at(day, hour + 2), layoutStyle,
+                                   true, 50, 10.0));
+        schedule.addEvent(events.back());
+        return events.back();
+    };
+    Event* morning = addEvent(0, 10, LayoutStyle::Meeting);
+    Event* afternoon = addEvent(0, 14, LayoutStyle::Meeting);
+    Event* second = addEvent(1, 10, LayoutStyle::Meeting);
+    Event* third = addEvent(2, 10, LayoutStyle::Meeting);
+    Event* lecture = addEvent(2, 18, LayoutStyle::Lecture);
+    addEvent(14, 18, LayoutStyle::Meeting);
+    RecurrenceRule rule;
+    RecurringEvent* series = new RecurringEvent("render_check_series", users[0], at(0, 8), at(0, 9), LayoutStyle::Meeting, true, 20, 0.0, rule);
+    schedule.addRecurringEvent(series);
+    std::map<int, Reservation*> reservations;
+    Reservation* canceled = nullptr;
+    std::string message;
+
+    // Each step changes the data the way the application does and states how many cached views that must invalidate
+    struct Step {
+        std::string name;
+        std::uint64_t expected;
+        std::function<void()> apply;
+    };
+    std::vector<Step> steps = {
+        {"initial", 17, [] {}},  // 6 events x 2 views, days 0, 1, 2, 7 and 14
+        {"unchanged", 0, [] {}},
+        {"add_reservation", 3, [&] { canceled = reservations[1] = Reservation::create(1, users[1], morning, morning->getStartTime()); }},
+        {"purchase_ticket", 3, [&] { second->purchaseTicket(users[1], 1, message); }},
+        {"cancel_ticket", 3, [&] { second->cancelTicket(users[1], 1, message); }},
+        {"waitlist", 3, [&] { third->addToWaitlist(users[2]); }},
+        {"seat_allocation", 3, [&] {
+             reservations[2] = Reservation::create(2, users[2], lecture, lecture->getStartTime());
+             reservations[2]->assignSeats(2);
+         }},
+        {"cancel_reservation", 3, [&] {
+             reservations.erase(1);
+             Reservation::destroy(canceled);
+         }},
+        {"reschedule", 4, [&] { schedule.rescheduleEvent(afternoon, at(1, 14), at(1, 16)); }},  // Both days and the event
+        {"event_cancel", 1, [&] { schedule.removeEvent(third); }},                              // Only its day is shown again
+        {"recurring_skip", 1, [&] { series->addException(formatDate(firstDay + 14)); }},
+        {"materialize_occurrence", 3, [&] {
+             events.push_back(schedule.materializeOccurrence(RecurringEvent::occurrenceName(series->getEventName(), formatDate(firstDay + 7))));
+         }},
+        {"add_event", 3, [&] { addEvent(1, 18, LayoutStyle::Dance); }},
+    };
+
+    // The mutators print messages
+    std::ostringstream discard;
+    std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+    std::vector<RenderCheckResult> results;
+    for (const Step& step : steps) {
+        step.apply();
+        schedule.publishSnapshot(reservations);
+        std::uint64_t before = getStats().misses;
+        RenderCheckResult result;
+        result.step = step.name;
+        result.expected = step.expected;
+        {
+            SnapshotStore::ReadGuard snapshot = schedule.getSnapshots().read();
+            result.matches = renderAll(*snapshot, firstDay, lastDay);
+            // Rendering again without a change must be served entirely from the cache
+            std::uint64_t rendered = getStats().misses;
+            result.matches = renderAll(*snapshot, firstDay, lastDay) && result.matches && getStats().misses == rendered;
+        }
+        result.rendered = getStats().misses - before;
+        results.push_back(result);
+    }
+    std::cout.rdbuf(console);
+
+    for (Event* event : events) delete event;
+    delete series;
+    for (User* user : users) delete user;
+    // Runs before any real reservation is loaded, so every slot is synthetic
+    Reservation::destroyAll();
+    reset();
+    return results;
+}
+
+// Prints the check results as a table
+void RenderCache::printCheck(std::ostream& out, const std::vector<RenderCheckResult>& results) {
+    out << std::left << std::setw(24) << "Step" << std::right << std::setw(10) << "Rendered" << std::setw(10) << "Expected" << "  Result"
+        << std::endl;
+    for (const RenderCheckResult& result : results) {
+        out << std::left << std::setw(24) << result.step << std::right << std::setw(10) << result.rendered << std::setw(10) << result.expected << "  "
+            << (result.passed() ? "ok" : !result.matches ? "STALE" : "IMPRECISE") << std::endl;
+    }
+}
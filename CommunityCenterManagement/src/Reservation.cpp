@@ -2,23 +2,72 @@
 #include "Event.hpp"
 #include "User.hpp"
 #include "FacilityManager.hpp"
+#include "Metrics.hpp"
+#include "ReservationStore.hpp"
+#include "TimeUtils.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
+
+static const int kCalculateCostMetric = Metrics::registerMetric("calculate_cost");
+static const int kLoadReservationsMetric = Metrics::registerMetric("load_reservations");
+static const int kSaveReservationsMetric = Metrics::registerMetric("save_reservations");
+
+// Returns the slot map owning all reservations
+static SlotMap<Reservation>& reservationSlots() {
+    static SlotMap<Reservation> slots;
+    return slots;
+}
 
 // Constructor for the Reservation class
 Reservation::Reservation(int reservationID, User* user, Event* event, const std::string& reservationTime)
     : reservationID(reservationID), user(user), event(event), reservationStatus(ReservationStatus::Pending),
-      totalCost(0), paymentStatus(PaymentStatus::Unpaid), reservationTime(reservationTime) {
+      totalCost(0), paymentStatus(PaymentStatus::Unpaid), reservationTime(reservationTime), createdMinute(currentMinutes()),
+      version(Event::nextVersion()) {
     totalCost = calculateCost();
-    user->addReservation(this); // Add reservation to user's list
-    event->addReservation(this); // Add reservation to event's list using the new method
+}
+
+// Creates a reservation and links it to its user and event
+Reservation* Reservation::create(int reservationID, User* user, Event* event, const std::string& reservationTime) {
+    ReservationHandle handle = reservationSlots().emplace(reservationID, user, event, reservationTime);
+    Reservation* reservation = reservationSlots().get(handle);
+    reservation->handle = handle;
+    user->addReservation(reservation); // Add reservation to user's list
+    event->addReservation(reservation); // Add reservation to event's list
+    ReservationStore::noteChange(reservationID);
+    return reservation;
+}
+
+// Unlinks a reservation from its user and event, releases its seats and frees it
+void Reservation::destroy(Reservation* reservation) {
+    ReservationStore::noteChange(reservation->reservationID);
+    reservation->event->releaseSeats(reservation->seats);
+    reservation->user->removeReservation(reservation);
+    reservation->event->removeReservation(reservation);
+    reservationSlots().erase(reservation->handle);
+}
+
+// Frees every reservation
+void Reservation::destroyAll() {
+    reservationSlots().clear();
+}
+
+// Returns the reservation a handle refers to, or nullptr if it was destroyed
+Reservation* Reservation::resolve(ReservationHandle handle) {
+    return reservationSlots().get(handle);
 }
 
 // Calculates the total cost of the reservation
 double Reservation::calculateCost() {
+    ScopedTimer timer(kCalculateCostMetric);
     // Implement cost calculation logic based on user type and event details
-    int duration = std::stoi(event->getEndTime().substr(11, 2)) - std::stoi(event->getStartTime().substr(11, 2));
+    // The duration counts whole hours of the clock (end hour minus start hour)
+    long long start, end;
+    if (!parseTimestamp(event->getStartTime(), start) || !parseTimestamp(event->getEndTime(), end)) {
+        return 0;
+    }
+    long long duration = (end - dayOfMinute(end) * kMinutesPerDay) / 60 - (start - dayOfMinute(start) * kMinutesPerDay) / 60;
     double cost = duration * 10; // Standard service charge
     
     if (user->getUserType() == UserType::City) {
@@ -34,20 +83,68 @@ double Reservation::calculateCost() {
     return cost;
 }
 
+// Takes a new render version and notes the change for the next save
+void Reservation::markChanged() {
+    version = Event::nextVersion();
+    ReservationStore::noteChange(reservationID);
+}
+
+// Formats the assigned seats as labels
+std::string Reservation::getSeatLabels() const {
+    return event->formatSeats(seats);
+}
+
+// Allocates the best available seats of the event for a group
+bool Reservation::assignSeats(int count) {
+    markChanged();
+    event->releaseSeats(seats);
+    return event->allocateSeats(count, seats);
+}
+
+// Returns the number of seats held, or 1 for a reservation without assigned seats
+int Reservation::getGroupSize() const {
+    if (seats.empty()) return 1;
+    int count = 0;
+    for (const SeatBlock& block : seats) count += static_cast<int>(block.count);
+    return count;
+}
+
+// Cancels an unpaid hold and releases its seats
+void Reservation::expireHold() {
+    reservationStatus = ReservationStatus::Canceled;
+    event->releaseSeats(seats);
+    seats.clear();
+    user->refreshBooking(this);
+    markChanged();
+}
+
+// Restarts the hold clock
+void Reservation::restartHold(long long minute) {
+    createdMinute = minute;
+    markChanged();
+}
+
 // Handles payment for the reservation
-void Reservation::makePayment(FacilityManager& facilityManager) {
+void Reservation::makePayment(FacilityManager& facilityManager, std::string& message) {
     paymentStatus = PaymentStatus::Paid;
     reservationStatus = ReservationStatus::Confirmed;
     facilityManager.updateFacilityBudget(totalCost); // Update the budget when payment is made
-    std::cout << "Payment made for reservation " << reservationID << "." << std::endl;
+    markChanged();
+    message = "Payment made for reservation ";
+    message += std::to_string(reservationID);
+    message += ".";
 }
 
 // Processes a refund for the reservation
-void Reservation::processRefund(FacilityManager& facilityManager) {
+void Reservation::processRefund(FacilityManager& facilityManager, std::string& message) {
     paymentStatus = PaymentStatus::Unpaid;
     reservationStatus = ReservationStatus::Canceled;
+    user->refreshBooking(this);
     facilityManager.updateFacilityBudget(-totalCost); // Update the budget when refund is processed
-    std::cout << "Refund processed for reservation " << reservationID << "." << std::endl;
+    markChanged();
+    message = "Refund processed for reservation ";
+    message += std::to_string(reservationID);
+    message += ".";
 }
 
 // Prints detailed information of the reservation
@@ -56,37 +153,127 @@ void Reservation::getDetailedView() const {
               << "\nEvent: " << event->getEventName() << "\nStatus: " << static_cast<int>(reservationStatus)
               << "\nPayment Status: " << static_cast<int>(paymentStatus) << "\nTotal Cost: " << totalCost
               << "\nReservation Time: " << reservationTime << std::endl;
+    if (!seats.empty()) {
+        std::cout << "Seats: " << getSeatLabels() << std::endl;
+    }
+}
+
+// Parses one line of the reservation file, returning nullptr if it is malformed or refers to an unknown user or event
+Reservation* Reservation::parseRecord(const std::string& line, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events) {
+    std::istringstream iss(line);
+    int reservationID;
+    std::string username, eventName, reservationStatusStr, paymentStatusStr, reservationTime;
+    ReservationStatus reservationStatus = ReservationStatus::Pending;
+    PaymentStatus paymentStatus = PaymentStatus::Unpaid;
+    double totalCost;
+    if (!(iss >> reservationID >> username >> eventName >> reservationStatusStr >> paymentStatusStr >> totalCost >> reservationTime)) {
+        return nullptr;
+    }
+    // Optional key=value fields: assigned seats and the creation time of the hold
+    // (a bare token is the seat list of files written before the fields had keys)
+    std::string field, seatLabels, created;
+    while (iss >> field) {
+        if (field.compare(0, 6, "seats=") == 0) seatLabels = field.substr(6);
+        else if (field.compare(0, 8, "created=") == 0) created = field.substr(8);
+        else if (field.find('=') == std::string::npos) seatLabels = field;
+    }
+
+    if (reservationStatusStr == "Pending") reservationStatus = ReservationStatus::Pending;
+    else if (reservationStatusStr == "Confirmed") reservationStatus = ReservationStatus::Confirmed;
+    else if (reservationStatusStr == "Canceled") reservationStatus = ReservationStatus::Canceled;
+
+    if (paymentStatusStr == "Unpaid") paymentStatus = PaymentStatus::Unpaid;
+    else if (paymentStatusStr == "Paid") paymentStatus = PaymentStatus::Paid;
+
+    auto user = users.find(username);
+    auto event = events.find(eventName);
+    if (user == users.end() || event == events.end()) {
+        std::cerr << "Error: Reservation " << reservationID << " refers to an unknown user or event." << std::endl;
+        return nullptr;
+    }
+    Reservation* reservation = create(reservationID, user->second, event->second, reservationTime);
+    reservation->reservationStatus = reservationStatus;
+    reservation->totalCost = totalCost;
+    reservation->paymentStatus = paymentStatus;
+    if (reservationStatus == ReservationStatus::Canceled) {
+        reservation->user->refreshBooking(reservation);
+    }
+    long long createdMinute;
+    if (!created.empty() && parseTimestamp(created, createdMinute)) {
+        reservation->createdMinute = createdMinute;
+    }  // Otherwise the hold counts as placed now
+    if (!seatLabels.empty()) {
+        std::vector<SeatBlock> seats;
+        int seatsPerRow = SeatLayout::forStyle(event->second->getLayoutStyle()).seatsPerRow();
+        if (!SeatMap::parseBlocks(seatLabels, seatsPerRow, seats) || !event->second->claimSeats(seats)) {
+            std::cerr << "Error: Seats " << seatLabels << " of reservation " << reservationID << " are invalid or already taken." << std::endl;
+        } else {
+            reservation->seats = seats;
+        }
+    }
+    return reservation;
+}
+
+// Formats the reservation as one line of the reservation file (without the newline)
+std::string Reservation::formatRecord() const {
+    std::string reservationStatusStr, paymentStatusStr;
+    switch (reservationStatus) {
+        case ReservationStatus::Pending: reservationStatusStr = "Pending"; break;
+        case ReservationStatus::Confirmed: reservationStatusStr = "Confirmed"; break;
+        case ReservationStatus::Canceled: reservationStatusStr = "Canceled"; break;
+    }
+    switch (paymentStatus) {
+        case PaymentStatus::Unpaid: paymentStatusStr = "Unpaid"; break;
+        case PaymentStatus::Paid: paymentStatusStr = "Paid"; break;
+    }
+    std::ostringstream line;
+    line << reservationID << " " << user->getUsername() << " " << event->getEventName() << " "
+         << reservationStatusStr << " " << paymentStatusStr << " " << totalCost << " " << reservationTime;
+    if (!seats.empty()) {
+        line << " seats=" << getSeatLabels();
+    }
+    line << " created=" << formatTimestamp(createdMinute);
+    return line.str();
+}
+
+// Formats the line that removes a reservation from the file
+std::string Reservation::formatTombstone(int reservationID) {
+    return "-" + std::to_string(reservationID);
+}
+
+// Checks if a line removes a reservation, extracting its ID
+bool Reservation::parseTombstone(const std::string& line, int& reservationID) {
+    if (line.size() < 2 || line[0] != '-') return false;
+    char* end = nullptr;
+    long id = std::strtol(line.c_str() + 1, &end, 10);
+    if (end == line.c_str() + 1 || *end != '\0' || id <= 0) return false;
+    reservationID = static_cast<int>(id);
+    return true;
 }
 
 // Loads reservations from a file
 std::map<int, Reservation*> Reservation::loadReservations(const std::string& filename, const std::map<std::string, User*>& users, const std::map<std::string, Event*>& events) {
+    ScopedTimer timer(kLoadReservationsMetric);
     std::map<int, Reservation*> reservations;
     std::ifstream file(filename);
     if (file.is_open()) {
+        // Changes are appended to the file: a later line for an ID replaces the earlier one, a tombstone drops it
         std::string line;
         while (getline(file, line)) {
-            std::istringstream iss(line);
             int reservationID;
-            std::string username, eventName, reservationStatusStr, paymentStatusStr, reservationTime;
-            ReservationStatus reservationStatus = ReservationStatus::Pending;
-            PaymentStatus paymentStatus = PaymentStatus::Unpaid;
-            double totalCost;
-            iss >> reservationID >> username >> eventName >> reservationStatusStr >> paymentStatusStr >> totalCost >> reservationTime;
-
-            if (reservationStatusStr == "Pending") reservationStatus = ReservationStatus::Pending;
-            else if (reservationStatusStr == "Confirmed") reservationStatus = ReservationStatus::Confirmed;
-            else if (reservationStatusStr == "Canceled") reservationStatus = ReservationStatus::Canceled;
-
-            if (paymentStatusStr == "Unpaid") paymentStatus = PaymentStatus::Unpaid;
-            else if (paymentStatusStr == "Paid") paymentStatus = PaymentStatus::Paid;
-
-            User* user = users.at(username);
-            Event* event = events.at(eventName);
-            Reservation* reservation = new Reservation(reservationID, user, event, reservationTime);
-            reservation->reservationStatus = reservationStatus;
-            reservation->totalCost = totalCost;
-            reservation->paymentStatus = paymentStatus;
-            reservations[reservationID] = reservation;
+            bool tombstone = parseTombstone(line, reservationID);
+            if (!tombstone) reservationID = std::atoi(line.c_str());
+            // The earlier record goes first, so its seats are free for the new one
+            auto earlier = reservations.find(reservationID);
+            if (earlier != reservations.end()) {
+                destroy(earlier->second);
+                reservations.erase(earlier);
+            }
+            if (tombstone) continue;
+            Reservation* reservation = parseRecord(line, users, events);
+            if (reservation) {
+                reservations[reservation->getReservationID()] = reservation;
+            }
         }
         file.close();
     } else {
@@ -97,22 +284,15 @@ std::map<int, Reservation*> Reservation::loadReservations(const std::string& fil
 
 // Saves reservations to a file
 void Reservation::saveReservations(const std::string& filename, const std::map<int, Reservation*>& reservations) {
+    ScopedTimer timer(kSaveReservationsMetric);
+    // When the file is paged by the reservation store, archived records must be kept as well
+    if (ReservationStore::save(filename, reservations)) {
+        return;
+    }
     std::ofstream file(filename);
     if (file.is_open()) {
         for (const auto& pair : reservations) {
-            Reservation* reservation = pair.second;
-            std::string reservationStatusStr, paymentStatusStr;
-            switch (reservation->reservationStatus) {
-                case ReservationStatus::Pending: reservationStatusStr = "Pending"; break;
-                case ReservationStatus::Confirmed: reservationStatusStr = "Confirmed"; break;
-                case ReservationStatus::Canceled: reservationStatusStr = "Canceled"; break;
-            }
-            switch (reservation->paymentStatus) {
-                case PaymentStatus::Unpaid: paymentStatusStr = "Unpaid"; break;
-                case PaymentStatus::Paid: paymentStatusStr = "Paid"; break;
-            }
-            file << reservation->getReservationID() << " " << reservation->getUser()->getUsername() << " " << reservation->getEvent()->getEventName() << " "
-                 << reservationStatusStr << " " << paymentStatusStr << " " << reservation->getTotalCost() << " " << reservation->getReservationTime() << std::endl;
+            file << pair.second->formatRecord() << std::endl;
         }
         file.close();
     } else {
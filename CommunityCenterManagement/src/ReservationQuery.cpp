@@ -0,0 +1,228 @@
+#include "ReservationQuery.hpp"
+#include "Snapshot.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <unordered_map>
+
+static const int kQueryMetric = Metrics::registerMetric("reservation_query");
+
+static const char* kStatusNames[] = {"pending", "confirmed", "canceled"};
+static const char* kPaymentNames[] = {"unpaid", "paid"};
+static const char* kUserTypeNames[] = {"city", "organization", "resident", "nonresident"};
+
+// Returns a lower-case copy of a string
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+// Finds a name in a table, returning its position or -1
+template <size_t N>
+static int findName(const char* const (&names)[N], const std::string& value) {
+    for (size_t i = 0; i < N; ++i) {
+        if (value == names[i]) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// Constructor for empty indexes
+ReservationIndex::ReservationIndex() {
+    static const SharedBitmap empty = std::make_shared<Bitmap>();
+    allRows = empty;
+    for (SharedBitmap& rows : statusRows) rows = empty;
+    for (SharedBitmap& rows : paymentRows) rows = empty;
+    for (SharedBitmap& rows : userTypeRows) rows = empty;
+}
+
+// Moves the changed reservations between the bitmaps
+void ReservationIndex::update(const std::vector<Change>& changes) {
+    // A bitmap still shared with earlier snapshots is copied before its first change, then changed in place
+    std::unordered_map<SharedBitmap*, Bitmap*> copies;
+    auto writable = [&copies](SharedBitmap& slot) -> Bitmap& {
+        auto copy = copies.find(&slot);
+        if (copy != copies.end()) return *copy->second;
+        std::shared_ptr<Bitmap> fresh = slot ? std::make_shared<Bitmap>(*slot) : std::make_shared<Bitmap>();
+        slot = fresh;
+        copies.emplace(&slot, fresh.get());
+        return *fresh;
+    };
+    std::vector<long long> days;
+    auto move = [&](const ReservationSnapshot& reservation, bool present) {
+        std::uint32_t row = static_cast<std::uint32_t>(reservation.reservationID);
+        SharedBitmap* slots[6] = {&allRows, &statusRows[static_cast<int>(reservation.reservationStatus)],
+                                  &paymentRows[static_cast<int>(reservation.paymentStatus)], &userTypeRows[static_cast<int>(reservation.userType)]};
+        size_t count = 4;
+        if (reservation.eventDay >= 0) {
+            slots[count++] = &dayRows[reservation.eventDay];
+            slots[count++] = &weekRows[reservation.eventDay - weekdayFromDays(reservation.eventDay)];
+            days.push_back(reservation.eventDay);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (present) {
+                writable(*slots[i]).insert(row);
+            } else {
+                writable(*slots[i]).remove(row);
+            }
+        }
+    };
+    for (const Change& change : changes) {
+        if (change.first) move(*change.first, false);
+        if (change.second) move(*change.second, true);
+    }
+    // Days and weeks left without reservations are dropped
+    for (long long day : days) {
+        auto rows = dayRows.find(day);
+        if (rows != dayRows.end() && rows->second->empty()) dayRows.erase(rows);
+        auto week = weekRows.find(day - weekdayFromDays(day));
+        if (week != weekRows.end() && week->second->empty()) weekRows.erase(week);
+    }
+}
+
+// Returns the rows of reservations for events starting on a day
+const Bitmap* ReservationIndex::dayBitmap(long long day) const {
+    auto rows = dayRows.find(day);
+    return rows != dayRows.end() ? rows->second.get() : nullptr;
+}
+
+// Appends the bitmaps whose union holds the rows matching one value of a field
+bool ReservationIndex::matchValue(const std::string& field, const std::string& value, std::vector<const Bitmap*>& parts, std::string& error) const {
+    if (field == "status" || field == "payment" || field == "usertype") {
+        int position = field == "status" ? findName(kStatusNames, value) : field == "payment" ? findName(kPaymentNames, value) : findName(kUserTypeNames, value);
+        if (position < 0) {
+            error = "Unknown " + field + " '" + value + "'.";
+            return false;
+        }
+        parts.push_back(field == "status" ? statusRows[position].get() : field == "payment" ? paymentRows[position].get() : userTypeRows[position].get());
+        return true;
+    }
+    if (field != "date") {
+        error = "Unknown field '" + field + "'.";
+        return false;
+    }
+
+    long long today = dayOfMinute(currentMinutes());
+    long long monday = today - weekdayFromDays(today);
+    long long firstDay, lastDay;
+    size_t dots = value.find("..");
+    if (value == "today") {
+        firstDay = lastDay = today;
+    } else if (value == "thisweek") {
+        firstDay = monday;
+        lastDay = monday + 6;
+    } else if (value == "nextweek") {
+        firstDay = monday + 7;
+        lastDay = monday + 13;
+    } else if (dots != std::string::npos) {
+        if (!parseDate(value.substr(0, dots), firstDay) || !parseDate(value.substr(dots + 2), lastDay) || lastDay < firstDay) {
+            error = "Invalid date range '" + value + "'.";
+            return false;
+        }
+    } else if (!parseDate(value, firstDay)) {
+        error = "Invalid date '" + value + "'.";
+        return false;
+    } else {
+        lastDay = firstDay;
+    }
+    auto day = dayRows.lower_bound(firstDay);
+    while (day != dayRows.end() && day->first <= lastDay) {
+        long long weekStart = day->first - weekdayFromDays(day->first);
+        if (weekStart >= firstDay && weekStart + 6 <= lastDay) {
+            parts.push_back(weekRows.at(weekStart).get());
+            day = dayRows.lower_bound(weekStart + 7);
+        } else {
+            parts.push_back(day->second.get());
+            ++day;
+        }
+    }
+    return true;
+}
+
+// Evaluates a filter
+bool ReservationIndex::evaluate(const std::string& filter, Bitmap& rows, std::string& error) const {
+    // Terms point into the indexes; only terms combining several bitmaps own their result
+    std::deque<Bitmap> unions;
+    std::vector<const Bitmap*> required, excluded;
+    std::istringstream terms(toLower(filter));
+    std::string term;
+    while (terms >> term) {
+        size_t equals = term.find('=');
+        if (equals == std::string::npos || equals == 0) {
+            error = "Expected field=value, got '" + term + "'.";
+            return false;
+        }
+        bool negated = term[equals - 1] == '!';
+        std::string field = term.substr(0, negated ? equals - 1 : equals);
+        std::istringstream values(term.substr(equals + 1));
+        std::string value;
+        std::vector<const Bitmap*> parts;
+        while (getline(values, value, ',')) {
+            if (!matchValue(field, value, parts, error)) return false;
+        }
+        if (parts.size() != 1) {
+            unions.emplace_back();
+            for (const Bitmap* part : parts) {
+                unions.back() = Bitmap::unite(unions.back(), *part);
+            }
+            parts.assign(1, &unions.back());
+        }
+        (negated ? excluded : required).push_back(parts[0]);
+    }
+
+    // Intersect the most selective terms first so every later step works on less
+    std::sort(required.begin(), required.end(), [](const Bitmap* a, const Bitmap* b) { return a->cardinality() < b->cardinality(); });
+    if (required.empty()) {
+        rows = *allRows;
+    } else if (required.size() == 1) {
+        rows = *required[0];
+    } else {
+        rows = Bitmap::intersect(*required[0], *required[1]);
+    }
+    for (size_t i = 2; i < required.size() && !rows.empty(); ++i) {
+        rows = Bitmap::intersect(rows, *required[i]);
+    }
+    for (size_t i = 0; i < excluded.size() && !rows.empty(); ++i) {
+        rows = Bitmap::subtract(rows, *excluded[i]);
+    }
+    return true;
+}
+
+// Returns the bytes used by the indexes
+size_t ReservationIndex::memoryUsage() const {
+    size_t bytes = allRows->memoryUsage();
+    for (const SharedBitmap& bitmap : statusRows) bytes += bitmap->memoryUsage();
+    for (const SharedBitmap& bitmap : paymentRows) bytes += bitmap->memoryUsage();
+    for (const SharedBitmap& bitmap : userTypeRows) bytes += bitmap->memoryUsage();
+    for (const auto& pair : dayRows) bytes += pair.second->memoryUsage();
+    for (const auto& pair : weekRows) bytes += pair.second->memoryUsage();
+    return bytes;
+}
+
+// Runs a filter against a snapshot
+bool queryReservations(const ScheduleSnapshot& snapshot, const std::string& filter, size_t limit,
+                       std::vector<const ReservationSnapshot*>& matches, size_t& total, std::string& error) {
+    ScopedTimer timer(kQueryMetric);
+    Bitmap rows;
+    if (!snapshot.reservationIndex.evaluate(filter, rows, error)) return false;
+    total = rows.cardinality();
+    std::vector<std::uint32_t> selected;
+    rows.collect(selected, limit);
+    matches.clear();
+    for (std::uint32_t row : selected) {
+        matches.push_back(snapshot.findReservation(static_cast<int>(row)));
+    }
+    return true;
+}
+
+// Formats a reservation as one query result line
+std::string formatQueryRow(const ReservationSnapshot& reservation) {
+    static const char* statusNames[] = {"Pending", "Confirmed", "Canceled"};
+    std::ostringstream line;
+    line << reservation.reservationID << " " << reservation.username << " " << reservation.eventName << " "
+         << statusNames[static_cast<int>(reservation.reservationStatus)] << " "
+         << (reservation.paymentStatus == PaymentStatus::Paid ? "Paid" : "Unpaid") << " " << reservation.totalCost;
+    return line.str();
+}
@@ -0,0 +1,829 @@
+#include "ReservationStore.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include "HoldExpiry.hpp"
+#include "TaskPool.hpp"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <string_view>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const int kPageInMetric = Metrics::registerMetric("reservation_page_in");
+static const int kBuildIndexMetric = Metrics::registerMetric("reservation_index_build");
+
+// The file is rewritten once its superseded lines and tombstones outnumber its records (and this floor)
+static const size_t kMinCompactLines = 1024;
+
+// The index is folded into a new one once the lines appended after it outnumber its records (and this floor)
+static const size_t kMinFoldLines = 1024;
+// Bytes before the end of the indexed part that are hashed to recognize the file
+static const std::uint64_t kBoundaryBytes = 64;
+
+// Index file layout: header, records sorted by ID, events sorted by name,
+// record positions grouped by event, then the event names.
+// The index covers the first dataSize bytes of the reservation file; lines appended
+// later are scanned when the index is mapped. Appends keep the file's inode, while
+// every rewrite renames a new file into place, so the inode and the hashed bytes at
+// the end of the covered part tell whether the index still describes the file.
+static const char kIndexMagic[8] = {'C', 'C', 'M', 'R', 'I', 'D', 'X', '2'};
+
+struct IndexHeader {
+    char magic[8];
+    std::uint64_t dataSize;      // Bytes of the reservation file the index covers
+    std::uint64_t dataInode;     // Inode of that file
+    std::uint32_t recordCount;
+    std::uint32_t eventCount;
+    std::int32_t maxID;          // Highest ID ever handed out; carried over from index to index, so it never goes down
+    std::uint32_t namesSize;
+    std::uint64_t boundaryHash;  // Hash of the kBoundaryBytes before dataSize
+    std::uint32_t staleLines;    // Superseded lines and tombstones in the covered part
+};
+
+struct IndexRecord {
+    std::int32_t reservationID;
+    std::uint32_t event;   // Position in the event table
+    std::uint64_t offset;  // Offset of the line in the reservation file
+};
+
+struct IndexEvent {
+    std::uint32_t nameOffset;
+    std::uint32_t nameLength;
+    std::uint32_t first;  // First position in the grouped record list
+    std::uint32_t count;
+};
+
+// Record collected while writing or scanning the reservation file
+struct ScannedRecord {
+    int reservationID;
+    std::uint32_t slot;  // Interned event name, or kRemovedSlot for a tombstone
+    std::uint64_t offset;
+};
+
+static const std::uint32_t kRemovedSlot = 0xffffffffu;
+
+// Record appended to the reservation file after its index was built
+struct TailRecord {
+    std::uint64_t offset;
+    std::string eventName;
+    bool removed;  // A tombstone: the reservation is gone
+};
+
+// Event names interned while scanning
+struct NameTable {
+    std::unordered_map<std::string, std::uint32_t> slots;
+    std::vector<std::string> names;
+
+    std::uint32_t intern(const std::string& name) {
+        auto it = slots.find(name);
+        if (it != slots.end()) return it->second;
+        std::uint32_t slot = static_cast<std::uint32_t>(names.size());
+        slots.emplace(name, slot);
+        names.push_back(name);
+        return slot;
+    }
+};
+
+// State of the open store
+struct StoreState {
+    bool isOpen = false;
+    std::string filename;
+    const std::map<std::string, User*>* users = nullptr;
+    const std::map<std::string, Event*>* events = nullptr;
+    size_t capacity = 0;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const IndexHeader* header = nullptr;
+    const IndexRecord* records = nullptr;
+    const IndexEvent* indexEvents = nullptr;
+    const std::uint32_t* grouped = nullptr;
+    const char* names = nullptr;
+
+    std::uint64_t dataSize = 0;           // Current size of the reservation file
+    std::map<int, TailRecord> tail;       // Records appended since, superseding the index
+    std::unordered_map<std::string, std::set<int>> tailEvents;  // IDs in tail by event name
+    size_t diskRecords = 0;               // Reservations the file holds, archived or resident
+    size_t staleLines = 0;                // Superseded lines and tombstones in the file
+    std::set<int> changedIDs;             // Reservations changed since the last save
+
+    std::unordered_set<int> loadedIDs;    // Reservations read from the file that are still resident
+    std::set<std::string> pinnedEvents;   // Events inside the active horizon, never evicted
+    std::list<std::string> lru;           // Paged-in events, most recently used first
+    std::map<std::string, std::pair<std::list<std::string>::iterator, size_t>> pagedEvents;  // Position in lru and reservation count
+    size_t pagedCount = 0;
+    int reservedID = 0;                   // IDs up to this one are taken outside the file (archive segments)
+};
+
+static StoreState state;
+
+// Reads the size and inode of a file
+static bool statFile(const std::string& filename, std::uint64_t& size, std::uint64_t& inode) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return false;
+    size = static_cast<std::uint64_t>(info.st_size);
+    inode = static_cast<std::uint64_t>(info.st_ino);
+    return true;
+}
+
+// Hashes (FNV-1a) the bytes of a file just before dataSize, or returns 0 if they cannot be read
+static std::uint64_t boundaryHash(const std::string& filename, std::uint64_t dataSize) {
+    std::uint64_t length = std::min(dataSize, kBoundaryBytes);
+    char bytes[kBoundaryBytes];
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open() || !file.seekg(static_cast<std::streamoff>(dataSize - length)) ||
+        !file.read(bytes, static_cast<std::streamsize>(length))) {
+        return 0;
+    }
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::uint64_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Extracts the reservation ID and event name from a line of the reservation file
+static bool parseKey(const std::string& line, int& reservationID, std::string& eventName) {
+    char* end = nullptr;
+    long id = std::strtol(line.c_str(), &end, 10);
+    if (end == line.c_str()) return false;
+    size_t userStart = line.find_first_not_of(' ', end - line.c_str());
+    size_t userEnd = line.find(' ', userStart);
+    if (userStart == std::string::npos || userEnd == std::string::npos) return false;
+    size_t eventStart = line.find_first_not_of(' ', userEnd);
+    if (eventStart == std::string::npos) return false;
+    size_t eventEnd = line.find(' ', eventStart);
+    eventName = line.substr(eventStart, eventEnd == std::string::npos ? std::string::npos : eventEnd - eventStart);
+    reservationID = static_cast<int>(id);
+    return true;
+}
+
+// Unmaps the current index
+static void unmapIndex() {
+    if (state.mapping) {
+        munmap(state.mapping, state.mappingSize);
+    }
+    state.mapping = nullptr;
+    state.mappingSize = 0;
+    state.header = nullptr;
+    state.records = nullptr;
+    state.indexEvents = nullptr;
+    state.grouped = nullptr;
+    state.names = nullptr;
+}
+
+// Maps the index of a reservation file, returning false if it is missing, corrupt or does not describe the file;
+// the lines appended after the part it covers are left to scanTail
+static bool mapIndex(const std::string& filename) {
+    std::uint64_t dataSize, dataInode;
+    if (!statFile(filename, dataSize, dataInode)) return false;
+    const std::string indexFilename = filename + ".idx";
+    int fd = ::open(indexFilename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(IndexHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const IndexHeader* header = static_cast<const IndexHeader*>(mapping);
+    size_t expected = sizeof(IndexHeader) + header->recordCount * sizeof(IndexRecord) + header->eventCount * sizeof(IndexEvent) +
+                      header->recordCount * sizeof(std::uint32_t) + header->namesSize;
+    if (std::memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 || expected != size || header->dataInode != dataInode ||
+        header->dataSize > dataSize || header->boundaryHash != boundaryHash(filename, header->dataSize)) {
+        munmap(mapping, size);
+        return false;
+    }
+
+    unmapIndex();
+    const char* base = static_cast<const char*>(mapping);
+    state.mapping = mapping;
+    state.mappingSize = size;
+    state.header = header;
+    state.records = reinterpret_cast<const IndexRecord*>(base + sizeof(IndexHeader));
+    state.indexEvents = reinterpret_cast<const IndexEvent*>(state.records + header->recordCount);
+    state.grouped = reinterpret_cast<const std::uint32_t*>(state.indexEvents + header->eventCount);
+    state.names = reinterpret_cast<const char*>(state.grouped + header->recordCount);
+    state.dataSize = header->dataSize;
+    state.tail.clear();
+    state.tailEvents.clear();
+    state.diskRecords = header->recordCount;
+    state.staleLines = header->staleLines;
+    return true;
+}
+
+// Returns the ID high-water mark of an index file, even one built for another version of the data file, or 0
+static int readHighWater(const std::string& indexFilename) {
+    std::ifstream file(indexFilename, std::ios::binary);
+    IndexHeader header;
+    // maxID sits at the same place in every index version
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), offsetof(IndexHeader, namesSize)) ||
+        std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic) - 1) != 0) {
+        return 0;
+    }
+    return header.maxID;
+}
+
+// Writes the index of the first dataSize bytes of a reservation file from their scanned records, keeping IDs up to highWater taken
+static bool writeIndex(const std::string& filename, std::vector<ScannedRecord>& scanned, const NameTable& nameTable,
+                       std::uint64_t dataSize, size_t staleLines, int highWater) {
+    std::uint64_t fileSize, dataInode;
+    if (!statFile(filename, fileSize, dataInode)) return false;
+    const std::string indexFilename = filename + ".idx";
+
+    // Number the events by name so lookups can binary search them
+    std::vector<std::uint32_t> byName(nameTable.names.size());
+    for (std::uint32_t i = 0; i < byName.size(); ++i) byName[i] = i;
+    std::sort(byName.begin(), byName.end(),
+              [&nameTable](std::uint32_t a, std::uint32_t b) { return nameTable.names[a] < nameTable.names[b]; });
+    std::vector<std::uint32_t> rank(byName.size());
+    for (std::uint32_t i = 0; i < byName.size(); ++i) rank[byName[i]] = i;
+
+    std::stable_sort(scanned.begin(), scanned.end(),
+                     [](const ScannedRecord& a, const ScannedRecord& b) { return a.reservationID < b.reservationID; });
+
+    IndexHeader header = {};
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.dataSize = dataSize;
+    header.dataInode = dataInode;
+    header.boundaryHash = boundaryHash(filename, dataSize);
+    header.staleLines = static_cast<std::uint32_t>(staleLines);
+    header.recordCount = static_cast<std::uint32_t>(scanned.size());
+    header.eventCount = static_cast<std::uint32_t>(byName.size());
+    // Canceled reservations leave the file, but their IDs stay taken: the journals refer to them
+    header.maxID = std::max(highWater, scanned.empty() ? 0 : scanned.back().reservationID);
+
+    std::vector<IndexRecord> records(scanned.size());
+    std::vector<IndexEvent> indexEvents(byName.size());
+    for (size_t i = 0; i < scanned.size(); ++i) {
+        records[i] = IndexRecord{scanned[i].reservationID, rank[scanned[i].slot], scanned[i].offset};
+        ++indexEvents[records[i].event].count;
+    }
+    std::string names;
+    std::uint32_t first = 0;
+    for (std::uint32_t i = 0; i < indexEvents.size(); ++i) {
+        const std::string& name = nameTable.names[byName[i]];
+        indexEvents[i].nameOffset = static_cast<std::uint32_t>(names.size());
+        indexEvents[i].nameLength = static_cast<std::uint32_t>(name.size());
+        indexEvents[i].first = first;
+        first += indexEvents[i].count;
+        names += name;
+    }
+    header.namesSize = static_cast<std::uint32_t>(names.size());
+    std::vector<std::uint32_t> grouped(records.size());
+    std::vector<std::uint32_t> filled(indexEvents.size(), 0);
+    for (std::uint32_t i = 0; i < records.size(); ++i) {
+        const IndexEvent& event = indexEvents[records[i].event];
+        grouped[event.first + filled[records[i].event]++] = i;
+    }
+
+    const std::string tempFilename = indexFilename + ".tmp";
+    std::ofstream file(tempFilename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << tempFilename << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(IndexRecord));
+    file.write(reinterpret_cast<const char*>(indexEvents.data()), indexEvents.size() * sizeof(IndexEvent));
+    file.write(reinterpret_cast<const char*>(grouped.data()), grouped.size() * sizeof(std::uint32_t));
+    file.write(names.data(), names.size());
+    file.close();
+    if (!file || std::rename(tempFilename.c_str(), indexFilename.c_str()) != 0) {
+        std::cerr << "Error: Unable to write file " << indexFilename << std::endl;
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Records of one chunk of the reservation file, with event names interned per chunk
+struct ScannedChunk {
+    std::vector<ScannedRecord> records;
+    NameTable nameTable;
+};
+
+// Scans the lines starting in [first, last) of the file contents
+static ScannedChunk scanChunk(const std::string& contents, size_t first, size_t last) {
+    ScannedChunk chunk;
+    std::string line, eventName;
+    while (first < last) {
+        size_t newline = contents.find('\n', first);
+        if (newline == std::string::npos) newline = contents.size();
+        line.assign(contents, first, newline - first);
+        int reservationID;
+        if (Reservation::parseTombstone(line, reservationID)) {
+            chunk.records.push_back(ScannedRecord{reservationID, kRemovedSlot, first});
+        } else if (parseKey(line, reservationID, eventName)) {
+            chunk.records.push_back(ScannedRecord{reservationID, chunk.nameTable.intern(eventName), first});
+        }
+        first = newline + 1;
+    }
+    return chunk;
+}
+
+// Keeps the last record of each reservation in file order, dropping the removed ones; returns the highest ID seen
+static int keepLatest(std::vector<ScannedRecord>& scanned) {
+    std::stable_sort(scanned.begin(), scanned.end(),
+                     [](const ScannedRecord& a, const ScannedRecord& b) { return a.reservationID < b.reservationID; });
+    int highest = scanned.empty() ? 0 : scanned.back().reservationID;
+    size_t kept = 0;
+    for (size_t i = 0; i < scanned.size(); ++i) {
+        bool last = i + 1 == scanned.size() || scanned[i + 1].reservationID != scanned[i].reservationID;
+        if (last && scanned[i].slot != kRemovedSlot) scanned[kept++] = scanned[i];
+    }
+    scanned.resize(kept);
+    return highest;
+}
+
+// Scans the reservation file and writes a fresh index for it
+static bool rebuildIndex(const std::string& filename) {
+    ScopedTimer timer(kBuildIndexMetric);
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    // Chunks of about 1 MB, cut after a newline, are scanned on the task pool and merged in file order
+    const size_t kChunkBytes = 1 << 20;
+    TaskPool& pool = TaskPool::shared();
+    std::vector<std::future<ScannedChunk>> chunks;
+    for (size_t first = 0; first < contents.size();) {
+        size_t last = std::min(contents.size(), first + kChunkBytes);
+        size_t newline = contents.find('\n', last == 0 ? 0 : last - 1);
+        last = newline == std::string::npos ? contents.size() : newline + 1;
+        chunks.push_back(pool.submit([&contents, first, last]() { return scanChunk(contents, first, last); }));
+        first = last;
+    }
+    std::vector<ScannedRecord> scanned;
+    NameTable nameTable;
+    for (std::future<ScannedChunk>& future : chunks) {
+        ScannedChunk chunk = pool.wait(future);
+        std::vector<std::uint32_t> slots;
+        for (const std::string& name : chunk.nameTable.names) {
+            slots.push_back(nameTable.intern(name));
+        }
+        for (ScannedRecord& record : chunk.records) {
+            if (record.slot != kRemovedSlot) record.slot = slots[record.slot];
+            scanned.push_back(record);
+        }
+    }
+    size_t lines = scanned.size();
+    int highWater = std::max(readHighWater(filename + ".idx"), keepLatest(scanned));
+    return writeIndex(filename, scanned, nameTable, contents.size(), lines - scanned.size(), highWater) && mapIndex(filename);
+}
+
+// Finds an event in the index, or nullptr
+static const IndexEvent* findIndexEvent(const std::string& eventName) {
+    if (!state.header) return nullptr;
+    const IndexEvent* begin = state.indexEvents;
+    const IndexEvent* end = begin + state.header->eventCount;
+    const IndexEvent* found = std::lower_bound(begin, end, eventName, [](const IndexEvent& event, const std::string& name) {
+        return std::string_view(state.names + event.nameOffset, event.nameLength) < name;
+    });
+    if (found == end || std::string_view(state.names + found->nameOffset, found->nameLength) != eventName) return nullptr;
+    return found;
+}
+
+// Finds a reservation in the index, or nullptr (the tail may hold a newer record)
+static const IndexRecord* findIndexRecord(int reservationID) {
+    if (!state.header) return nullptr;
+    const IndexRecord* begin = state.records;
+    const IndexRecord* end = begin + state.header->recordCount;
+    const IndexRecord* found = std::lower_bound(begin, end, reservationID,
+                                                [](const IndexRecord& record, int id) { return record.reservationID < id; });
+    return found == end || found->reservationID != reservationID ? nullptr : found;
+}
+
+// Checks if the file currently holds a record of a reservation
+static bool onDisk(int reservationID) {
+    auto appended = state.tail.find(reservationID);
+    if (appended != state.tail.end()) return !appended->second.removed;
+    return findIndexRecord(reservationID) != nullptr;
+}
+
+// Accounts for a record appended to the file after the part the index covers
+static void recordAppended(int reservationID, TailRecord record) {
+    bool wasOnDisk = onDisk(reservationID);
+    state.staleLines += (wasOnDisk ? 1 : 0) + (record.removed ? 1 : 0);
+    if (record.removed) {
+        state.diskRecords -= wasOnDisk ? 1 : 0;
+    } else {
+        state.diskRecords += wasOnDisk ? 0 : 1;
+        state.tailEvents[record.eventName].insert(reservationID);
+    }
+    auto previous = state.tail.find(reservationID);
+    if (previous != state.tail.end() && !previous->second.removed && previous->second.eventName != record.eventName) {
+        state.tailEvents[previous->second.eventName].erase(reservationID);
+    }
+    state.tail[reservationID] = std::move(record);
+}
+
+// Reads the lines appended after the part of the file the index covers
+static bool scanTail() {
+    std::ifstream file(state.filename, std::ios::binary);
+    if (!file.is_open() || !file.seekg(static_cast<std::streamoff>(state.dataSize))) {
+        std::cerr << "Error: Unable to open file " << state.filename << std::endl;
+        return false;
+    }
+    std::string line, eventName;
+    while (getline(file, line)) {
+        int reservationID;
+        std::uint64_t offset = state.dataSize;
+        state.dataSize += line.size() + (file.eof() ? 0 : 1);
+        if (Reservation::parseTombstone(line, reservationID)) {
+            recordAppended(reservationID, TailRecord{offset, std::string(), true});
+        } else if (parseKey(line, reservationID, eventName)) {
+            recordAppended(reservationID, TailRecord{offset, eventName, false});
+        }
+    }
+    return true;
+}
+
+// Reads the lines at the given offsets and adds the reservations that are not resident yet, returning how many were added
+static size_t loadOffsets(std::vector<std::uint64_t>& offsets, std::map<int, Reservation*>& reservations) {
+    std::sort(offsets.begin(), offsets.end());
+    std::ifstream file(state.filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << state.filename << std::endl;
+        return 0;
+    }
+    size_t loaded = 0;
+    std::string line;
+    for (std::uint64_t offset : offsets) {
+        file.seekg(static_cast<std::streamoff>(offset));
+        if (!getline(file, line)) {
+            file.clear();
+            continue;
+        }
+        // Already resident (e.g. created after the index was built): keep the live object, which also holds its seats;
+        // changed but not resident means destroyed and not saved yet
+        int reservationID = std::atoi(line.c_str());
+        if (reservations.count(reservationID) || state.changedIDs.count(reservationID)) continue;
+        Reservation* reservation = Reservation::parseRecord(line, *state.users, *state.events);
+        if (!reservation) continue;
+        state.changedIDs.erase(reservation->getReservationID());  // Read, not changed
+        reservations[reservation->getReservationID()] = reservation;
+        state.loadedIDs.insert(reservation->getReservationID());
+        HoldExpiry::track(reservation);  // Its timer was skipped when it was evicted
+        ++loaded;
+    }
+    return loaded;
+}
+
+// Collects the offsets of the archived reservations of an event, returning false if the file holds none of its records
+static bool collectOffsets(const std::string& eventName, const std::map<int, Reservation*>& reservations, std::vector<std::uint64_t>& offsets) {
+    const IndexEvent* event = findIndexEvent(eventName);
+    if (event) {
+        for (std::uint32_t i = event->first; i < event->first + event->count; ++i) {
+            const IndexRecord& record = state.records[state.grouped[i]];
+            if (!reservations.count(record.reservationID) && !state.tail.count(record.reservationID)) {
+                offsets.push_back(record.offset);
+            }
+        }
+    }
+    auto appended = state.tailEvents.find(eventName);
+    if (appended == state.tailEvents.end()) return event != nullptr;
+    for (int reservationID : appended->second) {
+        const TailRecord& record = state.tail.at(reservationID);
+        if (!record.removed && !reservations.count(reservationID)) {
+            offsets.push_back(record.offset);
+        }
+    }
+    return true;
+}
+
+// Appends the changed reservations to the file: their current record, or a tombstone for the ones that are gone
+static bool appendChanges(const std::map<int, Reservation*>& reservations) {
+    if (state.changedIDs.empty()) return true;
+    std::string journal;
+    std::vector<std::pair<int, TailRecord>> appended;
+    // A last line without its newline (e.g. edited by hand) must not swallow the first appended record
+    std::ifstream input(state.filename, std::ios::binary);
+    char last = '\n';
+    if (state.dataSize > 0 && input.seekg(static_cast<std::streamoff>(state.dataSize - 1)) && input.get(last) && last != '\n') {
+        journal += '\n';
+    }
+    input.close();
+    for (int reservationID : state.changedIDs) {
+        auto resident = reservations.find(reservationID);
+        if (resident == reservations.end()) {
+            // Created and dropped between two saves: the file never saw it
+            if (!onDisk(reservationID)) continue;
+            appended.emplace_back(reservationID, TailRecord{state.dataSize + journal.size(), std::string(), true});
+            journal += Reservation::formatTombstone(reservationID);
+        } else {
+            appended.emplace_back(reservationID, TailRecord{state.dataSize + journal.size(), resident->second->getEvent()->getEventName(), false});
+            journal += resident->second->formatRecord();
+        }
+        journal += '\n';
+    }
+    std::ofstream output(state.filename, std::ios::app);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open file " << state.filename << std::endl;
+        return false;
+    }
+    output << journal;
+    output.close();
+    if (!output) {
+        std::cerr << "Error: Unable to write file " << state.filename << std::endl;
+        return false;
+    }
+
+    state.dataSize += journal.size();
+    for (auto& pair : appended) {
+        if (pair.second.removed) {
+            state.loadedIDs.erase(pair.first);
+        } else {
+            state.loadedIDs.insert(pair.first);
+        }
+        recordAppended(pair.first, std::move(pair.second));
+    }
+    state.changedIDs.clear();
+    return true;
+}
+
+// Writes a new index covering the appended lines as well, without touching the reservation file
+static bool foldTail(int highWater) {
+    std::vector<ScannedRecord> scanned;
+    NameTable nameTable;
+    for (std::uint32_t i = 0; state.header && i < state.header->recordCount; ++i) {
+        const IndexRecord& record = state.records[i];
+        if (state.tail.count(record.reservationID)) continue;
+        const IndexEvent& event = state.indexEvents[record.event];
+        std::string eventName(state.names + event.nameOffset, event.nameLength);
+        scanned.push_back(ScannedRecord{record.reservationID, nameTable.intern(eventName), record.offset});
+    }
+    for (const auto& pair : state.tail) {
+        if (!pair.second.removed) {
+            scanned.push_back(ScannedRecord{pair.first, nameTable.intern(pair.second.eventName), pair.second.offset});
+        }
+    }
+    return writeIndex(state.filename, scanned, nameTable, state.dataSize, state.staleLines, highWater) && mapIndex(state.filename);
+}
+
+// Drops the resident reservations of a paged-in event
+static void evictEvent(const std::string& eventName, std::map<int, Reservation*>& reservations) {
+    auto paged = state.pagedEvents.find(eventName);
+    if (paged == state.pagedEvents.end()) return;
+    state.lru.erase(paged->second.first);
+    state.pagedCount -= std::min(state.pagedCount, paged->second.second);
+    state.pagedEvents.erase(paged);
+
+    auto event = state.events->find(eventName);
+    if (event == state.events->end()) return;
+    const std::vector<Reservation*> resident = event->second->getReservations();
+    for (Reservation* reservation : resident) {
+        int reservationID = reservation->getReservationID();
+        reservations.erase(reservationID);
+        state.loadedIDs.erase(reservationID);
+        Reservation::destroy(reservation);
+        state.changedIDs.erase(reservationID);  // Saved before eviction; dropping it from memory is no change
+    }
+}
+
+// Writes the resident reservations merged with the archived ones of the open file, recording where each line went;
+// returns the number of bytes written
+static std::uint64_t writeMerged(std::ofstream& output, const std::map<int, Reservation*>& reservations, std::vector<ScannedRecord>& scanned,
+                        NameTable& nameTable) {
+    std::ifstream input(state.filename);
+    std::unordered_map<int, std::uint64_t> latest;
+    if (input.is_open()) {
+        latest = ReservationStore::latestRecords(input);
+        input.clear();
+        input.seekg(0);
+    }
+    std::unordered_set<int> written;
+    std::uint64_t offset = 0;
+    auto writeLine = [&](const std::string& line, int reservationID, const std::string& eventName) {
+        output << line << '\n';
+        scanned.push_back(ScannedRecord{reservationID, nameTable.intern(eventName), offset});
+        offset += line.size() + 1;
+    };
+
+    // Keep the file order: resident records are rewritten, archived ones copied, superseded and deleted ones dropped
+    std::string line, eventName;
+    std::uint64_t inputOffset = 0;
+    while (input.is_open() && getline(input, line)) {
+        int reservationID;
+        std::uint64_t lineOffset = inputOffset;
+        inputOffset += line.size() + 1;
+        if (!parseKey(line, reservationID, eventName) || latest[reservationID] != lineOffset) continue;
+        auto resident = reservations.find(reservationID);
+        if (resident != reservations.end()) {
+            if (written.insert(reservationID).second) {
+                writeLine(resident->second->formatRecord(), reservationID, resident->second->getEvent()->getEventName());
+            }
+        } else if (!state.loadedIDs.count(reservationID)) {
+            writeLine(line, reservationID, eventName);
+        }
+    }
+    for (const auto& pair : reservations) {
+        if (!written.count(pair.first)) {
+            writeLine(pair.second->formatRecord(), pair.first, pair.second->getEvent()->getEventName());
+        }
+    }
+    return offset;
+}
+
+// Opens a reservation file, loading the reservations of events ending at or after horizonStart
+std::map<int, Reservation*> ReservationStore::open(const std::string& filename, const std::map<std::string, User*>& users,
+                                                   const std::map<std::string, Event*>& events, long long horizonStart, size_t capacity) {
+    close();
+    std::map<int, Reservation*> reservations;
+    state.filename = filename;
+    state.users = &users;
+    state.events = &events;
+    state.capacity = capacity;
+
+    std::ifstream probe(filename);
+    if (!probe.is_open()) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return reservations;
+    }
+    probe.close();
+    if (!(mapIndex(filename) && scanTail()) && !rebuildIndex(filename)) {
+        // Without an index fall back to loading everything
+        return Reservation::loadReservations(filename, users, events);
+    }
+    state.isOpen = true;
+
+    std::vector<std::uint64_t> offsets;
+    for (const auto& pair : events) {
+        long long end;
+        if (parseTimestamp(pair.second->getEndTime(), end) && end < horizonStart) continue;
+        state.pinnedEvents.insert(pair.first);
+        collectOffsets(pair.first, reservations, offsets);
+    }
+    loadOffsets(offsets, reservations);
+    return reservations;
+}
+
+// Releases the index
+void ReservationStore::close() {
+    unmapIndex();
+    state = StoreState();
+}
+
+// Checks if a file is paged by the store
+bool ReservationStore::isOpen(const std::string& filename) {
+    return state.isOpen && state.filename == filename;
+}
+
+// Pages in the archived reservations of an event, returning how many were loaded
+size_t ReservationStore::pageInEvent(const std::string& eventName, std::map<int, Reservation*>& reservations) {
+    if (!state.isOpen || state.pinnedEvents.count(eventName)) return 0;
+    auto paged = state.pagedEvents.find(eventName);
+    if (paged != state.pagedEvents.end()) {
+        state.lru.splice(state.lru.begin(), state.lru, paged->second.first);
+        return 0;
+    }
+    std::vector<std::uint64_t> offsets;
+    if (!collectOffsets(eventName, reservations, offsets)) return 0;
+
+    ScopedTimer timer(kPageInMetric);
+    size_t loaded = loadOffsets(offsets, reservations);
+    state.lru.push_front(eventName);
+    state.pagedEvents[eventName] = std::make_pair(state.lru.begin(), loaded);
+    state.pagedCount += loaded;
+
+    // Keep the event just paged in even if it alone exceeds the bound; unsaved changes go to the file before anything is dropped
+    while (state.pagedCount > state.capacity && state.lru.size() > 1 && appendChanges(reservations)) {
+        evictEvent(state.lru.back(), reservations);
+    }
+    return loaded;
+}
+
+// Pages in the archived reservations of the event a reservation belongs to
+size_t ReservationStore::pageInReservation(int reservationID, std::map<int, Reservation*>& reservations) {
+    if (!state.isOpen || !state.header || reservations.count(reservationID)) return 0;
+    auto appended = state.tail.find(reservationID);
+    if (appended != state.tail.end()) {
+        return appended->second.removed ? 0 : pageInEvent(appended->second.eventName, reservations);
+    }
+    const IndexRecord* found = findIndexRecord(reservationID);
+    if (!found) return 0;
+    const IndexEvent& event = state.indexEvents[found->event];
+    return pageInEvent(std::string(state.names + event.nameOffset, event.nameLength), reservations);
+}
+
+// Returns the highest reservation ID ever handed out: in memory, on disk or recorded by the index
+int ReservationStore::maxReservationID(const std::map<int, Reservation*>& reservations) {
+    int maxID = reservations.empty() ? 0 : reservations.rbegin()->first;
+    maxID = std::max(maxID, state.reservedID);
+    if (state.isOpen && state.header) {
+        maxID = std::max(maxID, static_cast<int>(state.header->maxID));
+    }
+    // Tombstones keep the IDs of appended reservations taken as well
+    if (state.isOpen && !state.tail.empty()) {
+        maxID = std::max(maxID, state.tail.rbegin()->first);
+    }
+    return maxID;
+}
+
+// Keeps IDs up to maxID from being handed out again
+void ReservationStore::reserveIDs(int maxID) {
+    state.reservedID = std::max(state.reservedID, maxID);
+}
+
+// Returns the number of reservations on disk that are not resident
+size_t ReservationStore::archivedCount() {
+    if (!state.isOpen || !state.header) return 0;
+    return state.diskRecords > state.loadedIDs.size() ? state.diskRecords - state.loadedIDs.size() : 0;
+}
+
+// Notes that a reservation changed, so the next save appends it
+void ReservationStore::noteChange(int reservationID) {
+    if (state.isOpen) state.changedIDs.insert(reservationID);
+}
+
+// Finds the line holding the current record of each reservation
+std::unordered_map<int, std::uint64_t> ReservationStore::latestRecords(std::istream& input) {
+    std::unordered_map<int, std::uint64_t> latest;
+    std::string line, eventName;
+    std::uint64_t offset = 0;
+    while (getline(input, line)) {
+        int reservationID;
+        if (Reservation::parseTombstone(line, reservationID) || parseKey(line, reservationID, eventName)) {
+            latest[reservationID] = offset;
+        }
+        offset += line.size() + 1;
+    }
+    return latest;
+}
+
+// Saves the changed reservations, appending them until the stale lines outnumber the records
+bool ReservationStore::save(const std::string& filename, const std::map<int, Reservation*>& reservations) {
+    if (!isOpen(filename)) return false;
+    if (state.staleLines <= std::max(kMinCompactLines, state.diskRecords)) {
+        // Once the appended lines outnumber the indexed records, the index is rewritten to cover them
+        if (appendChanges(reservations) && state.tail.size() > std::max(kMinFoldLines, state.header ? state.header->recordCount : size_t(0)) &&
+            !foldTail(maxReservationID(reservations))) {
+            std::cerr << "Error: Reservation index could not be updated." << std::endl;
+        }
+        return true;
+    }
+
+    const std::string tempFilename = filename + ".tmp";
+    std::ofstream output(tempFilename);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open file " << tempFilename << std::endl;
+        return true;
+    }
+    std::vector<ScannedRecord> scanned;
+    NameTable nameTable;
+    std::uint64_t dataSize = writeMerged(output, reservations, scanned, nameTable);
+    output.close();
+    if (!output || std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Error: Unable to write file " << filename << std::endl;
+        std::remove(tempFilename.c_str());
+        return true;
+    }
+
+    // Every resident reservation is now on disk
+    state.loadedIDs.clear();
+    for (const auto& pair : reservations) {
+        state.loadedIDs.insert(pair.first);
+    }
+    state.changedIDs.clear();
+    if (!writeIndex(filename, scanned, nameTable, dataSize, 0, maxReservationID(reservations)) || !mapIndex(filename)) {
+        std::cerr << "Error: Reservation index could not be updated." << std::endl;
+    }
+    return true;
+}
+
+// Writes every reservation, resident or archived, to another file without touching the store
+bool ReservationStore::exportTo(const std::string& target, const std::map<int, Reservation*>& reservations) {
+    if (!state.isOpen) return false;
+    std::ofstream output(target);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open file " << target << std::endl;
+        return false;
+    }
+    std::vector<ScannedRecord> scanned;
+    NameTable nameTable;
+    writeMerged(output, reservations, scanned, nameTable);
+    output.close();
+    return static_cast<bool>(output);
+}
@@ -1,63 +1,331 @@
 #include "Schedule.hpp"
+#include "Metrics.hpp"
+#include "TimeUtils.hpp"
+#include "RenderCache.hpp"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <set>
+
+static const int kCheckAvailabilityMetric = Metrics::registerMetric("check_availability");
+static const int kFindEventMetric = Metrics::registerMetric("find_event");
 
 // Adds an event to the schedule
 void Schedule::addEvent(Event* event) {
-    events.push_back(event);
+    events[event->getEventName()] = event;
+    indexEvent(event);
 }
 
 // Removes an event from the schedule
-void Schedule::removeEvent(int eventID) {
-    // Implement event removal logic
+void Schedule::removeEvent(const Event* event) {
+    auto it = events.find(event->getEventName());
+    if (it != events.end() && it->second == event) {
+        events.erase(it);
+    }
+    unindexEvent(event);
     std::cout << "Event removed." << std::endl;
 }
 
+// Removes every event and recurring series from the schedule
+void Schedule::clear() {
+    events.clear();
+    calendar.clear();
+    undatedEvents.clear();
+    durations.clear();
+    recurringEvents.clear();
+}
+
+// Moves an event to new times, keeping the day index sorted
+void Schedule::rescheduleEvent(Event* event, const std::string& startTime, const std::string& endTime) {
+    unindexEvent(event);
+    event->reschedule(startTime, endTime);
+    indexEvent(event);
+}
+
+// Adds an event to the day index, or to the undated events if its times do not parse
+void Schedule::indexEvent(Event* event) {
+    // An event joining a day changes that day's view even if the event itself is unchanged
+    event->markChanged();
+    long long start, end;
+    if (!parseTimestamp(event->getStartTime(), start) || !parseTimestamp(event->getEndTime(), end)) {
+        undatedEvents.push_back(event);
+        return;
+    }
+    std::vector<CalendarEntry>& bucket = calendar[dayOfMinute(start)];
+    auto position = std::upper_bound(bucket.begin(), bucket.end(), start,
+                                     [](long long value, const CalendarEntry& entry) { return value < entry.start; });
+    bucket.insert(position, CalendarEntry{start, end, event});
+    // An end before the start reaches no earlier day
+    durations.insert(std::max(0LL, end - start));
+}
+
+// Removes an event from the day index and the undated events
+void Schedule::unindexEvent(const Event* event) {
+    undatedEvents.erase(std::remove(undatedEvents.begin(), undatedEvents.end(), event), undatedEvents.end());
+    long long start;
+    if (parseTimestamp(event->getStartTime(), start)) {
+        auto bucket = calendar.find(dayOfMinute(start));
+        if (bucket != calendar.end()) {
+            std::vector<CalendarEntry>& entries = bucket->second;
+            auto removed = std::remove_if(entries.begin(), entries.end(), [event](const CalendarEntry& entry) { return entry.event == event; });
+            for (auto it = removed; it != entries.end(); ++it) {
+                auto duration = durations.find(std::max(0LL, it->end - it->start));
+                if (duration != durations.end()) durations.erase(duration);
+            }
+            entries.erase(removed, entries.end());
+            if (entries.empty()) {
+                calendar.erase(bucket);
+            }
+        }
+    }
+}
+
+// Returns the events overlapping [start, end) in start order
+std::vector<Event*> Schedule::eventsBetween(long long start, long long end) const {
+    std::vector<Event*> found;
+    // Events starting up to the longest duration earlier can still reach into the range
+    auto bucket = calendar.lower_bound(dayOfMinute(start - getLongestEvent()));
+    for (; bucket != calendar.end() && bucket->first * kMinutesPerDay < end; ++bucket) {
+        for (const CalendarEntry& entry : bucket->second) {
+            if (entry.start >= end) break;
+            if (entry.end > start) {
+                found.push_back(entry.event);
+            }
+        }
+    }
+    return found;
+}
+
+// Returns the first event overlapping [start, end), without collecting the others
+Event* Schedule::firstEventBetween(long long start, long long end) const {
+    auto bucket = calendar.lower_bound(dayOfMinute(start - getLongestEvent()));
+    for (; bucket != calendar.end() && bucket->first * kMinutesPerDay < end; ++bucket) {
+        for (const CalendarEntry& entry : bucket->second) {
+            if (entry.start >= end) break;
+            if (entry.end > start) {
+                return entry.event;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Returns the events indexed by start day
+const std::map<long long, std::vector<Schedule::CalendarEntry>>& Schedule::getCalendar() const {
+    return calendar;
+}
+
+// Returns the events whose times could not be parsed
+const std::vector<Event*>& Schedule::getUndatedEvents() const {
+    return undatedEvents;
+}
+
+// Returns the longest duration of an indexed event in minutes
+long long Schedule::getLongestEvent() const {
+    return durations.empty() ? 0 : *durations.rbegin();
+}
+
+// Views the events of the days [firstDay, lastDay], one line per event
+void Schedule::viewScheduleRange(long long firstDay, long long lastDay) const {
+    SnapshotStore::ReadGuard snapshot = snapshots.read();
+    long long rangeStart = firstDay * kMinutesPerDay;
+    long long rangeEnd = (lastDay + 1) * kMinutesPerDay;
+
+    // Days with an event or occurrence starting in the range; whatever started earlier but reaches into it is listed under the first day
+    std::set<long long> days;
+    struct Line {
+        long long start;
+        long long end;
+        std::string name;
+        int ticketsSold;
+        int maxGuests;
+    };
+    std::vector<Line> earlier;
+    for (const EventSnapshot* event : snapshot->eventsBetween(rangeStart, rangeEnd)) {
+        if (event->startMinute < rangeStart) {
+            earlier.push_back(Line{event->startMinute, event->endMinute, event->eventName, event->ticketsSold, event->maxGuests});
+        } else {
+            days.insert(dayOfMinute(event->startMinute));
+        }
+    }
+    for (const auto& series : snapshot->recurringEvents) {
+        for (long long start : series->occurrencesBetween(rangeStart, rangeEnd)) {
+            if (start < rangeStart) {
+                earlier.push_back(Line{start, start + series->getDuration(),
+                                       RecurringEvent::occurrenceName(series->getEventName(), formatDate(dayOfMinute(start))), -1, series->getMaxGuests()});
+            } else {
+                days.insert(dayOfMinute(start));
+            }
+        }
+    }
+    std::stable_sort(earlier.begin(), earlier.end(), [](const Line& a, const Line& b) { return a.start < b.start; });
+
+    std::cout << "Schedule from " << formatDate(firstDay) << " to " << formatDate(lastDay) << ":" << std::endl;
+    if (earlier.empty() && days.empty()) {
+        std::cout << "No events scheduled." << std::endl;
+        return;
+    }
+    if (!earlier.empty()) {
+        std::cout << formatDate(firstDay) << std::endl;
+        for (const Line& line : earlier) {
+            printScheduleLine(line.start, line.end, line.name, line.ticketsSold, line.maxGuests);
+        }
+    }
+    // Each day's block is rendered once per change of that day
+    for (long long day : days) {
+        std::shared_ptr<const std::string> block = RenderCache::dayView(*snapshot, day);
+        size_t skip = (day == firstDay && !earlier.empty()) ? block->find('\n') + 1 : 0;  // The first day's date is already printed
+        std::cout.write(block->data() + skip, static_cast<std::streamsize>(block->size() - skip));
+    }
+    std::cout.flush();
+}
+
 // Views the current schedule
 void Schedule::viewSchedule() const {
+    SnapshotStore::ReadGuard snapshot = snapshots.read();
     std::cout << "Viewing schedule." << std::endl;
-    if (events.empty()) {
+    if (snapshot->events.empty()) {
         std::cout << "No events scheduled." << std::endl;
     } else {
-        for (const auto& event : events) {
-            event->getEventDetails();
+        for (const auto& event : snapshot->events) {
+            std::cout << *RenderCache::eventDetails(*event);
+        }
+        std::cout.flush();
+    }
+}
+
+// Publishes a snapshot of the schedule and reservations for readers
+void Schedule::publishSnapshot(const std::map<int, Reservation*>& reservations) {
+    // Publish events in start order so snapshot range queries can use the day index
+    std::vector<Event*> ordered;
+    ordered.reserve(events.size());
+    for (const auto& bucket : calendar) {
+        for (const CalendarEntry& entry : bucket.second) {
+            ordered.push_back(entry.event);
         }
     }
+    ordered.insert(ordered.end(), undatedEvents.begin(), undatedEvents.end());
+    // The current snapshot stays pinned while the new one is built from it
+    SnapshotStore::ReadGuard previous = snapshots.read();
+    snapshots.publish(ScheduleSnapshot::build(ordered, recurringEvents, reservations, *previous));
+}
+
+// Returns the snapshot store readers pin snapshots from
+const SnapshotStore& Schedule::getSnapshots() const {
+    return snapshots;
 }
 
 // Checks if a time slot is available
 bool Schedule::checkAvailability(const std::string& startTime, const std::string& endTime) const {
+    ScopedTimer timer(kCheckAvailabilityMetric);
+    std::cout << "Checking availability." << std::endl;
+    long long newStart, newEnd;
+    if (!parseTimestamp(startTime, newStart) || !parseTimestamp(endTime, newEnd)) {
+        std::cout << "Invalid time format. Use YYYY-MM-DDTHH:MM." << std::endl;
+        return false;
+    }
+
+    // Only the day buckets that can reach the requested slot are visited
+    if (const Event* overlapping = firstEventBetween(newStart, newEnd)) {
+        std::cout << "Time slot is not available due to overlap with event: " << overlapping->getEventName() << std::endl;
+        return false;
+    }
+
+    // Recurring series are checked arithmetically, whatever their number of occurrences
+    for (const auto& pair : recurringEvents) {
+        long long occurrenceStart;
+        if (pair.second->overlaps(newStart, newEnd, &occurrenceStart)) {
+            int year, month, day;
+            civilFromDays(dayOfMinute(occurrenceStart), year, month, day);
+            // Same text as RecurringEvent::occurrenceName, streamed piecewise
+            std::cout << "Time slot is not available due to overlap with event: " << pair.first << '@' << std::setfill('0')
+                      << std::setw(4) << year << '-' << std::setw(2) << month << '-' << std::setw(2) << day << std::setfill(' ') << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks if no occurrence of a new series overlaps the schedule
+bool Schedule::checkRecurringAvailability(const RecurringEvent& series) const {
     std::cout << "Checking availability." << std::endl;
-    std::tm newStartTime = {};
-    std::tm newEndTime = {};
-    std::istringstream newStartTimeStream(startTime);
-    std::istringstream newEndTimeStream(endTime);
-    newStartTimeStream >> std::get_time(&newStartTime, "%Y-%m-%dT%H:%M");
-    newEndTimeStream >> std::get_time(&newEndTime, "%Y-%m-%dT%H:%M");
-
-    for (const auto& event : events) {
-        std::tm eventStartTime = {};
-        std::tm eventEndTime = {};
-        std::istringstream eventStartTimeStream(event->getStartTime());
-        std::istringstream eventEndTimeStream(event->getEndTime());
-        eventStartTimeStream >> std::get_time(&eventStartTime, "%Y-%m-%dT%H:%M");
-        eventEndTimeStream >> std::get_time(&eventEndTime, "%Y-%m-%dT%H:%M");
-
-        if (mktime(&newStartTime) < mktime(&eventEndTime) && mktime(&newEndTime) > mktime(&eventStartTime)) {
-            std::cout << "Time slot is not available due to overlap with event: " << event->getEventName() << std::endl;
+    for (const auto& pair : events) {
+        const Event* event = pair.second;
+        long long eventStart, eventEnd, occurrenceStart;
+        if (!parseTimestamp(event->getStartTime(), eventStart) || !parseTimestamp(event->getEndTime(), eventEnd)) {
+            continue;
+        }
+        if (series.overlaps(eventStart, eventEnd, &occurrenceStart)) {
+            std::cout << "Occurrence on " << formatDate(dayOfMinute(occurrenceStart)) << " overlaps with event: " << event->getEventName() << std::endl;
             return false;
         }
     }
+
+    // Walk the new series' occurrences against the other series; open-ended series are checked two years ahead
+    long long firstStart;
+    parseTimestamp(series.getStartTime(), firstStart);
+    long long horizon = firstStart + 2 * 366 * kMinutesPerDay;
+    for (long long occurrence = series.nextOccurrence(firstStart); occurrence >= 0 && occurrence < horizon;
+         occurrence = series.nextOccurrence(occurrence + 1)) {
+        for (const auto& pair : recurringEvents) {
+            if (pair.second->overlaps(occurrence, occurrence + series.getDuration())) {
+                std::cout << "Occurrence on " << formatDate(dayOfMinute(occurrence)) << " overlaps with recurring event: " << pair.first << std::endl;
+                return false;
+            }
+        }
+    }
     return true;
 }
 
+// Adds a recurring event series to the schedule
+void Schedule::addRecurringEvent(RecurringEvent* series) {
+    recurringEvents[series->getEventName()] = series;
+    series->markChanged();
+}
+
+// Finds a recurring event series by name
+RecurringEvent* Schedule::findRecurringEvent(const std::string& seriesName) const {
+    auto it = recurringEvents.find(seriesName);
+    return it != recurringEvents.end() ? it->second : nullptr;
+}
+
+// Returns all recurring event series
+const std::map<std::string, RecurringEvent*>& Schedule::getRecurringEvents() const {
+    return recurringEvents;
+}
+
+// Checks if a name refers to a not yet materialized occurrence
+bool Schedule::findOccurrence(const std::string& occurrenceName, RecurringEvent*& series, long long& occurrenceStart) const {
+    std::string seriesName, date;
+    long long day;
+    if (!RecurringEvent::splitOccurrenceName(occurrenceName, seriesName, date) || !parseDate(date, day)) {
+        return false;
+    }
+    series = findRecurringEvent(seriesName);
+    return series && series->occursOn(day, occurrenceStart);
+}
+
+// Turns an occurrence into a standalone event in the schedule
+Event* Schedule::materializeOccurrence(const std::string& occurrenceName) {
+    RecurringEvent* series;
+    long long occurrenceStart;
+    if (!findOccurrence(occurrenceName, series, occurrenceStart)) {
+        return nullptr;
+    }
+    Event* event = series->materialize(formatDate(dayOfMinute(occurrenceStart)));
+    if (event) {
+        addEvent(event);
+    }
+    return event;
+}
+
 // Finds an event by name
 Event* Schedule::findEvent(const std::string& eventName) const {
-    for (const auto& event : events) {
-        if (event->getEventName() == eventName) {
-            return event;
-        }
+    ScopedTimer timer(kFindEventMetric);
+    auto it = events.find(eventName);
+    if (it != events.end()) {
+        return it->second;
     }
     std::cout << "Event " << eventName << " not found." << std::endl;
     return nullptr;
@@ -0,0 +1,235 @@
+#include "ScheduleAudit.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include "TaskPool.hpp"
+#include <chrono>
+#include <algorithm>
+
+static const int kAuditMetric = Metrics::registerMetric("audit");
+
+// Day bucket of the schedule calendar
+struct AuditDay {
+    long long day;
+    const std::vector<Schedule::CalendarEntry>* entries;
+};
+
+// Minutes an organizer booked in one week
+struct WeekTotal {
+    const User* organizer;
+    long long weekStart;
+    long long minutes;
+};
+
+// Findings of one worker, merged in worker order afterwards
+struct AuditPartial {
+    std::vector<std::pair<const Event*, const Event*>> overlaps;
+    std::vector<const Event*> outsideOperatingHours;
+    std::vector<WeekTotal> weekTotals;  // Per organizer and week, weeks in order
+    std::vector<const Reservation*> reservationsOutsideEvent;
+};
+
+// Sweeps the days [firstDay, lastDay) and checks the reservations [firstReservation, lastReservation)
+static void auditRange(const std::vector<AuditDay>& days, size_t firstDay, size_t lastDay, long long longestEvent,
+                       const std::vector<const Reservation*>& reservations, size_t firstReservation, size_t lastReservation,
+                       AuditPartial& partial) {
+    // Events still running when the sweep starts
+    std::vector<Schedule::CalendarEntry> active;
+    if (firstDay < lastDay) {
+        long long rangeStart = days[firstDay].day * kMinutesPerDay;
+        for (size_t i = firstDay; i-- > 0;) {
+            // Nothing starting on this day or earlier can reach the range
+            if ((days[i].day + 1) * kMinutesPerDay + longestEvent <= rangeStart) break;
+            for (const Schedule::CalendarEntry& entry : *days[i].entries) {
+                if (entry.end > rangeStart) active.push_back(entry);
+            }
+        }
+        std::sort(active.begin(), active.end(),
+                  [](const Schedule::CalendarEntry& a, const Schedule::CalendarEntry& b) { return a.start < b.start; });
+    }
+
+    // Days are visited in order, so weekly totals only need a small map for the current week
+    std::map<const User*, long long> weekMinutes;
+    long long currentWeek = 0;
+    for (size_t i = firstDay; i < lastDay; ++i) {
+        long long weekStart = days[i].day - weekdayFromDays(days[i].day);
+        if (weekStart != currentWeek) {
+            for (const auto& pair : weekMinutes) {
+                partial.weekTotals.push_back(WeekTotal{pair.first, currentWeek, pair.second});
+            }
+            weekMinutes.clear();
+            currentWeek = weekStart;
+        }
+        for (const Schedule::CalendarEntry& entry : *days[i].entries) {
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [&entry](const Schedule::CalendarEntry& other) { return other.end <= entry.start; }),
+                         active.end());
+            for (const Schedule::CalendarEntry& other : active) {
+                partial.overlaps.emplace_back(other.event, entry.event);
+            }
+            active.push_back(entry);
+
+            if (!Event::isWithinOperatingHours(entry.start, entry.end)) {
+                partial.outsideOperatingHours.push_back(entry.event);
+            }
+            weekMinutes[entry.event->getOrganizer()] += entry.end - entry.start;
+        }
+    }
+    for (const auto& pair : weekMinutes) {
+        partial.weekTotals.push_back(WeekTotal{pair.first, currentWeek, pair.second});
+    }
+
+    for (size_t i = firstReservation; i < lastReservation; ++i) {
+        const Reservation* reservation = reservations[i];
+        const Event* event = reservation->getEvent();
+        long long time, start, end;
+        if (!event || !parseTimestamp(reservation->getReservationTime(), time) || !parseTimestamp(event->getStartTime(), start) ||
+            !parseTimestamp(event->getEndTime(), end) || time < start || time > end) {
+            partial.reservationsOutsideEvent.push_back(reservation);
+        }
+    }
+}
+
+// Audits the schedule and reservations split into up to threads ranges run on the shared task pool
+AuditReport ScheduleAudit::run(const Schedule& schedule, const std::map<int, Reservation*>& reservations, unsigned threads) {
+    ScopedTimer timer(kAuditMetric);
+    auto started = std::chrono::steady_clock::now();
+    AuditReport report;
+
+    std::vector<AuditDay> days;
+    size_t eventCount = 0;
+    for (const auto& pair : schedule.getCalendar()) {
+        days.push_back(AuditDay{pair.first, &pair.second});
+        eventCount += pair.second.size();
+    }
+    std::vector<const Reservation*> reservationList;
+    reservationList.reserve(reservations.size());
+    for (const auto& pair : reservations) {
+        reservationList.push_back(pair.second);
+    }
+
+    TaskPool& pool = TaskPool::shared();
+    if (threads == 0) {
+        threads = pool.concurrency();
+    }
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, std::max(days.size(), reservationList.size()))));
+
+    // Split the days into contiguous ranges holding about the same number of events
+    std::vector<size_t> dayBounds(1, 0);
+    size_t seen = 0;
+    for (size_t i = 0; i < days.size() && dayBounds.size() < threads; ++i) {
+        seen += days[i].entries->size();
+        if (seen * threads >= eventCount * dayBounds.size()) {
+            dayBounds.push_back(i + 1);
+        }
+    }
+    while (dayBounds.size() <= threads) {
+        dayBounds.push_back(days.size());
+    }
+
+    std::vector<AuditPartial> partials(threads);
+    pool.parallelFor(0, threads, 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+            size_t firstReservation = reservationList.size() * t / threads;
+            size_t lastReservation = reservationList.size() * (t + 1) / threads;
+            auditRange(days, dayBounds[t], dayBounds[t + 1], schedule.getLongestEvent(), reservationList, firstReservation, lastReservation,
+                       partials[t]);
+        }
+    });
+
+    std::map<std::pair<const User*, long long>, long long> weeklyMinutes;
+    for (AuditPartial& partial : partials) {
+        report.overlaps.insert(report.overlaps.end(), partial.overlaps.begin(), partial.overlaps.end());
+        report.outsideOperatingHours.insert(report.outsideOperatingHours.end(), partial.outsideOperatingHours.begin(),
+                                            partial.outsideOperatingHours.end());
+        report.reservationsOutsideEvent.insert(report.reservationsOutsideEvent.end(), partial.reservationsOutsideEvent.begin(),
+                                               partial.reservationsOutsideEvent.end());
+        // A week split across two ranges shows up in both
+        for (const WeekTotal& total : partial.weekTotals) {
+            weeklyMinutes[std::make_pair(total.organizer, total.weekStart)] += total.minutes;
+        }
+    }
+    for (const auto& pair : weeklyMinutes) {
+        const User* organizer = pair.first.first;
+        if (organizer && pair.second > organizer->getWeeklyLimit() * 60LL) {
+            report.quotaViolations.push_back(QuotaViolation{organizer, pair.first.second, pair.second});
+        }
+    }
+    std::sort(report.quotaViolations.begin(), report.quotaViolations.end(), [](const QuotaViolation& a, const QuotaViolation& b) {
+        if (a.weekStart != b.weekStart) return a.weekStart < b.weekStart;
+        return a.organizer->getUsername() < b.organizer->getUsername();
+    });
+    report.invalidTimes.assign(schedule.getUndatedEvents().begin(), schedule.getUndatedEvents().end());
+
+    report.eventsChecked = eventCount + schedule.getUndatedEvents().size();
+    report.reservationsChecked = reservationList.size();
+    report.threadsUsed = std::min(threads, pool.concurrency());
+    report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+// Checks if the audit found nothing
+bool AuditReport::isClean() const {
+    return overlaps.empty() && outsideOperatingHours.empty() && invalidTimes.empty() && quotaViolations.empty() &&
+           reservationsOutsideEvent.empty();
+}
+
+// Prints a category header and returns how many entries to print
+static size_t printHeader(std::ostream& out, const std::string& title, size_t count, size_t limit) {
+    out << title << ": " << count << std::endl;
+    return (limit == 0 || count < limit) ? count : limit;
+}
+
+// Prints how many entries were left out
+static void printRemainder(std::ostream& out, size_t count, size_t printed) {
+    if (printed < count) {
+        out << " ... and " << (count - printed) << " more" << std::endl;
+    }
+}
+
+// Prints the findings, at most limit entries per category
+void AuditReport::print(std::ostream& out, size_t limit) const {
+    out << "Audit of " << eventsChecked << " events and " << reservationsChecked << " reservations finished in " << milliseconds
+        << " ms using " << threadsUsed << " thread(s)." << std::endl;
+
+    size_t shown = printHeader(out, "Overlapping bookings", overlaps.size(), limit);
+    for (size_t i = 0; i < shown; ++i) {
+        const Event* first = overlaps[i].first;
+        const Event* second = overlaps[i].second;
+        out << " - " << first->getEventName() << " (" << first->getStartTime() << " to " << first->getEndTime() << ") overlaps "
+            << second->getEventName() << " (" << second->getStartTime() << " to " << second->getEndTime() << ")" << std::endl;
+    }
+    printRemainder(out, overlaps.size(), shown);
+
+    shown = printHeader(out, "Bookings outside operating hours", outsideOperatingHours.size(), limit);
+    for (size_t i = 0; i < shown; ++i) {
+        const Event* event = outsideOperatingHours[i];
+        out << " - " << event->getEventName() << " (" << event->getStartTime() << " to " << event->getEndTime() << ")" << std::endl;
+    }
+    printRemainder(out, outsideOperatingHours.size(), shown);
+
+    shown = printHeader(out, "Events with invalid times", invalidTimes.size(), limit);
+    for (size_t i = 0; i < shown; ++i) {
+        const Event* event = invalidTimes[i];
+        out << " - " << event->getEventName() << " (" << event->getStartTime() << " to " << event->getEndTime() << ")" << std::endl;
+    }
+    printRemainder(out, invalidTimes.size(), shown);
+
+    shown = printHeader(out, "Organizers over their weekly limit", quotaViolations.size(), limit);
+    for (size_t i = 0; i < shown; ++i) {
+        const QuotaViolation& violation = quotaViolations[i];
+        out << " - " << violation.organizer->getUsername() << ", week of " << formatDate(violation.weekStart) << ": "
+            << violation.minutes / 60.0 << " hours (limit " << violation.organizer->getWeeklyLimit() << ")" << std::endl;
+    }
+    printRemainder(out, quotaViolations.size(), shown);
+
+    shown = printHeader(out, "Reservations outside their event time", reservationsOutsideEvent.size(), limit);
+    for (size_t i = 0; i < shown; ++i) {
+        const Reservation* reservation = reservationsOutsideEvent[i];
+        const Event* event = reservation->getEvent();
+        out << " - Reservation " << reservation->getReservationID() << " at " << reservation->getReservationTime() << " for "
+            << (event ? event->getEventName() : "<no event>");
+        if (event) out << " (" << event->getStartTime() << " to " << event->getEndTime() << ")";
+        out << std::endl;
+    }
+    printRemainder(out, reservationsOutsideEvent.size(), shown);
+}
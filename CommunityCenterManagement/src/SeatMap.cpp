@@ -0,0 +1,246 @@
+#include "SeatMap.hpp"
+#include "Event.hpp"
+#include <sstream>
+#include <cstdlib>
+#include <climits>
+
+// Returns the number of seats in one row
+int SeatLayout::seatsPerRow() const {
+    int seats = 0;
+    for (int section : sections) seats += section;
+    return seats;
+}
+
+// Returns the template of a layout style
+const SeatLayout& SeatLayout::forStyle(LayoutStyle style) {
+    // Lectures: two side blocks around a wide center block; weddings: the two sides of the aisle
+    static const SeatLayout meeting{false, {10}};
+    static const SeatLayout lecture{true, {6, 12, 6}};
+    static const SeatLayout wedding{true, {6, 6}};
+    static const SeatLayout dance{false, {10}};
+    switch (style) {
+        case LayoutStyle::Lecture:
+            return lecture;
+        case LayoutStyle::Wedding:
+            return wedding;
+        case LayoutStyle::Dance:
+            return dance;
+        default:
+            return meeting;
+    }
+}
+
+// Builds an empty map of capacity seats laid out by a template
+SeatMap::SeatMap(const SeatLayout& layout, int capacity) : seatCount(capacity > 0 ? capacity : 0) {
+    for (int section : layout.sections) {
+        sectionStarts.push_back(stride);
+        sectionSizes.push_back(section);
+        stride += section + 1;
+        perRow += section;
+    }
+    if (perRow == 0 || seatCount == 0) return;
+    int rows = (seatCount + perRow - 1) / perRow;
+    std::uint32_t bits = static_cast<std::uint32_t>(rows) * stride;
+    words.assign(bits / 64 + 1, ~0ULL);  // At least one bit past the seats stays set as a sentinel
+    for (int seat = 0; seat < seatCount; ++seat) {
+        std::uint32_t bit = bitOfSeat(seat);
+        words[bit / 64] &= ~(1ULL << (bit % 64));
+    }
+}
+
+// Returns the bit of a seat
+std::uint32_t SeatMap::bitOfSeat(std::uint32_t seat) const {
+    std::uint32_t row = seat / perRow;
+    int column = static_cast<int>(seat % perRow);
+    size_t section = 0;
+    while (column >= sectionSizes[section]) column -= sectionSizes[section++];
+    return row * stride + sectionStarts[section] + column;
+}
+
+// Returns the seat of a bit that is not an aisle
+std::uint32_t SeatMap::seatOfBit(std::uint32_t bit) const {
+    std::uint32_t row = bit / stride;
+    int offset = static_cast<int>(bit % stride);
+    int seat = 0;
+    size_t section = 0;
+    while (offset >= sectionStarts[section] + sectionSizes[section] + 1) seat += sectionSizes[section++];
+    return row * perRow + seat + (offset - sectionStarts[section]);
+}
+
+// Returns the first free bit at or after a bit
+std::uint32_t SeatMap::nextFree(std::uint32_t bit) const {
+    size_t index = bit / 64;
+    if (index >= words.size()) return static_cast<std::uint32_t>(words.size() * 64);
+    std::uint64_t word = ~words[index] & (~0ULL << (bit % 64));
+    while (word == 0) {
+        if (++index == words.size()) return static_cast<std::uint32_t>(words.size() * 64);
+        word = ~words[index];
+    }
+    return static_cast<std::uint32_t>(index * 64 + __builtin_ctzll(word));
+}
+
+// Returns the first taken bit at or after a bit
+std::uint32_t SeatMap::nextTaken(std::uint32_t bit) const {
+    size_t index = bit / 64;
+    if (index >= words.size()) return static_cast<std::uint32_t>(words.size() * 64);
+    std::uint64_t word = words[index] & (~0ULL << (bit % 64));
+    while (word == 0) {
+        if (++index == words.size()) return static_cast<std::uint32_t>(words.size() * 64);
+        word = words[index];
+    }
+    return static_cast<std::uint32_t>(index * 64 + __builtin_ctzll(word));
+}
+
+// Checks if every bit of [first, first + count) is free
+bool SeatMap::rangeFree(std::uint32_t first, std::uint32_t count) const {
+    return nextTaken(first) >= first + count;
+}
+
+// Sets or clears the bits [first, first + count)
+void SeatMap::setRange(std::uint32_t first, std::uint32_t count, bool taken) {
+    std::uint32_t end = first + count;
+    while (first < end) {
+        std::uint32_t bits = std::min<std::uint32_t>(64 - first % 64, end - first);
+        std::uint64_t mask = (bits == 64 ? ~0ULL : ((1ULL << bits) - 1)) << (first % 64);
+        if (taken) {
+            words[first / 64] |= mask;
+        } else {
+            words[first / 64] &= ~mask;
+        }
+        first += bits;
+    }
+}
+
+// Converts a seat block to its bit range
+bool SeatMap::toBits(const SeatBlock& block, std::uint32_t& first) const {
+    if (block.count == 0 || block.first >= static_cast<std::uint32_t>(seatCount) || block.count > static_cast<std::uint32_t>(seatCount) - block.first) {
+        return false;
+    }
+    first = bitOfSeat(block.first);
+    // Consecutive seats are consecutive bits only within one section
+    return bitOfSeat(block.first + block.count - 1) == first + block.count - 1;
+}
+
+// Finds the frontmost, most central contiguous block of count seats
+bool SeatMap::findContiguous(int count, SeatBlock& block) const {
+    if (count <= 0 || count > available()) return false;
+    std::uint32_t limit = static_cast<std::uint32_t>(words.size() * 64);
+    bool found = false;
+    long long bestRow = 0, bestDistance = 0;
+    std::uint32_t bestBit = 0;
+    for (std::uint32_t free = nextFree(0); free < limit;) {
+        std::uint32_t taken = nextTaken(free);
+        long long row = free / stride;
+        // Rows are visited front to back, so nothing behind the row of a found block can beat it
+        if (found && row > bestRow) break;
+        if (taken - free >= static_cast<std::uint32_t>(count)) {
+            // Twice the row's center, in bits, to keep the arithmetic integral
+            long long center2 = 2 * row * stride + (stride - 2);
+            long long start2 = center2 - (count - 1);  // Twice the start that centers the block
+            long long lowest = free, highest = taken - count;
+            long long start = std::max(lowest, std::min(highest, start2 / 2));
+            long long distance = std::llabs(2 * start + (count - 1) - center2);
+            if (!found || distance < bestDistance) {
+                found = true;
+                bestRow = row;
+                bestDistance = distance;
+                bestBit = static_cast<std::uint32_t>(start);
+            }
+        }
+        free = nextFree(taken);
+    }
+    if (found) block = SeatBlock{seatOfBit(bestBit), static_cast<std::uint32_t>(count)};
+    return found;
+}
+
+// Finds count seats for a group
+bool SeatMap::findBestAvailable(int count, std::vector<SeatBlock>& blocks) const {
+    blocks.clear();
+    if (count <= 0 || count > available()) return false;
+    SeatBlock block;
+    if (findContiguous(count, block)) {
+        blocks.push_back(block);
+        return true;
+    }
+    // No block is wide enough: fill the frontmost free runs
+    std::uint32_t limit = static_cast<std::uint32_t>(words.size() * 64);
+    std::uint32_t remaining = static_cast<std::uint32_t>(count);
+    for (std::uint32_t free = nextFree(0); free < limit && remaining > 0;) {
+        std::uint32_t taken = nextTaken(free);
+        std::uint32_t take = std::min(remaining, taken - free);
+        blocks.push_back(SeatBlock{seatOfBit(free), take});
+        remaining -= take;
+        free = nextFree(taken);
+    }
+    return remaining == 0;
+}
+
+// Marks a block occupied
+bool SeatMap::occupy(const SeatBlock& block) {
+    std::uint32_t first;
+    if (!toBits(block, first) || !rangeFree(first, block.count)) return false;
+    setRange(first, block.count, true);
+    occupiedCount += static_cast<int>(block.count);
+    return true;
+}
+
+// Marks a block free again
+void SeatMap::release(const SeatBlock& block) {
+    std::uint32_t first;
+    if (!toBits(block, first)) return;
+    setRange(first, block.count, false);
+    occupiedCount -= static_cast<int>(block.count);
+}
+
+// Formats a seat as a label: row letters (A-Z, AA-AZ, ...) and 1-based seat number
+static std::string seatLabel(std::uint32_t seat, int seatsPerRow) {
+    std::uint32_t row = seat / seatsPerRow;
+    std::string letters;
+    do {
+        letters.insert(letters.begin(), static_cast<char>('A' + row % 26));
+        row = row / 26;
+    } while (row-- > 0);
+    return letters + std::to_string(seat % seatsPerRow + 1);
+}
+
+// Parses a seat label, returning false if it is malformed
+static bool parseSeatLabel(const std::string& label, int seatsPerRow, std::uint32_t& seat) {
+    size_t digits = 0;
+    long long row = -1;
+    while (digits < label.size() && label[digits] >= 'A' && label[digits] <= 'Z') {
+        row = (row + 1) * 26 + (label[digits++] - 'A');
+    }
+    if (row < 0 || digits == label.size()) return false;
+    char* end;
+    long number = std::strtol(label.c_str() + digits, &end, 10);
+    if (*end != '\0' || number < 1 || number > seatsPerRow) return false;
+    seat = static_cast<std::uint32_t>(row * seatsPerRow + number - 1);
+    return true;
+}
+
+// Formats blocks as seat labels
+std::string SeatMap::formatBlocks(const std::vector<SeatBlock>& blocks, int seatsPerRow) {
+    std::string text;
+    for (const SeatBlock& block : blocks) {
+        if (!text.empty()) text += ",";
+        text += seatLabel(block.first, seatsPerRow);
+        if (block.count > 1) text += "-" + seatLabel(block.first + block.count - 1, seatsPerRow);
+    }
+    return text;
+}
+
+// Parses seat labels
+bool SeatMap::parseBlocks(const std::string& text, int seatsPerRow, std::vector<SeatBlock>& blocks) {
+    blocks.clear();
+    std::istringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        size_t dash = part.find('-');
+        std::uint32_t first, last;
+        if (!parseSeatLabel(part.substr(0, dash), seatsPerRow, first)) return false;
+        last = first;
+        if (dash != std::string::npos && (!parseSeatLabel(part.substr(dash + 1), seatsPerRow, last) || last < first)) return false;
+        blocks.push_back(SeatBlock{first, last - first + 1});
+    }
+    return !blocks.empty();
+}
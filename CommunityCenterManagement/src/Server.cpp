@@ -0,0 +1,490 @@
+#include "Server.hpp"
+#include "HelperFunctions.hpp"
+#include "Metrics.hpp"
+#include "HoldExpiry.hpp"
+#include "CheckIn.hpp"
+#include "DiskSnapshot.hpp"
+#include "Archive.hpp"
+#include "SharedStore.hpp"
+#include "FlashSale.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <sstream>
+#include <optional>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static const int kServerRequestMetric = Metrics::registerMetric("server_request");
+
+// Input buffered per connection; a connection stops being read while it is full
+static const size_t kMaxBufferedInput = 64 * 1024;
+
+// Set by the signal handler or stop() to end the event loop
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+// Puts a file descriptor into non-blocking mode
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Converts a reservation status to its file representation
+static const char* reservationStatusName(ReservationStatus status) {
+    switch (status) {
+        case ReservationStatus::Pending: return "Pending";
+        case ReservationStatus::Confirmed: return "Confirmed";
+        case ReservationStatus::Canceled: return "Canceled";
+    }
+    return "Unknown";
+}
+
+// Constructor storing references to the shared application state
+Server::Server(FacilityManager& facilityManager, std::map<std::string, User*>& users, std::map<std::string, Event*>& events,
+               std::map<int, Reservation*>& reservations)
+    : facilityManager(facilityManager), users(users), events(events), reservations(reservations), listenFd(-1), epollFd(-1), nextSerial(0) {}
+
+// Closes all sockets
+Server::~Server() {
+    for (auto& pair : connections) {
+        close(pair.first);
+    }
+    if (listenFd >= 0) close(listenFd);
+    if (epollFd >= 0) close(epollFd);
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+}
+
+// Listens on a Unix domain socket at the given path
+bool Server::listenUnix(const std::string& path) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << path << std::endl;
+        return false;
+    }
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Unable to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error: Unable to listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    unixPath = path;
+    std::cout << "Server listening on unix:" << path << std::endl;
+    return setNonBlocking(listenFd);
+}
+
+// Listens on a TCP port bound to localhost
+bool Server::listenTcp(int port) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Unable to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error: Unable to listen on port " << port << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::cout << "Server listening on tcp:127.0.0.1:" << port << std::endl;
+    return setNonBlocking(listenFd);
+}
+
+// Registers the listening socket with a new epoll instance
+bool Server::startLoop() {
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        std::cerr << "Error: Unable to create epoll instance: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == 0;
+}
+
+// Runs the event loop until stop() is called or a termination signal arrives
+void Server::run() {
+    if (listenFd < 0 || !startLoop()) {
+        return;
+    }
+    stopRequested = 0;
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    epoll_event readyEvents[64];
+    while (!stopRequested) {
+        // The timeout only bounds how long a stop request or a due hold can go unnoticed; queued flash-sale requests are admitted right away
+        int ready = epoll_wait(epollFd, readyEvents, 64, FlashSale::queued() > 0 ? 0 : 500);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        {
+            SharedStore::WriteLock holdLock(false);
+            std::string expiries;  // Already in the hold log; nobody at a socket asked for them
+            if (holdLock.acquired() && HoldExpiry::advance(currentMinutes(), reservations, events, expiries) > 0) {
+                facilityManager.getSchedule().publishSnapshot(reservations);
+            } else {
+                holdLock.noChanges();
+            }
+        }
+        DiskSnapshot::tick(currentMinutes(), facilityManager, users, events, reservations);
+        Archive::tick(currentMinutes());
+        for (int i = 0; i < ready; ++i) {
+            int fd = readyEvents[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            // A hang-up can arrive with requests still buffered, so read them first; the read reports the end or the error
+            if (readyEvents[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                readFromConnection(it->second);
+            }
+            it = connections.find(fd);
+            if (it != connections.end() && (readyEvents[i].events & EPOLLOUT)) {
+                flushConnection(it->second);
+            }
+        }
+        // Requests queued during this round are admitted one batch per round
+        if (FlashSale::queued() > 0) {
+            admitFlashSaleBatch();
+        }
+    }
+    std::cout << "Server stopped." << std::endl;
+}
+
+// Asks the event loop to exit
+void Server::stop() {
+    stopRequested = 1;
+}
+
+// Accepts all pending connections
+void Server::acceptConnections() {
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        setNonBlocking(fd);
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Fails harmlessly on Unix sockets
+        Connection connection;
+        connection.fd = fd;
+        connection.session.connectionFd = fd;
+        connection.session.serial = ++nextSerial;
+        connections[fd] = connection;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+// Reads available data, up to a full input buffer, and processes complete request lines
+void Server::readFromConnection(Connection& connection) {
+    char buffer[4096];
+    while (connection.input.size() < kMaxBufferedInput) {
+        ssize_t count = read(connection.fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            connection.input.append(buffer, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeConnection(connection.fd);
+            return;
+        }
+        // End of input: answer what was already received, then close
+        connection.inputClosed = connection.inputClosed || count == 0;
+        break;
+    }
+    processInput(connection);
+}
+
+// Processes the buffered request lines until one waits in the flash-sale queue
+void Server::processInput(Connection& connection) {
+    size_t start = 0;
+    size_t newline;
+    // Answers go out in request order, so the lines after a queued request wait for its batch
+    while (!connection.session.closeRequested && connection.session.queuedRequests == 0 &&
+           (newline = connection.input.find('\n', start)) != std::string::npos) {
+        std::string line = connection.input.substr(start, newline - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = newline + 1;
+        if (!line.empty()) {
+            connection.output += handleRequest(connection.session, line);
+        }
+    }
+    connection.input.erase(0, start);
+    // With nothing waiting, the rest of a full buffer is one line that never ends
+    if (connection.input.size() >= kMaxBufferedInput && !connection.session.closeRequested && connection.session.queuedRequests == 0) {
+        connection.output += "ERR Request line too long.\n";
+        connection.input.clear();
+        connection.session.closeRequested = true;
+    }
+    // All requests read in one go form a write batch: publish it to snapshot readers once
+    publishWrites(connection.session);
+    if (connection.inputClosed && connection.session.queuedRequests == 0) {
+        connection.session.closeRequested = true;
+    }
+    flushConnection(connection);
+}
+
+// Publishes the session's unpublished writes to snapshot readers
+void Server::publishWrites(Session& session) {
+    if (session.unpublishedWrites) {
+        facilityManager.getSchedule().publishSnapshot(reservations);
+        session.unpublishedWrites = false;
+    }
+}
+
+// Admits one flash-sale batch and answers the waiting connections
+void Server::admitFlashSaleBatch() {
+    std::vector<FlashSaleOutcome> outcomes;
+    {
+        SharedStore::WriteLock batchLock;
+        if (FlashSale::admitBatch(facilityManager.getSchedule(), events, reservations, outcomes) > 0) {
+            facilityManager.getSchedule().publishSnapshot(reservations);
+        } else {
+            batchLock.noChanges();
+        }
+    }
+    std::vector<int> answered;
+    for (const FlashSaleOutcome& outcome : outcomes) {
+        // A client that left keeps its reservation; it shows up in MYRES
+        auto it = connections.find(outcome.request.requester);
+        if (it == connections.end() || it->second.session.serial != outcome.request.serial) continue;
+        Connection& connection = it->second;
+        --connection.session.queuedRequests;
+        if (outcome.reservation) {
+            connection.output += "OK " + std::to_string(outcome.reservation->getReservationID()) + " " +
+                                 std::to_string(outcome.reservation->getTotalCost()) + (outcome.waitlisted ? " waitlisted\n" : "\n");
+        } else {
+            connection.output += "ERR " + outcome.message + "\n";
+        }
+        answered.push_back(connection.fd);
+    }
+    for (int fd : answered) {
+        auto it = connections.find(fd);
+        if (it != connections.end()) {
+            processInput(it->second);
+        }
+    }
+}
+
+// Writes as much buffered output as the socket accepts
+void Server::flushConnection(Connection& connection) {
+    while (!connection.output.empty()) {
+        ssize_t count = write(connection.fd, connection.output.data(), connection.output.size());
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            closeConnection(connection.fd);
+            return;
+        }
+        connection.output.erase(0, static_cast<size_t>(count));
+    }
+    if (connection.output.empty() && connection.session.closeRequested) {
+        closeConnection(connection.fd);
+        return;
+    }
+    updateInterest(connection);
+}
+
+// Updates the epoll interest set of a connection
+void Server::updateInterest(Connection& connection) {
+    epoll_event event = {};
+    // A full input buffer is drained by the requests ahead of it (a flash-sale batch) before reading more
+    bool readable = !connection.inputClosed && connection.input.size() < kMaxBufferedInput;
+    event.events = (readable ? static_cast<uint32_t>(EPOLLIN) : 0u) | (connection.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    event.data.fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+// Closes a connection and forgets its state
+void Server::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+// Executes one request line for a session and returns the response
+std::string Server::handleRequest(Session& session, const std::string& line) {
+    ScopedTimer timer(kServerRequestMetric);
+    std::istringstream iss(line);
+    std::string command;
+    iss >> command;
+    std::ostringstream response;
+    std::string message;
+
+    // In shared mode, catch up with the other processes first; commands that modify data hold the shared lock
+    SharedStore::refresh();
+    std::optional<SharedStore::WriteLock> writeLock;
+    if (command == "RESERVE" || command == "PAY" || command == "CANCEL") {
+        writeLock.emplace();
+    } else {
+        // A read sees the writes made earlier in its own batch
+        publishWrites(session);
+    }
+    session.wroteData = false;
+
+    if (command == "LOGIN") {
+        std::string username, password;
+        iss >> username >> password;
+        session.user = authenticateUser(users, username, password);
+        if (session.user) {
+            response << "OK " << session.user->getUsername() << "\n";
+        } else {
+            response << "ERR Invalid username or password.\n";
+        }
+    } else if (command == "LOGOUT") {
+        session.user = nullptr;
+        response << "OK\n";
+    } else if (command == "LIST") {
+        SnapshotStore::ReadGuard snapshot = facilityManager.getSchedule().getSnapshots().read();
+        response << "OK " << snapshot->events.size() << "\n";
+        for (const auto& event : snapshot->events) {
+            response << event->eventName << " " << event->startTime << " " << event->endTime << " "
+                     << event->ticketsSold << " " << event->maxGuests << " " << event->ticketPrice << "\n";
+        }
+    } else if (command == "MYRES") {
+        if (!session.user) {
+            response << "ERR Please login first.\n";
+        } else {
+            const std::vector<Reservation*> userReservations = session.user->getUserReservations();
+            response << "OK " << userReservations.size() << "\n";
+            for (const auto& reservation : userReservations) {
+                response << reservation->getReservationID() << " " << reservation->getEvent()->getEventName() << " "
+                         << reservationStatusName(reservation->getReservationStatus()) << " "
+                         << (reservation->getPaymentStatus() == PaymentStatus::Paid ? "Paid" : "Unpaid") << " "
+                         << reservation->getTotalCost() << "\n";
+            }
+        }
+    } else if (command == "AVAIL") {
+        std::string startTime, endTime;
+        if (!(iss >> startTime >> endTime)) {
+            response << "ERR Usage: AVAIL <start> <end>\n";
+        } else {
+            bool available = facilityManager.getSchedule().checkAvailability(startTime, endTime);
+            response << "OK " << (available ? "available" : "unavailable") << "\n";
+        }
+    } else if (command == "RESERVE") {
+        std::string eventName, reservationTime;
+        if (!(iss >> eventName >> reservationTime)) {
+            response << "ERR Usage: RESERVE <event> <time>\n";
+        } else if (session.user && FlashSale::isFlashSale(eventName)) {
+            // Answered by admitFlashSaleBatch once the request's batch is admitted
+            FlashSale::enqueue({session.user, eventName, reservationTime, session.connectionFd, session.serial});
+            ++session.queuedRequests;
+        } else {
+            Reservation* reservation = reserveEvent(facilityManager.getSchedule(), events, session.user, reservations, eventName, reservationTime, message);
+            if (reservation) {
+                session.wroteData = true;
+                response << "OK " << reservation->getReservationID() << " " << reservation->getTotalCost() << "\n";
+            } else {
+                response << "ERR " << message << "\n";
+            }
+        }
+    } else if (command == "PAY") {
+        std::string eventName;
+        if (!(iss >> eventName)) {
+            response << "ERR Usage: PAY <event>\n";
+        } else {
+            Reservation* reservation = payForEvent(session.user, reservations, facilityManager, eventName, message);
+            if (reservation) {
+                session.wroteData = true;
+                response << "OK " << reservation->getReservationID() << "\n";
+            } else {
+                response << "ERR " << message << "\n";
+            }
+        }
+    } else if (command == "CANCEL") {
+        int reservationID;
+        if (!(iss >> reservationID)) {
+            response << "ERR Usage: CANCEL <reservationID>\n";
+        } else if (cancelReservationByID(session.user, reservations, facilityManager, reservationID, message)) {
+            session.wroteData = true;
+            response << "OK " << reservationID << "\n";
+        } else {
+            response << "ERR " << message << "\n";
+        }
+    } else if (command == "QUERY") {
+        std::string filter;
+        getline(iss, filter);
+        std::vector<const ReservationSnapshot*> matches;
+        size_t total = 0;
+        if (!session.user || session.user->getUserType() != UserType::City) {
+            response << "ERR Only city staff can query reservations.\n";
+        } else if (!queryReservations(*facilityManager.getSchedule().getSnapshots().read(), filter, 0, matches, total, message)) {
+            response << "ERR " << message << "\n";
+        } else {
+            response << "OK " << total << "\n";
+            for (const ReservationSnapshot* reservation : matches) {
+                response << formatQueryRow(*reservation) << "\n";
+            }
+        }
+    } else if (command == "CHECKIN") {
+        std::string eventName;
+        int reservationID;
+        if (!(iss >> eventName >> reservationID)) {
+            response << "ERR Usage: CHECKIN <event> <reservationID>\n";
+        } else {
+            std::shared_ptr<CheckInSession> checkIn = openCheckIn(session.user, facilityManager.getSchedule(), reservations, eventName, message);
+            if (!checkIn) {
+                response << "ERR " << message << "\n";
+            } else if (scanAtDoor(*checkIn, facilityManager.getSchedule(), reservations, reservationID, message)) {
+                response << "OK " << checkIn->getHeadcount() << " " << checkIn->getMaxGuests() << "\n";
+            } else {
+                response << "ERR " << message << "\n";
+            }
+        }
+    } else if (command == "SNAPSHOT") {
+        if (!session.user || session.user->getUserType() != UserType::City) {
+            response << "ERR Only city staff can take snapshots.\n";
+        } else if (DiskSnapshot::start(facilityManager, users, events, reservations, message)) {
+            DiskSnapshotStats stats = DiskSnapshot::getStats();
+            response << "OK " << stats.started << " " << stats.lastPauseNanoseconds / 1000 << "\n";
+        } else {
+            response << "ERR " << message << "\n";
+        }
+    } else if (command == "QUIT") {
+        session.closeRequested = true;
+        response << "OK\n";
+    } else {
+        response << "ERR Unknown command " << command << "\n";
+    }
+    if (writeLock && !session.wroteData) {
+        writeLock->noChanges();
+    }
+    session.unpublishedWrites = session.unpublishedWrites || session.wroteData;
+    return response.str();
+}
@@ -0,0 +1,229 @@
+#include "SharedStore.hpp"
+#include "TimeUtils.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const int kSharedReloadMetric = Metrics::registerMetric("shared_reload");
+static const char kSharedMagic[8] = {'C', 'C', 'M', 'S', 'H', 'M', '0', '1'};
+
+// Layout of the shared file
+struct SharedHeader {
+    char magic[8];
+    std::uint32_t headerSize;             // sizeof(SharedHeader) of the creator, so mismatched builds refuse to attach
+    std::atomic<std::uint32_t> ready;     // Set once the creator has initialized the mutex
+    pthread_mutex_t writeLock;            // Process-shared, robust
+    std::atomic<std::uint32_t> sequence;  // Seqlock over the change record: odd while it is being written
+    std::atomic<std::uint64_t> generation;
+    std::atomic<std::int32_t> lastWriterPid;
+    std::atomic<std::int64_t> lastWriteMinute;
+};
+
+// Process-local state
+static SharedHeader* header = nullptr;
+static std::uint64_t loadedGeneration = 0;  // Generation the process's objects were loaded at
+static int lockDepth = 0;                   // Nested WriteLocks only lock once
+static bool recovered = false;              // The previous owner died holding the mutex
+static std::function<void()> reloadData;
+
+// Initializes a freshly created shared file
+static bool initializeHeader(SharedHeader* fresh) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    int error = pthread_mutex_init(&fresh->writeLock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (error != 0) return false;
+    fresh->headerSize = sizeof(SharedHeader);
+    fresh->sequence.store(0, std::memory_order_relaxed);
+    fresh->generation.store(1, std::memory_order_relaxed);
+    fresh->lastWriterPid.store(0, std::memory_order_relaxed);
+    fresh->lastWriteMinute.store(0, std::memory_order_relaxed);
+    std::memcpy(fresh->magic, kSharedMagic, sizeof(kSharedMagic));
+    fresh->ready.store(1, std::memory_order_release);
+    return true;
+}
+
+// Maps the shared file, creating and initializing it if needed
+bool SharedStore::open(const std::string& filename) {
+    close();
+    bool created = true;
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = ::open(filename.c_str(), O_RDWR);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return false;
+    }
+    if (created && ftruncate(fd, sizeof(SharedHeader)) != 0) {
+        std::cerr << "Error: Unable to size " << filename << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    // A process that lost the creation race waits (up to a second) for the creator to size and initialize the file
+    struct stat status;
+    for (int attempt = 0; fstat(fd, &status) == 0 && status.st_size < static_cast<off_t>(sizeof(SharedHeader)) && attempt < 100; ++attempt) {
+        usleep(10000);
+    }
+    if (status.st_size < static_cast<off_t>(sizeof(SharedHeader))) {
+        std::cerr << "Error: " << filename << " is not a shared store; remove it if no desk is running." << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(SharedHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: Unable to map " << filename << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    SharedHeader* shared = static_cast<SharedHeader*>(mapping);
+    if (created && !initializeHeader(shared)) {
+        std::cerr << "Error: Unable to initialize the lock of " << filename << std::endl;
+        munmap(mapping, sizeof(SharedHeader));
+        return false;
+    }
+    for (int attempt = 0; shared->ready.load(std::memory_order_acquire) == 0 && attempt < 100; ++attempt) {
+        usleep(10000);
+    }
+    if (shared->ready.load(std::memory_order_acquire) == 0 || std::memcmp(shared->magic, kSharedMagic, sizeof(kSharedMagic)) != 0 ||
+        shared->headerSize != sizeof(SharedHeader)) {
+        std::cerr << "Error: " << filename << " is not a shared store of this version; remove it if no desk is running." << std::endl;
+        munmap(mapping, sizeof(SharedHeader));
+        return false;
+    }
+    header = shared;
+    // The data files are loaded right after this, so they reflect at least this generation
+    loadedGeneration = generation();
+    return true;
+}
+
+// Unmaps the shared file
+void SharedStore::close() {
+    if (header) {
+        munmap(header, sizeof(SharedHeader));
+        header = nullptr;
+    }
+}
+
+// Checks if shared mode is on
+bool SharedStore::isEnabled() {
+    return header != nullptr;
+}
+
+// Sets the function reloading every data file into the process
+void SharedStore::setReloader(std::function<void()> reloader) {
+    reloadData = std::move(reloader);
+}
+
+// Returns the current data generation
+std::uint64_t SharedStore::generation() {
+    if (!header) return 0;
+    return header->generation.load(std::memory_order_acquire);
+}
+
+// Returns the pid of the last writer and the minute of its last write, read consistently under the seqlock
+void SharedStore::lastWrite(int& pid, long long& minute) {
+    pid = 0;
+    minute = 0;
+    if (!header) return;
+    std::uint32_t before, after;
+    do {
+        before = header->sequence.load(std::memory_order_acquire);
+        pid = header->lastWriterPid.load(std::memory_order_relaxed);
+        minute = header->lastWriteMinute.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = header->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+// Locks the shared mutex, recovering it if its owner died; returns false if it is busy and wait is false
+static bool lockShared(bool wait = true) {
+    int result = pthread_mutex_trylock(&header->writeLock);
+    if (result == EBUSY) {
+        if (!wait) return false;
+        std::cout << "Waiting for another desk to finish..." << std::endl;
+        result = pthread_mutex_lock(&header->writeLock);
+    }
+    if (result == EOWNERDEAD) {
+        // The owner may have died halfway through saving: everyone reloads
+        pthread_mutex_consistent(&header->writeLock);
+        std::cerr << "Error: A desk stopped while saving; reloading the data." << std::endl;
+        recovered = true;
+    }
+    return true;
+}
+
+// Reloads the data if they are older than the shared generation (the mutex is held)
+static bool reloadIfStale() {
+    if (!recovered && SharedStore::generation() == loadedGeneration) return false;
+    if (reloadData) {
+        ScopedTimer timer(kSharedReloadMetric);
+        reloadData();
+    }
+    loadedGeneration = SharedStore::generation();
+    return true;
+}
+
+// Reloads the data if another process wrote since the last load
+bool SharedStore::refresh() {
+    if (!header || lockDepth > 0 || generation() == loadedGeneration) return false;
+    lockShared();
+    bool reloaded = reloadIfStale();
+    if (recovered) {
+        // Make the other desks reload too
+        recovered = false;
+        header->generation.fetch_add(1, std::memory_order_acq_rel);
+        loadedGeneration = generation();
+    }
+    pthread_mutex_unlock(&header->writeLock);
+    return reloaded;
+}
+
+// Locks the shared mutex and refreshes the data
+SharedStore::WriteLock::WriteLock(bool wait) : locked(false), skipped(false), changed(true) {
+    if (!header || lockDepth > 0) {
+        if (header) ++lockDepth;
+        return;
+    }
+    if (!lockShared(wait)) {
+        skipped = true;
+        return;
+    }
+    ++lockDepth;
+    locked = true;
+    reloadIfStale();
+    if (recovered) {
+        // The other desks must reload as well, even if this action changes nothing
+        recovered = false;
+        changed = true;
+    }
+}
+
+// Publishes the write and unlocks the shared mutex
+SharedStore::WriteLock::~WriteLock() {
+    if (!header || skipped) return;
+    --lockDepth;
+    if (!locked) return;
+    if (!changed) {
+        pthread_mutex_unlock(&header->writeLock);
+        return;
+    }
+    std::uint32_t sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->lastWriterPid.store(static_cast<std::int32_t>(getpid()), std::memory_order_relaxed);
+    header->lastWriteMinute.store(currentMinutes(), std::memory_order_relaxed);
+    header->sequence.store(sequence + 2, std::memory_order_release);
+    loadedGeneration = header->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+    pthread_mutex_unlock(&header->writeLock);
+}
@@ -0,0 +1,474 @@
+#include "Snapshot.hpp"
+#include "User.hpp"
+#include "TimeUtils.hpp"
+#include <iostream>
+#include <mutex>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <set>
+
+namespace {
+
+// Hands out process-wide reader IDs and recycles them when threads exit
+struct ReaderIDPool {
+    std::mutex mutex;
+    std::vector<int> freeIDs;
+    int nextID = 0;
+
+    int acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeIDs.empty()) {
+            int id = freeIDs.back();
+            freeIDs.pop_back();
+            return id;
+        }
+        return nextID++;
+    }
+
+    void release(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeIDs.push_back(id);
+    }
+};
+
+ReaderIDPool& readerIDPool() {
+    static ReaderIDPool pool;
+    return pool;
+}
+
+// Reader ID of the calling thread, returned to the pool when the thread exits
+struct ThreadReaderID {
+    int id;
+    ThreadReaderID() : id(readerIDPool().acquire()) {}
+    ~ThreadReaderID() { readerIDPool().release(id); }
+};
+
+int currentReaderID() {
+    thread_local ThreadReaderID readerID;
+    if (readerID.id >= SnapshotStore::kMaxReaders) {
+        std::cerr << "Error: Too many concurrent snapshot readers." << std::endl;
+        std::abort();
+    }
+    return readerID.id;
+}
+
+// Scrambles a value so that sums of fingerprints rarely collide (splitmix64 finalizer)
+std::uint64_t mixFingerprint(std::uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// Returns the day an event snapshot starts on, or -1 for none
+long long eventDay(const EventSnapshot* event) {
+    return event && event->startMinute >= 0 ? dayOfMinute(event->startMinute) : -1;
+}
+
+// Fingerprints an event for the signature of its day
+std::uint64_t eventFingerprint(const EventSnapshot& event) {
+    std::uint64_t fingerprint = mixFingerprint(std::hash<std::string>()(event.eventName));
+    for (long long field : {event.startMinute, event.endMinute, static_cast<long long>(event.ticketsSold),
+                            static_cast<long long>(event.maxGuests), static_cast<long long>(event.layoutStyle)}) {
+        fingerprint = mixFingerprint(fingerprint ^ static_cast<std::uint64_t>(field));
+    }
+    return fingerprint;
+}
+
+// Fingerprints a reservation for the signature of its event's day
+std::uint64_t reservationFingerprint(const ReservationSnapshot& reservation) {
+    std::uint64_t fingerprint = mixFingerprint(static_cast<std::uint64_t>(reservation.reservationID) << 8 |
+                                               static_cast<std::uint64_t>(reservation.reservationStatus) << 1 |
+                                               static_cast<std::uint64_t>(reservation.paymentStatus));
+    return mixFingerprint(fingerprint ^ std::hash<std::string>()(reservation.eventName));
+}
+
+// Copies an event for readers
+std::shared_ptr<const EventSnapshot> copyEvent(const Event* event) {
+    std::shared_ptr<EventSnapshot> copy = std::make_shared<EventSnapshot>();
+    copy->eventName = event->getEventName();
+    copy->organizer = event->getOrganizer()->getUsername();
+    copy->startTime = event->getStartTime();
+    copy->endTime = event->getEndTime();
+    if (!parseTimestamp(copy->startTime, copy->startMinute) || !parseTimestamp(copy->endTime, copy->endMinute)) {
+        copy->startMinute = copy->endMinute = -1;
+    }
+    copy->layoutStyle = event->getLayoutStyle();
+    copy->isPublic = event->isPublicEvent();
+    copy->maxGuests = event->getMaxGuests();
+    copy->ticketPrice = event->getTicketPrice();
+    copy->ticketsSold = event->getTicketsSold();
+    copy->seatCapacity = event->getSeatMap().capacity();
+    copy->seatsAvailable = event->getSeatMap().available();
+    copy->version = event->getVersion();
+    for (const User* user : event->getWaitlist()) {
+        copy->waitlist.push_back(user->getUsername());
+    }
+    for (const Reservation* reservation : event->getReservations()) {
+        copy->reservations.emplace_back(reservation->getReservationID(), reservation->getUser()->getUsername());
+    }
+    return copy;
+}
+
+// Copies a reservation for readers, taking the day of its event from a snapshot
+std::shared_ptr<const ReservationSnapshot> copyReservation(const Reservation* reservation, const ScheduleSnapshot& snapshot) {
+    std::shared_ptr<ReservationSnapshot> copy = std::make_shared<ReservationSnapshot>();
+    copy->reservationID = reservation->getReservationID();
+    copy->username = reservation->getUser()->getUsername();
+    copy->userType = reservation->getUser()->getUserType();
+    copy->eventName = reservation->getEvent()->getEventName();
+    copy->eventDay = eventDay(snapshot.findEvent(copy->eventName));
+    copy->reservationStatus = reservation->getReservationStatus();
+    copy->paymentStatus = reservation->getPaymentStatus();
+    copy->totalCost = reservation->getTotalCost();
+    copy->reservationTime = reservation->getReservationTime();
+    if (!reservation->getSeats().empty()) copy->seats = reservation->getSeatLabels();
+    copy->version = reservation->getVersion();
+    return copy;
+}
+
+// Adds (sign 1) or removes (sign -1) the fingerprint of a dated event or reservation from its day's signature
+void addSignature(std::map<long long, std::uint64_t>& signatures, long long day, std::uint64_t fingerprint, int sign) {
+    if (day < 0) return;
+    if (sign > 0) {
+        signatures[day] += fingerprint;
+    } else {
+        signatures[day] -= fingerprint;
+    }
+}
+
+} // namespace
+
+// Finds an event by name, or nullptr
+const EventSnapshot* ScheduleSnapshot::findEvent(const std::string& eventName) const {
+    auto it = layout->eventIndex.find(eventName);
+    return it != layout->eventIndex.end() ? events[it->second].get() : nullptr;
+}
+
+// Finds a reservation by ID, or nullptr
+const ReservationSnapshot* ScheduleSnapshot::findReservation(int reservationID) const {
+    size_t page = static_cast<size_t>(reservationID / kReservationPageSize);
+    if (reservationID < 0 || page >= reservationPages.size() || !reservationPages[page]) return nullptr;
+    const auto& entries = reservationPages[page]->reservations;
+    auto it = std::lower_bound(entries.begin(), entries.end(), reservationID,
+                               [](const std::shared_ptr<const ReservationSnapshot>& entry, int id) { return entry->reservationID < id; });
+    return it != entries.end() && (*it)->reservationID == reservationID ? it->get() : nullptr;
+}
+
+// Returns the events overlapping [start, end) in start order
+std::vector<const EventSnapshot*> ScheduleSnapshot::eventsBetween(long long start, long long end) const {
+    std::vector<const EventSnapshot*> found;
+    auto day = layout->dayIndex.lower_bound(dayOfMinute(start - layout->longestEvent));
+    for (; day != layout->dayIndex.end() && day->first * kMinutesPerDay < end; ++day) {
+        for (size_t i = day->second.first; i < day->second.second; ++i) {
+            const EventSnapshot& event = *events[i];
+            if (event.startMinute >= end) break;
+            if (event.endMinute > start) {
+                found.push_back(&event);
+            }
+        }
+    }
+    return found;
+}
+
+// Builds a snapshot of the given events, recurring series and reservations, sharing what did not change since previous
+ScheduleSnapshot* ScheduleSnapshot::build(const std::vector<Event*>& events, const std::map<std::string, RecurringEvent*>& recurringEvents,
+                                          const std::map<int, Reservation*>& reservations, const ScheduleSnapshot& previous) {
+    ScheduleSnapshot* snapshot = new ScheduleSnapshot();
+
+    // Events keep the previous copy while their render version is unchanged
+    std::vector<std::pair<const EventSnapshot*, const EventSnapshot*>> changedEvents;  // Before and after, nullptr for none
+    snapshot->events.reserve(events.size());
+    bool sameLayout = events.size() == previous.events.size();
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event* event = events[i];
+        std::shared_ptr<const EventSnapshot> before;
+        if (i < previous.events.size() && previous.events[i]->eventName == event->getEventName()) {
+            before = previous.events[i];
+        } else {
+            auto found = previous.layout->eventIndex.find(event->getEventName());
+            if (found != previous.layout->eventIndex.end()) before = previous.events[found->second];
+        }
+        if (before && before->version == event->getVersion()) {
+            snapshot->events.push_back(std::move(before));
+        } else {
+            snapshot->events.push_back(copyEvent(event));
+            changedEvents.emplace_back(before.get(), snapshot->events.back().get());
+        }
+        const EventSnapshot& after = *snapshot->events.back();
+        sameLayout = sameLayout && previous.events[i]->eventName == after.eventName && previous.events[i]->startMinute == after.startMinute &&
+                     previous.events[i]->endMinute == after.endMinute;
+    }
+
+    // The positions only change when an event is added, removed or moved
+    if (sameLayout) {
+        snapshot->layout = previous.layout;
+    } else {
+        std::shared_ptr<EventLayout> layout = std::make_shared<EventLayout>();
+        for (size_t position = 0; position < snapshot->events.size(); ++position) {
+            const EventSnapshot& event = *snapshot->events[position];
+            layout->eventIndex[event.eventName] = position;
+            if (event.startMinute >= 0) {
+                // Events arrive in start order, so each day covers a contiguous range
+                auto& range = layout->dayIndex[dayOfMinute(event.startMinute)];
+                if (range.first == range.second) range.first = position;
+                range.second = position + 1;
+                layout->longestEvent = std::max(layout->longestEvent, event.endMinute - event.startMinute);
+            }
+        }
+        for (const auto& pair : previous.layout->eventIndex) {
+            if (!layout->eventIndex.count(pair.first)) changedEvents.emplace_back(previous.events[pair.second].get(), nullptr);
+        }
+        snapshot->layout = layout;
+    }
+
+    // Day signatures are sums, so a change subtracts the old fingerprint and adds the new one;
+    // the reservations of an event that moved to another day are copied again for their new day
+    snapshot->daySignatures = previous.daySignatures;
+    std::set<std::string> movedEvents;
+    for (const auto& change : changedEvents) {
+        if (change.first) addSignature(snapshot->daySignatures, eventDay(change.first), eventFingerprint(*change.first), -1);
+        if (change.second) addSignature(snapshot->daySignatures, eventDay(change.second), eventFingerprint(*change.second), 1);
+        if (eventDay(change.first) != eventDay(change.second)) {
+            movedEvents.insert(change.first ? change.first->eventName : change.second->eventName);
+        }
+    }
+
+    // Recurring series are in name order in both; a skipped occurrence keeps the render version (see markChanged)
+    snapshot->recurringEvents.reserve(recurringEvents.size());
+    size_t next = 0;
+    for (const auto& pair : recurringEvents) {
+        while (next < previous.recurringEvents.size() && previous.recurringEvents[next]->getEventName() < pair.first) ++next;
+        const RecurringEvent* before = next < previous.recurringEvents.size() ? previous.recurringEvents[next].get() : nullptr;
+        if (before && before->getEventName() == pair.first && before->getVersion() == pair.second->getVersion() &&
+            before->getRule().exceptions.size() == pair.second->getRule().exceptions.size()) {
+            snapshot->recurringEvents.push_back(previous.recurringEvents[next]);
+        } else {
+            snapshot->recurringEvents.push_back(std::make_shared<const RecurringEvent>(*pair.second));
+        }
+    }
+
+    // Reservations are walked page by page against the previous pages; a page without changes is shared as a whole
+    std::vector<ReservationIndex::Change> changedReservations;
+    size_t pageCount = reservations.empty() ? 0 : static_cast<size_t>(reservations.rbegin()->first / kReservationPageSize) + 1;
+    snapshot->reservationPages.resize(pageCount);
+    snapshot->reservationCount = reservations.size();
+    auto live = reservations.begin();
+    for (size_t page = 0; page < std::max(pageCount, previous.reservationPages.size()); ++page) {
+        auto first = live;
+        size_t count = 0;
+        for (; live != reservations.end() && static_cast<size_t>(live->first / kReservationPageSize) == page; ++live) ++count;
+        const ReservationPage* before = page < previous.reservationPages.size() ? previous.reservationPages[page].get() : nullptr;
+        auto unchanged = [&movedEvents](const ReservationSnapshot& copy, const Reservation* reservation) {
+            return copy.reservationID == reservation->getReservationID() && copy.version == reservation->getVersion() &&
+                   (movedEvents.empty() || !movedEvents.count(copy.eventName));
+        };
+
+        bool samePage = (before ? before->reservations.size() : 0) == count;
+        auto it = first;
+        for (size_t i = 0; samePage && i < count; ++i, ++it) {
+            samePage = unchanged(*before->reservations[i], it->second);
+        }
+        if (samePage) {
+            if (page < pageCount) snapshot->reservationPages[page] = previous.reservationPages[page];
+            continue;
+        }
+
+        // Merge the previous copies with the live reservations by ID
+        std::shared_ptr<ReservationPage> copy = std::make_shared<ReservationPage>();
+        copy->reservations.reserve(count);
+        size_t old = 0;
+        size_t oldCount = before ? before->reservations.size() : 0;
+        for (it = first; it != live; ++it) {
+            for (; old < oldCount && before->reservations[old]->reservationID < it->first; ++old) {
+                changedReservations.emplace_back(before->reservations[old].get(), nullptr);
+            }
+            if (old < oldCount && unchanged(*before->reservations[old], it->second)) {
+                copy->reservations.push_back(before->reservations[old++]);
+                continue;
+            }
+            const ReservationSnapshot* replaced = nullptr;
+            if (old < oldCount && before->reservations[old]->reservationID == it->first) replaced = before->reservations[old++].get();
+            copy->reservations.push_back(copyReservation(it->second, *snapshot));
+            changedReservations.emplace_back(replaced, copy->reservations.back().get());
+        }
+        for (; old < oldCount; ++old) {
+            changedReservations.emplace_back(before->reservations[old].get(), nullptr);
+        }
+        if (page < pageCount && count > 0) snapshot->reservationPages[page] = std::move(copy);
+    }
+    for (const auto& change : changedReservations) {
+        if (change.first) addSignature(snapshot->daySignatures, change.first->eventDay, reservationFingerprint(*change.first), -1);
+        if (change.second) addSignature(snapshot->daySignatures, change.second->eventDay, reservationFingerprint(*change.second), 1);
+    }
+    // Days without events have no signature
+    if (!sameLayout) {
+        for (auto it = snapshot->daySignatures.begin(); it != snapshot->daySignatures.end();) {
+            it = snapshot->layout->dayIndex.count(it->first) ? std::next(it) : snapshot->daySignatures.erase(it);
+        }
+    }
+
+    snapshot->reservationIndex = previous.reservationIndex;
+    snapshot->reservationIndex.update(changedReservations);
+    return snapshot;
+}
+
+// Prints basic details of an event snapshot
+void printEventDetails(const EventSnapshot& event, std::ostream& out) {
+    out << "Event: " << event.eventName << "\nOrganizer: " << event.organizer << "\nStart Time: " << event.startTime << "\nEnd Time: " << event.endTime
+        << "\nLayout Style: " << static_cast<int>(event.layoutStyle) << "\nPublic: " << (event.isPublic ? "Yes" : "No")
+        << "\nMax Guests: " << event.maxGuests << "\nTicket Price: $" << event.ticketPrice << "\nTickets Sold: " << event.ticketsSold
+        << "\nReservations: " << std::endl;
+    for (const auto& reservation : event.reservations) {
+        out << " - Reservation ID: " << reservation.first << ", User: " << reservation.second << std::endl;
+    }
+}
+
+// Prints the detailed view of an event snapshot
+void printEventDetailedView(const EventSnapshot& event, std::ostream& out) {
+    out << "Event: " << event.eventName << "\nOrganizer: " << event.organizer << "\nStart Time: " << event.startTime << "\nEnd Time: " << event.endTime
+        << "\nLayout Style: " << static_cast<int>(event.layoutStyle) << "\nPublic: " << (event.isPublic ? "Yes" : "No")
+        << "\nMax Guests: " << event.maxGuests << "\nTicket Price: $" << event.ticketPrice << "\nTickets Sold: " << event.ticketsSold << std::endl;
+    if (event.seatCapacity > 0) {
+        out << "Seats Available: " << event.seatsAvailable << " of " << event.seatCapacity << std::endl;
+    }
+    out << "Waitlist: " << std::endl;
+    for (const auto& username : event.waitlist) {
+        out << " - " << username << std::endl;
+    }
+    out << "Reservations: " << std::endl;
+    for (const auto& reservation : event.reservations) {
+        out << " - Reservation ID: " << reservation.first << ", User: " << reservation.second << std::endl;
+    }
+}
+
+// Prints one schedule line
+void printScheduleLine(long long start, long long end, const std::string& name, int ticketsSold, int maxGuests, std::ostream& out) {
+    out << "  " << formatTimestamp(start).substr(11) << "-" << formatTimestamp(end).substr(11) << "  " << name << "  (";
+    if (ticketsSold >= 0) {
+        out << ticketsSold << "/" << maxGuests << " tickets)" << std::endl;
+    } else {
+        out << "recurring, " << maxGuests << " guests)" << std::endl;
+    }
+}
+
+// Prints the date and the schedule lines of a day
+void printScheduleDay(const ScheduleSnapshot& snapshot, long long day, std::ostream& out) {
+    out << formatDate(day) << std::endl;
+    // Events come first among equal start times, as in the range view
+    std::vector<std::pair<long long, const EventSnapshot*>> events;
+    auto range = snapshot.layout->dayIndex.find(day);
+    if (range != snapshot.layout->dayIndex.end()) {
+        for (size_t i = range->second.first; i < range->second.second; ++i) {
+            events.emplace_back(snapshot.events[i]->startMinute, snapshot.events[i].get());
+        }
+    }
+    std::vector<std::pair<long long, const RecurringEvent*>> occurrences;
+    for (const auto& series : snapshot.recurringEvents) {
+        long long start;
+        if (series->occursOn(day, start)) {
+            occurrences.emplace_back(start, series.get());
+        }
+    }
+    std::stable_sort(occurrences.begin(), occurrences.end(),
+                     [](const std::pair<long long, const RecurringEvent*>& a, const std::pair<long long, const RecurringEvent*>& b) { return a.first < b.first; });
+    size_t next = 0;
+    for (const auto& event : events) {
+        for (; next < occurrences.size() && occurrences[next].first < event.first; ++next) {
+            const RecurringEvent& series = *occurrences[next].second;
+            printScheduleLine(occurrences[next].first, occurrences[next].first + series.getDuration(),
+                              RecurringEvent::occurrenceName(series.getEventName(), formatDate(day)), -1, series.getMaxGuests(), out);
+        }
+        printScheduleLine(event.second->startMinute, event.second->endMinute, event.second->eventName, event.second->ticketsSold,
+                          event.second->maxGuests, out);
+    }
+    for (; next < occurrences.size(); ++next) {
+        const RecurringEvent& series = *occurrences[next].second;
+        printScheduleLine(occurrences[next].first, occurrences[next].first + series.getDuration(),
+                          RecurringEvent::occurrenceName(series.getEventName(), formatDate(day)), -1, series.getMaxGuests(), out);
+    }
+}
+
+// Prints the detailed view of a reservation snapshot
+void printReservationDetails(const ReservationSnapshot& reservation) {
+    std::cout << "Reservation ID: " << reservation.reservationID << "\nUser: " << reservation.username
+              << "\nEvent: " << reservation.eventName << "\nStatus: " << static_cast<int>(reservation.reservationStatus)
+              << "\nPayment Status: " << static_cast<int>(reservation.paymentStatus) << "\nTotal Cost: " << reservation.totalCost
+              << "\nReservation Time: " << reservation.reservationTime << std::endl;
+    if (!reservation.seats.empty()) {
+        std::cout << "Seats: " << reservation.seats << std::endl;
+    }
+}
+
+// Pins the current snapshot: announce the epoch first, then load the pointer
+SnapshotStore::ReadGuard::ReadGuard(const SnapshotStore& store) : store(store), readerID(currentReaderID()) {
+    ReaderSlot& slot = store.readers[readerID];
+    if (slot.depth++ == 0) {
+        slot.epoch.store(store.globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+    snapshot = store.current.load(std::memory_order_seq_cst);
+}
+
+// Leaves the read section
+SnapshotStore::ReadGuard::~ReadGuard() {
+    ReaderSlot& slot = store.readers[readerID];
+    if (--slot.depth == 0) {
+        slot.epoch.store(0, std::memory_order_release);
+    }
+}
+
+// Constructor publishing an empty snapshot
+SnapshotStore::SnapshotStore() : current(new ScheduleSnapshot()), globalEpoch(1), nextVersion(1) {}
+
+// Frees the current and all retired snapshots
+SnapshotStore::~SnapshotStore() {
+    delete current.load();
+    for (auto& entry : retired) {
+        delete entry.second;
+    }
+}
+
+// Publishes a new snapshot and retires the previous one
+void SnapshotStore::publish(ScheduleSnapshot* snapshot) {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    snapshot->version = nextVersion++;
+    const ScheduleSnapshot* previous = current.exchange(snapshot, std::memory_order_seq_cst);
+    // Readers that announced an epoch <= retireEpoch may still hold previous
+    std::uint64_t retireEpoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    retired.emplace_back(retireEpoch, previous);
+    reclaim();
+}
+
+// Returns the version of the current snapshot
+std::uint64_t SnapshotStore::currentVersion() const {
+    ReadGuard guard(*this);
+    return guard->version;
+}
+
+// Returns the number of replaced snapshots not reclaimed yet
+size_t SnapshotStore::retiredCount() const {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
+
+// Frees retired snapshots no active reader can still reference
+void SnapshotStore::reclaim() {
+    std::uint64_t oldestActive = UINT64_MAX;
+    for (const ReaderSlot& slot : readers) {
+        std::uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0 && epoch < oldestActive) {
+            oldestActive = epoch;
+        }
+    }
+    size_t kept = 0;
+    for (auto& entry : retired) {
+        if (entry.first < oldestActive) {
+            delete entry.second;
+        } else {
+            retired[kept++] = entry;
+        }
+    }
+    retired.resize(kept);
+}
@@ -0,0 +1,92 @@
+#include "TaskPool.hpp"
+#include <climits>
+
+// Pool and deque index of the worker running on this thread
+static thread_local const TaskPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+// Worker count requested for the shared pool (UINT_MAX until configured)
+static unsigned configuredWorkers = UINT_MAX;
+
+// Starts a pool with the given number of worker threads
+TaskPool::TaskPool(unsigned workers) : queued(0) {
+    for (unsigned i = 0; i <= workers; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (unsigned i = 0; i < workers; ++i) {
+        threads.emplace_back(&TaskPool::workerLoop, this, i);
+    }
+}
+
+// Finishes the queued tasks and joins the workers
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// Sets the worker count of the shared pool
+void TaskPool::configure(unsigned workers) {
+    configuredWorkers = workers;
+}
+
+// Returns the shared pool
+TaskPool& TaskPool::shared() {
+    static TaskPool pool(configuredWorkers != UINT_MAX ? configuredWorkers : std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+// Pushes a task onto the deque of the calling worker, or the shared deque for outside threads
+void TaskPool::push(Task task) {
+    Queue& queue = *queues[currentPool == this ? currentQueue : queues.size() - 1];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the lock orders the increment before a sleeping worker's check
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+// Runs one queued task: the newest of the own deque, or else the oldest of another one
+bool TaskPool::runOne() {
+    if (queued.load(std::memory_order_acquire) == 0) return false;
+    size_t self = currentPool == this ? currentQueue : queues.size() - 1;
+    Task task;
+    for (size_t i = 0; i < queues.size() && !task; ++i) {
+        Queue& queue = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    queued.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+// Loop of a worker thread: run tasks until the pool stops and every deque is empty
+void TaskPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+    while (true) {
+        if (runOne()) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping && queued.load(std::memory_order_acquire) == 0) break;
+        wake.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    }
+}
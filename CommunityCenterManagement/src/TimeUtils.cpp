@@ -0,0 +1,106 @@
+#include "TimeUtils.hpp"
+#include <ctime>
+#include <cstdio>
+
+// Converts a civil date to days since 1970-01-01 (proleptic Gregorian calendar)
+long long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const long long era = (year >= 0 ? year : year - 399) / 400;
+    const long long yearOfEra = year - era * 400;
+    const long long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Converts days since 1970-01-01 to a civil date
+void civilFromDays(long long days, int& year, int& month, int& day) {
+    days += 719468;
+    const long long era = (days >= 0 ? days : days - 146096) / 146097;
+    const long long dayOfEra = days - era * 146097;
+    const long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const long long monthPrime = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * monthPrime + 2) / 5 + 1);
+    month = static_cast<int>(monthPrime < 10 ? monthPrime + 3 : monthPrime - 9);
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+// Returns the number of days in a month
+int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return (month == 2 && leap) ? 29 : days[month - 1];
+}
+
+// Returns the day of the week (0 = Monday ... 6 = Sunday)
+int weekdayFromDays(long long days) {
+    // 1970-01-01 was a Thursday
+    long long weekday = (days + 3) % 7;
+    return static_cast<int>(weekday < 0 ? weekday + 7 : weekday);
+}
+
+// Reads a fixed number of digits starting at position, returning -1 if any is not a digit
+static int readDigits(const std::string& text, size_t position, size_t count) {
+    int value = 0;
+    for (size_t i = position; i < position + count; ++i) {
+        char c = text[i];
+        if (c < '0' || c > '9') return -1;
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+// Parses "YYYY-MM-DD" into days since the epoch
+bool parseDate(const std::string& text, long long& days) {
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-') return false;
+    int year = readDigits(text, 0, 4);
+    int month = readDigits(text, 5, 2);
+    int day = readDigits(text, 8, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return false;
+    days = daysFromCivil(year, month, day);
+    return true;
+}
+
+// Parses "YYYY-MM-DDTHH:MM" into minutes since the epoch
+bool parseTimestamp(const std::string& text, long long& minutes) {
+    long long days;
+    if (text.size() != 16 || text[10] != 'T' || text[13] != ':' || !parseDate(text, days)) return false;
+    int hour = readDigits(text, 11, 2);
+    int minute = readDigits(text, 14, 2);
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
+    minutes = days * kMinutesPerDay + hour * 60 + minute;
+    return true;
+}
+
+// Formats minutes since the epoch as "YYYY-MM-DDTHH:MM"
+std::string formatTimestamp(long long minutes) {
+    long long days = dayOfMinute(minutes);
+    long long minuteOfDay = minutes - days * kMinutesPerDay;
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d", year, month, day,
+                  static_cast<int>(minuteOfDay / 60), static_cast<int>(minuteOfDay % 60));
+    return buffer;
+}
+
+// Formats days since the epoch as "YYYY-MM-DD"
+std::string formatDate(long long days) {
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+    return buffer;
+}
+
+// Returns the day containing the given minute
+long long dayOfMinute(long long minutes) {
+    return minutes >= 0 ? minutes / kMinutesPerDay : -((-minutes + kMinutesPerDay - 1) / kMinutesPerDay);
+}
+
+// Returns the current local time in minutes since the epoch
+long long currentMinutes() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * kMinutesPerDay + local.tm_hour * 60 + local.tm_min;
+}
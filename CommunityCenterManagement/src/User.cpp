@@ -1,18 +1,117 @@
 #include "User.hpp"
 #include "Reservation.hpp"
 #include "Event.hpp"
+#include "Metrics.hpp"
+#include "TimeUtils.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 
+static const int kLoadUsersMetric = Metrics::registerMetric("load_users");
+static const int kSaveUsersMetric = Metrics::registerMetric("save_users");
+
 // Constructor for the User class
 User::User(const std::string& username, const std::string& password, UserType userType)
     : username(username), password(password), userType(userType), weeklyReservationHours(0) {}
 
+// Returns the user's live reservations
+std::vector<Reservation*> User::getUserReservations() const {
+    std::vector<Reservation*> reservations;
+    reservations.reserve(userReservations.size());
+    for (SlotHandle handle : userReservations) {
+        if (Reservation* reservation = Reservation::resolve(handle)) reservations.push_back(reservation);
+    }
+    return reservations;
+}
+
+// Forgets every reservation and the personal calendar
+void User::clearReservations() {
+    userReservations.clear();
+    bookings.clear();
+    furthestBooking.clear();
+}
+
+// Returns the user's reservation for an event, resolving the handles in place
+Reservation* User::findReservation(const std::string& eventName) const {
+    for (SlotHandle handle : userReservations) {
+        Reservation* reservation = Reservation::resolve(handle);
+        if (reservation && reservation->getEvent()->getEventName() == eventName) return reservation;
+    }
+    return nullptr;
+}
+
 // Adds a reservation to the user
 void User::addReservation(Reservation* reservation) {
-    userReservations.push_back(reservation);
+    userReservations.push_back(reservation->getHandle());
+    addBooking(reservation);
+}
+
+// Removes a reservation from the user
+void User::removeReservation(Reservation* reservation) {
+    userReservations.erase(std::remove(userReservations.begin(), userReservations.end(), reservation->getHandle()), userReservations.end());
+    removeBooking(reservation->getHandle());
+}
+
+// Recomputes the furthest-reaching booking of every position from first on
+static void updateFurthest(const std::vector<BookedInterval>& bookings, std::vector<size_t>& furthest, size_t first) {
+    furthest.resize(bookings.size());
+    for (size_t i = first; i < bookings.size(); ++i) {
+        furthest[i] = (i > 0 && bookings[furthest[i - 1]].end >= bookings[i].end) ? furthest[i - 1] : i;
+    }
+}
+
+// Adds the time range of a live reservation to the personal calendar
+void User::addBooking(const Reservation* reservation) {
+    long long start, end;
+    if (reservation->getReservationStatus() == ReservationStatus::Canceled || !parseTimestamp(reservation->getEvent()->getStartTime(), start) ||
+        !parseTimestamp(reservation->getEvent()->getEndTime(), end)) {
+        return;
+    }
+    BookedInterval booking{start, end, reservation->getHandle()};
+    auto position = std::upper_bound(bookings.begin(), bookings.end(), booking,
+                                     [](const BookedInterval& a, const BookedInterval& b) { return a.start < b.start; });
+    size_t index = static_cast<size_t>(position - bookings.begin());
+    bookings.insert(position, booking);
+    updateFurthest(bookings, furthestBooking, index);
+}
+
+// Removes the time range of a reservation from the personal calendar
+void User::removeBooking(SlotHandle reservation) {
+    for (size_t i = 0; i < bookings.size(); ++i) {
+        if (bookings[i].reservation == reservation) {
+            bookings.erase(bookings.begin() + i);
+            updateFurthest(bookings, furthestBooking, i);
+            return;
+        }
+    }
+}
+
+// Updates the personal calendar after a reservation was canceled or its event moved
+void User::refreshBooking(const Reservation* reservation) {
+    removeBooking(reservation->getHandle());
+    addBooking(reservation);
+}
+
+// Returns a live reservation whose event overlaps [start, end)
+Reservation* User::findConflict(long long start, long long end) const {
+    // Only bookings starting before end can overlap; of those, the furthest-reaching one decides
+    auto position = std::lower_bound(bookings.begin(), bookings.end(), end,
+                                     [](const BookedInterval& booking, long long time) { return booking.start < time; });
+    if (position == bookings.begin()) return nullptr;
+    const BookedInterval& furthest = bookings[furthestBooking[position - bookings.begin() - 1]];
+    return furthest.end > start ? Reservation::resolve(furthest.reservation) : nullptr;
+}
+
+// Returns the live reservations whose events start at or after now, in start order
+std::vector<Reservation*> User::getUpcomingReservations(long long now) const {
+    std::vector<Reservation*> upcoming;
+    auto position = std::lower_bound(bookings.begin(), bookings.end(), now,
+                                     [](const BookedInterval& booking, long long time) { return booking.start < time; });
+    for (; position != bookings.end(); ++position) {
+        if (Reservation* reservation = Reservation::resolve(position->reservation)) upcoming.push_back(reservation);
+    }
+    return upcoming;
 }
 
 // Adds reservation hours to the user
@@ -25,21 +124,21 @@ void User::subtractReservationHours(int hours) {
     weeklyReservationHours -= hours;
 }
 
-// Checks if the user has exceeded their weekly reservation limit
-bool User::checkWeeklyLimit(int duration) const {
-    int weeklyLimit = 0;
+// Returns the weekly reservation limit in hours for the user's type
+int User::getWeeklyLimit() const {
     switch (userType) {
         case UserType::City:
-            weeklyLimit = 48;
-            break;
+            return 48;
         case UserType::Organization:
-            weeklyLimit = 36;
-            break;
+            return 36;
         default:
-            weeklyLimit = 24;
-            break;
+            return 24;
     }
-    return (weeklyReservationHours + duration) <= weeklyLimit;
+}
+
+// Checks if the user has exceeded their weekly reservation limit
+bool User::checkWeeklyLimit(int duration) const {
+    return (weeklyReservationHours + duration) <= getWeeklyLimit();
 }
 
 // Logs the user in
@@ -62,32 +161,23 @@ void User::makeReservation() {
     std::cout << "Making reservation for user " << username << "." << std::endl;
 }
 
-// Cancels a reservation for the user
-void User::cancelReservation(int reservationID) {
-    auto it = std::find_if(userReservations.begin(), userReservations.end(),
-        [reservationID](Reservation* res) { return res->getReservationID() == reservationID; });
-
-    if (it != userReservations.end()) {
-        std::cout << "Refund processed for reservation " << reservationID << "." << std::endl;
-        delete *it; // Free the memory
-        userReservations.erase(it); // Remove the pointer from the vector
-        std::cout << "Reservation canceled successfully." << std::endl;
-    } else {
-        std::cout << "Reservation not found or you do not have permission to cancel this reservation." << std::endl;
-    }
-}
-
 // Views the user's reservations
 void User::viewReservations() {
-    if (userReservations.empty()) {
+    const std::vector<Reservation*> reservations = getUserReservations();
+    if (reservations.empty()) {
         std::cout << "No reservations found for user " << username << "." << std::endl;
         return;
     }
-    for (const auto& reservation : userReservations) {
-        if (reservation == nullptr) {
-            std::cout << "Error: Found a null reservation pointer." << std::endl;
-            continue;
+    const std::vector<Reservation*> upcoming = getUpcomingReservations(currentMinutes());
+    if (!upcoming.empty()) {
+        std::cout << "Upcoming:" << std::endl;
+        for (const auto& reservation : upcoming) {
+            std::cout << " - " << reservation->getEvent()->getStartTime() << " to " << reservation->getEvent()->getEndTime() << " "
+                      << reservation->getEvent()->getEventName() << " (reservation " << reservation->getReservationID() << ")" << std::endl;
         }
+        std::cout << std::endl;
+    }
+    for (const auto& reservation : reservations) {
         std::cout << "Reservation ID: " << reservation->getReservationID()
                   << "\nEvent: " << reservation->getEvent()->getEventName()
                   << "\nStatus: " << static_cast<int>(reservation->getReservationStatus())
@@ -155,6 +245,7 @@ void NonResidentUser::specificNonResidentFunction() {
 
 // Loads users from a file
 std::map<std::string, User*> User::loadUsers(const std::string& filename) {
+    ScopedTimer timer(kLoadUsersMetric);
     std::map<std::string, User*> users;
     std::ifstream file(filename);
     if (file.is_open()) {
@@ -189,6 +280,7 @@ std::map<std::string, User*> User::loadUsers(const std::string& filename) {
 
 // Saves users to a file
 void User::saveUsers(const std::string& filename, const std::map<std::string, User*>& users) {
+    ScopedTimer timer(kSaveUsersMetric);
     std::ofstream file(filename);
     if (file.is_open()) {
         for (const auto& pair : users) {
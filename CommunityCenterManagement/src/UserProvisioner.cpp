@@ -0,0 +1,240 @@
+#include "UserProvisioner.hpp"
+#include "Metrics.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+static const int kProvisionUsersMetric = Metrics::registerMetric("provision_users");
+static const char* kUsersFilename = "data/users.txt";
+
+// One parsed input row
+struct ProvisionRow {
+    int lineNumber;
+    std::string username;
+    std::string password;
+    UserType userType = UserType::Resident;
+    std::string rejectReason;  // Empty while the row is still clean
+};
+
+namespace {
+
+// Bloom filter over usernames: 10 bits and 7 probes per name, about 1% false positives
+class UsernameFilter {
+public:
+    explicit UsernameFilter(size_t names) {
+        size_t size = 64;
+        while (size < names * 10) size *= 2;
+        bits.assign(size / 64, 0);
+        mask = size - 1;
+    }
+
+    // Adds a name
+    void add(const std::string& name) {
+        std::uint64_t hash = fnv1a(name);
+        for (std::uint64_t i = 0, probe = hash; i < kProbes; ++i, probe += (hash >> 32) | 1) {
+            bits[(probe & mask) / 64] |= std::uint64_t(1) << (probe % 64);
+        }
+    }
+
+    // Checks if a name may have been added; false means it certainly was not
+    bool mayContain(const std::string& name) const {
+        std::uint64_t hash = fnv1a(name);
+        for (std::uint64_t i = 0, probe = hash; i < kProbes; ++i, probe += (hash >> 32) | 1) {
+            if (!(bits[(probe & mask) / 64] & (std::uint64_t(1) << (probe % 64)))) return false;
+        }
+        return true;
+    }
+
+private:
+    static const std::uint64_t kProbes = 7;
+    std::vector<std::uint64_t> bits;
+    std::uint64_t mask;
+
+    // Hashes a name with 64-bit FNV-1a; the probes step by its upper half (double hashing)
+    static std::uint64_t fnv1a(const std::string& name) {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : name) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+} // namespace
+
+// Splits up to four words off a line on spaces and tabs, returning how many there were (four meaning four or more)
+static size_t splitWords(const std::string& line, std::string (&words)[4]) {
+    size_t count = 0, pos = 0;
+    while (count < 4) {
+        size_t first = line.find_first_not_of(" \t\r", pos);
+        if (first == std::string::npos) break;
+        pos = line.find_first_of(" \t\r", first);
+        words[count++].assign(line, first, pos == std::string::npos ? std::string::npos : pos - first);
+        if (pos == std::string::npos) break;
+    }
+    return count;
+}
+
+// Parses a user type name
+static bool parseUserType(const std::string& text, UserType& userType) {
+    if (text == "City") userType = UserType::City;
+    else if (text == "Organization") userType = UserType::Organization;
+    else if (text == "Resident") userType = UserType::Resident;
+    else if (text == "NonResident") userType = UserType::NonResident;
+    else return false;
+    return true;
+}
+
+// Returns the name of a user type as written to users.txt
+static const char* userTypeName(UserType userType) {
+    switch (userType) {
+        case UserType::City: return "City";
+        case UserType::Organization: return "Organization";
+        case UserType::Resident: return "Resident";
+        case UserType::NonResident: return "NonResident";
+    }
+    return "";
+}
+
+// Creates a user of the given type
+static User* createUser(const ProvisionRow& row) {
+    switch (row.userType) {
+        case UserType::City: return new CityUser(row.username, row.password);
+        case UserType::Organization: return new OrganizationUser(row.username, row.password);
+        case UserType::Resident: return new ResidentUser(row.username, row.password);
+        case UserType::NonResident: return new NonResidentUser(row.username, row.password);
+    }
+    return nullptr;
+}
+
+// Checks if a file is missing, empty or ends with a newline, so appended lines start on a line of their own
+static bool endsWithNewline(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open() || file.tellg() <= 0) return true;
+    file.seekg(-1, std::ios::end);
+    return file.get() == '\n';
+}
+
+// Creates the accounts listed in a file, saves them with one write and writes rejects to reportFilename
+ProvisionResult UserProvisioner::provisionUsers(const std::string& filename, const std::string& reportFilename, std::map<std::string, User*>& users) {
+    ScopedTimer timer(kProvisionUsersMetric);
+    ProvisionResult result;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return result;
+    }
+
+    // Parse every row and apply the checks that need no lookup
+    std::vector<ProvisionRow> rows;
+    std::string line;
+    std::string words[4];
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        ++lineNumber;
+        size_t count = splitWords(line, words);
+        if (count == 0 || words[0][0] == '#') continue;
+        ProvisionRow row;
+        row.lineNumber = lineNumber;
+        row.username = words[0];
+        if (count != 3) {
+            row.rejectReason = "expected username, password and type";
+        } else if (!parseUserType(words[2], row.userType)) {
+            row.rejectReason = "invalid user type " + words[2];
+        } else {
+            row.password = std::move(words[1]);
+        }
+        rows.push_back(std::move(row));
+    }
+    file.close();
+
+    // Sort the rows by username; equal names keep their file order, so the first one wins
+    std::sort(rows.begin(), rows.end(), [](const ProvisionRow& a, const ProvisionRow& b) {
+        int order = a.username.compare(b.username);
+        return order != 0 ? order < 0 : a.lineNumber < b.lineNumber;
+    });
+
+    UsernameFilter filter(users.size());
+    for (const auto& pair : users) {
+        filter.add(pair.first);
+    }
+
+    // Merge the sorted rows against the registry, which std::map keeps sorted too. The registry
+    // cursor only moves for names the filter flags, and never further than the last of them.
+    std::vector<size_t> accepted;
+    accepted.reserve(rows.size());
+    auto existing = users.begin();
+    const ProvisionRow* previous = nullptr;
+    for (size_t index = 0; index < rows.size(); ++index) {
+        ProvisionRow& row = rows[index];
+        if (!row.rejectReason.empty()) continue;
+        if (previous && previous->username == row.username) {
+            row.rejectReason = "duplicate of line " + std::to_string(previous->lineNumber);
+            continue;
+        }
+        previous = &row;
+        if (filter.mayContain(row.username)) {
+            while (existing != users.end() && existing->first < row.username) ++existing;
+            if (existing != users.end() && existing->first == row.username) {
+                row.rejectReason = "username already taken";
+                continue;
+            }
+        }
+        accepted.push_back(index);
+    }
+    result.rejected = static_cast<int>(rows.size() - accepted.size());
+
+    // Insert the new users in one ordered pass, then persist them with a single append
+    if (!accepted.empty()) {
+        std::string lines;
+        auto hint = users.begin();
+        for (size_t index : accepted) {
+            const ProvisionRow& row = rows[index];
+            hint = std::next(users.emplace_hint(hint, row.username, createUser(row)));
+            lines += row.username + " " + row.password + " " + userTypeName(row.userType) + "\n";
+        }
+        bool newline = endsWithNewline(kUsersFilename);
+        std::ofstream out(kUsersFilename, std::ios::app);
+        if (out.is_open()) {
+            if (!newline) out << "\n";
+            out << lines << std::flush;
+        }
+        if (out.is_open() && out.good()) {
+            result.accepted = static_cast<int>(accepted.size());
+            result.committed = true;
+        } else {
+            // The append did not reach the file, so roll the whole batch back
+            for (size_t index : accepted) {
+                auto it = users.find(rows[index].username);
+                delete it->second;
+                users.erase(it);
+            }
+            result.rejected = static_cast<int>(rows.size());
+            for (size_t index : accepted) {
+                rows[index].rejectReason = "not saved";
+            }
+            std::cerr << "Error: Provisioning not committed, " << kUsersFilename << " could not be written." << std::endl;
+        }
+    }
+
+    if (result.rejected > 0) {
+        // The report lists the rejects in file order
+        std::vector<const ProvisionRow*> rejects;
+        for (const ProvisionRow& row : rows) {
+            if (!row.rejectReason.empty()) rejects.push_back(&row);
+        }
+        std::sort(rejects.begin(), rejects.end(), [](const ProvisionRow* a, const ProvisionRow* b) { return a->lineNumber < b->lineNumber; });
+        std::ofstream report(reportFilename);
+        if (report.is_open()) {
+            for (const ProvisionRow* row : rejects) {
+                report << "line " << row->lineNumber << "," << row->username << "," << row->rejectReason << "\n";
+            }
+            report.close();
+        } else {
+            std::cerr << "Error: Unable to open file " << reportFilename << std::endl;
+        }
+    }
+    return result;
+}